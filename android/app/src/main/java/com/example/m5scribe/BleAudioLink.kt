@@ -0,0 +1,176 @@
+package com.example.m5scribe
+
+import android.annotation.SuppressLint
+import android.bluetooth.BluetoothDevice
+import android.bluetooth.BluetoothGatt
+import android.bluetooth.BluetoothGattCallback
+import android.bluetooth.BluetoothGattCharacteristic
+import android.bluetooth.BluetoothGattDescriptor
+import android.bluetooth.BluetoothProfile
+import android.content.Context
+import android.os.Build
+import android.util.Log
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.withTimeout
+import java.io.IOException
+import java.util.UUID
+
+/**
+ * BLE GATT経由の受信路（firmware の TRANSPORT_BLE ビルドと対になる）
+ *
+ * - MTUを最大まで要求し、1通知あたりのペイロードを増やす
+ * - 受信した通知数に応じてクレジットを返し、端末側の送信量を制御する
+ * - 受信したバイト列はSPPと同じリンクフレーム形式なので LinkFrameParser にそのまま渡せる
+ */
+@SuppressLint("MissingPermission")
+class BleAudioLink(
+    private val context: Context,
+    private val device: BluetoothDevice,
+    private val onData: (ByteArray, Int) -> Unit,
+    private val onClosed: () -> Unit
+) {
+    companion object {
+        private const val TAG = "BleAudioLink"
+
+        private val SERVICE_UUID: UUID = UUID.fromString("6e5a0001-5c7b-4d2e-9f3a-4d35536372b1")
+        private val TX_CHAR_UUID: UUID = UUID.fromString("6e5a0002-5c7b-4d2e-9f3a-4d35536372b1")
+        private val RX_CHAR_UUID: UUID = UUID.fromString("6e5a0003-5c7b-4d2e-9f3a-4d35536372b1")
+        private val CCCD_UUID: UUID = UUID.fromString("00002902-0000-1000-8000-00805f9b34fb")
+
+        private const val REQUEST_MTU = 517
+        private const val CREDIT_BATCH = 8          // この数の通知を受け取るごとにクレジットを返す
+        private const val CONNECT_TIMEOUT_MS = 15000L
+    }
+
+    private var gatt: BluetoothGatt? = null
+    private var rxCharacteristic: BluetoothGattCharacteristic? = null
+    private val ready = CompletableDeferred<Unit>()
+    private var pendingCredits = 0
+    @Volatile private var closed = false
+
+    var mtu = 23
+        private set
+
+    suspend fun connect() {
+        gatt = device.connectGatt(context, false, gattCallback, BluetoothDevice.TRANSPORT_LE)
+        try {
+            withTimeout(CONNECT_TIMEOUT_MS) { ready.await() }
+        } catch (e: Exception) {
+            close()
+            throw IOException("BLE connection failed: ${e.message}", e)
+        }
+    }
+
+    fun close() {
+        if (closed) return
+        closed = true
+        gatt?.disconnect()
+        gatt?.close()
+        gatt = null
+    }
+
+    /**
+     * 制御フレームを端末に送る（応答なし書き込み）
+     *
+     * @return GATTがビジーで書き込めなかった場合は false
+     */
+    fun write(frame: ByteArray): Boolean {
+        val g = gatt ?: return false
+        val characteristic = rxCharacteristic ?: return false
+        return if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
+            g.writeCharacteristic(
+                characteristic, frame, BluetoothGattCharacteristic.WRITE_TYPE_NO_RESPONSE
+            ) == BluetoothGatt.GATT_SUCCESS
+        } else {
+            @Suppress("DEPRECATION")
+            characteristic.writeType = BluetoothGattCharacteristic.WRITE_TYPE_NO_RESPONSE
+            @Suppress("DEPRECATION")
+            characteristic.value = frame
+            @Suppress("DEPRECATION")
+            g.writeCharacteristic(characteristic)
+        }
+    }
+
+    private fun onNotification(value: ByteArray) {
+        onData(value, value.size)
+
+        // クレジット返却（書き込めなかった分は次の通知でまとめて返す）
+        pendingCredits++
+        if (pendingCredits >= CREDIT_BATCH) {
+            val args = byteArrayOf((pendingCredits and 0xFF).toByte(), (pendingCredits shr 8).toByte())
+            if (write(LinkFrame.buildControl(LinkFrame.CTRL_CREDIT, args))) {
+                pendingCredits = 0
+            }
+        }
+    }
+
+    private val gattCallback = object : BluetoothGattCallback() {
+        override fun onConnectionStateChange(g: BluetoothGatt, status: Int, newState: Int) {
+            if (newState == BluetoothProfile.STATE_CONNECTED) {
+                Log.d(TAG, "GATT connected, requesting MTU $REQUEST_MTU")
+                g.requestConnectionPriority(BluetoothGatt.CONNECTION_PRIORITY_BALANCED)
+                g.requestMtu(REQUEST_MTU)
+            } else if (newState == BluetoothProfile.STATE_DISCONNECTED) {
+                Log.d(TAG, "GATT disconnected (status=$status)")
+                if (!ready.isCompleted) {
+                    ready.completeExceptionally(IOException("GATT disconnected (status=$status)"))
+                } else if (!closed) {
+                    close()
+                    onClosed()
+                }
+            }
+        }
+
+        override fun onMtuChanged(g: BluetoothGatt, newMtu: Int, status: Int) {
+            mtu = newMtu
+            Log.d(TAG, "MTU negotiated: $newMtu")
+            g.discoverServices()
+        }
+
+        override fun onServicesDiscovered(g: BluetoothGatt, status: Int) {
+            val service = g.getService(SERVICE_UUID)
+            val tx = service?.getCharacteristic(TX_CHAR_UUID)
+            rxCharacteristic = service?.getCharacteristic(RX_CHAR_UUID)
+            if (tx == null || rxCharacteristic == null) {
+                ready.completeExceptionally(IOException("M5Scribe GATT service not found"))
+                return
+            }
+
+            g.setCharacteristicNotification(tx, true)
+            val cccd = tx.getDescriptor(CCCD_UUID)
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
+                g.writeDescriptor(cccd, BluetoothGattDescriptor.ENABLE_NOTIFICATION_VALUE)
+            } else {
+                @Suppress("DEPRECATION")
+                cccd.value = BluetoothGattDescriptor.ENABLE_NOTIFICATION_VALUE
+                @Suppress("DEPRECATION")
+                g.writeDescriptor(cccd)
+            }
+        }
+
+        override fun onDescriptorWrite(g: BluetoothGatt, descriptor: BluetoothGattDescriptor, status: Int) {
+            if (status == BluetoothGatt.GATT_SUCCESS) {
+                ready.complete(Unit)
+            } else {
+                ready.completeExceptionally(IOException("Failed to enable notifications (status=$status)"))
+            }
+        }
+
+        override fun onCharacteristicChanged(
+            g: BluetoothGatt,
+            characteristic: BluetoothGattCharacteristic,
+            value: ByteArray
+        ) {
+            onNotification(value)
+        }
+
+        @Deprecated("Deprecated in Java")
+        @Suppress("DEPRECATION")
+        override fun onCharacteristicChanged(g: BluetoothGatt, characteristic: BluetoothGattCharacteristic) {
+            // API 32 以前
+            if (Build.VERSION.SDK_INT < Build.VERSION_CODES.TIRAMISU) {
+                onNotification(characteristic.value)
+            }
+        }
+    }
+}
@@ -3,23 +3,34 @@ package com.example.m5scribe
 import android.annotation.SuppressLint
 import android.bluetooth.BluetoothDevice
 import android.bluetooth.BluetoothSocket
+import android.content.Context
 import android.media.AudioAttributes
 import android.media.AudioFormat
 import android.media.AudioTrack
+import android.os.SystemClock
 import android.util.Log
+import kotlinx.coroutines.CancellationException
 import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.Job
+import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.isActive
 import java.io.IOException
 import java.io.InputStream
+import java.io.OutputStream
 import java.util.UUID
+import kotlin.random.Random
 
 class BluetoothAudioService(
+    private val context: Context,
     private val device: BluetoothDevice,
     private val onConnectionStateChanged: (Boolean) -> Unit,
     private val onAudioDataReceived: ((ByteArray) -> Unit)? = null,
+    private val onSpeakerChange: (() -> Unit)? = null,
+    private val onReconnecting: ((Boolean) -> Unit)? = null,                // 切断を検出 / 再接続した
+    private val onReconnected: ((reconnectMs: Long, lostMs: Long) -> Unit)? = null,  // 欠落は不明なら -1
+    private val onFormatNegotiated: ((String) -> Unit)? = null,             // 端末と取り決めた形式（セッションに記録）
     private var audioPlaybackEnabled: Boolean = false  // デフォルトはOFF
 ) {
     companion object {
@@ -27,48 +38,108 @@ class BluetoothAudioService(
         // Standard SPP (Serial Port Profile) UUID
         private val SPP_UUID: UUID = UUID.fromString("00001101-0000-1000-8000-00805F9B34FB")
 
-        // Audio configuration matching M5Stack settings
-        private const val SAMPLE_RATE = 16000  // 16kHz to match M5Stack
+        // Audio configuration（サンプルレートは接続時に端末の対応形式から決める）
+        private const val DEFAULT_SAMPLE_RATE = 16000  // 対応形式を返さない端末・音声認識に合わせるレート
         private const val CHANNEL_CONFIG = AudioFormat.CHANNEL_OUT_MONO
         private const val AUDIO_FORMAT = AudioFormat.ENCODING_PCM_16BIT
         private const val BUFFER_SIZE = 2048  // Smaller buffer for lower latency
+
+        private const val STATS_INTERVAL_MS = 10000L
+
+        // 切断されたときのバックグラウンド再接続（ジッター付き指数バックオフ）
+        private const val RECONNECT_BASE_DELAY_MS = 500L
+        private const val RECONNECT_MAX_DELAY_MS = 8000L
+        private const val RECONNECT_GIVE_UP_MS = 60000L   // 端末が再接続を待つ時間（LINK_DISCOVERABLE_MS）
+        // 再開要求（CTRL_RESUME）の応答を待つ時間。対応していない端末ならその間のフレームをそのまま使う
+        private const val RESUME_WAIT_MS = 500L
+        // ウェイクワード待ち: 端末が接続を受け付けるまで試し続ける間隔（失敗 1 回はページのタイムアウトで約 5 秒）
+        private const val STANDBY_RETRY_MS = 1000L
+
+        // 形式の取り決め（CTRL_CAPS → TYPE_CAPS → 計測 → CTRL_SELECT、m5scribed と同じ考え方）
+        private const val PROBE_MS = 3000L      // 今の形式で送信量を測る時間
+        private const val KEEP_UP = 0.95        // 届いた音声 / 実時間がこれ以上なら追いついている
+        private const val HEADROOM = 0.8        // 遅れていたときに使う、測った送信量の割合
+        private const val CPU_BUDGET = 0.05     // 復号に使ってよい CPU（音声 1 秒あたりの秒）
     }
 
     private var bluetoothSocket: BluetoothSocket? = null
     private var inputStream: InputStream? = null
+    private var outputStream: OutputStream? = null
     private var audioTrack: AudioTrack? = null
     private var receiveJob: Job? = null
+    private var bleLink: BleAudioLink? = null
     private var isConnected = false
     private var volumeScale = 0.8f
+    private val scaledBuffer = ShortArray(LinkFrame.MAX_PAYLOAD / 2)
+    private val adpcmBuffer = ByteArray(LinkFrame.MAX_PAYLOAD)
 
-    @SuppressLint("MissingPermission")
-    suspend fun connect() {
-        try {
-            Log.d(TAG, "Connecting to ${device.name} (${device.address})...")
+    // 受信統計（SPP / BLE のスループット比較用）
+    private var statsBytes = 0L
+    private var statsStartTime = 0L
 
-            // Create socket
-            bluetoothSocket = device.createRfcommSocketToServiceRecord(SPP_UUID)
+    // 直近に受信した音声の末尾（サンプル番号、-1 = まだ受け取っていない）
+    private var lastAudioEnd = -1L
 
-            // Connect (this is blocking)
-            bluetoothSocket?.connect()
+    // 再接続（セッション・音声認識・文字起こしは切断中もそのまま）
+    @Volatile private var userClosed = false
+    @Volatile private var reconnecting = false
+    private var reconnectJob: Job? = null
+    private var dropTime = 0L              // 切断を検出した時刻（elapsedRealtime）
+    private var dropAudioEnd = -1L         // 切断前に受け取った音声の末尾
+    private var reconnectMs = 0L
+    private var reconnectAttempts = 0
+    @Volatile private var resumePending = false    // 再接続後の最初の音声を待っている
+    @Volatile private var resumeDeadline = 0L      // 続きのフレームを待つ期限（elapsedRealtime）
+    private val heldFrames = ArrayList<Pair<Long, ByteArray>>()
 
-            if (bluetoothSocket?.isConnected == true) {
-                inputStream = bluetoothSocket?.inputStream
-                isConnected = true
-                onConnectionStateChanged(true)
-                Log.d(TAG, "Connected successfully")
+    // 端末と取り決めた形式（対応形式を返さない端末では 16 kHz の PCM / ADPCM のまま）
+    @Volatile private var sampleRate = DEFAULT_SAMPLE_RATE
+    private var caps: LinkCaps? = null
+    private var targetRate = DEFAULT_SAMPLE_RATE
+    private var frameSamples = 0
+    private var probeStart = 0L          // 計測の開始（elapsedRealtime、0 なら計測していない）
+    private var probeSamples = 0L
+    private var probeBytes = 0L          // 音声フレームのヘッダー込みのバイト数
+    private var linkRate = 0.0           // 最後に測った送信量（B/s）
+    private var selectPending = false    // CTRL_SELECT の結果待ち
+    private var formatSettled = false    // 結果が届いたらもう測らない
+    private val adpcmAffordable by lazy { adpcmDecodeLoad() <= CPU_BUDGET }
+    var audioFormat: String? = null
+        private set
 
-                // Initialize audio playback (only if enabled)
-                if (audioPlaybackEnabled) {
-                    initializeAudioTrack()
-                    Log.d(TAG, "Audio playback is ENABLED")
-                } else {
-                    Log.d(TAG, "Audio playback is DISABLED")
-                }
+    // 端末の遅延計測のチャープ（表示を待っている計測番号と到着時刻、-1 = 待っていない）
+    @Volatile private var chirpNumber = -1
+    @Volatile private var chirpArrival = 0L
 
-                // Start receiving audio data
-                startReceiving()
+    var dropCount = 0
+        private set
+    var totalLostMs = 0L
+        private set
+
+    private val frameParser = LinkFrameParser { type, timestamp, payload, length ->
+        when (type) {
+            LinkFrame.TYPE_AUDIO_PCM16 -> {
+                countProbe(length / 2, length)
+                onAudioFrame(timestamp, payload, length)
+            }
+            // 選んだとき・端末のバッテリーが少ないときは ADPCM（1/4）で届く
+            LinkFrame.TYPE_AUDIO_ADPCM -> {
+                val decoded = ImaAdpcm.decode(payload, length, adpcmBuffer)
+                countProbe(decoded / 2, length)
+                onAudioFrame(timestamp, adpcmBuffer, decoded)
             }
+            LinkFrame.TYPE_MARKER -> handleMarker(timestamp, payload, length)
+            LinkFrame.TYPE_CAPS -> handleCaps(payload, length)
+        }
+    }
+
+    suspend fun connect() {
+        userClosed = false
+        try {
+            Log.d(TAG, "Connecting to ${device.name} (${device.address})...")
+            openLink()
+            onConnected()
+            queryCaps()
         } catch (e: IOException) {
             Log.e(TAG, "Connection failed", e)
             disconnect()
@@ -76,9 +147,187 @@ class BluetoothAudioService(
         }
     }
 
+    /**
+     * 端末が接続を受け付けるまで待ってから接続する（ウェイクワード待ち）
+     *
+     * 端末は待機中は接続を受け付けず、ウェイクワードを検出すると LINK_DISCOVERABLE_MS（60 秒）の間だけ受け付ける。
+     * その間に届くように接続を試し続ける。stopWaiting() / disconnect() でやめる。
+     */
+    suspend fun connectWhenAvailable() {
+        userClosed = false
+        var attempts = 0
+        while (!userClosed) {
+            try {
+                openLink()
+                break
+            } catch (e: CancellationException) {
+                throw e
+            } catch (e: Exception) {
+                closeLink()
+                attempts++
+                delay(STANDBY_RETRY_MS)
+            }
+        }
+        if (userClosed) {
+            closeLink()
+            return
+        }
+        Log.i(TAG, "[standby] device accepted the connection after $attempts attempts")
+        onConnected()
+        queryCaps()
+    }
+
+    /**
+     * ウェイクワード待ちをやめる（接続していないので接続状態は通知しない）
+     */
+    fun stopWaiting() {
+        userClosed = true
+        closeLink()
+    }
+
+    /**
+     * リンクを開いて受信を始める（最初の接続と再接続で共通、転送路は端末の種別で決まる）
+     */
+    @SuppressLint("MissingPermission")
+    private suspend fun openLink() {
+        frameParser.reset()
+
+        if (device.type == BluetoothDevice.DEVICE_TYPE_LE) {
+            // BLE GATT（firmware の TRANSPORT_BLE ビルド）
+            bleLink = BleAudioLink(
+                context = context,
+                device = device,
+                onData = { data, length -> onBytesReceived(data, length) },
+                onClosed = { onLinkLost("GATT disconnected") }
+            )
+            bleLink?.connect()
+            Log.d(TAG, "Connected over BLE (MTU ${bleLink?.mtu})")
+            return
+        }
+
+        // Connect (this is blocking)
+        val socket = device.createRfcommSocketToServiceRecord(SPP_UUID)
+        bluetoothSocket = socket
+        socket.connect()
+        inputStream = socket.inputStream
+        outputStream = socket.outputStream
+        Log.d(TAG, "Connected successfully")
+
+        // Start receiving audio data
+        startReceiving(socket)
+    }
+
+    /**
+     * リンクだけを閉じる（AudioTrack と接続状態の通知はそのまま）
+     */
+    private fun closeLink() {
+        receiveJob?.cancel()
+        receiveJob = null
+        try {
+            bleLink?.close()
+            bleLink = null
+            inputStream?.close()
+            inputStream = null
+            outputStream?.close()
+            outputStream = null
+            bluetoothSocket?.close()
+            bluetoothSocket = null
+        } catch (e: IOException) {
+            Log.e(TAG, "Error closing link", e)
+        }
+    }
+
+    private fun sendControl(frame: ByteArray): Boolean {
+        bleLink?.let { return it.write(frame) }
+        return try {
+            outputStream?.write(frame)
+            outputStream != null
+        } catch (e: IOException) {
+            false
+        }
+    }
+
+    /**
+     * 予期しない切断。セッションは終えずにバックグラウンドで再接続する
+     */
+    private fun onLinkLost(reason: String) {
+        synchronized(this) {
+            if (userClosed || !isConnected || reconnecting) return
+            reconnecting = true
+        }
+        Log.w(TAG, "Link lost ($reason), reconnecting in background")
+        closeLink()
+        dropTime = SystemClock.elapsedRealtime()
+        dropAudioEnd = lastAudioEnd
+        dropCount++
+        onReconnecting?.invoke(true)
+        reconnectJob = CoroutineScope(Dispatchers.IO).launch { reconnectLoop() }
+    }
+
+    private suspend fun reconnectLoop() {
+        var attempt = 0
+        while (!userClosed) {
+            val elapsed = SystemClock.elapsedRealtime() - dropTime
+            if (elapsed >= RECONNECT_GIVE_UP_MS) {
+                Log.w(TAG, "[reconnect] gave up after $attempt attempts (${elapsed} ms)")
+                reconnectJob = null
+                disconnect()
+                return
+            }
+
+            // 上限付きの指数バックオフの後半に一様なジッター（複数端末・再起動直後の集中を避ける）
+            val backoff = minOf(RECONNECT_MAX_DELAY_MS, RECONNECT_BASE_DELAY_MS shl minOf(attempt, 8))
+            delay(backoff / 2 + Random.nextLong(backoff / 2 + 1))
+            attempt++
+            if (userClosed) return
+
+            // 受信はリンクを開いた時点で始まるので、先に再開待ちにしておく
+            resumePending = true
+            resumeDeadline = Long.MAX_VALUE
+            heldFrames.clear()
+            try {
+                openLink()
+            } catch (e: Exception) {
+                Log.d(TAG, "[reconnect] attempt $attempt failed: ${e.message}")
+                closeLink()
+                continue
+            }
+
+            reconnectMs = SystemClock.elapsedRealtime() - dropTime
+            reconnectAttempts = attempt
+            // 受け取った位置から続けてもらう（履歴に残っていれば欠落なし）
+            val args = ByteArray(4) { i -> (dropAudioEnd shr (8 * i)).toByte() }
+            resumeDeadline = if (dropAudioEnd >= 0 && sendControl(LinkFrame.buildControl(LinkFrame.CTRL_RESUME, args))) {
+                SystemClock.elapsedRealtime() + RESUME_WAIT_MS
+            } else {
+                0L
+            }
+            queryCaps()  // 端末は接続ごとに PCM に戻るので選び直す
+            reconnecting = false
+            Log.i(TAG, "[reconnect] link back after $reconnectMs ms ($attempt attempts)")
+            onReconnecting?.invoke(false)
+            return
+        }
+    }
+
+    private fun onConnected() {
+        isConnected = true
+        statsBytes = 0
+        statsStartTime = System.currentTimeMillis()
+        onConnectionStateChanged(true)
+
+        // Initialize audio playback (only if enabled)
+        if (audioPlaybackEnabled) {
+            initializeAudioTrack()
+            Log.d(TAG, "Audio playback is ENABLED")
+        } else {
+            Log.d(TAG, "Audio playback is DISABLED")
+        }
+    }
+
     private fun initializeAudioTrack() {
         val minBufferSize = AudioTrack.getMinBufferSize(
-            SAMPLE_RATE,
+            sampleRate,
             CHANNEL_CONFIG,
             AUDIO_FORMAT
         )
@@ -94,7 +343,7 @@ class BluetoothAudioService(
             )
             .setAudioFormat(
                 AudioFormat.Builder()
-                    .setSampleRate(SAMPLE_RATE)
+                    .setSampleRate(sampleRate)
                     .setChannelMask(CHANNEL_CONFIG)
                     .setEncoding(AUDIO_FORMAT)
                     .build()
@@ -107,33 +356,19 @@ class BluetoothAudioService(
         Log.d(TAG, "AudioTrack initialized (buffer: $bufferSize bytes)")
     }
 
-    private fun startReceiving() {
+    private fun startReceiving(socket: BluetoothSocket) {
+        val stream = socket.inputStream
         receiveJob = CoroutineScope(Dispatchers.IO).launch {
             val buffer = ByteArray(BUFFER_SIZE)
-            val scaledBuffer = ShortArray(BUFFER_SIZE / 2)
 
             Log.d(TAG, "Started receiving audio data")
 
             try {
-                while (isActive && isConnected) {
-                    val bytesRead = inputStream?.read(buffer) ?: -1
+                while (isActive) {
+                    val bytesRead = stream.read(buffer)
 
                     if (bytesRead > 0) {
-                        // 音声認識サービスに生データを渡す（音量調整前）
-                        onAudioDataReceived?.invoke(buffer.copyOf(bytesRead))
-
-                        // AudioTrackが初期化されている場合のみ再生
-                        if (audioPlaybackEnabled && audioTrack != null) {
-                            // Convert bytes to shorts and apply volume
-                            for (i in 0 until bytesRead / 2) {
-                                val sample = ((buffer[i * 2].toInt() and 0xFF) or
-                                             (buffer[i * 2 + 1].toInt() shl 8)).toShort()
-                                scaledBuffer[i] = (sample * volumeScale).toInt().toShort()
-                            }
-
-                            // Write to AudioTrack
-                            audioTrack?.write(scaledBuffer, 0, bytesRead / 2)
-                        }
+                        onBytesReceived(buffer, bytesRead)
                     } else if (bytesRead == -1) {
                         Log.w(TAG, "End of stream reached")
                         break
@@ -143,9 +378,261 @@ class BluetoothAudioService(
                 Log.e(TAG, "Error receiving audio data", e)
             } finally {
                 Log.d(TAG, "Stopped receiving audio data")
-                disconnect()
+                // 閉じたのがこのソケットなら切断（再接続中に開いた新しいリンクは閉じない）
+                if (bluetoothSocket === socket) onLinkLost("SPP stream closed")
+            }
+        }
+    }
+
+    /**
+     * 受信したバイト列をフレームに分解（SPP / BLE 共通）
+     */
+    private fun onBytesReceived(data: ByteArray, length: Int) {
+        frameParser.push(data, length)
+
+        statsBytes += length
+        val now = System.currentTimeMillis()
+        if (now - statsStartTime >= STATS_INTERVAL_MS) {
+            val kbps = statsBytes * 1000.0 / (now - statsStartTime) / 1000.0
+            val link = if (bleLink != null) "BLE" else "SPP"
+            Log.d(TAG, "[link] $link %.1f kB/s, resync=${frameParser.resyncCount}".format(kbps))
+            statsBytes = 0
+            statsStartTime = now
+        }
+        if (probeStart != 0L && SystemClock.elapsedRealtime() - probeStart >= PROBE_MS) finishProbe()
+    }
+
+    /**
+     * 端末の対応形式を問い合わせる（接続・再接続のたび）
+     *
+     * 応答が来たら今の形式で PROBE_MS の間に届いた音声の量を実時間と比べ、追いついていればその送信量、
+     * 遅れていればその HEADROOM 倍を使える帯域とし、復号できる形式のうち音質のよい順に入るものを選ぶ。
+     * 下げた形式でも遅れていれば、もう一度測ってさらに下げる。応答しない端末ではこれまでどおり。
+     */
+    private fun queryCaps() {
+        caps = null
+        probeStart = 0L
+        selectPending = false
+        formatSettled = false
+        if (!sendControl(LinkFrame.buildControl(LinkFrame.CTRL_CAPS))) Log.w(TAG, "[caps] query failed")
+    }
+
+    private fun handleCaps(payload: ByteArray, length: Int) {
+        val c = LinkCaps.parse(payload, length) ?: return
+        val first = caps == null
+        caps = c
+        if (c.sampleRate != sampleRate) {
+            sampleRate = c.sampleRate
+            if (audioTrack != null) {
+                audioTrack?.release()
+                initializeAudioTrack()
             }
         }
+
+        if (!first) {
+            if (!selectPending) return
+            selectPending = false
+            recordFormat()
+            if (!formatSettled) startProbe()
+            return
+        }
+        Log.d(TAG, "[caps] device: modes 0x%02x, rates ${c.rates} Hz, frames ${c.frames} samples, features 0x%04x"
+            .format(c.modes, c.features))
+        // 音声認識に合わせて 16 kHz があればそれ、無ければいちばん高いもの
+        targetRate = if (DEFAULT_SAMPLE_RATE in c.rates) DEFAULT_SAMPLE_RATE else c.rates.maxOrNull() ?: c.sampleRate
+        // フレームは最長（ヘッダーと無線のパケットが最も少ない）
+        frameSamples = c.frames.maxOrNull() ?: c.frameSamples
+        startProbe()
+    }
+
+    private fun startProbe() {
+        probeSamples = 0
+        probeBytes = 0
+        probeStart = SystemClock.elapsedRealtime()
+    }
+
+    private fun countProbe(samples: Int, length: Int) {
+        if (probeStart == 0L) return
+        probeSamples += samples
+        probeBytes += LinkFrame.HEADER_SIZE + length
+    }
+
+    // 計測が終わったら、測った送信量に入る形式を選ぶ
+    private fun finishProbe() {
+        val c = caps ?: return
+        val seconds = (SystemClock.elapsedRealtime() - probeStart) / 1000.0
+        val audioRate = probeSamples / seconds / sampleRate
+        linkRate = probeBytes / seconds
+        probeStart = 0L
+
+        // 受けられる形式（音質のよい順、log-mel は音声にならないので選ばない）
+        val modes = listOf(LinkFrame.MODE_PCM16, LinkFrame.MODE_ADPCM).filter {
+            c.hasMode(it) && (it != LinkFrame.MODE_ADPCM || adpcmAffordable)
+        }
+        if (modes.isEmpty()) return
+        val keptUp = audioRate >= KEEP_UP
+        val budget = if (keptUp) linkRate / KEEP_UP else linkRate * HEADROOM
+        val choice = modes.firstOrNull { bytesPerSecond(it, targetRate, frameSamples) <= budget } ?: modes.last()
+        Log.d(TAG, "[caps] probe: %.2f s audio/s, %.1f kB/s%s -> ${modeName(choice)}"
+            .format(audioRate, linkRate / 1000, if (keptUp) "" else " (falling behind)"))
+
+        // 追いついているか、もう下げられなければこれで決まり
+        formatSettled = keptUp || choice == modes.last()
+        if (choice == c.mode && frameSamples == c.frameSamples && targetRate == c.sampleRate) {
+            formatSettled = true
+            recordFormat()
+            return
+        }
+        val args = byteArrayOf(
+            choice.toByte(),
+            (targetRate and 0xFF).toByte(), (targetRate shr 8).toByte(),
+            (frameSamples and 0xFF).toByte(), (frameSamples shr 8).toByte()
+        )
+        selectPending = sendControl(LinkFrame.buildControl(LinkFrame.CTRL_SELECT, args))
+    }
+
+    private fun recordFormat() {
+        val c = caps ?: return
+        val format = "${modeName(c.mode)} %d Hz, %d ms frames (link %.1f kB/s)"
+            .format(c.sampleRate, c.frameSamples * 1000 / c.sampleRate, linkRate / 1000)
+        audioFormat = format
+        Log.i(TAG, "[caps] streaming $format")
+        onFormatNegotiated?.invoke(format)
+    }
+
+    private fun modeName(mode: Int): String = when (mode) {
+        LinkFrame.MODE_ADPCM -> "ADPCM"
+        LinkFrame.MODE_FEATURES -> "log-mel"
+        else -> "PCM16"
+    }
+
+    // 音声の形式ごとの送信量（ヘッダー込み、B/s）
+    private fun bytesPerSecond(mode: Int, rate: Int, frame: Int): Double {
+        val payload = if (mode == LinkFrame.MODE_ADPCM) ImaAdpcm.HEADER_SIZE + (frame + 1) / 2 else frame * 2
+        return (payload + LinkFrame.HEADER_SIZE).toDouble() * rate / frame
+    }
+
+    // 音声 1 秒分の ADPCM の復号にかかる時間（秒、内容によらないので無音で測る）
+    private fun adpcmDecodeLoad(): Double {
+        val payload = ByteArray(ImaAdpcm.HEADER_SIZE + 512)
+        val out = ByteArray(2048)
+        val start = System.nanoTime()
+        repeat(sampleRate / 1024 + 1) { ImaAdpcm.decode(payload, payload.size, out) }
+        return (System.nanoTime() - start) / 1e9
+    }
+
+    /**
+     * 音声フレーム（PCM / ADPCM 復号後）
+     *
+     * 再接続直後は端末が CTRL_RESUME を処理する前のライブのフレームが先に届くことがあるので、
+     * 切断前の続きのフレームが来るか RESUME_WAIT_MS たつまで取っておく。
+     */
+    private fun onAudioFrame(timestamp: Long, pcm: ByteArray, length: Int) {
+        if (resumePending) {
+            val waiting = SystemClock.elapsedRealtime() < resumeDeadline
+            if (timestamp == dropAudioEnd) {
+                heldFrames.clear()
+                finishResume(timestamp)
+            } else if (waiting) {
+                heldFrames.add(Pair(timestamp, pcm.copyOf(length)))
+                return
+            } else {
+                val held = ArrayList(heldFrames)
+                heldFrames.clear()
+                finishResume(held.firstOrNull()?.first ?: timestamp)
+                for ((t, data) in held) deliverAudio(t, data, data.size)
+            }
+        }
+        deliverAudio(timestamp, pcm, length)
+    }
+
+    // 再接続にかかった時間と、切断で失った音声の長さ
+    private fun finishResume(firstTimestamp: Long) {
+        resumePending = false
+        val lostMs = if (dropAudioEnd < 0 || firstTimestamp < dropAudioEnd) {
+            -1L  // 切断前に音声が無かったか、端末が再起動した
+        } else {
+            (firstTimestamp - dropAudioEnd) * 1000 / sampleRate
+        }
+        if (lostMs > 0) totalLostMs += lostMs
+        val detail = when {
+            lostMs < 0 -> "audio position unknown"
+            lostMs == 0L -> "no audio lost (resumed)"
+            else -> "lost $lostMs ms of audio"
+        }
+        Log.i(TAG, "[reconnect] drop #$dropCount: back in $reconnectMs ms after $reconnectAttempts attempts, " +
+                "$detail (total lost ${totalLostMs} ms)")
+        onReconnected?.invoke(reconnectMs, lostMs)
+    }
+
+    private fun deliverAudio(timestamp: Long, pcm: ByteArray, length: Int) {
+        lastAudioEnd = timestamp + length / 2
+        handleAudio(pcm, length)
+    }
+
+    private fun handleAudio(payload: ByteArray, length: Int) {
+        // 音声認識サービスに生データを渡す（音量調整前）
+        onAudioDataReceived?.invoke(payload.copyOf(length))
+
+        // AudioTrackが初期化されている場合のみ再生
+        if (audioPlaybackEnabled && audioTrack != null) {
+            // Convert bytes to shorts and apply volume
+            for (i in 0 until length / 2) {
+                val sample = ((payload[i * 2].toInt() and 0xFF) or
+                             (payload[i * 2 + 1].toInt() shl 8)).toShort()
+                scaledBuffer[i] = (sample * volumeScale).toInt().toShort()
+            }
+
+            // Write to AudioTrack
+            audioTrack?.write(scaledBuffer, 0, length / 2)
+        }
+    }
+
+    /**
+     * 端末が検出した境界マーカー
+     *
+     * 話者交代は検出に約1.5秒かかるため、境界は受信済み音声より少し前の位置になる。
+     */
+    private fun handleMarker(timestamp: Long, payload: ByteArray, length: Int) {
+        if (length < 1) return
+        when (payload[0].toInt() and 0xFF) {
+            LinkFrame.MARKER_SPEAKER_CHANGE -> {
+                val lagMs = (lastAudioEnd - timestamp) * 1000 / sampleRate
+                Log.d(TAG, "Speaker change at sample $timestamp (${lagMs} ms behind live)")
+                onSpeakerChange?.invoke()
+            }
+            LinkFrame.MARKER_CHIRP -> if (length >= 6) handleChirp(payload)
+        }
+    }
+
+    /**
+     * 端末の遅延計測のチャープ（-DLATENCY_PROBE=1 のビルド）
+     *
+     * 到着をすぐ返して端末に往復を測らせ、次に文字起こしを表示したとき（onTranscriptShown）に表示までの時間を返す。
+     */
+    private fun handleChirp(payload: ByteArray) {
+        fun u16(i: Int) = (payload[i].toInt() and 0xFF) or ((payload[i + 1].toInt() and 0xFF) shl 8)
+        val number = payload[1].toInt() and 0xFF
+        sendControl(LinkFrame.buildControl(LinkFrame.CTRL_CHIRP_ACK,
+            byteArrayOf(number.toByte(), LinkFrame.CHIRP_ARRIVED.toByte())))
+        chirpArrival = SystemClock.elapsedRealtime()
+        chirpNumber = number
+        Log.i(TAG, "[latency] chirp #$number: speaker->capture %.1f ms, capture->send ${u16(4)} ms"
+            .format(u16(2) * 1000.0 / sampleRate))
+    }
+
+    /**
+     * 文字起こし（部分結果を含む）を画面に出したときに呼ぶ
+     */
+    fun onTranscriptShown() {
+        val number = chirpNumber
+        if (number < 0) return
+        chirpNumber = -1
+        val shownMs = (SystemClock.elapsedRealtime() - chirpArrival).coerceAtMost(0xFFFF)
+        Log.i(TAG, "[latency] chirp #$number: transcript shown $shownMs ms after arrival")
+        val args = byteArrayOf(number.toByte(), LinkFrame.CHIRP_SHOWN.toByte(),
+            (shownMs and 0xFF).toByte(), (shownMs shr 8).toByte())
+        CoroutineScope(Dispatchers.IO).launch { sendControl(LinkFrame.buildControl(LinkFrame.CTRL_CHIRP_ACK, args)) }
     }
 
     fun setVolume(volume: Float) {
@@ -154,20 +641,18 @@ class BluetoothAudioService(
     }
 
     fun disconnect() {
+        userClosed = true
         isConnected = false
-        receiveJob?.cancel()
+        reconnecting = false
+        reconnectJob?.cancel()
+        reconnectJob = null
+        closeLink()
 
         try {
             audioTrack?.stop()
             audioTrack?.release()
             audioTrack = null
 
-            inputStream?.close()
-            inputStream = null
-
-            bluetoothSocket?.close()
-            bluetoothSocket = null
-
             onConnectionStateChanged(false)
             Log.d(TAG, "Disconnected")
         } catch (e: IOException) {
@@ -0,0 +1,53 @@
+package com.example.m5scribe
+
+/**
+ * IMA-ADPCM の復号（firmware の src/adpcm.h と同じ形式）
+ *
+ * [0-1] フレーム先頭の予測値（int16 LE）
+ * [2]   ステップ番号
+ * [3]   予約
+ * [4..] 4bit コード（1バイトに2サンプル、下位ニブルが先）
+ */
+object ImaAdpcm {
+    const val HEADER_SIZE = 4
+
+    private val STEP_TABLE = intArrayOf(
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+        253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+        1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+        3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+        11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+        32767
+    )
+
+    private val INDEX_TABLE = intArrayOf(-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8)
+
+    /**
+     * 16bit LE PCM として out に書き込み、書き込んだバイト数を返す
+     */
+    fun decode(payload: ByteArray, length: Int, out: ByteArray): Int {
+        if (length < HEADER_SIZE) return 0
+
+        var predictor = ((payload[0].toInt() and 0xFF) or (payload[1].toInt() shl 8))
+        var index = (payload[2].toInt() and 0xFF).coerceAtMost(88)
+
+        val samples = minOf((length - HEADER_SIZE) * 2, out.size / 2)
+        for (i in 0 until samples) {
+            val b = payload[HEADER_SIZE + i / 2].toInt()
+            val code = if (i and 1 == 0) b and 0x0F else (b shr 4) and 0x0F
+
+            val step = STEP_TABLE[index]
+            var diff = step shr 3
+            if (code and 4 != 0) diff += step
+            if (code and 2 != 0) diff += step shr 1
+            if (code and 1 != 0) diff += step shr 2
+            predictor = (if (code and 8 != 0) predictor - diff else predictor + diff).coerceIn(-32768, 32767)
+            index = (index + INDEX_TABLE[code]).coerceIn(0, 88)
+
+            out[i * 2] = (predictor and 0xFF).toByte()
+            out[i * 2 + 1] = (predictor shr 8).toByte()
+        }
+        return samples * 2
+    }
+}
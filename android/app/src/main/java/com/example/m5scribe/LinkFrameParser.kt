@@ -0,0 +1,161 @@
+package com.example.m5scribe
+
+/**
+ * M5Stackとのリンクフレーム形式（firmware の src/link_frame.h と同じ）
+ *
+ * [0-1] 同期ワード 'M' '5'
+ * [2]   種別
+ * [3]   フラグ
+ * [4-5] ペイロード長（LE）
+ * [6-7] シーケンス番号（LE）
+ * [8-11] タイムスタンプ（キャプチャ開始からのサンプル番号、LE）
+ */
+object LinkFrame {
+    const val SYNC0 = 0x4D
+    const val SYNC1 = 0x35
+    const val HEADER_SIZE = 12
+    const val MAX_PAYLOAD = 4096
+
+    const val TYPE_AUDIO_PCM16 = 0x01
+    const val TYPE_MARKER = 0x03
+    const val TYPE_AUDIO_ADPCM = 0x04
+    const val TYPE_CAPS = 0x08       // 端末の対応形式と現在の設定（LinkCaps）
+    const val TYPE_CONTROL = 0x10
+
+    const val CTRL_CREDIT = 0x01
+    const val CTRL_RESUME = 0x06     // 再接続後、このサンプル番号から続けてもらう（uint32 LE）
+    const val CTRL_CAPS = 0x07       // 対応形式の問い合わせ
+    const val CTRL_SELECT = 0x08     // 形式の選択（[1] 送信内容, [2-3] サンプルレート, [4-5] フレームのサンプル数）
+    const val CTRL_CHIRP_ACK = 0x09  // 遅延計測のチャープの応答（[1] 計測番号, [2] 段階, [3-4] 到着から表示まで ms）
+
+    // 送信内容（LinkStreamMode）
+    const val MODE_PCM16 = 0
+    const val MODE_FEATURES = 1
+    const val MODE_ADPCM = 2
+
+    const val MARKER_SPEAKER_CHANGE = 0x01
+    const val MARKER_CHIRP = 0x02    // 遅延計測（[1] 計測番号, [2-3] 鳴らしてからキャプチャまでのサンプル数, [4-5] 送信まで ms）
+
+    // CTRL_CHIRP_ACK の段階
+    const val CHIRP_ARRIVED = 0
+    const val CHIRP_SHOWN = 1
+
+    /**
+     * 受信側 → M5Stack の制御フレームを組み立てる
+     */
+    fun buildControl(command: Int, args: ByteArray = ByteArray(0)): ByteArray {
+        val length = 1 + args.size
+        val frame = ByteArray(HEADER_SIZE + length)
+        frame[0] = SYNC0.toByte()
+        frame[1] = SYNC1.toByte()
+        frame[2] = TYPE_CONTROL.toByte()
+        frame[4] = (length and 0xFF).toByte()
+        frame[5] = (length shr 8).toByte()
+        frame[HEADER_SIZE] = command.toByte()
+        args.copyInto(frame, HEADER_SIZE + 1)
+        return frame
+    }
+}
+
+/**
+ * 端末の対応形式（TYPE_CAPS のペイロード、firmware の LinkCaps と同じ）
+ *
+ * mode / sampleRate / frameSamples は現在の設定、modes は送れる送信内容（1 shl MODE_*）
+ */
+data class LinkCaps(
+    val mode: Int,
+    val sampleRate: Int,
+    val frameSamples: Int,
+    val modes: Int,
+    val features: Int,
+    val rates: List<Int>,
+    val frames: List<Int>
+) {
+    fun hasMode(mode: Int): Boolean = modes and (1 shl mode) != 0
+
+    companion object {
+        fun parse(p: ByteArray, length: Int): LinkCaps? {
+            fun u16(i: Int) = (p[i].toInt() and 0xFF) or ((p[i + 1].toInt() and 0xFF) shl 8)
+            if (length < 10 || u16(2) == 0 || u16(4) == 0) return null
+            var n = 9
+            val rateCount = p[n++].toInt() and 0xFF
+            if (length < n + 2 * rateCount + 1) return null
+            val rates = List(rateCount) { u16(n + 2 * it) }
+            n += 2 * rateCount
+            val frameCount = p[n++].toInt() and 0xFF
+            if (length < n + 2 * frameCount) return null
+            val frames = List(frameCount) { u16(n + 2 * it) }
+            return LinkCaps(p[1].toInt() and 0xFF, u16(2), u16(4), p[6].toInt() and 0xFF, u16(7), rates, frames)
+        }
+    }
+}
+
+/**
+ * バイトストリームからリンクフレームを切り出す
+ *
+ * SPPは境界のないストリーム、BLEはMTU単位の通知なので、どちらも push() に流し込む。
+ */
+class LinkFrameParser(
+    private val onFrame: (type: Int, timestamp: Long, payload: ByteArray, length: Int) -> Unit
+) {
+    private val header = ByteArray(LinkFrame.HEADER_SIZE)
+    private val payload = ByteArray(LinkFrame.MAX_PAYLOAD)
+    private var received = 0
+    private var type = 0
+    private var length = 0
+    private var timestamp = 0L
+
+    var resyncCount = 0
+        private set
+
+    fun reset() {
+        received = 0
+    }
+
+    fun push(data: ByteArray, count: Int) {
+        var i = 0
+        while (i < count) {
+            if (received < LinkFrame.HEADER_SIZE) {
+                val b = data[i].toInt() and 0xFF
+                i++
+                // 同期ワードの確認
+                if ((received == 0 && b != LinkFrame.SYNC0) || (received == 1 && b != LinkFrame.SYNC1)) {
+                    received = if (b == LinkFrame.SYNC0) 1 else 0
+                    resyncCount++
+                    continue
+                }
+                header[received++] = b.toByte()
+
+                if (received == LinkFrame.HEADER_SIZE) {
+                    type = header[2].toInt() and 0xFF
+                    length = (header[4].toInt() and 0xFF) or ((header[5].toInt() and 0xFF) shl 8)
+                    timestamp = (header[8].toLong() and 0xFF) or
+                            ((header[9].toLong() and 0xFF) shl 8) or
+                            ((header[10].toLong() and 0xFF) shl 16) or
+                            ((header[11].toLong() and 0xFF) shl 24)
+
+                    if (length > LinkFrame.MAX_PAYLOAD) {
+                        received = 0
+                        resyncCount++
+                    } else if (length == 0) {
+                        onFrame(type, timestamp, payload, 0)
+                        received = 0
+                    }
+                }
+                continue
+            }
+
+            // ペイロード（まとめてコピー）
+            val offset = received - LinkFrame.HEADER_SIZE
+            val n = minOf(length - offset, count - i)
+            data.copyInto(payload, offset, i, i + n)
+            received += n
+            i += n
+
+            if (offset + n == length) {
+                onFrame(type, timestamp, payload, length)
+                received = 0
+            }
+        }
+    }
+}
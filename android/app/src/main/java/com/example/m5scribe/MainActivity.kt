@@ -43,8 +43,17 @@ class MainActivity : AppCompatActivity() {
     private lateinit var sessionRepository: SessionRepository
     private var currentSessionId: Int? = null
     private var currentSessionStartTime: String? = null
+    private var currentAudioFormat: String? = null   // 端末と取り決めた形式（BluetoothAudioService）
     private var isReceiverRegistered = false
 
+    // 話者交代（端末のマーカー）で区切るターン番号
+    private var turnNumber = 1
+    private var turnBoundaryPending = false
+
+    // ウェイクワード待ち（切断後も、端末が接続を受け付けたら自動で接続する）
+    @Volatile private var standbyActive = false
+    private var userDisconnected = false      // アプリで切断したら待たない
+
     // BroadcastReceiver for receiving transcription results from service and disconnect requests
     private val transcriptionReceiver = object : BroadcastReceiver() {
         override fun onReceive(context: Context?, intent: Intent?) {
@@ -55,6 +64,7 @@ class MainActivity : AppCompatActivity() {
                     Log.d("MainActivity", "Partial result received: $text")
                     runOnUiThread {
                         updatePartialTranscription(text)
+                        if (text.isNotBlank()) bluetoothService?.onTranscriptShown()
                     }
                 }
                 "com.example.m5scribe.FINAL_RESULT" -> {
@@ -62,6 +72,7 @@ class MainActivity : AppCompatActivity() {
                     Log.d("MainActivity", "Final result received: $text")
                     runOnUiThread {
                         appendTranscription(text)
+                        if (text.isNotBlank()) bluetoothService?.onTranscriptShown()
                     }
                 }
                 "com.example.m5scribe.DISCONNECT_REQUEST" -> {
@@ -256,8 +267,14 @@ class MainActivity : AppCompatActivity() {
     }
 
     @SuppressLint("MissingPermission")
-    private fun connectToDevice(device: BluetoothDevice) {
-        binding.statusText.text = getString(R.string.status_connecting)
+    private fun connectToDevice(device: BluetoothDevice, standby: Boolean = false) {
+        if (standby) {
+            binding.statusText.text = getString(R.string.status_standby, device.name ?: device.address)
+        } else {
+            stopStandby()
+            userDisconnected = false
+            binding.statusText.text = getString(R.string.status_connecting)
+        }
         binding.statusText.setTextColor(getColor(android.R.color.holo_orange_dark))
 
         // IOスレッドで接続処理を実行（UIスレッドをブロックしない）
@@ -267,17 +284,21 @@ class MainActivity : AppCompatActivity() {
                 val audioPlaybackEnabled = getAudioPlaybackSetting()
                 Log.d("MainActivity", "Audio playback enabled: $audioPlaybackEnabled")
 
-                withContext(Dispatchers.Main) {
-                    Toast.makeText(this@MainActivity,
-                        if (audioPlaybackEnabled) "音声再生: ON" else "音声再生: OFF（マイクのみで認識）",
-                        Toast.LENGTH_SHORT).show()
+                if (!standby) {
+                    withContext(Dispatchers.Main) {
+                        Toast.makeText(this@MainActivity,
+                            if (audioPlaybackEnabled) "音声再生: ON" else "音声再生: OFF（マイクのみで認識）",
+                            Toast.LENGTH_SHORT).show()
+                    }
                 }
 
                 bluetoothService = BluetoothAudioService(
+                    context = this@MainActivity,
                     device = device,
                     onConnectionStateChanged = { connected ->
                         runOnUiThread {
                             if (connected) {
+                                standbyActive = false
                                 binding.statusText.text = getString(R.string.status_connected, device.name)
                                 binding.statusText.setTextColor(getColor(android.R.color.holo_green_dark))
                                 Toast.makeText(this@MainActivity, R.string.toast_connected, Toast.LENGTH_SHORT).show()
@@ -326,19 +347,62 @@ class MainActivity : AppCompatActivity() {
                                 // 再接続ボタンを表示する
                                 binding.reconnectButton.visibility = android.view.View.VISIBLE
                                 binding.reconnectButton.isEnabled = true
+
+                                // 端末のウェイクワードで接続を受け付けたら自動で接続する
+                                if (!userDisconnected) startStandby(device)
                             }
                         }
                     },
                     onAudioDataReceived = null,  // マイクベースの認識では使用しない
+                    onSpeakerChange = {
+                        // 次の確定結果から新しいターンとして表示
+                        runOnUiThread { turnBoundaryPending = true }
+                    },
+                    onReconnecting = { reconnecting ->
+                        // 切断中もセッション・文字起こしは続ける（端末の再接続を裏で待つ）
+                        runOnUiThread {
+                            if (reconnecting) {
+                                binding.statusText.text = getString(R.string.status_reconnecting, device.name)
+                                binding.statusText.setTextColor(getColor(android.R.color.holo_orange_dark))
+                            } else {
+                                binding.statusText.text = getString(R.string.status_connected, device.name)
+                                binding.statusText.setTextColor(getColor(android.R.color.holo_green_dark))
+                            }
+                        }
+                    },
+                    onReconnected = { reconnectMs, lostMs ->
+                        runOnUiThread {
+                            val message = if (lostMs >= 0) {
+                                getString(R.string.toast_reconnected_lost, reconnectMs / 1000.0, lostMs / 1000.0)
+                            } else {
+                                getString(R.string.toast_reconnected, reconnectMs / 1000.0)
+                            }
+                            Toast.makeText(this@MainActivity, message, Toast.LENGTH_SHORT).show()
+                        }
+                    },
+                    onFormatNegotiated = { format ->
+                        runOnUiThread {
+                            currentAudioFormat = format
+                            updateCurrentSession()
+                        }
+                    },
                     audioPlaybackEnabled = audioPlaybackEnabled  // 設定から読み込んだ値
                 )
 
                 // Bluetooth接続（ブロッキング処理だがIOスレッドで実行）
-                bluetoothService?.connect()
+                if (standby) {
+                    bluetoothService?.connectWhenAvailable()
+                } else {
+                    bluetoothService?.connect()
+                }
             } catch (e: Exception) {
                 withContext(Dispatchers.Main) {
-                    binding.statusText.text = getString(R.string.status_disconnected)
-                    binding.statusText.setTextColor(getColor(android.R.color.holo_red_dark))
+                    // 端末が接続を受け付けていなければウェイクワード待ちに入る
+                    if (!userDisconnected) startStandby(device)
+                    if (!standbyActive) {
+                        binding.statusText.text = getString(R.string.status_disconnected)
+                        binding.statusText.setTextColor(getColor(android.R.color.holo_red_dark))
+                    }
                     Toast.makeText(this@MainActivity, getString(R.string.toast_connection_failed, e.message), Toast.LENGTH_LONG).show()
 
                     // 接続失敗時に再接続ボタンを表示
@@ -349,7 +413,30 @@ class MainActivity : AppCompatActivity() {
         }
     }
 
+    /**
+     * ウェイクワード待ちを始める
+     *
+     * 端末は待機中は接続を受け付けず、ウェイクワードを検出したときだけ接続モードに入るので、
+     * 最後に接続した端末への接続を裏で試し続ける（BluetoothAudioService.connectWhenAvailable）。
+     */
+    private fun startStandby(device: BluetoothDevice) {
+        if (standbyActive) return
+        standbyActive = true
+        Log.d("MainActivity", "Waiting for ${device.address} to accept a connection (wake word)")
+        connectToDevice(device, standby = true)
+    }
+
+    private fun stopStandby() {
+        if (!standbyActive) return
+        standbyActive = false
+        val service = bluetoothService
+        bluetoothService = null
+        CoroutineScope(Dispatchers.IO).launch { service?.stopWaiting() }
+    }
+
     private fun disconnectFromDevice() {
+        userDisconnected = true
+        stopStandby()
         stopTranscription()
         endCurrentSession()
 
@@ -378,9 +465,12 @@ class MainActivity : AppCompatActivity() {
 
         currentSessionId = sessionRepository.getNextSessionId()
         currentSessionStartTime = timeFormat.format(now)
+        currentAudioFormat = null
 
         // 文字起こし内容をクリア
         transcriptionBuilder.clear()
+        turnNumber = 1
+        turnBoundaryPending = false
         binding.transcriptionText.text = getString(R.string.transcription_placeholder)
         binding.partialResultText.text = getString(R.string.partial_result_placeholder)
 
@@ -480,8 +570,17 @@ class MainActivity : AppCompatActivity() {
             if (transcriptionBuilder.isNotEmpty()) {
                 transcriptionBuilder.append("\n")
             }
+            // 話者交代の後は新しいターンの番号を付ける
+            val line = if (turnBoundaryPending) {
+                turnBoundaryPending = false
+                turnNumber++
+                getString(R.string.turn_label, turnNumber) + " " + text
+            } else {
+                text
+            }
+
             // タイムスタンプを横に表示（タブで区切り）
-            transcriptionBuilder.append("$timestamp\t$text")
+            transcriptionBuilder.append("$timestamp\t$line")
 
             // 確定結果のみを表示
             binding.transcriptionText.text = transcriptionBuilder.toString()
@@ -536,7 +635,8 @@ class MainActivity : AppCompatActivity() {
             startTime = startTime,
             endTime = timeFormat.format(now),
             transcription = transcriptionText,
-            summary = null
+            summary = null,
+            audioFormat = currentAudioFormat
         )
 
         // ファイルI/Oを非同期で実行
@@ -835,6 +935,8 @@ class MainActivity : AppCompatActivity() {
 
     override fun onDestroy() {
         super.onDestroy()
+        userDisconnected = true
+        standbyActive = false
 
         // 文字起こしサービスを停止
         stopTranscription()
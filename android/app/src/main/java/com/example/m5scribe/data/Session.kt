@@ -14,7 +14,8 @@ data class Session(
     val startTime: String,          // 開始時刻（HH:mm:ss形式）
     val endTime: String,            // 終了時刻（HH:mm:ss形式）
     val transcription: String,      // 文字起こし全文（タイムスタンプ付き）
-    val summary: String? = null     // LLMによる要約（nullの場合は未要約）
+    val summary: String? = null,    // LLMによる要約（nullの場合は未要約）
+    val audioFormat: String? = null // 端末と取り決めた音声の形式（例: "PCM16 16000 Hz, 64 ms frames (link 32.1 kB/s)"）
 ) {
     /**
      * セッションの所要時間を分単位で計算
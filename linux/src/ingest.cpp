@@ -0,0 +1,216 @@
+/**
+ * 受信路の実装
+ */
+#include "ingest.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if HAVE_BLUEZ
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/rfcomm.h>
+#endif
+
+static bool startsWith(const char* s, const char* prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+bool ingestParse(IngestSource& src, const char* spec) {
+    if (startsWith(spec, "rfcomm:")) {
+        src.kind = INGEST_RFCOMM;
+        src.target = spec + 7;
+        size_t slash = src.target.find('/');
+        if (slash != std::string::npos) {
+            src.port = atoi(src.target.c_str() + slash + 1);
+            src.target.resize(slash);
+        }
+        return src.target.size() == 17;
+    }
+    if (startsWith(spec, "tty:")) {
+        src.kind = INGEST_TTY;
+        src.target = spec + 4;
+        return !src.target.empty();
+    }
+    if (strcmp(spec, "pty") == 0) {
+        src.kind = INGEST_PTY;
+        return true;
+    }
+    if (startsWith(spec, "tcp-listen:")) {
+        src.kind = INGEST_TCP_LISTEN;
+        src.port = atoi(spec + 11);
+        return src.port > 0;
+    }
+    if (startsWith(spec, "tcp:")) {
+        src.kind = INGEST_TCP_CONNECT;
+        src.target = spec + 4;
+        size_t colon = src.target.rfind(':');
+        if (colon == std::string::npos) return false;
+        src.port = atoi(src.target.c_str() + colon + 1);
+        src.target.resize(colon);
+        return src.port > 0;
+    }
+    return false;
+}
+
+// バイナリをそのまま通すよう端末設定を raw にする
+static void makeRaw(int fd) {
+    termios t;
+    if (tcgetattr(fd, &t) == 0) {
+        cfmakeraw(&t);
+        tcsetattr(fd, TCSANOW, &t);
+    }
+}
+
+static int openRfcomm(IngestSource& src) {
+#if HAVE_BLUEZ
+    int fd = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+    if (fd < 0) {
+        perror("socket(RFCOMM)");
+        return -1;
+    }
+
+    sockaddr_rc addr = {};
+    addr.rc_family = AF_BLUETOOTH;
+    addr.rc_channel = (uint8_t)src.port;
+    str2ba(src.target.c_str(), &addr.rc_bdaddr);
+
+    fprintf(stderr, "[ingest] connecting RFCOMM %s channel %d\n", src.target.c_str(), src.port);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror("connect(RFCOMM)");
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    (void)src;
+    fprintf(stderr, "[ingest] built without BlueZ; use tty:/dev/rfcommN after 'rfcomm bind'\n");
+    return -1;
+#endif
+}
+
+static int openTty(IngestSource& src) {
+    int fd = open(src.target.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(src.target.c_str());
+        return -1;
+    }
+    makeRaw(fd);
+    return fd;
+}
+
+static int openPty(IngestSource& src) {
+    if (src.fd >= 0) return src.fd;
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        if (master >= 0) close(master);
+        return -1;
+    }
+
+    const char* slaveName = ptsname(master);
+    src.ptySlaveFd = open(slaveName, O_RDWR | O_NOCTTY);
+    if (src.ptySlaveFd >= 0) makeRaw(src.ptySlaveFd);
+    makeRaw(master);
+
+    src.target = slaveName;
+    fprintf(stderr, "[ingest] pty ready: write the device stream to %s\n", slaveName);
+    return master;
+}
+
+static int openTcpConnect(IngestSource& src) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    char port[16];
+    snprintf(port, sizeof(port), "%d", src.port);
+    if (getaddrinfo(src.target.c_str(), port, &hints, &res) != 0) {
+        fprintf(stderr, "[ingest] cannot resolve %s\n", src.target.c_str());
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) perror("connect(TCP)");
+    return fd;
+}
+
+static int openTcpListen(IngestSource& src) {
+    if (src.listenFd < 0) {
+        src.listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (src.listenFd < 0) {
+            perror("socket");
+            return -1;
+        }
+        int one = 1;
+        setsockopt(src.listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(src.port);
+        if (bind(src.listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(src.listenFd, 1) != 0) {
+            perror("bind/listen");
+            close(src.listenFd);
+            src.listenFd = -1;
+            return -1;
+        }
+        fprintf(stderr, "[ingest] listening on TCP port %d\n", src.port);
+    }
+
+    int fd = accept(src.listenFd, nullptr, nullptr);
+    if (fd < 0) perror("accept");
+    return fd;
+}
+
+int ingestOpen(IngestSource& src) {
+    int fd = -1;
+    switch (src.kind) {
+        case INGEST_RFCOMM:      fd = openRfcomm(src); break;
+        case INGEST_TTY:         fd = openTty(src); break;
+        case INGEST_PTY:         fd = openPty(src); break;
+        case INGEST_TCP_CONNECT: fd = openTcpConnect(src); break;
+        case INGEST_TCP_LISTEN:  fd = openTcpListen(src); break;
+    }
+
+    if (fd >= 0 && (src.kind == INGEST_TCP_CONNECT || src.kind == INGEST_TCP_LISTEN)) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    src.fd = fd;
+    return fd;
+}
+
+void ingestCloseConnection(IngestSource& src) {
+    if (src.kind == INGEST_PTY) return;
+    if (src.fd >= 0) close(src.fd);
+    src.fd = -1;
+}
+
+bool ingestReconnectable(const IngestSource& src) {
+    return src.kind != INGEST_PTY;
+}
+
+void ingestShutdown(IngestSource& src) {
+    if (src.fd >= 0) close(src.fd);
+    if (src.listenFd >= 0) close(src.listenFd);
+    if (src.ptySlaveFd >= 0) close(src.ptySlaveFd);
+    src.fd = src.listenFd = src.ptySlaveFd = -1;
+}
@@ -0,0 +1,42 @@
+/**
+ * 受信路（デバイス → m5scribed）
+ *
+ *   rfcomm:AA:BB:CC:DD:EE:FF[/channel]  BlueZ RFCOMM ソケットで接続（HAVE_BLUEZ ビルドのみ）
+ *   tty:/dev/rfcomm0                    rfcomm bind 済みのデバイスファイルなど
+ *   pty                                 擬似端末を作成して slave 側のパスを表示（テスト用）
+ *   tcp:HOST:PORT                       TCP 接続（テスト用）
+ *   tcp-listen:PORT                     TCP 待ち受け（テスト用）
+ */
+#pragma once
+
+#include <string>
+
+enum IngestKind {
+    INGEST_RFCOMM,
+    INGEST_TTY,
+    INGEST_PTY,
+    INGEST_TCP_CONNECT,
+    INGEST_TCP_LISTEN,
+};
+
+struct IngestSource {
+    IngestKind kind = INGEST_PTY;
+    std::string target;      // アドレス／パス／ホスト
+    int port = 1;            // RFCOMM チャンネル／TCP ポート
+    int fd = -1;             // 現在の接続
+    int listenFd = -1;       // tcp-listen の待ち受けソケット
+    int ptySlaveFd = -1;     // pty の slave 側（閉じると master が EIO になるので保持）
+};
+
+bool ingestParse(IngestSource& src, const char* spec);
+
+// 接続できるまでブロックし、読み出し用 fd を返す（失敗時 -1）
+int ingestOpen(IngestSource& src);
+
+// 現在の接続だけ閉じる（待ち受けソケットや pty は残す）
+void ingestCloseConnection(IngestSource& src);
+
+// 再接続に意味がある種別か（pty は同じ fd を読み続ける。tty は閉じて開き直す）
+bool ingestReconnectable(const IngestSource& src);
+
+void ingestShutdown(IngestSource& src);
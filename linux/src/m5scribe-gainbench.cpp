@@ -0,0 +1,126 @@
+/**
+ * m5scribe-gainbench - 小さな声に利得を掛けたときの 16bit / 32bit 処理の比較
+ *
+ * WAV（16kHz / 16bit / モノラル）を「遠くの話者」として -A dB に下げてから量子化し、
+ * 端末で +A dB の利得を掛けて元の音量に戻したときの SNR（元の WAV に対する誤差）を比べる。
+ *   int16    : 16bit で取り込み、16bit のまま利得（従来の経路で後段に利得を足した場合）
+ *   wide     : 16bit で取り込み、32bit で利得、送信時に TPDF ディザ（-DCAPTURE_WIDE=1、wide_gain.cpp）
+ *   wide-24  : 24bit で取り込めた場合の wide（PDM の間引きを 24bit で出せるハードウェア向けの参考値）
+ * あわせてホストでの 1 サンプルあたりの処理時間と、履歴 1 秒あたりのメモリを出力する。
+ *
+ * 例: m5scribe-gainbench -a 30 testset/quiet1.wav testset/quiet2.wav
+ */
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "wav_sink.h"
+#include "wide_gain.h"
+
+#define SAMPLE_RATE 16000
+
+enum Path { PATH_INT16, PATH_WIDE, PATH_WIDE24, PATH_COUNT };
+static const char* pathNames[PATH_COUNT] = { "int16", "wide", "wide-24" };
+
+struct PathTotals {
+    double signal = 0;
+    double noise = 0;
+    double seconds = 0;
+};
+
+static double nowSec() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int16_t sat16(double v) {
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+static void runPath(Path path, const std::vector<int16_t>& clean, double atten, float gainDb,
+                    PathTotals& totals) {
+    size_t n = clean.size();
+    std::vector<int16_t> out(n);
+
+    // 取り込み（ここまではハードウェア側なので計時しない）
+    std::vector<int16_t> captured16(n);
+    std::vector<int32_t> wide(n);
+    for (size_t i = 0; i < n; i++) {
+        double quiet = clean[i] * atten;
+        captured16[i] = sat16(lrint(quiet));
+        if (path == PATH_WIDE24) {
+            wide[i] = (int32_t)lrint(quiet * 256.0) * 256;    // 24bit 精度
+        }
+    }
+
+    double start = nowSec();
+    if (path == PATH_INT16) {
+        int32_t gainQ12 = (int32_t)lrintf(powf(10.0f, gainDb / 20.0f) * 4096.0f);
+        for (size_t i = 0; i < n; i++) {
+            int32_t v = (captured16[i] * gainQ12 + 2048) >> 12;
+            out[i] = v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+        }
+    } else {
+        if (path == PATH_WIDE) wideFromInt16(captured16.data(), wide.data(), n);
+        WideGain g;
+        wideGainInit(g, gainDb, false);
+        TpdfDither d;
+        wideGainProcess(g, wide.data(), n);
+        wideToInt16Dither(d, wide.data(), out.data(), n);
+    }
+    totals.seconds += nowSec() - start;
+
+    for (size_t i = 0; i < n; i++) {
+        double e = (double)out[i] - clean[i];
+        totals.signal += (double)clean[i] * clean[i];
+        totals.noise += e * e;
+    }
+}
+
+int main(int argc, char** argv) {
+    float attenDb = 30.0f;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:h")) != -1) {
+        switch (opt) {
+            case 'a': attenDb = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-a DB] FILE.wav...\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-a DB] FILE.wav...\n", argv[0]);
+        return 2;
+    }
+
+    double atten = pow(10.0, -attenDb / 20.0);
+    PathTotals totals[PATH_COUNT];
+    uint64_t samples = 0;
+
+    for (int i = optind; i < argc; i++) {
+        std::vector<int16_t> clean;
+        if (!wavReadFile(argv[i], SAMPLE_RATE, clean)) {
+            fprintf(stderr, "skip %s\n", argv[i]);
+            continue;
+        }
+        for (int p = 0; p < PATH_COUNT; p++) runPath((Path)p, clean, atten, attenDb, totals[p]);
+        samples += clean.size();
+    }
+    if (samples == 0) return 1;
+
+    printf("talker at -%.0f dB, +%.0f dB gain, %.1f s of audio\n", attenDb, attenDb, (double)samples / SAMPLE_RATE);
+    printf("%-8s %9s %12s %14s\n", "path", "SNR dB", "ns/sample", "history B/s");
+    for (int p = 0; p < PATH_COUNT; p++) {
+        const PathTotals& t = totals[p];
+        printf("%-8s %9.2f %12.2f %14d\n", pathNames[p], 10.0 * log10(t.signal / t.noise),
+               t.seconds * 1e9 / samples, SAMPLE_RATE * (p == PATH_INT16 ? 2 : 4));
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * m5scribe-kernelcheck - 基本演算（audio_kernels）のビット一致確認
+ *
+ * PIE 版と同じ分割・累算幅で書いた lane-model を、シードを変えた試験ベクトルで scalar と照合し、
+ * 間引きフィルタの出力も両者で比べる。不一致があれば終了コード 1。
+ * ホストでの処理時間も出力する（PIE の実測は CoreS3 の env で行う）。
+ *
+ * 例: m5scribe-kernelcheck -s 200
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "audio_kernels.h"
+
+static uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 同じ入力を scalar / lane-model の dot で間引き、出力を比べる
+static bool checkDecimator(uint32_t factor, uint32_t numTaps) {
+    static Decimator a, b;
+    static int16_t in[DECIMATOR_MAX_BLOCK];
+    static int16_t outA[DECIMATOR_MAX_BLOCK], outB[DECIMATOR_MAX_BLOCK];
+    if (!decimatorInit(a, factor, numTaps) || !decimatorInit(b, factor, numTaps)) return false;
+
+    uint32_t state = factor * 1000 + numTaps;
+    bool ok = true;
+    // ブロック長を変えて窓の位置と境界のずれを一巡させる
+    for (int round = 0; round < 200 && ok; round++) {
+        size_t n = 1 + (round * 37) % DECIMATOR_MAX_BLOCK;
+        for (size_t i = 0; i < n; i++) {
+            state = state * 1664525u + 1013904223u;
+            in[i] = (int16_t)(state >> 16);
+        }
+        audioKernels = &audioKernelsScalar();
+        size_t na = decimatorProcess(a, in, n, outA);
+        audioKernels = &audioKernelsLaneModel();
+        size_t nb = decimatorProcess(b, in, n, outB);
+        ok = na == nb && memcmp(outA, outB, na * 2) == 0;
+    }
+    audioKernels = &audioKernelsScalar();
+    return ok;
+}
+
+static void printBench(const AudioKernels& kernels) {
+    AudioKernelsBench b;
+    audioKernelsBench(kernels, nowNs, 2000, b);
+    printf("%-12s %8.2f %8.2f %8.2f %10.2f\n", kernels.name, b.meterNs, b.dotNs, b.gainNs, b.decimateNs);
+}
+
+int main(int argc, char** argv) {
+    uint32_t seeds = 100;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:h")) != -1) {
+        switch (opt) {
+            case 's': seeds = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-s SEEDS]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    uint32_t mismatches = 0;
+    const char* firstFailure = nullptr;
+    for (uint32_t seed = 1; seed <= seeds; seed++) {
+        const char* failed = nullptr;
+        mismatches += audioKernelsSelfTest(audioKernelsLaneModel(), seed, &failed);
+        if (failed && !firstFailure) firstFailure = failed;
+    }
+    printf("lane-model vs scalar: %u seeds, %u mismatches%s%s\n", seeds, mismatches,
+           firstFailure ? ", first in " : "", firstFailure ? firstFailure : "");
+
+    bool decimatorOk = true;
+    static const uint32_t configs[][2] = { { 2, 16 }, { 3, 32 }, { 3, 64 }, { 6, 48 } };
+    for (auto& c : configs) {
+        bool ok = checkDecimator(c[0], c[1]);
+        printf("decimator /%u, %u taps: %s\n", c[0], c[1], ok ? "bit-exact" : "MISMATCH");
+        decimatorOk = decimatorOk && ok;
+    }
+
+    printf("\n%-12s %8s %8s %8s %10s  (ns per sample, host)\n", "kernels", "meter", "dot", "gain", "decimate/3");
+    printBench(audioKernelsScalar());
+    printBench(audioKernelsLaneModel());
+
+    return mismatches == 0 && decimatorOk ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/**
+ * m5scribe-melbench - 特徴量送信モードと PCM 送信の比較
+ *
+ * テストセットの WAV（16kHz / 16bit / モノラル）ごとに、端末と同じフロントエンド
+ * （mel_frontend.cpp / feature_codec.cpp）で log-mel を計算して 8bit 量子化し、
+ *   - リンク上のバイト数（ヘッダー込み、PCM 送信との比）
+ *   - 量子化誤差（dB）
+ *   - ホストでの計算時間
+ * を出力する。-o を指定すると量子化前後の特徴量を float32 [frames][80] で書き出すので、
+ * 同じ ASR に通して認識精度を比較できる。
+ *
+ * 例: m5scribe-melbench -o out testset/a.wav testset/b.wav
+ */
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "feature_codec.h"
+#include "link_frame.h"
+#include "mel_frontend.h"
+#include "wav_sink.h"
+
+#define PCM_FRAME_SAMPLES 1024   // 端末の PCM 送信 1 フレームのサンプル数（DATA_SIZE / 2）
+
+struct BenchResult {
+    uint64_t samples = 0;
+    uint64_t frames = 0;
+    uint64_t pcmBytes = 0;
+    uint64_t featureBytes = 0;
+    double errorSquared = 0.0;   // dB^2
+    double errorMax = 0.0;
+    double computeSec = 0.0;
+};
+
+struct Collector {
+    std::vector<float> frames;
+};
+
+static void onFrame(const float* logMel, uint32_t, void* context) {
+    Collector* c = (Collector*)context;
+    c->frames.insert(c->frames.end(), logMel, logMel + FEATURE_NUM_MELS);
+}
+
+static double nowSec() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void writeFeatures(const std::string& path, const std::vector<float>& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path.c_str());
+        return;
+    }
+    fwrite(data.data(), sizeof(float), data.size(), f);
+    fclose(f);
+}
+
+static void printResult(const char* name, const BenchResult& r) {
+    double seconds = (double)r.samples / FEATURE_SAMPLE_RATE;
+    printf("%-32s %7.1f s  PCM %6.2f kB/s  mel %5.2f kB/s (x%.1f)  err rms %.3f dB max %.2f dB  "
+           "host %.1f us/frame\n",
+           name, seconds,
+           r.pcmBytes / seconds / 1000.0,
+           r.featureBytes / seconds / 1000.0,
+           (double)r.pcmBytes / r.featureBytes,
+           sqrt(r.errorSquared / (r.frames * FEATURE_NUM_MELS)),
+           r.errorMax,
+           r.computeSec * 1e6 / r.frames);
+}
+
+int main(int argc, char** argv) {
+    const char* outDir = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:h")) != -1) {
+        switch (opt) {
+            case 'o': outDir = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-o OUT_DIR] FILE.wav...\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-o OUT_DIR] FILE.wav...\n", argv[0]);
+        return 2;
+    }
+
+    MelFrontend fe;
+    if (!melFrontendInit(fe, featureFrontendConfig())) return 1;
+
+    const double dbPerNat = 10.0 / log(10.0);
+    BenchResult total;
+
+    for (int i = optind; i < argc; i++) {
+        std::vector<int16_t> pcm;
+        if (!wavReadFile(argv[i], FEATURE_SAMPLE_RATE, pcm)) {
+            fprintf(stderr, "skip %s (need 16 kHz / 16 bit / mono PCM)\n", argv[i]);
+            continue;
+        }
+
+        BenchResult r;
+        Collector ref;
+        double start = nowSec();
+        melFrontendReset(fe, 0);
+        melFrontendPush(fe, pcm.data(), pcm.size(), 0, onFrame, &ref);
+
+        // 端末と同じバッチ単位で量子化して戻す
+        std::vector<float> decoded(ref.frames.size());
+        uint8_t payload[FEATURE_MAX_PAYLOAD];
+        size_t totalFrames = ref.frames.size() / FEATURE_NUM_MELS;
+        for (size_t f = 0; f < totalFrames; f += FEATURE_BATCH_FRAMES) {
+            int n = (int)(totalFrames - f < FEATURE_BATCH_FRAMES ? totalFrames - f : FEATURE_BATCH_FRAMES);
+            size_t length = featureBatchEncode(&ref.frames[f * FEATURE_NUM_MELS], n, FEATURE_NUM_MELS,
+                                               FEATURE_HOP_LENGTH, payload);
+            FeatureBatchInfo info;
+            featureBatchDecode(payload, length, &decoded[f * FEATURE_NUM_MELS],
+                               (size_t)n * FEATURE_NUM_MELS, info);
+            r.featureBytes += LINK_FRAME_HEADER_SIZE + length;
+        }
+        r.computeSec = nowSec() - start;
+
+        r.samples = pcm.size();
+        r.frames = totalFrames;
+        r.pcmBytes = (pcm.size() + PCM_FRAME_SAMPLES - 1) / PCM_FRAME_SAMPLES * LINK_FRAME_HEADER_SIZE +
+                     pcm.size() * 2;
+        for (size_t k = 0; k < ref.frames.size(); k++) {
+            double e = fabs(decoded[k] - ref.frames[k]) * dbPerNat;
+            r.errorSquared += e * e;
+            if (e > r.errorMax) r.errorMax = e;
+        }
+        if (r.frames == 0) continue;
+
+        const char* base = strrchr(argv[i], '/');
+        base = base ? base + 1 : argv[i];
+        printResult(base, r);
+
+        if (outDir) {
+            std::string stem = std::string(outDir) + "/" + base;
+            if (stem.size() > 4 && stem.compare(stem.size() - 4, 4, ".wav") == 0) stem.resize(stem.size() - 4);
+            writeFeatures(stem + ".ref.f32", ref.frames);
+            writeFeatures(stem + ".q8.f32", decoded);
+        }
+
+        total.samples += r.samples;
+        total.frames += r.frames;
+        total.pcmBytes += r.pcmBytes;
+        total.featureBytes += r.featureBytes;
+        total.errorSquared += r.errorSquared;
+        if (r.errorMax > total.errorMax) total.errorMax = r.errorMax;
+        total.computeSec += r.computeSec;
+    }
+
+    if (total.frames > 0) printResult("TOTAL", total);
+    melFrontendFree(fe);
+    return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * m5scribe-otacheck - 差分ファームウェア（tools/mkdelta.py）を端末と同じ手順で適用して確かめる
+ *
+ * ota_delta.cpp で old.bin に update.m5d を適用し、new.bin と一致するかを調べる。
+ *   - 差分を一度に渡す場合と、ランダムな大きさ（1-4096 バイト）に分けて渡す場合（受信チャンク境界の確認）
+ *   - 途中で切れた差分が完了扱いにならないこと、壊れた命令がエラーになること
+ * 元の読み出し・新の書き込みの回数とバイト数も出力する（実機のフラッシュ読み書き量の目安）。
+ *
+ * 例: m5scribe-otacheck old/firmware.bin .pio/build/m5stack-core2/firmware.bin update.m5d
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "ota_delta.h"
+
+struct HostImage {
+    const std::vector<uint8_t>* source;
+    std::vector<uint8_t> target;
+    uint32_t reads = 0;
+    uint64_t readBytes = 0;
+    uint32_t writes = 0;
+    bool outOfOrder = false;
+};
+
+static bool readSource(void* context, uint32_t offset, uint8_t* out, size_t length) {
+    HostImage& img = *(HostImage*)context;
+    if ((size_t)offset + length > img.source->size()) return false;
+    memcpy(out, img.source->data() + offset, length);
+    img.reads++;
+    img.readBytes += length;
+    return true;
+}
+
+static bool writeTarget(void* context, uint32_t offset, const uint8_t* data, size_t length) {
+    HostImage& img = *(HostImage*)context;
+    // 端末は先頭から順に書く前提で消去しているので、飛びがあれば誤り
+    if (offset != img.target.size()) img.outOfOrder = true;
+    if (offset + length > img.target.size()) img.target.resize(offset + length);
+    memcpy(img.target.data() + offset, data, length);
+    img.writes++;
+    return true;
+}
+
+static bool checkSource(void* context, const OtaDeltaInfo& info) {
+    HostImage& img = *(HostImage*)context;
+    return info.sourceSize == img.source->size();
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+// chunkMax = 0 なら一度に渡す
+static bool apply(const std::vector<uint8_t>& source, const std::vector<uint8_t>& delta, size_t length,
+                  size_t chunkMax, HostImage& img, OtaDeltaApplier& a) {
+    img.source = &source;
+    OtaDeltaIo io = { &img, readSource, writeTarget, checkSource };
+    otaDeltaBegin(a, io);
+
+    size_t pos = 0;
+    while (pos < length) {
+        size_t n = chunkMax == 0 ? length - pos : 1 + (size_t)rand() % chunkMax;
+        if (n > length - pos) n = length - pos;
+        if (!otaDeltaPush(a, delta.data() + pos, n)) return false;
+        pos += n;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = 1;
+    int rounds = 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:h")) != -1) {
+        switch (opt) {
+            case 's': seed = (unsigned)atoi(optarg); break;
+            case 'r': rounds = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-s SEED] [-r ROUNDS] OLD.bin NEW.bin UPDATE.m5d\n", argv[0]);
+                return 2;
+        }
+    }
+    if (argc - optind != 3) {
+        fprintf(stderr, "usage: %s [-s SEED] [-r ROUNDS] OLD.bin NEW.bin UPDATE.m5d\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> source, expected, delta;
+    if (!readFile(argv[optind], source) || !readFile(argv[optind + 1], expected) ||
+        !readFile(argv[optind + 2], delta)) {
+        fprintf(stderr, "cannot read input files\n");
+        return 1;
+    }
+    srand(seed);
+    int failures = 0;
+
+    // 一度に適用
+    {
+        HostImage img;
+        OtaDeltaApplier a;
+        bool ok = apply(source, delta, delta.size(), 0, img, a);
+        bool match = ok && otaDeltaFinished(a) && img.target == expected && !img.outOfOrder;
+        printf("whole      : %s (%zu -> %zu bytes, delta %zu bytes = %.1f%%, %u source reads / %llu bytes, %u writes)\n",
+               match ? "ok" : "FAIL", source.size(), img.target.size(), delta.size(),
+               100.0 * delta.size() / expected.size(), img.reads, (unsigned long long)img.readBytes, img.writes);
+        if (!ok) printf("             error: %s\n", otaDeltaErrorName(a.error));
+        if (!match) failures++;
+    }
+
+    // 受信チャンクの境界をずらして適用
+    int chunkFailures = 0;
+    for (int r = 0; r < rounds; r++) {
+        HostImage img;
+        OtaDeltaApplier a;
+        bool ok = apply(source, delta, delta.size(), 4096, img, a);
+        if (!ok || !otaDeltaFinished(a) || img.target != expected || img.outOfOrder) chunkFailures++;
+    }
+    printf("chunked    : %s (%d rounds, chunks of 1-4096 bytes)\n", chunkFailures == 0 ? "ok" : "FAIL", rounds);
+    failures += chunkFailures;
+
+    // 途中で切れた差分
+    {
+        HostImage img;
+        OtaDeltaApplier a;
+        bool ok = apply(source, delta, delta.size() - 1, 0, img, a);
+        bool pass = ok && !otaDeltaFinished(a);
+        printf("truncated  : %s\n", pass ? "ok (not finished)" : "FAIL");
+        if (!pass) failures++;
+    }
+
+    // 壊れた命令（最初の命令を未知の番号に）
+    if (delta.size() > OTA_DELTA_HEADER_SIZE) {
+        std::vector<uint8_t> broken = delta;
+        broken[OTA_DELTA_HEADER_SIZE] = 0x7F;
+        HostImage img;
+        OtaDeltaApplier a;
+        bool ok = apply(source, broken, broken.size(), 0, img, a);
+        bool pass = !ok && a.error == OTA_DELTA_ERR_FORMAT;
+        printf("bad op     : %s\n", pass ? "ok (rejected)" : "FAIL");
+        if (!pass) failures++;
+    }
+
+    // 別の元イメージ
+    {
+        std::vector<uint8_t> other(source.begin(), source.end() - (source.size() > 1 ? 1 : 0));
+        HostImage img;
+        OtaDeltaApplier a;
+        bool ok = apply(other, delta, delta.size(), 0, img, a);
+        bool pass = !ok && a.error == OTA_DELTA_ERR_SOURCE;
+        printf("wrong base : %s\n", pass ? "ok (rejected)" : "FAIL");
+        if (!pass) failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,347 @@
+/**
+ * m5scribe-qualitybench - 前処理・コーデック・レート変換の音質と CPU コストの比較
+ *
+ * WAV（16kHz / 16bit / モノラル）のコーパスを、端末と同じソース（dsp_pipeline.h・audio_kernels・adpcm・wide_gain）で
+ * 組んだ設定ごとに通し、元の音声に対する客観指標（quality_metrics.h の SNR・segSNR・LSD・STOI 推定）と
+ * 端末側の処理の 1 サンプルあたりのサイクル数（perf_event が使えなければ時間だけ）、リンクの送信量を出力する。
+ * 受信側の処理（ADPCM の復号、8kHz からの補間）は計時しない。
+ *
+ * 送信量・CPU・音質（-m の指標）の 3 つで他の設定に負けていないものを pareto とし、
+ * -o DIR で DIR/m5scribe-quality-<コミット>.csv に書き出す（コミットごとに並べて散布図にする）。
+ *
+ * 例: m5scribe-qualitybench -o bench testset/a.wav testset/b.wav
+ */
+#include <getopt.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "adpcm.h"
+#include "audio_kernels.h"
+#include "dsp_pipeline.h"
+#include "link_frame.h"
+#include "quality_metrics.h"
+#include "wav_sink.h"
+#include "wide_gain.h"
+
+#define SAMPLE_RATE      16000
+#define BLOCK_SAMPLES    256     // キャプチャの 1 ブロック（CAPTURE_BLOCK_SAMPLES）
+#define FRAME_MS         64      // 送信の 1 フレーム（端末の既定）
+#define DECIMATOR_TAPS   32
+#define INTERP_TAPS      48      // 受信側の 8kHz → 16kHz 補間（偶数なので半サンプル遅れ、間引きと合わせて整数になる）
+#define ADPCM_FRAME      512     // 8kHz でも割り切れる長さ（状態はフレームをまたいで続く）
+#define MAX_DELAY        128     // 揃えるときに探すずれ
+
+// 端末側の処理の時間とサイクル数
+struct DeviceCost {
+    uint64_t ns = 0;
+    uint64_t cycles = 0;
+    uint64_t startNs = 0;
+    uint64_t startCycles = 0;
+};
+
+static int cycleFd = -1;
+
+static uint64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// このスレッドのユーザー空間のサイクル数（使えなければ -1 のまま）
+static void openCycleCounter() {
+    perf_event_attr pe = {};
+    pe.type = PERF_TYPE_HARDWARE;
+    pe.size = sizeof(pe);
+    pe.config = PERF_COUNT_HW_CPU_CYCLES;
+    pe.exclude_kernel = 1;
+    pe.exclude_hv = 1;
+    cycleFd = syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+}
+
+static uint64_t readCycles() {
+    uint64_t v = 0;
+    if (cycleFd >= 0 && read(cycleFd, &v, sizeof(v)) != sizeof(v)) v = 0;
+    return v;
+}
+
+static void costBegin(DeviceCost& c) {
+    c.startCycles = readCycles();
+    c.startNs = nowNs();
+}
+
+static void costEnd(DeviceCost& c) {
+    c.ns += nowNs() - c.startNs;
+    c.cycles += readCycles() - c.startCycles;
+}
+
+// 処理の 1 段（x をその場で置き換える、端末側の分だけ cost に数える）
+typedef void (*Step)(std::vector<int16_t>& x, DeviceCost& cost);
+
+template <typename Chain>
+static void stepPipeline(std::vector<int16_t>& x, DeviceCost& cost) {
+    Chain chain;
+    costBegin(cost);
+    for (size_t i = 0; i + Chain::frameSize <= x.size(); i += Chain::frameSize) chain.process(&x[i]);
+    costEnd(cost);
+}
+
+using DcChain = dsp::Pipeline<SAMPLE_RATE, BLOCK_SAMPLES, dsp::DcBlock>;
+using DcHighPassChain = dsp::Pipeline<SAMPLE_RATE, BLOCK_SAMPLES, dsp::DcBlock, dsp::HighPass<80>>;
+
+// audio_kernels の Q14 双二次（80Hz ハイパス）
+static void stepBiquad(std::vector<int16_t>& x, DeviceCost& cost) {
+    Biquad bq;
+    biquadInitHighPass(bq, SAMPLE_RATE, 80.0f);
+    costBegin(cost);
+    for (size_t i = 0; i < x.size(); i += BLOCK_SAMPLES) biquadProcess(bq, &x[i], &x[i], BLOCK_SAMPLES);
+    costEnd(cost);
+}
+
+// 32bit の履歴（利得 0dB）から TPDF ディザで 16bit に戻す（-DCAPTURE_WIDE=1）
+static void stepWide(std::vector<int16_t>& x, DeviceCost& cost) {
+    std::vector<int32_t> wide(BLOCK_SAMPLES);
+    WideGain g;
+    wideGainInit(g, 0.0f, false);
+    TpdfDither d;
+    costBegin(cost);
+    for (size_t i = 0; i < x.size(); i += BLOCK_SAMPLES) {
+        wideFromInt16(&x[i], wide.data(), BLOCK_SAMPLES);
+        wideGainProcess(g, wide.data(), BLOCK_SAMPLES);
+        wideToInt16Dither(d, wide.data(), &x[i], BLOCK_SAMPLES);
+    }
+    costEnd(cost);
+}
+
+// 送信フレームごとに符号化（端末）して復号（受信側）
+static void stepAdpcm(std::vector<int16_t>& x, DeviceCost& cost) {
+    size_t frame = ADPCM_FRAME;
+    std::vector<uint8_t> encoded(adpcmEncodedSize(frame));
+    std::vector<std::vector<uint8_t>> frames;
+    AdpcmState state;
+    costBegin(cost);
+    for (size_t i = 0; i + frame <= x.size(); i += frame) {
+        size_t length = adpcmEncode(state, &x[i], frame, encoded.data());
+        frames.emplace_back(encoded.begin(), encoded.begin() + length);
+    }
+    costEnd(cost);
+    for (size_t f = 0; f < frames.size(); f++) {
+        adpcmDecode(frames[f].data(), frames[f].size(), &x[f * frame], frame);
+    }
+}
+
+// 8kHz に間引く（端末、audio_kernels の Decimator）
+static void stepDown2(std::vector<int16_t>& x, DeviceCost& cost) {
+    static Decimator d;
+    decimatorInit(d, 2, DECIMATOR_TAPS);
+    std::vector<int16_t> out(x.size() / 2 + 16);
+    size_t n = 0;
+    costBegin(cost);
+    for (size_t i = 0; i < x.size(); i += BLOCK_SAMPLES) n += decimatorProcess(d, &x[i], BLOCK_SAMPLES, &out[n]);
+    costEnd(cost);
+    out.resize(n);
+    x.swap(out);
+}
+
+// 16kHz に戻す（受信側、ゼロを挟んで窓付き sinc で補間）
+static void stepUp2(std::vector<int16_t>& x, DeviceCost&) {
+    static float taps[INTERP_TAPS];
+    for (int i = 0; i < INTERP_TAPS; i++) {
+        double t = i - (INTERP_TAPS - 1) / 2.0;
+        double sinc = t == 0 ? 1.0 : sin(M_PI * t / 2) / (M_PI * t / 2);
+        double hann = 0.5 - 0.5 * cos(2 * M_PI * (i + 0.5) / INTERP_TAPS);
+        taps[i] = (float)(sinc * hann);
+    }
+    std::vector<int16_t> out(x.size() * 2);
+    for (size_t n = 0; n < out.size(); n++) {
+        float acc = 0;
+        for (int k = 0; k < INTERP_TAPS; k++) {
+            long m = (long)n - k;
+            if (m >= 0 && (m & 1) == 0) acc += taps[k] * x[m / 2];
+        }
+        out[n] = (int16_t)fmaxf(-32768.0f, fminf(32767.0f, lrintf(acc)));
+    }
+    x.swap(out);
+}
+
+struct Config {
+    const char* name;
+    std::vector<Step> steps;
+    uint32_t linkRate;       // 送るサンプルレート
+    bool adpcm;
+};
+
+static const std::vector<Config> configs = {
+    { "pcm",            {},                                                    16000, false },
+    { "dc",             { stepPipeline<DcChain> },                             16000, false },
+    { "dc-hp80",        { stepPipeline<DcHighPassChain> },                     16000, false },
+    { "biquad-hp80",    { stepBiquad },                                        16000, false },
+    { "wide-dither",    { stepWide },                                          16000, false },
+    { "adpcm",          { stepAdpcm },                                         16000, true },
+    { "dc-hp80-adpcm",  { stepPipeline<DcHighPassChain>, stepAdpcm },          16000, true },
+    { "8k",             { stepDown2, stepUp2 },                                8000,  false },
+    { "8k-adpcm",       { stepDown2, stepAdpcm, stepUp2 },                     8000,  true },
+};
+
+// リンクの送信量（FRAME_MS ごとのフレーム、ヘッダー込み）
+static double linkBytesPerSecond(const Config& c) {
+    size_t samples = c.linkRate * FRAME_MS / 1000;
+    size_t payload = c.adpcm ? adpcmEncodedSize(samples) : samples * 2;
+    return (double)(payload + LINK_FRAME_HEADER_SIZE) * 1000 / FRAME_MS;
+}
+
+struct ConfigTotals {
+    DeviceCost cost;
+    QualityTotals quality;
+    QualityResult result = {};
+    double costPerSample = 0;   // サイクル（数えられなければ ns）
+    bool pareto = false;
+};
+
+static void runConfig(const Config& c, const std::vector<int16_t>& clean, ConfigTotals& totals) {
+    std::vector<int16_t> x = clean;
+    for (Step step : c.steps) step(x, totals.cost);
+
+    // フィルタ・間引きの遅れを揃えて比べる
+    size_t n = x.size() < clean.size() ? x.size() : clean.size();
+    int delay = alignDelay(clean.data(), x.data(), n, MAX_DELAY);
+    size_t start = delay < 0 ? -delay : 0;
+    size_t count = n - (delay > 0 ? delay : 0) - start;
+    qualityAccumulate(totals.quality, clean.data() + start, x.data() + start + delay, count);
+}
+
+static double metricValue(const QualityResult& r, const std::string& metric) {
+    if (metric == "snr") return r.snrDb;
+    if (metric == "segsnr") return r.segSnrDb;
+    if (metric == "lsd") return -r.lsdDb;   // 小さいほどよい
+    return r.stoi;
+}
+
+// 送信量・CPU・音質のどれでも負けていて、どれかで明らかに負けている設定があれば外す
+static void markPareto(std::vector<ConfigTotals>& totals, const std::string& metric) {
+    for (size_t i = 0; i < configs.size(); i++) {
+        totals[i].pareto = true;
+        for (size_t j = 0; j < configs.size() && totals[i].pareto; j++) {
+            if (i == j) continue;
+            double bi = linkBytesPerSecond(configs[i]), bj = linkBytesPerSecond(configs[j]);
+            double ci = totals[i].costPerSample, cj = totals[j].costPerSample;
+            double qi = metricValue(totals[i].result, metric), qj = metricValue(totals[j].result, metric);
+            bool noWorse = bj <= bi && cj <= ci && qj >= qi;
+            bool better = bj < bi || cj < ci || qj > qi;
+            if (noWorse && better) totals[i].pareto = false;
+        }
+    }
+}
+
+static std::string currentCommit() {
+    std::string commit = "unknown";
+    FILE* p = popen("git rev-parse --short HEAD 2>/dev/null", "r");
+    if (!p) return commit;
+    char buf[64];
+    if (fgets(buf, sizeof(buf), p)) {
+        buf[strcspn(buf, "\n")] = 0;
+        if (buf[0]) commit = buf;
+    }
+    pclose(p);
+    return commit;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [-m stoi|segsnr|lsd|snr] [-o DIR] [-c COMMIT] FILE.wav...\n"
+            "  -m METRIC  quality axis for the pareto flag (default stoi)\n"
+            "  -o DIR     write DIR/m5scribe-quality-<commit>.csv\n"
+            "  -c COMMIT  commit id for the CSV (default: git rev-parse --short HEAD)\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    std::string metric = "stoi";
+    const char* outDir = nullptr;
+    std::string commit;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:o:c:h")) != -1) {
+        switch (opt) {
+            case 'm': metric = optarg; break;
+            case 'o': outDir = optarg; break;
+            case 'c': commit = optarg; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc || (metric != "stoi" && metric != "segsnr" && metric != "lsd" && metric != "snr")) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (commit.empty()) commit = currentCommit();
+
+    openCycleCounter();
+    std::vector<ConfigTotals> totals(configs.size());
+    uint64_t samples = 0;
+    int files = 0;
+
+    for (int i = optind; i < argc; i++) {
+        std::vector<int16_t> clean;
+        if (!wavReadFile(argv[i], SAMPLE_RATE, clean)) {
+            fprintf(stderr, "skip %s\n", argv[i]);
+            continue;
+        }
+        // 送信フレームの整数倍に切る
+        clean.resize(clean.size() / 1024 * 1024);
+        if (clean.empty()) continue;
+        for (size_t c = 0; c < configs.size(); c++) runConfig(configs[c], clean, totals[c]);
+        samples += clean.size();
+        files++;
+    }
+    if (samples == 0) return 1;
+
+    for (ConfigTotals& t : totals) {
+        qualityFinish(t.quality, t.result);
+        t.costPerSample = (double)(cycleFd >= 0 ? t.cost.cycles : t.cost.ns) / samples;
+    }
+    markPareto(totals, metric);
+
+    printf("%d files, %.1f s of audio, commit %s%s\n", files, (double)samples / SAMPLE_RATE, commit.c_str(),
+           cycleFd >= 0 ? "" : " (no perf cycle counter, cost in ns)");
+    printf("%-14s %11s %10s %9s %8s %10s %8s %7s %s\n", "config", "cycles/smp", "ns/smp", "link kB/s", "SNR dB",
+           "segSNR dB", "LSD dB", "STOI", "pareto");
+    for (size_t c = 0; c < configs.size(); c++) {
+        const ConfigTotals& t = totals[c];
+        char cycles[16] = "-";
+        if (cycleFd >= 0) snprintf(cycles, sizeof(cycles), "%.2f", (double)t.cost.cycles / samples);
+        printf("%-14s %11s %10.2f %9.1f %8.2f %10.2f %8.2f %7.4f %s\n", configs[c].name, cycles,
+               (double)t.cost.ns / samples, linkBytesPerSecond(configs[c]) / 1000, t.result.snrDb,
+               t.result.segSnrDb, t.result.lsdDb, t.result.stoi, t.pareto ? "*" : "");
+    }
+
+    if (outDir) {
+        mkdir(outDir, 0755);
+        std::string path = std::string(outDir) + "/m5scribe-quality-" + commit + ".csv";
+        FILE* f = fopen(path.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "cannot write %s\n", path.c_str());
+            return 1;
+        }
+        fprintf(f, "commit,config,cycles_per_sample,ns_per_sample,link_bytes_per_s,snr_db,segsnr_db,lsd_db,stoi,"
+                   "pareto_%s\n", metric.c_str());
+        for (size_t c = 0; c < configs.size(); c++) {
+            const ConfigTotals& t = totals[c];
+            std::string cycles = cycleFd >= 0 ? std::to_string((double)t.cost.cycles / samples) : "";
+            fprintf(f, "%s,%s,%s,%.3f,%.0f,%.3f,%.3f,%.3f,%.4f,%d\n", commit.c_str(), configs[c].name,
+                    cycles.c_str(), (double)t.cost.ns / samples, linkBytesPerSecond(configs[c]), t.result.snrDb,
+                    t.result.segSnrDb, t.result.lsdDb, t.result.stoi, t.pareto ? 1 : 0);
+        }
+        fclose(f);
+        printf("wrote %s\n", path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+/**
+ * m5scribe-spkbench - 話者交代検出の評価
+ *
+ * 注釈付きの録音（16kHz / 16bit / モノラル WAV）に端末と同じ検出器（speaker_change.cpp）を
+ * 適用し、正解の境界と照合して適合率・再現率・F1、位置ずれ、ホストでの計算時間を出力する。
+ *
+ * 正解は WAV と同じ名前の .rttm（話者が変わる SPEAKER 行の開始時刻）か
+ * .txt（1 行に 1 つ境界の秒数）で与える。
+ *
+ * 例: m5scribe-spkbench -t 1.0 testset/meeting1.wav testset/meeting2.wav
+ */
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "speaker_change.h"
+#include "wav_sink.h"
+
+#define SAMPLE_RATE 16000
+
+struct BenchTotals {
+    size_t reference = 0;
+    size_t detected = 0;
+    size_t hits = 0;
+    double offsetSum = 0.0;
+    double audioSec = 0.0;
+    double computeSec = 0.0;
+    uint64_t frames = 0;
+};
+
+static void onBoundary(uint32_t sampleIndex, float, void* context) {
+    std::vector<double>* out = (std::vector<double>*)context;
+    out->push_back((double)sampleIndex / SAMPLE_RATE);
+}
+
+static double nowSec() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// .rttm（話者が変わった行の開始時刻）または .txt（秒数のリスト）を読む
+static bool readReference(const std::string& stem, std::vector<double>& out) {
+    std::string path = stem + ".rttm";
+    FILE* f = fopen(path.c_str(), "r");
+    bool rttm = f != nullptr;
+    if (!f) {
+        path = stem + ".txt";
+        f = fopen(path.c_str(), "r");
+    }
+    if (!f) return false;
+
+    char line[512];
+    std::string lastSpeaker;
+    std::vector<std::pair<double, std::string>> turns;
+    while (fgets(line, sizeof(line), f)) {
+        if (rttm) {
+            char type[32], file[128], chan[16], speaker[128];
+            double onset, duration;
+            if (sscanf(line, "%31s %127s %15s %lf %lf %*s %*s %127s", type, file, chan, &onset, &duration,
+                       speaker) == 6 && strcmp(type, "SPEAKER") == 0) {
+                turns.push_back({ onset, speaker });
+            }
+        } else {
+            char* end;
+            double t = strtod(line, &end);
+            if (end != line) out.push_back(t);
+        }
+    }
+    fclose(f);
+
+    std::sort(turns.begin(), turns.end());
+    for (size_t i = 0; i < turns.size(); i++) {
+        if (i > 0 && turns[i].second != lastSpeaker) out.push_back(turns[i].first);
+        lastSpeaker = turns[i].second;
+    }
+    std::sort(out.begin(), out.end());
+    return true;
+}
+
+// 許容幅内で 1 対 1 に対応付ける（近い順）
+static size_t matchBoundaries(const std::vector<double>& ref, const std::vector<double>& hyp, double tolerance,
+                              double& offsetSum) {
+    struct Pair { double distance; size_t r, h; };
+    std::vector<Pair> pairs;
+    for (size_t r = 0; r < ref.size(); r++) {
+        for (size_t h = 0; h < hyp.size(); h++) {
+            double d = fabs(ref[r] - hyp[h]);
+            if (d <= tolerance) pairs.push_back({ d, r, h });
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.distance < b.distance; });
+
+    std::vector<bool> usedRef(ref.size()), usedHyp(hyp.size());
+    size_t hits = 0;
+    for (const Pair& p : pairs) {
+        if (usedRef[p.r] || usedHyp[p.h]) continue;
+        usedRef[p.r] = usedHyp[p.h] = true;
+        offsetSum += p.distance;
+        hits++;
+    }
+    return hits;
+}
+
+static void printScores(const char* name, const BenchTotals& t) {
+    double precision = t.detected ? (double)t.hits / t.detected : 0.0;
+    double recall = t.reference ? (double)t.hits / t.reference : 0.0;
+    double f1 = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0.0;
+    printf("%-32s %7.1f s  ref %3zu  det %3zu  hit %3zu  P %.2f R %.2f F1 %.2f  offset %.2f s  "
+           "host %.1f us/frame (RTF %.4f)\n",
+           name, t.audioSec, t.reference, t.detected, t.hits, precision, recall, f1,
+           t.hits ? t.offsetSum / t.hits : 0.0,
+           t.frames ? t.computeSec * 1e6 / t.frames : 0.0,
+           t.audioSec > 0 ? t.computeSec / t.audioSec : 0.0);
+}
+
+int main(int argc, char** argv) {
+    double tolerance = 1.0;
+    bool verbose = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:vh")) != -1) {
+        switch (opt) {
+            case 't': tolerance = atof(optarg); break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-t TOLERANCE_SEC] [-v] FILE.wav...\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-t TOLERANCE_SEC] [-v] FILE.wav...\n", argv[0]);
+        return 2;
+    }
+
+    SpeakerChange* sc = new SpeakerChange();
+    if (!speakerChangeInit(*sc)) return 1;
+
+    BenchTotals total;
+    for (int i = optind; i < argc; i++) {
+        std::vector<int16_t> pcm;
+        if (!wavReadFile(argv[i], SAMPLE_RATE, pcm)) {
+            fprintf(stderr, "skip %s (need 16 kHz / 16 bit / mono PCM)\n", argv[i]);
+            continue;
+        }
+        std::string stem = argv[i];
+        if (stem.size() > 4 && stem.compare(stem.size() - 4, 4, ".wav") == 0) stem.resize(stem.size() - 4);
+        std::vector<double> ref, hyp;
+        if (!readReference(stem, ref)) {
+            fprintf(stderr, "skip %s (no %s.rttm or .txt)\n", argv[i], stem.c_str());
+            continue;
+        }
+
+        speakerChangeReset(*sc, 0);
+        uint32_t framesBefore = sc->frames;
+        double start = nowSec();
+        speakerChangePush(*sc, pcm.data(), pcm.size(), 0, onBoundary, &hyp);
+
+        BenchTotals t;
+        t.computeSec = nowSec() - start;
+        t.frames = sc->frames - framesBefore;
+        t.audioSec = (double)pcm.size() / SAMPLE_RATE;
+        t.reference = ref.size();
+        t.detected = hyp.size();
+        t.hits = matchBoundaries(ref, hyp, tolerance, t.offsetSum);
+
+        const char* base = strrchr(argv[i], '/');
+        printScores(base ? base + 1 : argv[i], t);
+        if (verbose) {
+            for (double h : hyp) printf("    boundary %.2f s\n", h);
+        }
+
+        total.reference += t.reference;
+        total.detected += t.detected;
+        total.hits += t.hits;
+        total.offsetSum += t.offsetSum;
+        total.audioSec += t.audioSec;
+        total.computeSec += t.computeSec;
+        total.frames += t.frames;
+    }
+
+    if (total.frames > 0) printScores("TOTAL", total);
+    speakerChangeFree(*sc);
+    delete sc;
+    return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * m5scribe-syncbench - 発話区間インデックスによる録音同期の転送量と時間の見積もり
+ *
+ * WAV（16kHz / 16bit / モノラル）を端末の SD 録音とみなし、端末と同じ speech_index で発話区間を求めて、
+ *   full         : 録音全体を送る（LINK_REC_FETCH_ALL）
+ *   speech-only  : インデックスと発話区間だけを送る（LINK_REC_FETCH_SPEECH）
+ * の転送量と、リンクの実効速度 -k kB/s（端末の [link] 行や m5scribed の [sync] 行の値）での時間を比べる。
+ * あわせてインデックス作成の 1 サンプルあたりの時間とインデックスの大きさを出力する。
+ * -o DIR でインデックス（.idx）と、発話区間をつないだ WAV を書き出す（区間の切れ目を耳で確かめる用）。
+ *
+ * 例: m5scribe-syncbench -k 95 testset/meeting1.wav testset/meeting2.wav
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include "audio_kernels.h"
+#include "speech_index.h"
+#include "wav_sink.h"
+
+#define SAMPLE_RATE 16000
+
+struct SyncTotals {
+    double seconds = 0;
+    double speechSeconds = 0;
+    uint64_t fullBytes = 0;
+    uint64_t speechBytes = 0;      // インデックス込み
+    uint32_t regions = 0;
+};
+
+static double nowSec() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void appendRecord(const uint8_t* record, size_t length, void* context) {
+    std::vector<uint8_t>* index = (std::vector<uint8_t>*)context;
+    index->insert(index->end(), record, record + length);
+}
+
+static std::string baseName(const char* path) {
+    const char* slash = strrchr(path, '/');
+    std::string name = slash ? slash + 1 : path;
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [-k KB_PER_S] [-o DIR] FILE.wav...\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    double linkKBps = 95.0;
+    const char* outDir = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:o:h")) != -1) {
+        switch (opt) {
+            case 'k': linkKBps = atof(optarg); break;
+            case 'o': outDir = optarg; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc || linkKBps <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (outDir) mkdir(outDir, 0755);
+
+    SyncTotals totals;
+    double indexSeconds = 0;
+    printf("link %.1f kB/s\n", linkKBps);
+    printf("%-24s %8s %8s %6s %8s %9s %9s %9s %9s\n", "file", "audio s", "speech s", "%", "regions",
+           "index B", "full s", "speech s", "speedup");
+
+    for (int i = optind; i < argc; i++) {
+        std::vector<int16_t> pcm;
+        if (!wavReadFile(argv[i], SAMPLE_RATE, pcm)) {
+            fprintf(stderr, "skip %s\n", argv[i]);
+            continue;
+        }
+
+        // 端末と同じく RECORDER_CHUNK_SAMPLES 相当ずつ渡す
+        std::vector<uint8_t> index(SPEECH_INDEX_HEADER_SIZE);
+        speechIndexWriteHeader(index.data(), SAMPLE_RATE);
+        SpeechIndexBuilder builder;
+        speechIndexInit(builder, SAMPLE_RATE, appendRecord, &index);
+        double start = nowSec();
+        for (size_t off = 0; off < pcm.size(); off += 2048) {
+            size_t n = pcm.size() - off < 2048 ? pcm.size() - off : 2048;
+            speechIndexPush(builder, pcm.data() + off, n);
+        }
+        speechIndexFinish(builder);
+        indexSeconds += nowSec() - start;
+
+        // 区間をインデックスから読み直す（端末の送信と同じ手順）
+        std::vector<int16_t> speech;
+        size_t off = SPEECH_INDEX_HEADER_SIZE, n;
+        SpeechIndexRecord record;
+        while ((n = speechIndexReadRecord(index.data() + off, index.size() - off, record)) > 0) {
+            if (record.type == SPEECH_INDEX_REGION) {
+                speech.insert(speech.end(), pcm.begin() + record.region.start, pcm.begin() + record.region.end);
+            }
+            off += n;
+        }
+
+        double seconds = (double)pcm.size() / SAMPLE_RATE;
+        double speechSeconds = (double)speech.size() / SAMPLE_RATE;
+        uint64_t fullBytes = pcm.size() * 2;
+        uint64_t speechBytes = speech.size() * 2 + index.size();
+        double fullTime = fullBytes / 1e3 / linkKBps;
+        double speechTime = speechBytes / 1e3 / linkKBps;
+        std::string name = baseName(argv[i]);
+        printf("%-24s %8.1f %8.1f %6.1f %8u %9zu %9.1f %9.1f %8.1fx\n", name.c_str(), seconds, speechSeconds,
+               100.0 * speechSeconds / seconds, builder.regions, index.size(), fullTime, speechTime,
+               speechTime > 0 ? fullTime / speechTime : 0.0);
+
+        totals.seconds += seconds;
+        totals.speechSeconds += speechSeconds;
+        totals.fullBytes += fullBytes;
+        totals.speechBytes += speechBytes;
+        totals.regions += builder.regions;
+
+        if (outDir) {
+            std::string path = std::string(outDir) + "/" + name + ".idx";
+            FILE* f = fopen(path.c_str(), "wb");
+            if (f) {
+                fwrite(index.data(), 1, index.size(), f);
+                fclose(f);
+            }
+            path = std::string(outDir) + "/" + name + "-speech.wav";
+            wavWriteFile(path.c_str(), SAMPLE_RATE, speech.data(), speech.size());
+        }
+    }
+    if (totals.seconds == 0) return 1;
+
+    double fullTime = totals.fullBytes / 1e3 / linkKBps;
+    double speechTime = totals.speechBytes / 1e3 / linkKBps;
+    printf("%-24s %8.1f %8.1f %6.1f %8u %9s %9.1f %9.1f %8.1fx\n", "total", totals.seconds, totals.speechSeconds,
+           100.0 * totals.speechSeconds / totals.seconds, totals.regions, "", fullTime, speechTime,
+           fullTime / speechTime);
+    printf("index: %.2f ns/sample on this host (%s kernels)\n",
+           indexSeconds * 1e9 / (totals.seconds * SAMPLE_RATE), audioKernels->name);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * m5scribe-tap - 共有メモリリングの消費者サンプル
+ *
+ * m5scribed が公開している PCM を読み出し、
+ *   - 標準出力に raw PCM（s16le）を流す（ASR などへパイプする用途）
+ *   - 1 秒ごとにレベルと遅延（受信→公開→消費）を stderr に出力する
+ *
+ * 例: m5scribe-tap | sox -t raw -r 16000 -e signed -b 16 -c 1 - out.wav
+ */
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shm_ring.h"
+
+#define READ_CHUNK 1024
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int) {
+    running = 0;
+}
+
+int main(int argc, char** argv) {
+    const char* shmName = "/m5scribe-pcm";
+    bool writeStdout = !isatty(STDOUT_FILENO);
+    bool quiet = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:nqh")) != -1) {
+        switch (opt) {
+            case 's': shmName = optarg; break;
+            case 'n': writeStdout = false; break;
+            case 'q': quiet = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-s SHM_NAME] [-n (no stdout)] [-q (no stats)]\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    ShmRing ring;
+    while (!shmRingAttach(ring, shmName)) {
+        sleep(1);
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    // 最新位置から読み始める
+    uint64_t pos = ring.header->writePos.load(std::memory_order_acquire);
+    int16_t buf[READ_CHUNK];
+
+    uint64_t statsStart = monotonicNs();
+    uint64_t samples = 0, dropped = 0;
+    double sumSquares = 0;
+    double ingestLatencySum = 0, publishLatencySum = 0, ingestLatencyMax = 0;
+    uint64_t latencyCount = 0;
+
+    while (running) {
+        uint64_t lost = 0;
+        size_t n = shmRingRead(ring, pos, buf, READ_CHUNK, &lost);
+        dropped += lost;
+
+        if (n == 0) {
+            // 新しいデータが来るまで短く待つ（5ms ポーリング）
+            timespec ts = { 0, 5000000 };
+            nanosleep(&ts, nullptr);
+        } else {
+            uint64_t now = monotonicNs();
+            uint64_t ingestNs, publishNs;
+            if (shmRingLookupTimes(ring, pos - 1, ingestNs, publishNs)) {
+                double ingestLatency = (now - ingestNs) / 1e3;
+                ingestLatencySum += ingestLatency;
+                publishLatencySum += (now - publishNs) / 1e3;
+                if (ingestLatency > ingestLatencyMax) ingestLatencyMax = ingestLatency;
+                latencyCount++;
+            }
+
+            for (size_t i = 0; i < n; i++) sumSquares += (double)buf[i] * buf[i];
+            samples += n;
+
+            if (writeStdout && fwrite(buf, sizeof(int16_t), n, stdout) != n) break;
+        }
+
+        uint64_t now = monotonicNs();
+        if (!quiet && now - statsStart >= 1000000000ull) {
+            double rms = samples ? sqrt(sumSquares / samples) : 0;
+            fprintf(stderr, "[tap] %.1f dBFS, %llu samples, %llu dropped, "
+                            "ingest->consume avg %.0f us max %.0f us, publish->consume avg %.0f us\n",
+                    rms > 0 ? 20 * log10(rms / 32768.0) : -120.0,
+                    (unsigned long long)samples, (unsigned long long)dropped,
+                    latencyCount ? ingestLatencySum / latencyCount : 0.0, ingestLatencyMax,
+                    latencyCount ? publishLatencySum / latencyCount : 0.0);
+            statsStart = now;
+            samples = dropped = latencyCount = 0;
+            sumSquares = ingestLatencySum = publishLatencySum = ingestLatencyMax = 0;
+        }
+    }
+
+    shmRingClose(ring);
+    return 0;
+}
@@ -0,0 +1,842 @@
+/**
+ * m5scribed - M5Scribe Linux 受信デーモン
+ *
+ * デバイスのリンクフレームを受信してデコードし、
+ *   - 共有メモリリング（/dev/shm）に PCM を公開（任意個数のローカル消費者向け、ADPCM は復号して公開）
+ *   - ローテーションする WAV ファイルに保存
+ *   - 特徴量送信モード（-F）では log-mel を float32 で FILE に書き出す（サーバー側 ASR 向け）
+ *   - SIGUSR1 を受けたら端末の履歴から直近 N 秒（-P）を取り直して別の WAV に書く（ライブは止めない）
+ *   - 接続ごとに端末の SD 録音のうち未取得のものを発話区間だけ（-S）または全体（-A）取り出す
+ *   - 接続ごとに端末の対応形式を問い合わせ、リンクの送信量と復号の負荷から形式を選ぶ（-w なら記録も残す）
+ * する。10 秒ごとに受信レート・欠落・CPU 使用率・処理遅延を stderr に出力する。
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "adpcm.h"
+#include "feature_codec.h"
+#include "link_frame.h"
+#include "ingest.h"
+#include "shm_ring.h"
+#include "wav_sink.h"
+
+#define DEFAULT_SHM_NAME      "/m5scribe-pcm"
+#define DEFAULT_SAMPLE_RATE   16000
+#define DEFAULT_RING_SECONDS  8
+#define MAX_RING_SAMPLES      (1u << 30)   // 共有メモリ 2GB
+#define STATS_INTERVAL_NS     10000000000ull
+#define RECONNECT_DELAY_SEC   2
+#define DEFAULT_REPLAY_SECONDS 10
+
+// 形式の取り決め
+#define NEGOTIATE_PROBE_NS    3000000000ull  // 今の形式で送信量を測る時間
+#define NEGOTIATE_KEEP_UP     0.95           // 届いた音声 / 実時間がこれ以上なら追いついている
+#define NEGOTIATE_HEADROOM    0.8            // 遅れていたときに使う、測った送信量の割合
+#define NEGOTIATE_CPU_BUDGET  0.05           // 復号に使ってよい CPU（音声 1 秒あたりの秒）
+
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t replayWanted = 0;
+
+struct DaemonStats {
+    uint64_t bytesIn = 0;
+    uint64_t frames = 0;
+    uint64_t samples = 0;
+    uint64_t seqGaps = 0;
+    uint64_t unknownFrames = 0;
+    uint64_t featureFrames = 0;    // 受信した log-mel フレーム数
+    uint64_t adpcmFrames = 0;      // ADPCM で届いた音声フレーム数
+    uint64_t processNsTotal = 0;   // read() 完了から公開までの処理時間
+    uint64_t processNsMax = 0;
+};
+
+// 履歴の再送（LINK_CTRL_REPLAY → LINK_FRAME_REPLAY）
+struct ReplayFetch {
+    std::string dir;               // 書き出し先
+    uint32_t seconds = DEFAULT_REPLAY_SECONDS;
+    uint64_t requestNs = 0;        // 要求を送った時刻（0 なら要求していない）
+    uint64_t firstNs = 0;          // 最初の再送フレーム
+    uint32_t start = 0;            // 最初のサンプル番号
+    uint32_t nextTimestamp = 0;
+    uint64_t skipped = 0;          // 途中で欠けたサンプル数
+    uint64_t liveSamples = 0;      // 再送の間に届いたライブの音声
+    std::vector<int16_t> pcm;
+};
+
+// SD 録音の同期（LINK_CTRL_REC_LIST → LINK_CTRL_REC_FETCH を 1 つずつ）
+struct RecordingEntry {
+    uint32_t id;
+    uint32_t totalSamples;
+    uint32_t speechSamples;
+};
+
+struct RecordingSync {
+    bool enabled = false;
+    uint8_t mode = LINK_REC_FETCH_SPEECH;
+    std::string dir;
+    std::vector<RecordingEntry> listed;    // 一覧の受信中
+    std::vector<RecordingEntry> pending;   // 未取得
+    size_t next = 0;
+    RecordingEntry current = {};
+    uint64_t requestNs = 0;
+    std::vector<uint8_t> index;
+    std::vector<int16_t> pcm;
+    uint32_t regions = 0;                  // 届いた音声の連続区間
+    uint32_t nextTimestamp = 0;
+    double seconds = 0;                    // 今回の接続の合計
+    uint64_t bytes = 0;
+    uint64_t fullBytes = 0;
+};
+
+// 接続時の形式の取り決め（LINK_CTRL_CAPS → LINK_FRAME_CAPS → 計測 → LINK_CTRL_SELECT）
+//   今の形式で NEGOTIATE_PROBE_NS の間に届いた音声の量を実時間と比べ、追いついていればその送信量、
+//   遅れていればその NEGOTIATE_HEADROOM 倍を使える帯域とし、受けられる形式のうち音質のよい順に
+//   入るものを選ぶ。下げた形式でも遅れていれば、もう一度測ってさらに下げる。
+struct Negotiation {
+    bool haveCaps = false;
+    LinkCaps caps = {};            // 最後に届いた対応形式（mode / sampleRate / frameSamples は現在の設定）
+    uint16_t frameSamples = 0;     // 選ぶフレーム長
+    uint64_t probeNs = 0;          // 計測の開始（0 なら計測していない）
+    uint64_t probeSamples = 0;
+    uint64_t probeBytes = 0;       // 音声フレームのヘッダー込みのバイト数
+    double linkRate = 0;           // 最後に測った送信量（B/s）
+    bool awaitingReply = false;    // LINK_CTRL_SELECT の結果待ち
+    bool settled = false;          // 結果が届いたらもう測らない
+};
+
+struct Daemon {
+    ShmRing ring;
+    WavSink wav;
+    bool wavEnabled = false;
+    FILE* featureOut = nullptr;    // -F: [frames][80] の float32
+    DaemonStats stats;
+    bool haveSeq = false;
+    uint16_t lastSeq = 0;
+    uint64_t currentIngestNs = 0;  // 処理中のバッファを read() した時刻
+    ReplayFetch replay;
+    RecordingSync sync;
+    Negotiation neg;
+    uint32_t frameMs = 0;          // -f: 希望するフレーム長（0 なら最長 = ヘッダーが最も少ない）
+    bool adpcmAffordable = true;   // ADPCM の復号が NEGOTIATE_CPU_BUDGET に収まる
+    std::string sessionLog;        // -w: 接続ごとに選んだ形式を追記する
+    int fd = -1;                   // 現在の接続（制御フレームの送信用）
+};
+
+static void onSignal(int) {
+    running = 0;
+}
+
+static void onReplaySignal(int) {
+    replayWanted = 1;
+}
+
+// PCM を共有メモリリングと WAV に公開する
+static void publishPcm(Daemon* d, const int16_t* pcm, size_t count) {
+    shmRingWrite(d->ring, pcm, count, d->currentIngestNs);
+    if (d->wavEnabled) wavSinkWrite(d->wav, pcm, count);
+    d->stats.samples += count;
+    if (d->replay.requestNs) d->replay.liveSamples += count;
+
+    uint64_t elapsed = monotonicNs() - d->currentIngestNs;
+    d->stats.processNsTotal += elapsed;
+    if (elapsed > d->stats.processNsMax) d->stats.processNsMax = elapsed;
+}
+
+// 形式の計測中なら届いた音声を数える
+static void countProbe(Daemon* d, const LinkFrameHeader& header, size_t samples) {
+    if (d->neg.probeNs == 0) return;
+    d->neg.probeSamples += samples;
+    d->neg.probeBytes += LINK_FRAME_HEADER_SIZE + header.length;
+}
+
+// 再送フレームを集め、最後のフレームで WAV に書いて所要時間を出す
+static void handleReplay(Daemon* d, const LinkFrameHeader& header, const uint8_t* payload) {
+    ReplayFetch& r = d->replay;
+    uint64_t now = monotonicNs();
+    if (r.firstNs == 0) {
+        r.firstNs = now;
+        r.start = r.nextTimestamp = header.timestamp;
+        if (r.requestNs == 0) r.requestNs = now;  // ほかの受信側が要求した分
+    }
+    size_t count = header.length / 2;
+    if (count > 0 && header.timestamp != r.nextTimestamp) r.skipped += header.timestamp - r.nextTimestamp;
+    r.pcm.insert(r.pcm.end(), (const int16_t*)payload, (const int16_t*)payload + count);
+    r.nextTimestamp = header.timestamp + count;
+    if (!(header.flags & LINK_FLAG_REPLAY_LAST)) return;
+
+    uint32_t rate = d->ring.header->sampleRate;
+    double firstMs = (r.firstNs - r.requestNs) / 1e6;
+    double totalMs = (now - r.requestNs) / 1e6;
+    double seconds = (double)r.pcm.size() / rate;
+    fprintf(stderr,
+            "[replay] %.2f s from %.2f s: first frame %.1f ms, done %.1f ms, %.1f kB/s (%.1fx real time), "
+            "%llu samples skipped, live %.2f s audio/s meanwhile\n",
+            seconds, (double)r.start / rate, firstMs, totalMs,
+            totalMs > 0 ? r.pcm.size() * 2 / totalMs : 0.0, totalMs > 0 ? seconds * 1000.0 / totalMs : 0.0,
+            (unsigned long long)r.skipped, totalMs > 0 ? (double)r.liveSamples / rate / (totalMs / 1000.0) : 0.0);
+
+    if (!r.pcm.empty()) {
+        char name[64];
+        snprintf(name, sizeof(name), "/m5scribe-replay-%u.wav", r.start);
+        std::string path = r.dir + name;
+        if (wavWriteFile(path.c_str(), rate, r.pcm.data(), r.pcm.size())) {
+            fprintf(stderr, "[replay] wrote %s\n", path.c_str());
+        }
+    }
+    r.pcm.clear();
+    r.requestNs = r.firstNs = 0;
+    r.skipped = r.liveSamples = 0;
+}
+
+static std::string recordingPath(const RecordingSync& s, uint32_t id, const char* ext) {
+    char name[48];
+    snprintf(name, sizeof(name), "/m5scribe-rec-%05u.%s", id, ext);
+    return s.dir + name;
+}
+
+// 次の未取得の録音を要求する（無ければ今回の接続の合計を出す）
+static void fetchNextRecording(Daemon* d) {
+    RecordingSync& s = d->sync;
+    if (s.next >= s.pending.size()) {
+        if (!s.pending.empty() && s.seconds > 0) {
+            double fullSeconds = s.bytes ? s.seconds * s.fullBytes / s.bytes : 0;
+            fprintf(stderr, "[sync] %zu recordings in %.1f s (%.1f MB); full transfer at the same rate ~%.1f s (%.1fx)\n",
+                    s.pending.size(), s.seconds, s.bytes / 1e6, fullSeconds, fullSeconds / s.seconds);
+        }
+        s.pending.clear();
+        s.next = 0;
+        return;
+    }
+
+    s.current = s.pending[s.next++];
+    s.index.clear();
+    s.pcm.clear();
+    s.regions = 0;
+    s.nextTimestamp = UINT32_MAX;
+    s.requestNs = monotonicNs();
+
+    uint8_t frame[LINK_FRAME_HEADER_SIZE + 6];
+    LinkFrameHeader h = { LINK_FRAME_CONTROL, 0, 6, 0, 0 };
+    linkFrameWriteHeader(frame, h);
+    uint8_t* p = frame + LINK_FRAME_HEADER_SIZE;
+    p[0] = LINK_CTRL_REC_FETCH;
+    for (int i = 0; i < 4; i++) p[1 + i] = (s.current.id >> (8 * i)) & 0xFF;
+    p[5] = s.mode;
+    if (write(d->fd, frame, sizeof(frame)) != (ssize_t)sizeof(frame)) {
+        fprintf(stderr, "[sync] failed to request recording %u\n", s.current.id);
+    }
+}
+
+static void handleRecording(Daemon* d, const LinkFrameHeader& header, const uint8_t* payload) {
+    RecordingSync& s = d->sync;
+    if (!s.enabled || header.length < 1) return;
+    bool last = header.flags & LINK_FLAG_RECORDING_LAST;
+
+    if (payload[0] == LINK_REC_LIST) {
+        for (size_t off = 1; off + 12 <= header.length; off += 12) {
+            RecordingEntry e;
+            memcpy(&e.id, payload + off, 4);
+            memcpy(&e.totalSamples, payload + off + 4, 4);
+            memcpy(&e.speechSamples, payload + off + 8, 4);
+            s.listed.push_back(e);
+        }
+        if (!last) return;
+
+        // 取得済み（.idx がある）ものは飛ばす
+        uint64_t total = 0, speech = 0;
+        s.pending.clear();
+        s.next = 0;
+        for (const RecordingEntry& e : s.listed) {
+            struct stat st;
+            if (stat(recordingPath(s, e.id, "idx").c_str(), &st) == 0) continue;
+            s.pending.push_back(e);
+            total += e.totalSamples;
+            speech += e.speechSamples;
+        }
+        uint32_t rate = d->ring.header->sampleRate;
+        fprintf(stderr, "[sync] %zu recordings on device, %zu new: %.1f s audio, %.1f s speech (%.1f%%)\n",
+                s.listed.size(), s.pending.size(), (double)total / rate, (double)speech / rate,
+                total ? 100.0 * speech / total : 0.0);
+        s.listed.clear();
+        s.seconds = 0;
+        s.bytes = s.fullBytes = 0;
+        fetchNextRecording(d);
+        return;
+    }
+
+    if (header.length < 5 || s.requestNs == 0) return;
+    const uint8_t* data = payload + 5;
+    size_t length = header.length - 5;
+    if (payload[0] == LINK_REC_INDEX) {
+        s.index.insert(s.index.end(), data, data + length);
+        return;
+    }
+    if (payload[0] != LINK_REC_AUDIO) return;
+
+    size_t count = length / 2;
+    if (count > 0 && header.timestamp != s.nextTimestamp) s.regions++;
+    s.pcm.insert(s.pcm.end(), (const int16_t*)data, (const int16_t*)data + count);
+    s.nextTimestamp = header.timestamp + count;
+    if (!last) return;
+
+    uint32_t rate = d->ring.header->sampleRate;
+    double seconds = (monotonicNs() - s.requestNs) / 1e9;
+    uint64_t bytes = s.pcm.size() * 2 + s.index.size();
+    uint64_t fullBytes = (uint64_t)s.current.totalSamples * 2;
+    fprintf(stderr,
+            "[sync] #%u %s: %.1f s of %.1f s audio in %u regions, %.1f kB in %.2f s (%.1f kB/s); "
+            "full transfer at this rate ~%.1f s\n",
+            s.current.id, s.mode == LINK_REC_FETCH_ALL ? "all" : "speech only",
+            (double)s.pcm.size() / rate, (double)s.current.totalSamples / rate, s.regions, bytes / 1e3, seconds,
+            seconds > 0 ? bytes / seconds / 1e3 : 0.0, bytes ? seconds * fullBytes / bytes : 0.0);
+    s.seconds += seconds;
+    s.bytes += bytes;
+    s.fullBytes += fullBytes;
+
+    // 音声（区間をつないだもの）とインデックス（区間の元の位置）
+    if (!s.index.empty()) {
+        std::string path = recordingPath(s, s.current.id, "wav");
+        wavWriteFile(path.c_str(), rate, s.pcm.data(), s.pcm.size());
+        path = recordingPath(s, s.current.id, "idx");
+        FILE* f = fopen(path.c_str(), "wb");
+        if (f) {
+            fwrite(s.index.data(), 1, s.index.size(), f);
+            fclose(f);
+        }
+    }
+    s.requestNs = 0;
+    fetchNextRecording(d);
+}
+
+static const char* modeName(uint8_t mode) {
+    return mode == LINK_MODE_FEATURES ? "log-mel" : (mode == LINK_MODE_ADPCM ? "ADPCM" : "PCM16");
+}
+
+// 受けられる形式（音質のよい順）。-F なら log-mel だけ、ADPCM は復号が CPU の予算に収まるときだけ
+static int candidateModes(const Daemon* d, uint8_t* out) {
+    int count = 0;
+    if (d->featureOut) {
+        if (linkCapsHasMode(d->neg.caps, LINK_MODE_FEATURES)) out[count++] = LINK_MODE_FEATURES;
+        return count;
+    }
+    out[count++] = LINK_MODE_PCM16;
+    if (d->adpcmAffordable && linkCapsHasMode(d->neg.caps, LINK_MODE_ADPCM)) out[count++] = LINK_MODE_ADPCM;
+    return count;
+}
+
+// 音声の形式ごとの送信量（ヘッダー込み、B/s）
+static double modeBytesPerSecond(uint8_t mode, uint32_t rate, uint16_t frameSamples) {
+    double payload = mode == LINK_MODE_ADPCM ? adpcmEncodedSize(frameSamples) : frameSamples * 2.0;
+    return (payload + LINK_FRAME_HEADER_SIZE) * rate / frameSamples;
+}
+
+// 音声 1 秒分の ADPCM の復号にかかる時間（秒）
+static double adpcmDecodeLoad(uint32_t rate) {
+    static int16_t pcm[1024];
+    static uint8_t encoded[ADPCM_HEADER_SIZE + sizeof(pcm) / 4];
+    for (size_t i = 0; i < 1024; i++) pcm[i] = (int16_t)(8000 * sin(2 * M_PI * 440 * i / rate));
+    AdpcmState state;
+    size_t length = adpcmEncode(state, pcm, 1024, encoded);
+
+    uint64_t start = monotonicNs();
+    for (uint32_t done = 0; done < rate; done += 1024) adpcmDecode(encoded, length, pcm, 1024);
+    return (monotonicNs() - start) / 1e9;
+}
+
+static bool sendControl(int fd, const uint8_t* args, uint16_t length) {
+    uint8_t frame[LINK_FRAME_HEADER_SIZE + 16];
+    LinkFrameHeader h = { LINK_FRAME_CONTROL, 0, length, 0, 0 };
+    linkFrameWriteHeader(frame, h);
+    memcpy(frame + LINK_FRAME_HEADER_SIZE, args, length);
+    size_t size = LINK_FRAME_HEADER_SIZE + length;
+    return write(fd, frame, size) == (ssize_t)size;
+}
+
+// 形式を選ぶ（サンプルレートはリングと同じもの）
+static void selectFormat(Daemon* d, uint8_t mode) {
+    uint32_t rate = d->ring.header->sampleRate;
+    uint16_t frameSamples = d->neg.frameSamples;
+    uint8_t args[6] = { LINK_CTRL_SELECT, mode, (uint8_t)(rate & 0xFF), (uint8_t)(rate >> 8),
+                        (uint8_t)(frameSamples & 0xFF), (uint8_t)(frameSamples >> 8) };
+    if (!sendControl(d->fd, args, sizeof(args))) {
+        fprintf(stderr, "[caps] failed to select %s\n", modeName(mode));
+        return;
+    }
+    d->neg.awaitingReply = true;
+}
+
+static void startProbe(Negotiation& n) {
+    n.probeNs = monotonicNs();
+    n.probeSamples = n.probeBytes = 0;
+}
+
+// 決まった形式を記録する（-w なら WAV と同じディレクトリの m5scribe-sessions.tsv に追記）
+static void recordFormat(Daemon* d) {
+    const LinkCaps& c = d->neg.caps;
+    fprintf(stderr, "[caps] streaming %s, %u Hz, %u ms frames (link %.1f kB/s)\n", modeName(c.mode), c.sampleRate,
+            c.frameSamples * 1000u / c.sampleRate, d->neg.linkRate / 1000.0);
+    if (d->sessionLog.empty()) return;
+
+    FILE* f = fopen(d->sessionLog.c_str(), "a");
+    if (!f) return;
+    char when[32];
+    time_t now = time(nullptr);
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    fprintf(f, "%s\t%s\t%u\t%u\t%.1f\n", when, modeName(c.mode), c.sampleRate, c.frameSamples, d->neg.linkRate / 1000.0);
+    fclose(f);
+}
+
+// 端末の対応形式（問い合わせへの応答、または LINK_CTRL_SELECT の結果）
+static void handleCaps(Daemon* d, const uint8_t* payload, size_t length) {
+    Negotiation& n = d->neg;
+    if (!linkCapsParse(payload, length, n.caps)) {
+        d->stats.unknownFrames++;
+        return;
+    }
+    const LinkCaps& c = n.caps;
+    if (n.haveCaps) {
+        if (!n.awaitingReply) return;
+        n.awaitingReply = false;
+        recordFormat(d);
+        if (!n.settled) startProbe(n);
+        return;
+    }
+    n.haveCaps = true;
+
+    std::string rates, frames;
+    for (int i = 0; i < c.rateCount; i++) rates += (i ? "/" : "") + std::to_string(c.rates[i]);
+    for (int i = 0; i < c.frameCount; i++) frames += (i ? "/" : "") + std::to_string(c.frames[i]);
+    fprintf(stderr, "[caps] device v%u: modes 0x%02x, rates %s Hz, frames %s samples, features 0x%04x\n",
+            c.version, c.modes, rates.c_str(), frames.c_str(), c.features);
+
+    uint32_t rate = d->ring.header->sampleRate;
+    bool rateOk = false;
+    for (int i = 0; i < c.rateCount; i++) rateOk = rateOk || c.rates[i] == rate;
+    if (!rateOk) fprintf(stderr, "[caps] device does not offer %u Hz (-r), keeping %u Hz\n", rate, c.sampleRate);
+
+    // 希望のフレーム長以下で最長のもの（無ければ最短）
+    uint32_t want = d->frameMs ? d->frameMs * rate / 1000 : UINT32_MAX;
+    n.frameSamples = 0;
+    for (int i = 0; i < c.frameCount; i++) {
+        uint16_t f = c.frames[i];
+        if (f <= want && f > n.frameSamples) n.frameSamples = f;
+    }
+    if (n.frameSamples == 0) {
+        for (int i = 0; i < c.frameCount; i++) {
+            if (n.frameSamples == 0 || c.frames[i] < n.frameSamples) n.frameSamples = c.frames[i];
+        }
+    }
+    if (n.frameSamples == 0) n.frameSamples = c.frameSamples;
+
+    // log-mel は送信量が小さいので測らずに選ぶ
+    uint8_t modes[3];
+    if (d->featureOut) {
+        n.settled = true;
+        if (candidateModes(d, modes) > 0) {
+            selectFormat(d, LINK_MODE_FEATURES);
+        } else {
+            fprintf(stderr, "[caps] device cannot send log-mel features\n");
+        }
+        return;
+    }
+    startProbe(n);
+}
+
+// 計測が終わったら、測った送信量に入る形式を選ぶ
+static void finishProbe(Daemon* d) {
+    Negotiation& n = d->neg;
+    double seconds = (monotonicNs() - n.probeNs) / 1e9;
+    uint32_t rate = d->ring.header->sampleRate;
+    double audioRate = n.probeSamples / seconds / rate;
+    n.linkRate = n.probeBytes / seconds;
+    n.probeNs = 0;
+
+    bool keptUp = audioRate >= NEGOTIATE_KEEP_UP;
+    double budget = keptUp ? n.linkRate / NEGOTIATE_KEEP_UP : n.linkRate * NEGOTIATE_HEADROOM;
+    uint8_t modes[3];
+    int count = candidateModes(d, modes);
+    uint8_t choice = modes[count - 1];  // 入るものが無ければいちばん小さいもの
+    for (int i = 0; i < count; i++) {
+        if (modeBytesPerSecond(modes[i], rate, n.frameSamples) <= budget) {
+            choice = modes[i];
+            break;
+        }
+    }
+    fprintf(stderr, "[caps] probe: %.2f s audio/s, %.1f kB/s%s -> %s\n", audioRate, n.linkRate / 1000.0,
+            keptUp ? "" : " (falling behind)", modeName(choice));
+
+    // 追いついているか、もう下げられなければこれで決まり
+    n.settled = keptUp || choice == modes[count - 1];
+    if (choice == n.caps.mode && n.frameSamples == n.caps.frameSamples && n.caps.sampleRate == rate) {
+        n.settled = true;
+        recordFormat(d);
+        return;
+    }
+    selectFormat(d, choice);
+}
+
+/**
+ * 端末の遅延計測のチャープ（-DLATENCY_PROBE=1 のビルド）
+ *
+ * 到着をすぐ返して端末に往復を測らせる。文字起こしはしないので表示（LINK_CHIRP_SHOWN）は返さず、
+ * 端末の [latency] 行は受信までの内訳になる。
+ */
+static void handleChirp(Daemon* d, const LinkFrameHeader& header, const uint8_t* payload) {
+    uint8_t ack[3] = { LINK_CTRL_CHIRP_ACK, payload[1], LINK_CHIRP_ARRIVED };
+    if (!sendControl(d->fd, ack, sizeof(ack))) fprintf(stderr, "[latency] failed to ack chirp #%u\n", payload[1]);
+
+    uint16_t speaker = payload[2] | (payload[3] << 8);
+    uint16_t send = payload[4] | (payload[5] << 8);
+    uint16_t score = payload[6] | (payload[7] << 8);
+    fprintf(stderr, "[latency] chirp #%u at %.2f s: speaker->capture %.1f ms, capture->send %u ms (score %.2f)\n",
+            payload[1], (double)header.timestamp / d->ring.header->sampleRate,
+            speaker * 1000.0 / d->ring.header->sampleRate, send, score / 1000.0);
+}
+
+static void handleFrame(const LinkFrameHeader& header, const uint8_t* payload, void* context) {
+    Daemon* d = (Daemon*)context;
+
+    if (d->haveSeq && header.seq != (uint16_t)(d->lastSeq + 1)) {
+        d->stats.seqGaps++;
+    }
+    d->haveSeq = true;
+    d->lastSeq = header.seq;
+    d->stats.frames++;
+
+    switch (header.type) {
+        case LINK_FRAME_AUDIO_PCM16:
+            countProbe(d, header, header.length / 2);
+            publishPcm(d, (const int16_t*)payload, header.length / 2);
+            break;
+        case LINK_FRAME_AUDIO_ADPCM: {
+            // 端末の省電力ティア。復号して PCM と同じ経路へ
+            static int16_t pcm[LINK_FRAME_MAX_PAYLOAD * 2];
+            size_t count = adpcmDecode(payload, header.length, pcm, sizeof(pcm) / sizeof(pcm[0]));
+            d->stats.adpcmFrames++;
+            countProbe(d, header, count);
+            publishPcm(d, pcm, count);
+            break;
+        }
+        case LINK_FRAME_FEATURES: {
+            static float logMel[FEATURE_BATCH_FRAMES * FEATURE_NUM_MELS * 4];
+            FeatureBatchInfo info;
+            if (!featureBatchDecode(payload, header.length, logMel, sizeof(logMel) / sizeof(float), info)) {
+                d->stats.unknownFrames++;
+                break;
+            }
+            if (d->featureOut) {
+                fwrite(logMel, sizeof(float), (size_t)info.numFrames * info.numMels, d->featureOut);
+                fflush(d->featureOut);
+            }
+            d->stats.featureFrames += info.numFrames;
+            d->stats.samples += (uint64_t)info.numFrames * info.hopLength;
+
+            uint64_t elapsed = monotonicNs() - d->currentIngestNs;
+            d->stats.processNsTotal += elapsed;
+            if (elapsed > d->stats.processNsMax) d->stats.processNsMax = elapsed;
+            break;
+        }
+        case LINK_FRAME_REPLAY:
+            handleReplay(d, header, payload);
+            break;
+        case LINK_FRAME_RECORDING:
+            handleRecording(d, header, payload);
+            break;
+        case LINK_FRAME_CAPS:
+            handleCaps(d, payload, header.length);
+            break;
+        case LINK_FRAME_MARKER:
+            if (header.length >= 1 && payload[0] == LINK_MARKER_SPEAKER_CHANGE) {
+                fprintf(stderr, "[marker] speaker change at %.2f s\n",
+                        (double)header.timestamp / d->ring.header->sampleRate);
+            } else if (header.length >= 8 && payload[0] == LINK_MARKER_CHIRP) {
+                handleChirp(d, header, payload);
+            }
+            break;
+        default:
+            d->stats.unknownFrames++;
+            break;
+    }
+}
+
+static double cpuSeconds() {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static void logStats(Daemon& d, DaemonStats& last, double& lastCpu, uint64_t& lastNs) {
+    uint64_t now = monotonicNs();
+    double seconds = (now - lastNs) / 1e9;
+    double cpu = cpuSeconds();
+    DaemonStats& s = d.stats;
+
+    uint64_t audioFrames = s.frames - last.frames - (s.unknownFrames - last.unknownFrames);
+    fprintf(stderr,
+            "[stats] %.1f kB/s, %.2f s audio/s, %llu frames (%llu mel, %llu adpcm), %llu seq gaps, %llu unknown, "
+            "cpu %.2f%%, ingest->publish avg %.1f us max %.1f us\n",
+            (s.bytesIn - last.bytesIn) / seconds / 1000.0,
+            (s.samples - last.samples) / seconds / d.ring.header->sampleRate,
+            (unsigned long long)(s.frames - last.frames),
+            (unsigned long long)(s.featureFrames - last.featureFrames),
+            (unsigned long long)(s.adpcmFrames - last.adpcmFrames),
+            (unsigned long long)(s.seqGaps - last.seqGaps),
+            (unsigned long long)(s.unknownFrames - last.unknownFrames),
+            (cpu - lastCpu) / seconds * 100.0,
+            audioFrames ? (s.processNsTotal - last.processNsTotal) / 1e3 / audioFrames : 0.0,
+            s.processNsMax / 1e3);
+
+    s.processNsMax = 0;
+    last = s;
+    lastCpu = cpu;
+    lastNs = now;
+}
+
+// 特徴量送信モードを要求する
+static bool requestFeatures(int fd) {
+    uint8_t frame[LINK_FRAME_HEADER_SIZE + 2];
+    LinkFrameHeader h = { LINK_FRAME_CONTROL, 0, 2, 0, 0 };
+    linkFrameWriteHeader(frame, h);
+    frame[LINK_FRAME_HEADER_SIZE] = LINK_CTRL_SET_MODE;
+    frame[LINK_FRAME_HEADER_SIZE + 1] = LINK_MODE_FEATURES;
+    return write(fd, frame, sizeof(frame)) == (ssize_t)sizeof(frame);
+}
+
+// 直近 seconds 秒の再送を要求する
+static bool requestReplay(int fd, uint32_t samples) {
+    uint8_t frame[LINK_FRAME_HEADER_SIZE + 9];
+    LinkFrameHeader h = { LINK_FRAME_CONTROL, 0, 9, 0, 0 };
+    linkFrameWriteHeader(frame, h);
+    uint8_t* p = frame + LINK_FRAME_HEADER_SIZE;
+    p[0] = LINK_CTRL_REPLAY;
+    for (int i = 0; i < 4; i++) {
+        p[1 + i] = (LINK_REPLAY_LATEST >> (8 * i)) & 0xFF;
+        p[5 + i] = (samples >> (8 * i)) & 0xFF;
+    }
+    return write(fd, frame, sizeof(frame)) == (ssize_t)sizeof(frame);
+}
+
+// SD 録音の一覧を要求する
+static bool requestRecordingList(int fd) {
+    uint8_t frame[LINK_FRAME_HEADER_SIZE + 1];
+    LinkFrameHeader h = { LINK_FRAME_CONTROL, 0, 1, 0, 0 };
+    linkFrameWriteHeader(frame, h);
+    frame[LINK_FRAME_HEADER_SIZE] = LINK_CTRL_REC_LIST;
+    return write(fd, frame, sizeof(frame)) == (ssize_t)sizeof(frame);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [options] SOURCE\n"
+            "\n"
+            "SOURCE:\n"
+            "  rfcomm:AA:BB:CC:DD:EE:FF[/channel]   BlueZ RFCOMM\n"
+            "  tty:/dev/rfcomm0                     serial device\n"
+            "  pty                                  pseudo terminal (testing)\n"
+            "  tcp:HOST:PORT | tcp-listen:PORT      TCP (testing)\n"
+            "\n"
+            "options:\n"
+            "  -s, --shm NAME          shared memory ring name (default %s)\n"
+            "  -r, --rate HZ           sample rate (default %d)\n"
+            "  -b, --ring-seconds N    ring capacity in seconds (default %d)\n"
+            "  -w, --wav-dir DIR       write rotating WAV files to DIR\n"
+            "  -R, --rotate SECONDS    WAV rotation interval (default 600)\n"
+            "  -F, --features FILE     request log-mel feature mode and write float32\n"
+            "                          [frames][%d] to FILE (may be a FIFO)\n"
+            "  -P, --replay-seconds N  on SIGUSR1, fetch the last N seconds from the device\n"
+            "                          history (default %d) into the WAV dir (or current dir)\n"
+            "  -S, --sync              on connect, fetch the speech regions of new SD\n"
+            "                          recordings into the WAV dir (or current dir)\n"
+            "  -A, --sync-all          like -S but fetch whole recordings\n"
+            "  -f, --frame-ms MS       preferred frame duration when negotiating with the\n"
+            "                          device (default: the longest it offers)\n",
+            argv0, DEFAULT_SHM_NAME, DEFAULT_SAMPLE_RATE, DEFAULT_RING_SECONDS, FEATURE_NUM_MELS,
+            DEFAULT_REPLAY_SECONDS);
+}
+
+int main(int argc, char** argv) {
+    const char* shmName = DEFAULT_SHM_NAME;
+    const char* wavDir = nullptr;
+    const char* featurePath = nullptr;
+    uint32_t sampleRate = DEFAULT_SAMPLE_RATE;
+    uint32_t ringSeconds = DEFAULT_RING_SECONDS;
+    uint32_t rotateSeconds = 600;
+    uint32_t replaySeconds = DEFAULT_REPLAY_SECONDS;
+    int syncMode = -1;
+    uint32_t frameMs = 0;
+
+    static const option longOptions[] = {
+        { "shm", required_argument, nullptr, 's' },
+        { "rate", required_argument, nullptr, 'r' },
+        { "ring-seconds", required_argument, nullptr, 'b' },
+        { "wav-dir", required_argument, nullptr, 'w' },
+        { "rotate", required_argument, nullptr, 'R' },
+        { "features", required_argument, nullptr, 'F' },
+        { "replay-seconds", required_argument, nullptr, 'P' },
+        { "sync", no_argument, nullptr, 'S' },
+        { "sync-all", no_argument, nullptr, 'A' },
+        { "frame-ms", required_argument, nullptr, 'f' },
+        { "help", no_argument, nullptr, 'h' },
+        { nullptr, 0, nullptr, 0 },
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:r:b:w:R:F:P:SAf:h", longOptions, nullptr)) != -1) {
+        switch (opt) {
+            case 's': shmName = optarg; break;
+            case 'r': sampleRate = atoi(optarg); break;
+            case 'b': ringSeconds = atoi(optarg); break;
+            case 'w': wavDir = optarg; break;
+            case 'R': rotateSeconds = atoi(optarg); break;
+            case 'F': featurePath = optarg; break;
+            case 'P': replaySeconds = atoi(optarg); break;
+            case 'S': syncMode = LINK_REC_FETCH_SPEECH; break;
+            case 'A': syncMode = LINK_REC_FETCH_ALL; break;
+            case 'f': frameMs = atoi(optarg); break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    IngestSource source;
+    if (!ingestParse(source, argv[optind])) {
+        fprintf(stderr, "invalid source: %s\n", argv[optind]);
+        return 2;
+    }
+
+    if (sampleRate == 0 || ringSeconds == 0 || (uint64_t)sampleRate * ringSeconds > MAX_RING_SAMPLES) {
+        fprintf(stderr, "invalid -r %u / -b %u: both must be positive and the ring at most %u samples\n",
+                sampleRate, ringSeconds, MAX_RING_SAMPLES);
+        return 2;
+    }
+
+    // 容量は 2 のべき乗に切り上げ（最低でも復号後の 1 フレームが入る大きさ）
+    uint32_t capacity = LINK_FRAME_MAX_PAYLOAD * 2;
+    while (capacity < sampleRate * ringSeconds) capacity <<= 1;
+
+    Daemon* d = new Daemon();
+    if (!shmRingCreate(d->ring, shmName, capacity, sampleRate)) return 1;
+    if (wavDir) {
+        d->wavEnabled = wavSinkOpen(d->wav, wavDir, sampleRate, rotateSeconds);
+    }
+    if (featurePath) {
+        d->featureOut = fopen(featurePath, "wb");
+        if (!d->featureOut) {
+            fprintf(stderr, "cannot open %s: %s\n", featurePath, strerror(errno));
+            return 1;
+        }
+    }
+    d->replay.dir = wavDir ? wavDir : ".";
+    d->replay.seconds = replaySeconds;
+    d->sync.enabled = syncMode >= 0;
+    d->sync.mode = syncMode >= 0 ? syncMode : LINK_REC_FETCH_SPEECH;
+    d->sync.dir = d->replay.dir;
+    d->frameMs = frameMs;
+    if (wavDir) d->sessionLog = std::string(wavDir) + "/m5scribe-sessions.tsv";
+    double load = adpcmDecodeLoad(sampleRate);
+    d->adpcmAffordable = load <= NEGOTIATE_CPU_BUDGET;
+    fprintf(stderr, "[m5scribed] ADPCM decode %.3f%% cpu%s\n", load * 100.0,
+            d->adpcmAffordable ? "" : " (over budget, will not select ADPCM)");
+    fprintf(stderr, "[m5scribed] ring %s: %u samples (%.1f s)\n", shmName, capacity, (double)capacity / sampleRate);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGUSR1, onReplaySignal);
+
+    LinkFrameParser* parser = new LinkFrameParser();
+    uint8_t buf[4096];
+
+    DaemonStats lastStats;
+    double lastCpu = cpuSeconds();
+    uint64_t lastStatsNs = monotonicNs();
+
+    while (running) {
+        int fd = ingestOpen(source);
+        if (fd < 0) {
+            if (!ingestReconnectable(source)) break;
+            sleep(RECONNECT_DELAY_SEC);
+            continue;
+        }
+        fprintf(stderr, "[m5scribed] connected\n");
+        linkFrameParserReset(*parser);
+        d->haveSeq = false;
+        if (d->featureOut && !requestFeatures(fd)) {
+            fprintf(stderr, "[m5scribed] failed to request feature mode\n");
+        }
+        d->fd = fd;
+        d->neg = Negotiation();
+        uint8_t capsQuery = LINK_CTRL_CAPS;
+        if (!sendControl(fd, &capsQuery, 1)) {
+            fprintf(stderr, "[m5scribed] failed to query capabilities\n");
+        }
+        d->sync.listed.clear();
+        d->sync.pending.clear();
+        d->sync.requestNs = 0;
+        if (d->sync.enabled && !requestRecordingList(fd)) {
+            fprintf(stderr, "[m5scribed] failed to request the recording list\n");
+        }
+
+        while (running) {
+            pollfd pfd = { fd, POLLIN, 0 };
+            int ready = poll(&pfd, 1, 1000);
+
+            if (monotonicNs() - lastStatsNs >= STATS_INTERVAL_NS) {
+                logStats(*d, lastStats, lastCpu, lastStatsNs);
+            }
+            if (d->neg.probeNs && monotonicNs() - d->neg.probeNs >= NEGOTIATE_PROBE_NS) {
+                finishProbe(d);
+            }
+            if (replayWanted) {
+                replayWanted = 0;
+                d->replay.pcm.clear();
+                d->replay.firstNs = 0;
+                d->replay.skipped = d->replay.liveSamples = 0;
+                d->replay.requestNs = monotonicNs();
+                if (!requestReplay(fd, d->replay.seconds * d->ring.header->sampleRate)) {
+                    fprintf(stderr, "[m5scribed] failed to request replay\n");
+                    d->replay.requestNs = 0;
+                } else {
+                    fprintf(stderr, "[replay] requested the last %u s\n", d->replay.seconds);
+                }
+            }
+            if (ready <= 0) continue;
+
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                fprintf(stderr, "[m5scribed] connection closed\n");
+                break;
+            }
+
+            d->currentIngestNs = monotonicNs();
+            d->stats.bytesIn += n;
+            linkFrameParserPush(*parser, buf, n, handleFrame, d);
+        }
+
+        ingestCloseConnection(source);
+        if (!ingestReconnectable(source)) continue;
+        if (running) sleep(RECONNECT_DELAY_SEC);
+    }
+
+    ingestShutdown(source);
+    if (d->wavEnabled) wavSinkClose(d->wav);
+    if (d->featureOut) fclose(d->featureOut);
+    shmRingClose(d->ring);
+    fprintf(stderr, "[m5scribed] stopped (parser resyncs: %u)\n", parser->resyncCount);
+    delete parser;
+    delete d;
+    return 0;
+}
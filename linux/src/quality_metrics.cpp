@@ -0,0 +1,211 @@
+/**
+ * 音質の客観指標の実装
+ */
+#include "quality_metrics.h"
+
+#include <math.h>
+#include <complex>
+#include <vector>
+
+#define QM_SAMPLE_RATE      16000
+#define QM_SEG_FRAME        320     // segSNR（20ms）
+#define QM_STFT_FRAME       400     // LSD / STOI（25ms、STOI の 256 / 10kHz 相当）
+#define QM_STFT_HOP         200
+#define QM_FFT_SIZE         512
+#define QM_SILENCE_DB       40.0    // 最大のフレームからこれ以上小さいフレームは無音として除く
+#define QM_SEG_MIN_DB       -10.0
+#define QM_SEG_MAX_DB       35.0
+#define QM_STOI_BANDS       15      // 1/3 オクターブ、150Hz から
+#define QM_STOI_SEGMENT     30      // 相関を取るフレーム数（384ms 相当）
+#define QM_STOI_CLIP_DB     -15.0   // 処理後の包絡を基準の (1 + 10^(-β/20)) 倍で抑える
+
+typedef std::complex<double> Complex;
+
+static void fft(std::vector<Complex>& a) {
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        Complex w(cos(-2 * M_PI / len), sin(-2 * M_PI / len));
+        for (size_t i = 0; i < n; i += len) {
+            Complex wk(1);
+            for (size_t k = 0; k < len / 2; k++) {
+                Complex u = a[i + k], v = a[i + k + len / 2] * wk;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+                wk *= w;
+            }
+        }
+    }
+}
+
+// 窓を掛けたフレームのパワースペクトル（QM_FFT_SIZE / 2 + 1 点）
+static void powerSpectrum(const int16_t* x, const std::vector<double>& window, std::vector<double>& power) {
+    std::vector<Complex> buf(QM_FFT_SIZE);
+    for (int i = 0; i < QM_STFT_FRAME; i++) buf[i] = x[i] * window[i];
+    fft(buf);
+    power.resize(QM_FFT_SIZE / 2 + 1);
+    for (int k = 0; k <= QM_FFT_SIZE / 2; k++) power[k] = std::norm(buf[k]);
+}
+
+int alignDelay(const int16_t* ref, const int16_t* out, size_t n, int maxLag) {
+    size_t span = 10 * QM_SAMPLE_RATE;
+    size_t start = n > span ? (n - span) / 2 : 0;
+    size_t end = n > span ? start + span : n;
+
+    int best = 0;
+    double bestCorr = -INFINITY;
+    for (int lag = -maxLag; lag <= maxLag; lag++) {
+        double corr = 0;
+        for (size_t i = start; i < end; i++) {
+            long j = (long)i + lag;
+            if (j >= 0 && j < (long)n) corr += (double)ref[i] * out[j];
+        }
+        if (corr > bestCorr) {
+            bestCorr = corr;
+            best = lag;
+        }
+    }
+    return best;
+}
+
+static void addSnr(QualityTotals& t, const int16_t* ref, const int16_t* out, size_t n) {
+    // 全体
+    for (size_t i = 0; i < n; i++) {
+        double e = (double)out[i] - ref[i];
+        t.signal += (double)ref[i] * ref[i];
+        t.noise += e * e;
+    }
+
+    // フレームごと（無音フレームを除く）
+    size_t frames = n / QM_SEG_FRAME;
+    std::vector<double> energy(frames), error(frames);
+    double maxEnergy = 0;
+    for (size_t f = 0; f < frames; f++) {
+        for (size_t i = f * QM_SEG_FRAME; i < (f + 1) * QM_SEG_FRAME; i++) {
+            double e = (double)out[i] - ref[i];
+            energy[f] += (double)ref[i] * ref[i];
+            error[f] += e * e;
+        }
+        if (energy[f] > maxEnergy) maxEnergy = energy[f];
+    }
+    double floor = maxEnergy * pow(10.0, -QM_SILENCE_DB / 10.0);
+    for (size_t f = 0; f < frames; f++) {
+        if (energy[f] <= floor || energy[f] == 0) continue;
+        double db = 10.0 * log10(energy[f] / (error[f] + 1e-9));
+        t.segSnrSum += db < QM_SEG_MIN_DB ? QM_SEG_MIN_DB : (db > QM_SEG_MAX_DB ? QM_SEG_MAX_DB : db);
+        t.segSnrFrames++;
+    }
+}
+
+// 1/3 オクターブ帯域に入る FFT の範囲 [lo, hi)
+static void bandBins(int band, int& lo, int& hi) {
+    double center = 150.0 * pow(2.0, band / 3.0);
+    double binHz = (double)QM_SAMPLE_RATE / QM_FFT_SIZE;
+    lo = (int)lround(center * pow(2.0, -1.0 / 6.0) / binHz);
+    hi = (int)lround(center * pow(2.0, 1.0 / 6.0) / binHz);
+    if (hi <= lo) hi = lo + 1;
+}
+
+// 基準と処理後の包絡（帯域 × フレーム）の区間ごとの相関
+static void addStoi(QualityTotals& t, const std::vector<double>& refEnv, const std::vector<double>& outEnv,
+                    size_t frames) {
+    const double clip = 1.0 + pow(10.0, -QM_STOI_CLIP_DB / 20.0);
+    for (size_t m = QM_STOI_SEGMENT; m <= frames; m++) {
+        for (int b = 0; b < QM_STOI_BANDS; b++) {
+            double x[QM_STOI_SEGMENT], y[QM_STOI_SEGMENT];
+            double xx = 0, yy = 0;
+            for (int i = 0; i < QM_STOI_SEGMENT; i++) {
+                size_t f = m - QM_STOI_SEGMENT + i;
+                x[i] = refEnv[f * QM_STOI_BANDS + b];
+                y[i] = outEnv[f * QM_STOI_BANDS + b];
+                xx += x[i] * x[i];
+                yy += y[i] * y[i];
+            }
+            // 処理後の包絡を基準のエネルギーに合わせ、大きく外れた分を抑えてから相関を取る
+            double alpha = yy > 0 ? sqrt(xx / yy) : 0;
+            double xm = 0, ym = 0;
+            for (int i = 0; i < QM_STOI_SEGMENT; i++) {
+                y[i] = fmin(alpha * y[i], clip * x[i]);
+                xm += x[i];
+                ym += y[i];
+            }
+            xm /= QM_STOI_SEGMENT;
+            ym /= QM_STOI_SEGMENT;
+            double sxy = 0, sxx = 0, syy = 0;
+            for (int i = 0; i < QM_STOI_SEGMENT; i++) {
+                sxy += (x[i] - xm) * (y[i] - ym);
+                sxx += (x[i] - xm) * (x[i] - xm);
+                syy += (y[i] - ym) * (y[i] - ym);
+            }
+            if (sxx <= 0 || syy <= 0) continue;
+            t.stoiSum += sxy / sqrt(sxx * syy);
+            t.stoiCount++;
+        }
+    }
+}
+
+static void addSpectral(QualityTotals& t, const int16_t* ref, const int16_t* out, size_t n) {
+    if (n < QM_STFT_FRAME) return;
+    std::vector<double> window(QM_STFT_FRAME);
+    for (int i = 0; i < QM_STFT_FRAME; i++) window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / QM_STFT_FRAME);
+
+    // 無音フレームの判定（基準の窓掛けエネルギー）
+    size_t frames = (n - QM_STFT_FRAME) / QM_STFT_HOP + 1;
+    std::vector<double> energy(frames);
+    double maxEnergy = 0;
+    for (size_t f = 0; f < frames; f++) {
+        const int16_t* x = ref + f * QM_STFT_HOP;
+        for (int i = 0; i < QM_STFT_FRAME; i++) energy[f] += (x[i] * window[i]) * (x[i] * window[i]);
+        if (energy[f] > maxEnergy) maxEnergy = energy[f];
+    }
+    double floor = maxEnergy * pow(10.0, -QM_SILENCE_DB / 10.0);
+
+    int lo[QM_STOI_BANDS], hi[QM_STOI_BANDS];
+    for (int b = 0; b < QM_STOI_BANDS; b++) bandBins(b, lo[b], hi[b]);
+
+    std::vector<double> refPower, outPower, refEnv, outEnv;
+    size_t kept = 0;
+    for (size_t f = 0; f < frames; f++) {
+        if (energy[f] <= floor || energy[f] == 0) continue;
+        powerSpectrum(ref + f * QM_STFT_HOP, window, refPower);
+        powerSpectrum(out + f * QM_STFT_HOP, window, outPower);
+
+        // LSD（直流を除く、-1 LSB 相当より小さいパワーは揃える）
+        double sum = 0;
+        for (int k = 1; k <= QM_FFT_SIZE / 2; k++) {
+            double d = 10.0 * log10((refPower[k] + 1.0) / (outPower[k] + 1.0));
+            sum += d * d;
+        }
+        t.lsdSum += sqrt(sum / (QM_FFT_SIZE / 2));
+        t.lsdFrames++;
+
+        for (int b = 0; b < QM_STOI_BANDS; b++) {
+            double r = 0, o = 0;
+            for (int k = lo[b]; k < hi[b]; k++) {
+                r += refPower[k];
+                o += outPower[k];
+            }
+            refEnv.push_back(sqrt(r));
+            outEnv.push_back(sqrt(o));
+        }
+        kept++;
+    }
+    addStoi(t, refEnv, outEnv, kept);
+}
+
+void qualityAccumulate(QualityTotals& totals, const int16_t* ref, const int16_t* out, size_t n) {
+    addSnr(totals, ref, out, n);
+    addSpectral(totals, ref, out, n);
+}
+
+void qualityFinish(const QualityTotals& t, QualityResult& r) {
+    r.snrDb = t.noise > 0 ? 10.0 * log10(t.signal / t.noise) : INFINITY;
+    r.segSnrDb = t.segSnrFrames ? t.segSnrSum / t.segSnrFrames : 0;
+    r.lsdDb = t.lsdFrames ? t.lsdSum / t.lsdFrames : 0;
+    r.stoi = t.stoiCount ? t.stoiSum / t.stoiCount : 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * 音質の客観指標（評価ツール用、16kHz / 16bit / モノラル）
+ *
+ * 基準（元の音声）と処理後の音声を比べる。処理後は alignDelay() で基準に揃えてから渡す。
+ *   SNR        : 全体の信号 / 誤差（波形が一致するほど高い、位相の変わるフィルタでは下がる）
+ *   segSNR     : 20ms フレームごとの SNR を [-10, 35] dB に丸めた平均（無音フレームは除く）
+ *   LSD        : 25ms フレームごとの対数スペクトルの差の RMS（dB、位相は見ない）
+ *   STOI       : 短時間客観了解度（Taal et al. 2011）の手順を 10kHz に落とさず 16kHz のまま行った推定値
+ * PESQ（ITU-T P.862）はライセンスの都合で実装しない。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 指標ごとの合計（ファイルをまたいで足し、qualityFinish() で平均にする）
+struct QualityTotals {
+    double signal = 0;          // SNR
+    double noise = 0;
+    double segSnrSum = 0;       // segSNR
+    uint64_t segSnrFrames = 0;
+    double lsdSum = 0;          // LSD
+    uint64_t lsdFrames = 0;
+    double stoiSum = 0;         // STOI（帯域 × 区間ごとの相関）
+    uint64_t stoiCount = 0;
+};
+
+struct QualityResult {
+    double snrDb;
+    double segSnrDb;
+    double lsdDb;
+    double stoi;
+};
+
+/**
+ * out が ref から何サンプル遅れているか（相互相関が最大のずれ、±maxLag）
+ *
+ * 長い音声は中ほどの 10 秒だけで求める。
+ */
+int alignDelay(const int16_t* ref, const int16_t* out, size_t n, int maxLag);
+
+// ref と out（同じ長さ n、揃え済み）の指標を totals に足す
+void qualityAccumulate(QualityTotals& totals, const int16_t* ref, const int16_t* out, size_t n);
+
+void qualityFinish(const QualityTotals& totals, QualityResult& result);
@@ -0,0 +1,204 @@
+/**
+ * 共有メモリ PCM リングバッファの実装
+ */
+#include "shm_ring.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+uint64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static size_t ringBytes(uint32_t capacity) {
+    return sizeof(ShmRingHeader) + (size_t)capacity * sizeof(int16_t);
+}
+
+bool shmRingCreate(ShmRing& ring, const char* name, uint32_t capacity, uint32_t sampleRate) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        fprintf(stderr, "shm ring capacity must be a power of two\n");
+        return false;
+    }
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        return false;
+    }
+
+    size_t size = ringBytes(capacity);
+    if (ftruncate(fd, size) != 0) {
+        perror("ftruncate");
+        close(fd);
+        return false;
+    }
+
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+
+    memset(mem, 0, size);
+    ring.header = (ShmRingHeader*)mem;
+    ring.samples = (int16_t*)((uint8_t*)mem + sizeof(ShmRingHeader));
+    ring.mappedSize = size;
+    ring.owner = true;
+    snprintf(ring.name, sizeof(ring.name), "%s", name);
+
+    ring.header->version = SHM_RING_VERSION;
+    ring.header->sampleRate = sampleRate;
+    ring.header->capacity = capacity;
+    // magic は最後に書く（読み出し側は magic で初期化完了を判定する）
+    std::atomic_thread_fence(std::memory_order_release);
+    ring.header->magic = SHM_RING_MAGIC;
+    return true;
+}
+
+void shmRingWrite(ShmRing& ring, const int16_t* data, size_t count, uint64_t ingestNs) {
+    ShmRingHeader* h = ring.header;
+    uint32_t mask = h->capacity - 1;
+    uint64_t pos = h->writePos.load(std::memory_order_relaxed);
+
+    // 容量より長ければ最後の capacity サンプルだけ残す（位置は全体の分だけ進める）
+    if (count > h->capacity) {
+        size_t skip = count - h->capacity;
+        data += skip;
+        pos += skip;
+        count = h->capacity;
+    }
+
+    // 折り返しを考慮して 2 回に分けてコピー
+    size_t start = pos & mask;
+    size_t first = count < h->capacity - start ? count : h->capacity - start;
+    memcpy(ring.samples + start, data, first * sizeof(int16_t));
+    memcpy(ring.samples, data + first, (count - first) * sizeof(int16_t));
+
+    uint64_t endPos = pos + count;
+    uint64_t seq = h->slotSeq.load(std::memory_order_relaxed);
+    ShmRingSlot& slot = h->slots[seq % SHM_RING_SLOTS];
+    slot.endPos.store(0, std::memory_order_relaxed);   // 更新中
+    slot.ingestNs.store(ingestNs, std::memory_order_relaxed);
+    slot.publishNs.store(monotonicNs(), std::memory_order_relaxed);
+    slot.endPos.store(endPos, std::memory_order_release);
+    h->slotSeq.store(seq + 1, std::memory_order_release);
+
+    h->writePos.store(endPos, std::memory_order_release);
+}
+
+bool shmRingAttach(ShmRing& ring, const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        perror("shm_open");
+        return false;
+    }
+
+    // まずヘッダーだけ map して容量を知る
+    void* mem = mmap(nullptr, sizeof(ShmRingHeader), PROT_READ, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        close(fd);
+        return false;
+    }
+    const ShmRingHeader* h = (const ShmRingHeader*)mem;
+    if (h->magic != SHM_RING_MAGIC || h->version != SHM_RING_VERSION) {
+        fprintf(stderr, "%s: not an m5scribe ring (or not ready yet)\n", name);
+        munmap(mem, sizeof(ShmRingHeader));
+        close(fd);
+        return false;
+    }
+    uint32_t capacity = h->capacity;
+    munmap(mem, sizeof(ShmRingHeader));
+
+    size_t size = ringBytes(capacity);
+    mem = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+
+    ring.header = (ShmRingHeader*)mem;
+    ring.samples = (int16_t*)((uint8_t*)mem + sizeof(ShmRingHeader));
+    ring.mappedSize = size;
+    ring.owner = false;
+    snprintf(ring.name, sizeof(ring.name), "%s", name);
+    return true;
+}
+
+size_t shmRingRead(ShmRing& ring, uint64_t& pos, int16_t* out, size_t maxCount, uint64_t* dropped) {
+    ShmRingHeader* h = ring.header;
+    uint32_t capacity = h->capacity;
+    uint32_t mask = capacity - 1;
+
+    uint64_t writePos = h->writePos.load(std::memory_order_acquire);
+    uint64_t skipped = 0;
+    if (writePos - pos > capacity) {
+        // 追い越された
+        skipped = writePos - capacity - pos;
+        pos = writePos - capacity;
+    }
+
+    size_t count = writePos - pos < maxCount ? writePos - pos : maxCount;
+    size_t start = pos & mask;
+    size_t first = count < capacity - start ? count : capacity - start;
+    memcpy(out, ring.samples + start, first * sizeof(int16_t));
+    memcpy(out + first, ring.samples, (count - first) * sizeof(int16_t));
+
+    // コピー中に上書きされた先頭部分は捨てる
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = h->writePos.load(std::memory_order_relaxed);
+    if (after - pos > capacity) {
+        uint64_t torn = after - capacity - pos;
+        if (torn >= count) torn = count;
+        memmove(out, out + torn, (count - torn) * sizeof(int16_t));
+        count -= torn;
+        skipped += torn;
+        pos += torn;
+    }
+
+    pos += count;
+    if (dropped) *dropped = skipped;
+    return count;
+}
+
+bool shmRingLookupTimes(ShmRing& ring, uint64_t pos, uint64_t& ingestNs, uint64_t& publishNs) {
+    ShmRingHeader* h = ring.header;
+    uint64_t seq = h->slotSeq.load(std::memory_order_acquire);
+    uint64_t oldest = seq > SHM_RING_SLOTS ? seq - SHM_RING_SLOTS : 0;
+
+    // 新しい方から、pos を含む最初のブロックを探す
+    for (uint64_t s = seq; s > oldest; s--) {
+        ShmRingSlot& slot = h->slots[(s - 1) % SHM_RING_SLOTS];
+        uint64_t endPos = slot.endPos.load(std::memory_order_acquire);
+        if (endPos == 0) continue;
+
+        uint64_t prevEnd = 0;
+        if (s - 1 > oldest) {
+            prevEnd = h->slots[(s - 2) % SHM_RING_SLOTS].endPos.load(std::memory_order_acquire);
+        }
+        if (pos >= prevEnd && pos < endPos) {
+            ingestNs = slot.ingestNs.load(std::memory_order_relaxed);
+            publishNs = slot.publishNs.load(std::memory_order_relaxed);
+            return slot.endPos.load(std::memory_order_acquire) == endPos;
+        }
+    }
+    return false;
+}
+
+void shmRingClose(ShmRing& ring) {
+    if (ring.header) {
+        munmap(ring.header, ring.mappedSize);
+        if (ring.owner) shm_unlink(ring.name);
+    }
+    ring.header = nullptr;
+    ring.samples = nullptr;
+}
@@ -0,0 +1,64 @@
+/**
+ * 共有メモリ PCM リングバッファ
+ *
+ * 書き込みは m5scribed の 1 プロセスのみ、読み出しは任意個数のローカルプロセス。
+ * 読み出し側はそれぞれ自分の読み出し位置を持ち、追い越された分は読み飛ばす。
+ *
+ *   [ShmRingHeader][int16_t samples[capacity]]
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHM_RING_MAGIC    0x5253354D  // 'M5SR'
+#define SHM_RING_VERSION  1
+#define SHM_RING_SLOTS    64          // 直近の書き込みブロックの受信時刻（遅延計測用）
+
+struct ShmRingSlot {
+    std::atomic<uint64_t> endPos;     // このブロック末尾のサンプル位置
+    std::atomic<uint64_t> ingestNs;   // リンクから読み込んだ時刻（CLOCK_MONOTONIC）
+    std::atomic<uint64_t> publishNs;  // リングに書き込んだ時刻
+};
+
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t capacity;                // サンプル数（2 のべき乗）
+    std::atomic<uint64_t> writePos;   // 書き込み済みサンプル総数
+    std::atomic<uint64_t> slotSeq;    // slots への書き込み回数
+    ShmRingSlot slots[SHM_RING_SLOTS];
+};
+
+struct ShmRing {
+    ShmRingHeader* header = nullptr;
+    int16_t* samples = nullptr;
+    size_t mappedSize = 0;
+    bool owner = false;
+    char name[64] = {};
+};
+
+// 書き込み側（m5scribed）
+bool shmRingCreate(ShmRing& ring, const char* name, uint32_t capacity, uint32_t sampleRate);
+// count が容量を超えたら最後の capacity サンプルだけ書く
+void shmRingWrite(ShmRing& ring, const int16_t* data, size_t count, uint64_t ingestNs);
+
+// 読み出し側
+bool shmRingAttach(ShmRing& ring, const char* name);
+
+/**
+ * pos から最大 maxCount サンプル読み出す
+ *
+ * 追い越されていた場合は読めるところまで pos を進め、読み飛ばしたサンプル数を *dropped に返す。
+ * @return 読み出したサンプル数
+ */
+size_t shmRingRead(ShmRing& ring, uint64_t& pos, int16_t* out, size_t maxCount, uint64_t* dropped);
+
+// pos を含むブロックの受信時刻・書き込み時刻（見つからなければ false）
+bool shmRingLookupTimes(ShmRing& ring, uint64_t pos, uint64_t& ingestNs, uint64_t& publishNs);
+
+void shmRingClose(ShmRing& ring);
+
+uint64_t monotonicNs();
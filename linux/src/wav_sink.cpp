@@ -0,0 +1,153 @@
+/**
+ * 時間でローテーションする WAV ファイル出力の実装
+ */
+#include "wav_sink.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define WAV_HEADER_SIZE 44
+#define HEADER_UPDATE_SECONDS 5
+
+static void putLe16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void putLe32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+// 16bit モノラル PCM の RIFF ヘッダーを書く（dataBytes は現在のデータサイズ）
+static void writeHeader(FILE* f, uint32_t sampleRate, uint32_t dataBytes) {
+    uint8_t h[WAV_HEADER_SIZE];
+    memcpy(h, "RIFF", 4);
+    putLe32(h + 4, 36 + dataBytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    putLe32(h + 16, 16);              // fmt チャンクサイズ
+    putLe16(h + 20, 1);               // PCM
+    putLe16(h + 22, 1);               // モノラル
+    putLe32(h + 24, sampleRate);
+    putLe32(h + 28, sampleRate * 2);  // バイトレート
+    putLe16(h + 32, 2);               // ブロックサイズ
+    putLe16(h + 34, 16);              // ビット深度
+    memcpy(h + 36, "data", 4);
+    putLe32(h + 40, dataBytes);
+
+    fseek(f, 0, SEEK_SET);
+    fwrite(h, 1, sizeof(h), f);
+    fseek(f, 0, SEEK_END);
+}
+
+static void finishFile(WavSink& sink) {
+    if (!sink.file) return;
+    writeHeader(sink.file, sink.sampleRate, (uint32_t)(sink.samplesInFile * 2));
+    fclose(sink.file);
+    fprintf(stderr, "[wav] closed %s (%.1f s)\n", sink.path.c_str(),
+            (double)sink.samplesInFile / sink.sampleRate);
+    sink.file = nullptr;
+}
+
+static bool startFile(WavSink& sink) {
+    char name[64];
+    time_t now = time(nullptr);
+    strftime(name, sizeof(name), "m5scribe-%Y%m%d-%H%M%S.wav", localtime(&now));
+    sink.path = sink.dir + "/" + name;
+
+    sink.file = fopen(sink.path.c_str(), "wb+");
+    if (!sink.file) {
+        perror(sink.path.c_str());
+        return false;
+    }
+    writeHeader(sink.file, sink.sampleRate, 0);
+    sink.samplesInFile = 0;
+    sink.samplesSinceHeaderUpdate = 0;
+    sink.filesWritten++;
+    fprintf(stderr, "[wav] writing %s\n", sink.path.c_str());
+    return true;
+}
+
+bool wavSinkOpen(WavSink& sink, const char* dir, uint32_t sampleRate, uint32_t rotateSeconds) {
+    sink.dir = dir;
+    sink.sampleRate = sampleRate;
+    sink.rotateSeconds = rotateSeconds;
+    mkdir(dir, 0755);
+    return true;
+}
+
+bool wavSinkWrite(WavSink& sink, const int16_t* samples, size_t count) {
+    if (!sink.file && !startFile(sink)) return false;
+
+    // 16bit LE をそのまま書く（x86 / ARM Linux はリトルエンディアン）
+    if (fwrite(samples, sizeof(int16_t), count, sink.file) != count) {
+        perror(sink.path.c_str());
+        return false;
+    }
+    sink.samplesInFile += count;
+    sink.samplesSinceHeaderUpdate += count;
+
+    if (sink.samplesSinceHeaderUpdate >= (uint64_t)sink.sampleRate * HEADER_UPDATE_SECONDS) {
+        writeHeader(sink.file, sink.sampleRate, (uint32_t)(sink.samplesInFile * 2));
+        fflush(sink.file);
+        sink.samplesSinceHeaderUpdate = 0;
+    }
+
+    if (sink.samplesInFile >= (uint64_t)sink.sampleRate * sink.rotateSeconds) {
+        finishFile(sink);
+    }
+    return true;
+}
+
+void wavSinkClose(WavSink& sink) {
+    finishFile(sink);
+}
+
+bool wavReadFile(const char* path, uint32_t sampleRate, std::vector<int16_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    uint8_t riff[12];
+    bool ok = fread(riff, 1, 12, f) == 12 && memcmp(riff, "RIFF", 4) == 0 && memcmp(riff + 8, "WAVE", 4) == 0;
+    bool formatOk = false;
+    while (ok) {
+        uint8_t chunk[8];
+        if (fread(chunk, 1, 8, f) != 8) break;
+        uint32_t size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < 16 || fread(fmt, 1, 16, f) != 16) break;
+            uint16_t channels = fmt[2] | (fmt[3] << 8);
+            uint32_t rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            uint16_t bits = fmt[14] | (fmt[15] << 8);
+            formatOk = (fmt[0] == 1 && channels == 1 && rate == sampleRate && bits == 16);
+            fseek(f, size - 16 + (size & 1), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!formatOk) break;
+            out.resize(size / 2);
+            out.resize(fread(out.data(), 2, out.size(), f));
+            fclose(f);
+            return true;
+        } else {
+            fseek(f, size + (size & 1), SEEK_CUR);
+        }
+    }
+    fclose(f);
+    return false;
+}
+
+bool wavWriteFile(const char* path, uint32_t sampleRate, const int16_t* samples, size_t count) {
+    FILE* f = fopen(path, "wb+");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    writeHeader(f, sampleRate, (uint32_t)(count * 2));
+    bool ok = fwrite(samples, sizeof(int16_t), count, f) == count;
+    if (fclose(f) != 0) ok = false;
+    if (!ok) perror(path);
+    return ok;
+}
@@ -0,0 +1,35 @@
+/**
+ * 時間でローテーションする WAV ファイル出力
+ *
+ * <dir>/m5scribe-YYYYmmdd-HHMMSS.wav を rotateSeconds ごとに切り替える。
+ * 異常終了しても再生できるよう、ヘッダーのサイズは数秒ごとに書き戻す。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct WavSink {
+    std::string dir;
+    uint32_t sampleRate = 16000;
+    uint32_t rotateSeconds = 600;
+
+    FILE* file = nullptr;
+    std::string path;
+    uint64_t samplesInFile = 0;
+    uint64_t samplesSinceHeaderUpdate = 0;
+    uint32_t filesWritten = 0;
+};
+
+bool wavSinkOpen(WavSink& sink, const char* dir, uint32_t sampleRate, uint32_t rotateSeconds);
+bool wavSinkWrite(WavSink& sink, const int16_t* samples, size_t count);
+void wavSinkClose(WavSink& sink);
+
+// 評価ツール用：モノラル 16bit PCM の WAV を読む（サンプルレートが違えば false）
+bool wavReadFile(const char* path, uint32_t sampleRate, std::vector<int16_t>& out);
+
+// モノラル 16bit PCM をまとめて 1 つの WAV に書く
+bool wavWriteFile(const char* path, uint32_t sampleRate, const int16_t* samples, size_t count);
@@ -0,0 +1,91 @@
+/**
+ * IMA-ADPCM の実装
+ */
+#include "adpcm.h"
+
+#include "hot_placement.h"
+
+HOT_TABLE(ADPCM) static const int16_t stepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+HOT_TABLE(ADPCM) static const int8_t indexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// コード 1 つ分の状態更新（符号化・復号で共通）
+static inline void applyCode(int& predictor, int& index, uint8_t code) {
+    int step = stepTable[index];
+    int diff = step >> 3;
+    if (code & 4) diff += step;
+    if (code & 2) diff += step >> 1;
+    if (code & 1) diff += step >> 2;
+    predictor += (code & 8) ? -diff : diff;
+    if (predictor > 32767) predictor = 32767;
+    if (predictor < -32768) predictor = -32768;
+
+    index += indexTable[code];
+    if (index < 0) index = 0;
+    if (index > 88) index = 88;
+}
+
+HOT_FUNC(ADPCM) size_t adpcmEncode(AdpcmState& state, const int16_t* pcm, size_t count, uint8_t* out) {
+    int predictor = state.predictor;
+    int index = state.stepIndex;
+
+    out[0] = predictor & 0xFF;
+    out[1] = (predictor >> 8) & 0xFF;
+    out[2] = index;
+    out[3] = 0;
+
+    uint8_t* data = out + ADPCM_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        int step = stepTable[index];
+        int diff = pcm[i] - predictor;
+        uint8_t code = 0;
+        if (diff < 0) {
+            code = 8;
+            diff = -diff;
+        }
+        if (diff >= step) { code |= 4; diff -= step; }
+        if (diff >= step >> 1) { code |= 2; diff -= step >> 1; }
+        if (diff >= step >> 2) { code |= 1; }
+
+        applyCode(predictor, index, code);
+
+        if (i & 1) {
+            data[i / 2] |= code << 4;
+        } else {
+            data[i / 2] = code;
+        }
+    }
+
+    state.predictor = predictor;
+    state.stepIndex = index;
+    return adpcmEncodedSize(count);
+}
+
+size_t adpcmDecode(const uint8_t* payload, size_t length, int16_t* out, size_t maxSamples) {
+    if (length < ADPCM_HEADER_SIZE) return 0;
+
+    int predictor = (int16_t)(payload[0] | (payload[1] << 8));
+    int index = payload[2] > 88 ? 88 : payload[2];
+
+    size_t count = (length - ADPCM_HEADER_SIZE) * 2;
+    if (count > maxSamples) count = maxSamples;
+
+    const uint8_t* data = payload + ADPCM_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t code = (i & 1) ? (data[i / 2] >> 4) : (data[i / 2] & 0x0F);
+        applyCode(predictor, index, code);
+        out[i] = (int16_t)predictor;
+    }
+    return count;
+}
@@ -0,0 +1,34 @@
+/**
+ * IMA-ADPCM（4bit、16bit PCM の 1/4）
+ *
+ * LINK_FRAME_AUDIO_ADPCM のペイロード:
+ *   [0-1]  フレーム先頭の予測値（int16 LE）
+ *   [2]    ステップ番号（0-88）
+ *   [3]    予約
+ *   [4..]  4bit コード（1 バイトに 2 サンプル、下位ニブルが先）
+ *
+ * フレームごとに状態を載せるので、欠落があっても次のフレームから復号できる。
+ * 端末・Linux 受信デーモンで共用する（Android は ImaAdpcm.kt）。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADPCM_HEADER_SIZE 4
+
+struct AdpcmState {
+    int16_t predictor = 0;
+    uint8_t stepIndex = 0;
+};
+
+// ペイロードのバイト数
+inline size_t adpcmEncodedSize(size_t samples) {
+    return ADPCM_HEADER_SIZE + (samples + 1) / 2;
+}
+
+// count サンプルを符号化して out に書き込む（書き込んだバイト数を返す）
+size_t adpcmEncode(AdpcmState& state, const int16_t* pcm, size_t count, uint8_t* out);
+
+// ペイロードを復号する（復号したサンプル数を返す、maxSamples で打ち切り）
+size_t adpcmDecode(const uint8_t* payload, size_t length, int16_t* out, size_t maxSamples);
@@ -0,0 +1,441 @@
+/**
+ * 基本演算の実装（scalar / lane-model / pie の切り替え）
+ */
+#include "audio_kernels.h"
+
+#include <math.h>
+#include <string.h>
+
+#define LANES       8      // 128bit レジスタ = int16 x 8
+#define DOT_CHUNK   32     // 1 回の累算のブロック数（40bit の累算器があふれない大きさ）
+
+static inline int16_t sat16(int32_t v) {
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+static inline bool aligned16(const void* p) {
+    return ((uintptr_t)p & 15) == 0;
+}
+
+// ---- scalar ----
+
+static void scalarMeter(const int16_t* x, size_t n, AudioMeterResult& out) {
+    int32_t peak = 0;
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        int32_t v = x[i];
+        int32_t a = v < 0 ? -v : v;
+        if (a > peak) peak = a;
+        sum += v * v;
+    }
+    out.peak = peak > 32767 ? 32767 : peak;
+    out.sumSquares = sum;
+}
+
+static int64_t scalarDot(const int16_t* x, const int16_t* y, size_t n) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += (int32_t)x[i] * y[i];
+    return sum;
+}
+
+static void scalarGain(const int16_t* x, int16_t* y, size_t n, int16_t gainQ12) {
+    for (size_t i = 0; i < n; i++) {
+        y[i] = sat16(((int32_t)x[i] * gainQ12) >> AUDIO_KERNELS_GAIN_SHIFT);
+    }
+}
+
+static void scalarNarrow(const int32_t* x, int16_t* y, size_t n, int shift) {
+    for (size_t i = 0; i < n; i++) y[i] = sat16(x[i] >> shift);
+}
+
+static const AudioKernels scalarKernels = {
+    "scalar", scalarMeter, scalarDot, scalarGain, scalarNarrow,
+};
+
+// ---- SIMD の分割（pie / lane-model 共通）----
+//
+// P は 16 バイト境界の本体だけを扱う 3 つの基本命令列を持つ:
+//   dot(x, y, blocks)          blocks <= DOT_CHUNK、40bit の累算を符号拡張して返す
+//   minmax(x, blocks, out16)   レーンごとの最大 8 個・最小 8 個
+//   gain(x, y, blocks, gain8)  レーンごとに sat16((x * g) >> 12)
+
+template <typename P>
+static int64_t simdDotAligned(const int16_t* x, const int16_t* y, size_t blocks) {
+    int64_t sum = 0;
+    while (blocks > 0) {
+        size_t chunk = blocks < DOT_CHUNK ? blocks : DOT_CHUNK;
+        sum += P::dot(x, y, chunk);
+        x += chunk * LANES;
+        y += chunk * LANES;
+        blocks -= chunk;
+    }
+    return sum;
+}
+
+template <typename P>
+static void simdMeter(const int16_t* x, size_t n, AudioMeterResult& out) {
+    // 先頭は境界までスカラー
+    size_t head = 0;
+    while (head < n && !aligned16(x + head)) head++;
+    size_t blocks = (n - head) / LANES;
+
+    AudioMeterResult part;
+    scalarMeter(x, head, out);
+    if (blocks > 0) {
+        const int16_t* body = x + head;
+        out.sumSquares += simdDotAligned<P>(body, body, blocks);
+
+        alignas(16) int16_t lanes[LANES * 2];
+        P::minmax(body, blocks, lanes);
+        for (int i = 0; i < LANES; i++) {
+            int32_t hi = lanes[i];
+            int32_t lo = -(int32_t)lanes[LANES + i];
+            if (hi > out.peak) out.peak = hi;
+            if (lo > out.peak) out.peak = lo > 32767 ? 32767 : lo;
+        }
+    }
+    size_t done = head + blocks * LANES;
+    scalarMeter(x + done, n - done, part);
+    if (part.peak > out.peak) out.peak = part.peak;
+    out.sumSquares += part.sumSquares;
+}
+
+template <typename P>
+static int64_t simdDot(const int16_t* x, const int16_t* y, size_t n) {
+    // 両方が同じ位置で境界に揃う場合だけ本体を SIMD で
+    if (((uintptr_t)x & 15) != ((uintptr_t)y & 15)) return scalarDot(x, y, n);
+    size_t head = 0;
+    while (head < n && !aligned16(x + head)) head++;
+    size_t blocks = (n - head) / LANES;
+    size_t done = head + blocks * LANES;
+    return scalarDot(x, y, head) + simdDotAligned<P>(x + head, y + head, blocks)
+           + scalarDot(x + done, y + done, n - done);
+}
+
+template <typename P>
+static void simdGain(const int16_t* x, int16_t* y, size_t n, int16_t gainQ12) {
+    if (((uintptr_t)x & 15) != ((uintptr_t)y & 15)) {
+        scalarGain(x, y, n, gainQ12);
+        return;
+    }
+    size_t head = 0;
+    while (head < n && !aligned16(x + head)) head++;
+    size_t blocks = (n - head) / LANES;
+    size_t done = head + blocks * LANES;
+
+    alignas(16) int16_t gain8[LANES];
+    for (int i = 0; i < LANES; i++) gain8[i] = gainQ12;
+
+    scalarGain(x, y, head, gainQ12);
+    if (blocks > 0) P::gain(x + head, y + head, blocks, gain8);
+    scalarGain(x + done, y + done, n - done, gainQ12);
+}
+
+// ---- lane-model（pie の命令列を C で再現）----
+
+struct LaneModel {
+    static int64_t dot(const int16_t* x, const int16_t* y, size_t blocks) {
+        // ee.vmulas.s16.accx: 8 レーンの積を 40bit の累算器に足し込む
+        int64_t accx = 0;
+        for (size_t b = 0; b < blocks; b++) {
+            for (int i = 0; i < LANES; i++) {
+                accx += (int32_t)x[b * LANES + i] * y[b * LANES + i];
+            }
+            accx = (int64_t)((uint64_t)accx << 24) >> 24;
+        }
+        return accx;
+    }
+
+    static void minmax(const int16_t* x, size_t blocks, int16_t* out16) {
+        for (int i = 0; i < LANES; i++) out16[i] = out16[LANES + i] = x[i];
+        for (size_t b = 0; b < blocks; b++) {
+            for (int i = 0; i < LANES; i++) {
+                int16_t v = x[b * LANES + i];
+                if (v > out16[i]) out16[i] = v;
+                if (v < out16[LANES + i]) out16[LANES + i] = v;
+            }
+        }
+    }
+
+    static void gain(const int16_t* x, int16_t* y, size_t blocks, const int16_t* gain8) {
+        // ee.vmul.s16（SAR = 12）
+        for (size_t b = 0; b < blocks; b++) {
+            for (int i = 0; i < LANES; i++) {
+                int32_t v = (int32_t)x[b * LANES + i] * gain8[i];
+                y[b * LANES + i] = sat16(v >> AUDIO_KERNELS_GAIN_SHIFT);
+            }
+        }
+    }
+};
+
+static const AudioKernels laneKernels = {
+    "lane-model", simdMeter<LaneModel>, simdDot<LaneModel>, simdGain<LaneModel>, scalarNarrow,
+};
+
+// ---- pie（audio_kernels_s3.S）----
+
+#if AUDIO_KERNELS_PIE
+extern "C" {
+int64_t audio_kernels_pie_dot(const int16_t* x, const int16_t* y, uint32_t blocks);
+void audio_kernels_pie_minmax(const int16_t* x, uint32_t blocks, int16_t* out16);
+void audio_kernels_pie_gain(const int16_t* x, int16_t* y, uint32_t blocks, const int16_t* gain8);
+}
+
+struct Pie {
+    static int64_t dot(const int16_t* x, const int16_t* y, size_t blocks) {
+        return audio_kernels_pie_dot(x, y, blocks);
+    }
+    static void minmax(const int16_t* x, size_t blocks, int16_t* out16) {
+        audio_kernels_pie_minmax(x, blocks, out16);
+    }
+    static void gain(const int16_t* x, int16_t* y, size_t blocks, const int16_t* gain8) {
+        audio_kernels_pie_gain(x, y, blocks, gain8);
+    }
+};
+
+// narrow は scalar のまま: PIE には 32bit から 16bit へ飽和して詰める命令が無く、シフト・上下限・
+// 16bit レーンの並べ替えを 8 サンプルごとに組むことになる。narrow はまだどこからも呼ばれておらず、
+// m5scribe-kernelcheck（と起動時の照合）で scalar と一致することだけを確かめている
+static const AudioKernels pieKernels = {
+    "pie", simdMeter<Pie>, simdDot<Pie>, simdGain<Pie>, scalarNarrow,
+};
+#endif
+
+const AudioKernels* audioKernels = &scalarKernels;
+
+const AudioKernels& audioKernelsScalar() {
+    return scalarKernels;
+}
+
+const AudioKernels& audioKernelsLaneModel() {
+    return laneKernels;
+}
+
+const AudioKernels* audioKernelsPie() {
+#if AUDIO_KERNELS_PIE
+    return &pieKernels;
+#else
+    return nullptr;
+#endif
+}
+
+// ---- 照合 ----
+
+#define TEST_LEN 640
+
+static uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state;
+}
+
+uint32_t audioKernelsSelfTest(const AudioKernels& kernels, uint32_t seed, const char** failed) {
+    alignas(16) static int16_t x[TEST_LEN + 8];
+    alignas(16) static int16_t y[TEST_LEN + 8];
+    alignas(16) static int16_t outA[TEST_LEN + 8];
+    alignas(16) static int16_t outB[TEST_LEN + 8];
+    alignas(16) static int32_t wide[TEST_LEN];
+    static const int16_t gains[] = { 0, 1, 4096, 4095, 12345, 32767, -4096, -32768 };
+
+    const AudioKernels& ref = scalarKernels;
+    uint32_t mismatches = 0;
+    *failed = nullptr;
+    auto fail = [&](const char* name) {
+        if (*failed == nullptr) *failed = name;
+        mismatches++;
+    };
+
+    // 乱数（半分は大振幅）と端の値
+    uint32_t state = seed;
+    for (int i = 0; i < TEST_LEN + 8; i++) {
+        uint32_t r = nextRandom(state);
+        x[i] = (i & 1) ? (int16_t)(r >> 16) : (int16_t)((int32_t)(r >> 16) >> 4);
+        y[i] = (int16_t)(nextRandom(state) >> 16);
+    }
+    x[3] = -32768;
+    x[TEST_LEN / 2] = -32768;
+    x[TEST_LEN / 2 + 1] = 32767;
+    y[17] = -32768;
+    for (int i = 0; i < TEST_LEN; i++) wide[i] = (int32_t)nextRandom(state);
+
+    // 長さ（端数・境界またぎ・累算の分割点）と開始位置（境界からのずれ）を変える
+    static const size_t lengths[] = { 0, 1, 7, 8, 9, 15, 16, 63, 64, 65, 255, 511, 512, 513, 600, TEST_LEN - 8 };
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t li = 0; li < sizeof(lengths) / sizeof(lengths[0]); li++) {
+            size_t n = lengths[li];
+            const int16_t* px = x + offset;
+
+            AudioMeterResult a, b;
+            ref.meter(px, n, a);
+            kernels.meter(px, n, b);
+            if (a.peak != b.peak || a.sumSquares != b.sumSquares) fail("meter");
+
+            if (ref.dot(px, y + offset, n) != kernels.dot(px, y + offset, n)) fail("dot");
+            if (ref.dot(px, px, n) != kernels.dot(px, px, n)) fail("dot");
+            if (ref.dot(px, y, n) != kernels.dot(px, y, n)) fail("dot");
+
+            for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+                ref.gain(px, outA + offset, n, gains[g]);
+                kernels.gain(px, outB + offset, n, gains[g]);
+                if (memcmp(outA + offset, outB + offset, n * 2) != 0) fail("gain");
+            }
+
+            for (int shift = 0; shift < 32; shift += 5) {
+                ref.narrow(wide, outA, n, shift);
+                kernels.narrow(wide, outB, n, shift);
+                if (memcmp(outA, outB, n * 2) != 0) fail("narrow");
+            }
+        }
+    }
+    // 累算器の上限近く（全サンプル -32768）
+    for (int i = 0; i < TEST_LEN; i++) outA[i] = -32768;
+    for (size_t n = 255; n <= 520; n += 265) {
+        AudioMeterResult a, b;
+        ref.meter(outA, n, a);
+        kernels.meter(outA, n, b);
+        if (a.peak != b.peak || a.sumSquares != b.sumSquares) fail("meter");
+        if (ref.dot(outA, outA, n) != kernels.dot(outA, outA, n)) fail("dot");
+    }
+    return mismatches;
+}
+
+const AudioKernels& audioKernelsBegin(const char** failed) {
+    audioKernels = &scalarKernels;
+    *failed = nullptr;
+#if AUDIO_KERNELS_PIE_VERIFIED
+    const AudioKernels* pie = audioKernelsPie();
+    if (pie != nullptr && audioKernelsSelfTest(*pie, 1, failed) == 0) {
+        audioKernels = pie;
+    }
+#endif
+    return *audioKernels;
+}
+
+// ---- 双二次フィルタ ----
+
+void biquadInitHighPass(Biquad& bq, uint32_t sampleRate, float cutoffHz) {
+    // 2 次バターワース（双一次変換）
+    float k = tanf(3.14159265f * cutoffHz / sampleRate);
+    float q = 0.70710678f;
+    float norm = 1.0f / (1.0f + k / q + k * k);
+    bq.b0 = (int16_t)lrintf(norm * 16384.0f);
+    bq.b1 = (int16_t)lrintf(-2.0f * norm * 16384.0f);
+    bq.b2 = bq.b0;
+    bq.a1 = (int16_t)lrintf(2.0f * (k * k - 1.0f) * norm * 16384.0f);
+    bq.a2 = (int16_t)lrintf((1.0f - k / q + k * k) * norm * 16384.0f);
+    bq.x1 = bq.x2 = bq.y1 = bq.y2 = 0;
+}
+
+void biquadProcess(Biquad& bq, const int16_t* x, int16_t* y, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t in = x[i];
+        int64_t acc = (int64_t)bq.b0 * in + (int64_t)bq.b1 * bq.x1 + (int64_t)bq.b2 * bq.x2
+                      - (int64_t)bq.a1 * bq.y1 - (int64_t)bq.a2 * bq.y2;
+        int32_t out = (int32_t)((acc + (1 << 13)) >> 14);
+        bq.x2 = bq.x1;
+        bq.x1 = in;
+        bq.y2 = bq.y1;
+        bq.y1 = out;
+        y[i] = sat16(out);
+    }
+}
+
+// ---- 間引き ----
+
+bool decimatorInit(Decimator& d, uint32_t factor, uint32_t numTaps) {
+    if (factor < 2 || numTaps == 0 || numTaps % LANES != 0 || numTaps > DECIMATOR_MAX_TAPS) return false;
+    d.factor = factor;
+    d.numTaps = numTaps;
+    d.phase = 0;
+    d.historyLen = 0;
+
+    // 窓付き sinc（ハミング窓）、遮断は出力ナイキストの 0.9 倍、直流利得 1
+    float h[DECIMATOR_MAX_TAPS];
+    float cutoff = 0.45f / factor;
+    float sum = 0;
+    for (uint32_t i = 0; i < numTaps; i++) {
+        float m = i - (numTaps - 1) / 2.0f;
+        float sinc = m == 0 ? 2.0f * cutoff : sinf(2.0f * 3.14159265f * cutoff * m) / (3.14159265f * m);
+        float window = 0.54f - 0.46f * cosf(2.0f * 3.14159265f * i / (numTaps - 1));
+        h[i] = sinc * window;
+        sum += h[i];
+    }
+
+    memset(d.taps, 0, sizeof(d.taps));
+    for (uint32_t s = 0; s < LANES; s++) {
+        for (uint32_t i = 0; i < numTaps; i++) {
+            d.taps[s][s + i] = (int16_t)lrintf(h[i] / sum * 32767.0f);
+        }
+    }
+    memset(d.buffer, 0, sizeof(d.buffer));
+    return true;
+}
+
+size_t decimatorProcess(Decimator& d, const int16_t* in, size_t n, int16_t* out) {
+    if (n > DECIMATOR_MAX_BLOCK) n = DECIMATOR_MAX_BLOCK;
+    memcpy(d.buffer + d.historyLen, in, n * sizeof(int16_t));
+    uint32_t total = d.historyLen + n;
+
+    // 窓の開始を 8 サンプル境界に切り下げ、ずれはずらした係数で吸収する
+    size_t produced = 0;
+    uint32_t p = d.phase;
+    while (p + d.numTaps <= total) {
+        uint32_t base = p & ~(uint32_t)(LANES - 1);
+        int64_t acc = audioKernels->dot(d.buffer + base, d.taps[p - base], d.numTaps + LANES);
+        out[produced++] = sat16((int32_t)((acc + (1 << 14)) >> 15));
+        p += d.factor;
+    }
+
+    // 境界を保ったまま残りを先頭へ
+    uint32_t drop = (p < total ? p : total) & ~(uint32_t)(LANES - 1);
+    memmove(d.buffer, d.buffer + drop, (total - drop) * sizeof(int16_t));
+    d.historyLen = total - drop;
+    d.phase = p - drop;
+    return produced;
+}
+
+// ---- 計測 ----
+
+#define BENCH_LEN 1024
+
+void audioKernelsBench(const AudioKernels& kernels, uint64_t (*nowNs)(), uint32_t rounds, AudioKernelsBench& out) {
+    alignas(16) static int16_t x[BENCH_LEN];
+    alignas(16) static int16_t y[BENCH_LEN];
+    alignas(16) static int16_t z[BENCH_LEN];
+    static Decimator decimator;
+
+    uint32_t state = 7;
+    for (int i = 0; i < BENCH_LEN; i++) {
+        x[i] = (int16_t)(nextRandom(state) >> 18);
+        y[i] = (int16_t)(nextRandom(state) >> 18);
+    }
+
+    const AudioKernels* saved = audioKernels;
+    audioKernels = &kernels;
+    volatile int64_t sink = 0;
+    float samples = (float)rounds * BENCH_LEN;
+
+    uint64_t start = nowNs();
+    for (uint32_t r = 0; r < rounds; r++) {
+        AudioMeterResult m;
+        kernels.meter(x, BENCH_LEN, m);
+        sink = sink + m.sumSquares;
+    }
+    out.meterNs = (nowNs() - start) / samples;
+
+    start = nowNs();
+    for (uint32_t r = 0; r < rounds; r++) sink = sink + kernels.dot(x, y, BENCH_LEN);
+    out.dotNs = (nowNs() - start) / samples;
+
+    start = nowNs();
+    for (uint32_t r = 0; r < rounds; r++) kernels.gain(x, z, BENCH_LEN, 5000);
+    out.gainNs = (nowNs() - start) / samples;
+
+    decimatorInit(decimator, 3, 32);
+    start = nowNs();
+    for (uint32_t r = 0; r < rounds; r++) decimatorProcess(decimator, x, BENCH_LEN, z);
+    out.decimateNs = (nowNs() - start) / samples;
+
+    audioKernels = saved;
+}
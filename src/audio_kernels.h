@@ -0,0 +1,91 @@
+/**
+ * サンプル単位の基本演算（メーター・内積・利得・int16 変換・間引き）
+ *
+ * 同じ API の実装を複数持ち、audioKernelsBegin() で実行時に選ぶ。
+ *   - scalar     : どこでも動く基準実装
+ *   - pie        : ESP32-S3 の PIE 命令（ee.*、audio_kernels_s3.S）。-DAUDIO_KERNELS_PIE=1 のビルドのみ
+ *   - lane-model : pie と同じ分割（先頭・16 バイト境界の本体・末尾、8 レーン、40bit 累算）を C で書いたもの。
+ *                  ホストで pie の手順（分割と累算幅）が scalar とビット一致することを確かめるために使う。
+ *                  ee.* 命令そのものの動き（飽和・SAR の扱いなど）はこれでは確かめられない
+ * pie はまだ実機で動かしていないので、audioKernelsBegin() は -DAUDIO_KERNELS_PIE_VERIFIED=1 のビルドでしか選ばない。
+ * 選ぶ場合も起動時に scalar と照合し（audioKernelsSelfTest）、1 つでも不一致なら scalar に戻す。
+ * 立ち上げ用ファームウェア（cores3/main_cores3.cpp）はこのフラグに関わらず pie を照合・計測して結果を出力する。
+ *
+ * 双二次フィルタは 1 チャンネルでは再帰の依存でレーンに分けられないので、どの実装も scalar を使う。
+ * Arduino に依存しないので Linux の評価ツール（m5scribe-kernelcheck）からも使う。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef AUDIO_KERNELS_PIE
+#define AUDIO_KERNELS_PIE 0
+#endif
+
+// CoreS3 の実機で pie の照合が通ったことを確かめたら 1 にする
+#ifndef AUDIO_KERNELS_PIE_VERIFIED
+#define AUDIO_KERNELS_PIE_VERIFIED 0
+#endif
+
+#define AUDIO_KERNELS_GAIN_SHIFT  12     // 利得は Q12（4096 = 1.0、最大 約 8 倍）
+#define DECIMATOR_MAX_TAPS        64     // 8 の倍数
+#define DECIMATOR_MAX_BLOCK       1024   // 1 回の入力サンプル数
+
+struct AudioMeterResult {
+    int32_t peak;           // |x| の最大（-32768 は 32767 とする）
+    int64_t sumSquares;
+};
+
+struct AudioKernels {
+    const char* name;
+    void (*meter)(const int16_t* x, size_t n, AudioMeterResult& out);
+    int64_t (*dot)(const int16_t* x, const int16_t* y, size_t n);
+    // y = sat16((x * gainQ12) >> 12)、x と y は同じでもよい
+    void (*gain)(const int16_t* x, int16_t* y, size_t n, int16_t gainQ12);
+    // y = sat16(x >> shift)
+    void (*narrow)(const int32_t* x, int16_t* y, size_t n, int shift);
+};
+
+// 現在選ばれている実装（audioKernelsBegin() までは scalar）
+extern const AudioKernels* audioKernels;
+
+const AudioKernels& audioKernelsScalar();
+const AudioKernels& audioKernelsLaneModel();
+const AudioKernels* audioKernelsPie();      // PIE の無いビルドでは nullptr
+
+// 試験ベクトルで scalar と比べ、不一致の数を返す（failed に最初の不一致の演算名）
+uint32_t audioKernelsSelfTest(const AudioKernels& kernels, uint32_t seed, const char** failed);
+
+// PIE があり実機で確かめ済み（AUDIO_KERNELS_PIE_VERIFIED）なら照合して選び、結果を返す（照合で落ちたら failed に演算名）
+const AudioKernels& audioKernelsBegin(const char** failed);
+
+// 2 次 IIR（Q14 係数、int16 入出力、状態は int32）
+struct Biquad {
+    int16_t b0, b1, b2, a1, a2;
+    int32_t x1, x2, y1, y2;
+};
+void biquadInitHighPass(Biquad& bq, uint32_t sampleRate, float cutoffHz);
+void biquadProcess(Biquad& bq, const int16_t* x, int16_t* y, size_t n);
+
+// 整数比の間引き（FIR ローパス、Q15 係数、内積は audioKernels->dot）
+struct Decimator {
+    uint32_t factor;
+    uint32_t numTaps;                         // 8 の倍数
+    uint32_t phase;                           // 次の窓の開始位置（buffer 内）
+    uint32_t historyLen;
+    alignas(16) int16_t taps[8][DECIMATOR_MAX_TAPS + 8];   // 窓の開始位置のずれ（0-7）ごとにずらした係数
+    alignas(16) int16_t buffer[DECIMATOR_MAX_TAPS + DECIMATOR_MAX_BLOCK + 16];
+};
+bool decimatorInit(Decimator& d, uint32_t factor, uint32_t numTaps);
+// 出力サンプル数を返す（n <= DECIMATOR_MAX_BLOCK）
+size_t decimatorProcess(Decimator& d, const int16_t* in, size_t n, int16_t* out);
+
+// 1 サンプルあたりの時間（ns）
+struct AudioKernelsBench {
+    float meterNs;
+    float dotNs;
+    float gainNs;
+    float decimateNs;   // 入力 1 サンプルあたり
+};
+void audioKernelsBench(const AudioKernels& kernels, uint64_t (*nowNs)(), uint32_t rounds, AudioKernelsBench& out);
@@ -0,0 +1,50 @@
+/**
+ * 起動ステージ計測の実装
+ */
+#include "boot_trace.h"
+
+#include <Arduino.h>
+
+struct BootStage {
+    const char* name;
+    uint32_t startUs;
+    uint32_t endUs;
+    const char* task;
+};
+
+static BootStage stages[BOOT_TRACE_MAX_STAGES];
+static int stageCount = 0;
+static portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+
+uint32_t bootTraceMark(const char* stage, uint32_t since) {
+    uint32_t now = micros();
+    const char* task = pcTaskGetTaskName(nullptr);
+
+    portENTER_CRITICAL(&traceMux);
+    if (since == 0) {
+        // 同じタスクの直前のステージの終わりから
+        for (int i = stageCount - 1; i >= 0; i--) {
+            if (stages[i].task == task) {
+                since = stages[i].endUs;
+                break;
+            }
+        }
+    }
+    if (stageCount < BOOT_TRACE_MAX_STAGES) {
+        stages[stageCount++] = { stage, since, now, task };
+    }
+    portEXIT_CRITICAL(&traceMux);
+    return now;
+}
+
+void bootTraceReport() {
+    Serial.println("[boot] stage                 at ms   took ms  task");
+    for (int i = 0; i < stageCount; i++) {
+        const BootStage& s = stages[i];
+        Serial.printf("[boot] %-20s %7.1f  %8.1f  %s\n", s.name, s.endUs / 1000.0f,
+                      (s.endUs - s.startUs) / 1000.0f, s.task);
+    }
+    if (stageCount > 0) {
+        Serial.printf("[boot] power-on to READY: %.1f ms\n", stages[stageCount - 1].endUs / 1000.0f);
+    }
+}
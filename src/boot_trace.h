@@ -0,0 +1,19 @@
+/**
+ * 起動ステージの計測
+ *
+ * setup() と起動用タスクから bootTraceMark() でステージの終了時刻を記録し、
+ * READY 表示後に bootTraceReport() で電源投入からの時刻と所要時間をまとめてシリアルに出力する。
+ * 時刻は micros()（電源投入＝ROM ブートからの経過）。並行するステージは所要時間の基準を
+ * bootTraceMark() の since で指定する（省略時は同じタスクの直前のステージ）。
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define BOOT_TRACE_MAX_STAGES 24
+
+// ステージの終了を記録し、その時刻を返す（複数タスクから呼んでよい）
+uint32_t bootTraceMark(const char* stage, uint32_t since = 0);
+
+// 記録したステージを時刻順に出力
+void bootTraceReport();
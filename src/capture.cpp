@@ -0,0 +1,233 @@
+/**
+ * 常時キャプチャと音声履歴リングの実装
+ */
+#include "capture.h"
+
+#include <driver/i2s.h>
+#include <freertos/semphr.h>
+
+#include "dsp_pipeline.h"
+#include "hot_path.h"
+#include "hot_placement.h"
+#include "wide_gain.h"
+
+// I2Sピン設定
+#define CONFIG_I2S_BCK_PIN     12
+#define CONFIG_I2S_LRCK_PIN    0
+#define CONFIG_I2S_DATA_PIN    2
+#define CONFIG_I2S_DATA_IN_PIN 34
+
+#define Speak_I2S_NUMBER I2S_NUM_0
+
+#define CAPTURE_TASK_STACK    8192
+#define CAPTURE_TASK_PRIORITY 5     // loop()（優先度 1）より高く、BT スタックとは別コア
+#define CAPTURE_TASK_CORE     1
+
+using CapturePipeline = dsp::Pipeline<SAMPLE_RATE, CAPTURE_BLOCK_SAMPLES,
+                                      dsp::Optional<CAPTURE_DC_BLOCK, dsp::DcBlock>,
+                                      dsp::Optional<(CAPTURE_HIGHPASS_HZ > 0), dsp::HighPass<CAPTURE_HIGHPASS_HZ>>>;
+
+#if CAPTURE_WIDE
+typedef int32_t HistorySample;
+static WideGain wideGain;
+static TpdfDither dither;
+#else
+typedef int16_t HistorySample;
+#endif
+
+static CapturePipeline pipeline;
+static HistorySample* history = nullptr;
+static uint32_t historyCapacity = 0;       // サンプル数
+static volatile uint32_t writeIndex = 0;
+static CaptureBlockHook blockHook = nullptr;
+static SemaphoreHandle_t dataReady = nullptr;
+
+// 処理時間の統計（captureLogStats）
+static uint32_t statBlocks = 0;
+static uint32_t statProcessUs = 0;
+static uint32_t statReadSamples = 0;
+static uint32_t statReadUs = 0;
+
+// マイク初期化
+bool InitMicrophone() {
+    esp_err_t err = ESP_OK;
+
+    i2s_driver_uninstall(Speak_I2S_NUMBER);
+
+    i2s_config_t i2s_config = {
+        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_PDM),
+        .sample_rate = SAMPLE_RATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_ONLY_RIGHT,
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .dma_buf_count = CAPTURE_DMA_BUF_COUNT,
+        .dma_buf_len = CAPTURE_DMA_BUF_LEN,
+        .use_apll = false,
+        .tx_desc_auto_clear = false,
+        .fixed_mclk = 0
+    };
+
+    err += i2s_driver_install(Speak_I2S_NUMBER, &i2s_config, 0, NULL);
+
+    i2s_pin_config_t tx_pin_config;
+#if (ESP_IDF_VERSION > ESP_IDF_VERSION_VAL(4, 3, 0))
+    tx_pin_config.mck_io_num = I2S_PIN_NO_CHANGE;
+#endif
+    tx_pin_config.bck_io_num = CONFIG_I2S_BCK_PIN;
+    tx_pin_config.ws_io_num = CONFIG_I2S_LRCK_PIN;
+    tx_pin_config.data_out_num = CONFIG_I2S_DATA_PIN;
+    tx_pin_config.data_in_num = CONFIG_I2S_DATA_IN_PIN;
+
+    err += i2s_set_pin(Speak_I2S_NUMBER, &tx_pin_config);
+    err += i2s_set_clk(Speak_I2S_NUMBER, SAMPLE_RATE, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
+
+    return (err == ESP_OK);
+}
+
+// リングへ書き込み（折り返しは 2 回に分ける）
+HOT_FUNC(CAPTURE) static void writeHistory(const HistorySample* samples, size_t count, uint32_t index) {
+    uint32_t start = index % historyCapacity;
+    size_t first = min((size_t)(historyCapacity - start), count);
+    memcpy(history + start, samples, first * sizeof(HistorySample));
+    memcpy(history, samples + first, (count - first) * sizeof(HistorySample));
+}
+
+HOT_FUNC(CAPTURE) static void captureTask(void* arg) {
+    static int16_t block[CAPTURE_BLOCK_SAMPLES];
+#if CAPTURE_WIDE
+    static int32_t wide[CAPTURE_BLOCK_SAMPLES];
+#endif
+
+    while (true) {
+        size_t bytesRead = 0;
+        esp_err_t result = i2s_read(Speak_I2S_NUMBER, block, sizeof(block), &bytesRead, portMAX_DELAY);
+        if (result != ESP_OK || bytesRead == 0) continue;
+
+        size_t count = bytesRead / 2;
+        uint32_t index = writeIndex;
+        uint32_t processStart = micros();
+        HotPathMark mark;
+        hotPathBegin(mark);
+
+        // 前処理（portMAX_DELAY の i2s_read は常に 1 ブロック分返す）
+        if (count == CapturePipeline::frameSize) pipeline.process(block);
+
+#if CAPTURE_WIDE
+        // 32bit で利得を掛けて履歴へ。以降のフック（解析・モニター）には丸めた 16bit を渡す
+        wideFromInt16(block, wide, count);
+        wideGainProcess(wideGain, wide, count);
+        writeHistory(wide, count, index);
+        wideToInt16Round(wide, block, count);
+#else
+        writeHistory(block, count, index);
+#endif
+        writeIndex = index + count;
+        hotPathEnd(HOT_CAPTURE, mark);
+        statProcessUs += micros() - processStart;
+        statBlocks++;
+
+        // モニター出力は遅延を抑えるため最初に
+        sidetoneProcess(block, count);
+
+        if (blockHook) blockHook(block, count, index);
+
+        xSemaphoreGive(dataReady);
+    }
+}
+
+bool captureBegin(CaptureBlockHook hook) {
+    blockHook = hook;
+
+#if CAPTURE_WIDE
+    wideGainInit(wideGain, CAPTURE_GAIN_DB, CAPTURE_WIDE_DC_BLOCK);
+#endif
+
+    // 履歴は PSRAM に置く（無ければ内部 RAM に 2 秒分、32bit なら 1 秒分）
+    historyCapacity = SAMPLE_RATE * CAPTURE_HISTORY_SECONDS;
+    if (psramFound()) {
+        history = (HistorySample*)ps_malloc(historyCapacity * sizeof(HistorySample));
+    }
+    if (history == nullptr) {
+        historyCapacity = SAMPLE_RATE * 4 / sizeof(HistorySample);
+        history = (HistorySample*)malloc(historyCapacity * sizeof(HistorySample));
+    }
+    if (history == nullptr) return false;
+
+    dataReady = xSemaphoreCreateBinary();
+    if (dataReady == nullptr) return false;
+
+    Serial.printf("Capture history: %u samples (%.1f s, %u KB)\n", historyCapacity,
+                  (float)historyCapacity / SAMPLE_RATE, historyCapacity * sizeof(HistorySample) / 1024);
+
+    return xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK, nullptr,
+                                   CAPTURE_TASK_PRIORITY, nullptr, CAPTURE_TASK_CORE) == pdPASS;
+}
+
+uint32_t captureWriteIndex() {
+    return writeIndex;
+}
+
+uint32_t captureOldestIndex() {
+    uint32_t w = writeIndex;
+    return w > historyCapacity ? w - historyCapacity : 0;
+}
+
+HOT_FUNC(READ) size_t captureRead(uint32_t& cursor, int16_t* out, size_t maxCount, uint32_t* dropped) {
+    HotPathMark mark;
+    hotPathBegin(mark);
+    uint32_t w = writeIndex;
+    uint32_t skipped = 0;
+
+    // 追い越されていたら最古のサンプルまで進める（書き込み中の 1 ブロック分は余裕を取る）
+    uint32_t margin = CAPTURE_BLOCK_SAMPLES;
+    if (w - cursor > historyCapacity - margin) {
+        uint32_t oldest = w - (historyCapacity - margin);
+        skipped = oldest - cursor;
+        cursor = oldest;
+    }
+
+    size_t count = min((size_t)(w - cursor), maxCount);
+    uint32_t start = cursor % historyCapacity;
+    size_t first = min((size_t)(historyCapacity - start), count);
+    uint32_t readStart = micros();
+#if CAPTURE_WIDE
+    // 16bit に落とすのはここ（送信路）だけ
+    wideToInt16Dither(dither, history + start, out, first);
+    wideToInt16Dither(dither, history, out + first, count - first);
+#else
+    memcpy(out, history + start, first * 2);
+    memcpy(out + first, history, (count - first) * 2);
+#endif
+    statReadUs += micros() - readStart;
+    statReadSamples += count;
+    cursor += count;
+    hotPathEnd(HOT_READ, mark);
+
+    if (dropped) *dropped = skipped;
+    return count;
+}
+
+bool captureWaitData(TickType_t timeout) {
+    return xSemaphoreTake(dataReady, timeout) == pdTRUE;
+}
+
+void captureLogStats() {
+    uint32_t blocks = statBlocks;
+    uint32_t processUs = statProcessUs;
+    uint32_t readSamples = statReadSamples;
+    uint32_t readUs = statReadUs;
+    statBlocks = statProcessUs = statReadSamples = statReadUs = 0;
+
+    float blockUs = 1e6f * CAPTURE_BLOCK_SAMPLES / SAMPLE_RATE;
+    float perBlock = blocks ? (float)processUs / blocks : 0;
+#if CAPTURE_WIDE
+    Serial.printf("[capture] 32bit gain %+d dB: ", CAPTURE_GAIN_DB);
+#else
+    Serial.print("[capture] 16bit: ");
+#endif
+    Serial.printf("%.1f us/block (%.2f%% of real time), read %.2f us/1k samples, history %u KB\n",
+                  perBlock, perBlock / blockUs * 100.0f,
+                  readSamples ? (float)readUs * 1000.0f / readSamples : 0.0f,
+                  historyCapacity * sizeof(HistorySample) / 1024);
+}
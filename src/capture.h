@@ -0,0 +1,74 @@
+/**
+ * 常時キャプチャと音声履歴リング
+ *
+ * I2S の読み込みは専用タスクで常に回し、PSRAM 上のリングにサンプル番号付きで書き込む。
+ * 送信側は自分のカーソルでリングを読むので、接続前のプリロール（ウェイクワード検出前後）も
+ * 同じ経路でそのまま送れる。
+ */
+#pragma once
+
+#include <Arduino.h>
+
+// 音声設定
+#define SAMPLE_RATE       16000  // 16kHz（帯域削減）
+
+#include "sidetone.h"
+
+#if SIDETONE
+// サイドトーンの遅延を小さくするため細かく読む（取りこぼし防止に DMA の総量は増やす）
+#define CAPTURE_BLOCK_SAMPLES    32     // 1 回の i2s_read（2ms @16kHz）
+#define CAPTURE_DMA_BUF_COUNT    32
+#define CAPTURE_DMA_BUF_LEN      32
+#else
+#define CAPTURE_BLOCK_SAMPLES    1024   // 1 回の i2s_read（64ms @16kHz）
+#define CAPTURE_DMA_BUF_COUNT    6
+#define CAPTURE_DMA_BUF_LEN      256
+#endif
+#define CAPTURE_HISTORY_SECONDS  30     // PSRAM が無い場合は 2 秒に縮小
+
+// 履歴に書く前の前処理（dsp_pipeline.h、無効なステージはコードごと消える）
+#ifndef CAPTURE_DC_BLOCK
+#define CAPTURE_DC_BLOCK         0
+#endif
+#ifndef CAPTURE_HIGHPASS_HZ
+#define CAPTURE_HIGHPASS_HZ      0      // 0 で無効（例: 80）
+#endif
+
+// 32bit の利得段（wide_gain.h）。履歴を 32bit で持ち、送信路で読むときだけ TPDF ディザで 16bit にする
+#ifndef CAPTURE_WIDE
+#define CAPTURE_WIDE             0
+#endif
+#ifndef CAPTURE_GAIN_DB
+#define CAPTURE_GAIN_DB          0      // CAPTURE_WIDE=1 のときの利得
+#endif
+#ifndef CAPTURE_WIDE_DC_BLOCK
+#define CAPTURE_WIDE_DC_BLOCK    1      // 利得の前に DC を除く（PDM マイクのオフセットで飽和しないように）
+#endif
+
+// キャプチャタスク内でブロックごとに呼ばれる（ウェイクワード検出など）
+typedef void (*CaptureBlockHook)(const int16_t* samples, size_t count, uint32_t firstIndex);
+
+// マイク初期化（I2S_NUM_0 を PDM 受信で使う）
+bool InitMicrophone();
+
+// キャプチャタスク開始（InitMicrophone() の後に呼ぶ）
+bool captureBegin(CaptureBlockHook hook);
+
+// 書き込み済みサンプル総数（次に書かれるサンプル番号）
+uint32_t captureWriteIndex();
+
+// リングに残っている最古のサンプル番号
+uint32_t captureOldestIndex();
+
+/**
+ * cursor から最大 maxCount サンプル読み出して cursor を進める
+ *
+ * 追い越された場合は最古のサンプルまで読み飛ばし、その数を *dropped に返す。
+ */
+size_t captureRead(uint32_t& cursor, int16_t* out, size_t maxCount, uint32_t* dropped);
+
+// 新しいブロックが書かれるまで待つ（timeout 経過で false）
+bool captureWaitData(TickType_t timeout);
+
+// 前回呼び出しからのキャプチャ処理・読み出し（ディザ）の時間と履歴のメモリをシリアルに出力
+void captureLogStats();
@@ -0,0 +1,58 @@
+/**
+ * M5Stack CoreS3（ESP32-S3）立ち上げ用ファームウェア
+ *
+ * 本体（main.cpp 以降）は M5Core2 ライブラリ・AXP192・PDM マイクのピン配置に依存しているため、
+ * CoreS3 の env（m5stack-cores3）ではまずこのファイルと audio_kernels だけをビルドし、
+ * PIE 版の基本演算が scalar とビット一致すること（起動時の照合）と処理時間をシリアルで確認する。
+ * 照合が通ったら結果を記録し、AUDIO_KERNELS_PIE_VERIFIED=1 にして初めて audioKernelsBegin() が pie を選ぶ。
+ */
+#include <Arduino.h>
+
+#include "../audio_kernels.h"
+
+static uint64_t nowNs() {
+    return (uint64_t)esp_timer_get_time() * 1000;
+}
+
+static void logBench(const AudioKernels& kernels) {
+    AudioKernelsBench b;
+    audioKernelsBench(kernels, nowNs, 200, b);
+    Serial.printf("[kernels] %-10s meter %.2f ns, dot %.2f ns, gain %.2f ns, decimate/3 %.2f ns (per sample)\n",
+                  kernels.name, b.meterNs, b.dotNs, b.gainNs, b.decimateNs);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(500);
+    Serial.println("\n\n=== M5Scribe CoreS3 kernel bring-up ===");
+
+    // audioKernelsBegin() の選択とは別に、pie を毎回すべてのシードで照合する
+    const AudioKernels* pie = audioKernelsPie();
+    if (pie != nullptr) {
+        uint32_t mismatches = 0;
+        const char* failed = nullptr;
+        for (uint32_t seed = 1; seed <= 16; seed++) {
+            const char* f = nullptr;
+            mismatches += audioKernelsSelfTest(*pie, seed, &f);
+            if (f && !failed) failed = f;
+        }
+        if (mismatches == 0) {
+            Serial.println("PIE kernels: bit-exact with scalar over 16 seeds");
+        } else {
+            Serial.printf("WARNING: PIE kernels disagree with scalar (%u mismatches, first in %s)\n",
+                          mismatches, failed);
+        }
+    }
+
+    const char* failed = nullptr;
+    const AudioKernels& selected = audioKernelsBegin(&failed);
+    Serial.printf("Audio kernels: %s%s\n", selected.name,
+                  AUDIO_KERNELS_PIE_VERIFIED ? "" : " (pie not selected until AUDIO_KERNELS_PIE_VERIFIED=1)");
+
+    logBench(audioKernelsScalar());
+    if (pie != nullptr) logBench(*pie);
+}
+
+void loop() {
+    delay(1000);
+}
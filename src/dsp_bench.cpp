@@ -0,0 +1,139 @@
+/**
+ * パイプライン計測の実装
+ */
+#include "dsp_bench.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "dsp_pipeline.h"
+
+#define RATE  DSP_BENCH_SAMPLE_RATE
+#define FRAME DSP_BENCH_FRAME
+#define SIGNAL_FRAMES 16   // 試験信号はこの長さを繰り返す（ESP32 の内部 RAM に収まる大きさ）
+
+template <bool On>
+using BenchPipeline = dsp::Pipeline<RATE, FRAME,
+                                    dsp::Optional<On, dsp::DcBlock>,
+                                    dsp::Optional<On, dsp::HighPass<80>>,
+                                    dsp::Optional<On, dsp::Agc<-20, 24>>,
+                                    dsp::Optional<On, dsp::Meter>>;
+
+// 実行時に組み替える連鎖（比較対象）
+struct DynStage {
+    bool enabled = true;
+    virtual ~DynStage() {}
+    virtual void process(float* x, size_t n) = 0;
+};
+
+template <typename S>
+struct DynAdapter : DynStage {
+    S stage;
+    void process(float* x, size_t n) override {
+        if (!enabled) return;
+        stage.template beginFrame<RATE, FRAME>();
+        for (size_t i = 0; i < n; i++) x[i] = stage.template step<RATE>(x[i]);
+        stage.template endFrame<RATE, FRAME>();
+    }
+};
+
+struct DynChain {
+    DynStage* stages[4];
+    size_t count = 0;
+    float work[FRAME];
+
+    void add(DynStage* s) { stages[count++] = s; }
+
+    void process(const int16_t* in, int16_t* out, size_t n) {
+        for (size_t i = 0; i < n; i++) work[i] = in[i];
+        for (size_t s = 0; s < count; s++) stages[s]->process(work, n);
+        for (size_t i = 0; i < n; i++) {
+            float x = work[i];
+            if (x > 32767.0f) x = 32767.0f;
+            if (x < -32768.0f) x = -32768.0f;
+            out[i] = (int16_t)x;
+        }
+    }
+};
+
+// 音声らしい試験信号（DC オフセット＋低域のうなり＋倍音＋雑音、振幅はゆっくり変化）
+static void makeSignal(int16_t* out, size_t count) {
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < count; i++) {
+        float t = (float)i / RATE;
+        float env = 0.2f + 0.8f * fabsf(sinf(2.0f * dsp::kPi * 0.7f * t));
+        float v = 400.0f + 300.0f * sinf(2.0f * dsp::kPi * 30.0f * t);
+        v += env * (3000.0f * sinf(2.0f * dsp::kPi * 220.0f * t) + 1500.0f * sinf(2.0f * dsp::kPi * 660.0f * t));
+        seed = seed * 1664525u + 1013904223u;
+        v += (float)((int32_t)(seed >> 16) - 32768) / 64.0f;
+        out[i] = (int16_t)v;
+    }
+}
+
+template <typename P>
+static float timePipeline(P& pipeline, const int16_t* signal, int16_t* out, uint32_t frames, uint64_t (*nowNs)()) {
+    uint64_t start = nowNs();
+    for (uint32_t f = 0; f < frames; f++) {
+        size_t offset = (size_t)(f % SIGNAL_FRAMES) * FRAME;
+        pipeline.process(signal + offset, out + offset);
+    }
+    return (float)(nowNs() - start) / ((float)frames * FRAME);
+}
+
+static float timeChain(DynChain& chain, const int16_t* signal, int16_t* out, uint32_t frames, uint64_t (*nowNs)()) {
+    uint64_t start = nowNs();
+    for (uint32_t f = 0; f < frames; f++) {
+        size_t offset = (size_t)(f % SIGNAL_FRAMES) * FRAME;
+        chain.process(signal + offset, out + offset, FRAME);
+    }
+    return (float)(nowNs() - start) / ((float)frames * FRAME);
+}
+
+void dspBenchRun(DspBenchResult& result, uint32_t frames, uint64_t (*nowNs)()) {
+    size_t count = (size_t)SIGNAL_FRAMES * FRAME;
+    int16_t* signal = (int16_t*)malloc(count * sizeof(int16_t));
+    int16_t* outA = (int16_t*)malloc(count * sizeof(int16_t));
+    int16_t* outB = (int16_t*)malloc(count * sizeof(int16_t));
+    result = DspBenchResult();
+    if (!signal || !outA || !outB) {
+        free(signal);
+        free(outA);
+        free(outB);
+        return;
+    }
+    makeSignal(signal, count);
+
+    BenchPipeline<true>* pipeline = new BenchPipeline<true>();
+    BenchPipeline<false>* bypass = new BenchPipeline<false>();
+
+    DynAdapter<dsp::DcBlock> dc;
+    DynAdapter<dsp::HighPass<80>> hp;
+    DynAdapter<dsp::Agc<-20, 24>> agc;
+    DynAdapter<dsp::Meter> meter;
+    DynChain* chain = new DynChain();
+    chain->add(&dc);
+    chain->add(&hp);
+    chain->add(&agc);
+    chain->add(&meter);
+
+    result.pipelineNs = timePipeline(*pipeline, signal, outA, frames, nowNs);
+    result.virtualNs = timeChain(*chain, signal, outB, frames, nowNs);
+
+    // 最後の SIGNAL_FRAMES 分の出力を比べる（状態がずれていれば差が残る）
+    result.maxDiff = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t d = abs((int32_t)outA[i] - outB[i]);
+        if (d > result.maxDiff) result.maxDiff = d;
+    }
+
+    for (size_t s = 0; s < chain->count; s++) chain->stages[s]->enabled = false;
+    result.pipelineBypassNs = timePipeline(*bypass, signal, outA, frames, nowNs);
+    result.virtualBypassNs = timeChain(*chain, signal, outB, frames, nowNs);
+
+    delete chain;
+    delete bypass;
+    delete pipeline;
+    free(signal);
+    free(outA);
+    free(outB);
+}
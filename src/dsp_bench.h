@@ -0,0 +1,27 @@
+/**
+ * dsp_pipeline.h の処理コスト計測
+ *
+ * 同じステージ（DC 除去・ハイパス・AGC・メーター）を
+ *   - dsp::Pipeline（コンパイル時合成、1 本のループに展開）
+ *   - 仮想関数でつないだ実行時の連鎖（ステージごとにフレームを 1 周）
+ * で処理し、1 サンプルあたりの時間を比べる。全ステージ無効の場合も測る。
+ * Linux の m5scribe-dspbench と、-DDSP_BENCH=1 のファームウェア（起動時に 1 回）から呼ぶ。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DSP_BENCH_SAMPLE_RATE 16000
+#define DSP_BENCH_FRAME       256
+
+struct DspBenchResult {
+    float pipelineNs;          // 1 サンプルあたり（全ステージ有効）
+    float virtualNs;
+    float pipelineBypassNs;    // 全ステージ無効
+    float virtualBypassNs;
+    int32_t maxDiff;           // 両者の出力の最大差（0 になるはず）
+};
+
+// nowNs は単調増加する時計（ns）
+void dspBenchRun(DspBenchResult& result, uint32_t frames, uint64_t (*nowNs)());
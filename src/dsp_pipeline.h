@@ -0,0 +1,211 @@
+/**
+ * コンパイル時に組み立てる音声処理パイプライン（ヘッダーのみ）
+ *
+ *   using Chain = dsp::Pipeline<16000, 256, dsp::DcBlock, dsp::HighPass<80>, dsp::Agc<-20, 24>, dsp::Meter>;
+ *   Chain chain;
+ *   chain.process(block);          // 256 サンプルをその場で処理
+ *   chain.stage<3>().rmsDbfs();    // ステージの状態を読む
+ *
+ * サンプルレートとフレーム長はテンプレート引数なので、係数は定数に畳み込まれ、
+ * 全ステージが 1 本のサンプルループにインライン展開される（ステージ間の中間バッファは無い）。
+ * dsp::Optional<false, S> は Bypass になり、全ステージが Bypass ならループごと消える。
+ *
+ * ステージは次のメンバーを持つ型（Stage を継承すると不要なものは省略できる）:
+ *   template <uint32_t Rate, size_t N> void beginFrame();   フレームの前
+ *   template <uint32_t Rate> float step(float x);            1 サンプル（int16 スケールの float）
+ *   template <uint32_t Rate, size_t N> void endFrame();     フレームの後
+ *
+ * 出力は int16 に飽和させる。ADPCM など型の変わる符号化はパイプラインの後段で行う。
+ * Arduino に依存しないので Linux の評価ツール（m5scribe-dspbench）からも使う。
+ */
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace dsp {
+
+constexpr float kPi = 3.14159265358979f;
+
+// tan(x) の級数展開（|x| < 0.5 で十分な精度、係数をコンパイル時に求めるため）
+constexpr float tanSmall(float x) {
+    return x + x * x * x / 3.0f + 2.0f * x * x * x * x * x / 15.0f
+           + 17.0f * x * x * x * x * x * x * x / 315.0f;
+}
+
+// ステージの既定実装
+struct Stage {
+    static constexpr bool bypass = false;
+    template <uint32_t Rate, size_t N> void beginFrame() {}
+    template <uint32_t Rate, size_t N> void endFrame() {}
+};
+
+// 何もしないステージ
+struct Bypass : Stage {
+    static constexpr bool bypass = true;
+    template <uint32_t Rate> float step(float x) { return x; }
+};
+
+template <bool Enabled, typename S>
+using Optional = typename std::conditional<Enabled, S, Bypass>::type;
+
+// DC 除去（1 次 IIR、約 10Hz）
+struct DcBlock : Stage {
+    float x1 = 0;
+    float y1 = 0;
+
+    template <uint32_t Rate> float step(float x) {
+        constexpr float r = 1.0f - 2.0f * kPi * 10.0f / Rate;
+        float y = x - x1 + r * y1;
+        x1 = x;
+        y1 = y;
+        return y;
+    }
+};
+
+// 2 次バターワースのハイパス（双一次変換）
+template <uint32_t CutoffHz>
+struct HighPass : Stage {
+    float z1 = 0;
+    float z2 = 0;
+
+    template <uint32_t Rate> float step(float x) {
+        static_assert(CutoffHz * 8 <= Rate, "cutoff too close to Nyquist for tanSmall()");
+        constexpr float k = tanSmall(kPi * CutoffHz / Rate);
+        constexpr float q = 0.70710678f;
+        constexpr float norm = 1.0f / (1.0f + k / q + k * k);
+        constexpr float b0 = norm;
+        constexpr float b1 = -2.0f * norm;
+        constexpr float a1 = 2.0f * (k * k - 1.0f) * norm;
+        constexpr float a2 = (1.0f - k / q + k * k) * norm;
+
+        // Direct Form II Transposed（b2 = b0）
+        float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b0 * x - a2 * y;
+        return y;
+    }
+};
+
+// 自動利得制御（フレーム単位で目標 RMS に向けて利得を決め、次のフレームで滑らかに移す）
+template <int TargetDbfs, int MaxGainDb>
+struct Agc : Stage {
+    float gain = 1.0f;
+    float gainStep = 0;
+    float targetGain = 1.0f;
+    float sumSquares = 0;
+
+    static constexpr float kFullScale = 32768.0f;
+    static constexpr float kSilence = 1.0f;    // RMS がこれ未満なら利得を上げない
+
+    template <uint32_t Rate, size_t N> void beginFrame() {
+        gainStep = (targetGain - gain) / N;
+        sumSquares = 0;
+    }
+
+    template <uint32_t Rate> float step(float x) {
+        sumSquares += x * x;
+        gain += gainStep;
+        return x * gain;
+    }
+
+    template <uint32_t Rate, size_t N> void endFrame() {
+        gain = targetGain;
+        float rms = sqrtf(sumSquares / N);
+        if (rms < kSilence) return;
+
+        const float target = kFullScale * powf(10.0f, TargetDbfs / 20.0f);
+        const float maxGain = powf(10.0f, MaxGainDb / 20.0f);
+        float desired = target / rms;
+        if (desired > maxGain) desired = maxGain;
+        // 上げるのはゆっくり、下げるのは速く
+        float rate = desired < targetGain ? 0.5f : 0.05f;
+        targetGain += rate * (desired - targetGain);
+    }
+};
+
+// レベルメーター（フレームごとのピークと RMS）
+struct Meter : Stage {
+    float peakAcc = 0;
+    float sumSquares = 0;
+    float lastPeak = 0;
+    float lastRms = 0;
+
+    template <uint32_t Rate, size_t N> void beginFrame() {
+        peakAcc = 0;
+        sumSquares = 0;
+    }
+
+    template <uint32_t Rate> float step(float x) {
+        float a = x < 0 ? -x : x;
+        if (a > peakAcc) peakAcc = a;
+        sumSquares += x * x;
+        return x;
+    }
+
+    template <uint32_t Rate, size_t N> void endFrame() {
+        lastPeak = peakAcc;
+        lastRms = sqrtf(sumSquares / N);
+    }
+
+    float peak() const { return lastPeak; }
+    float rms() const { return lastRms; }
+    float rmsDbfs() const { return lastRms > 0 ? 20.0f * log10f(lastRms / 32768.0f) : -120.0f; }
+};
+
+template <uint32_t Rate, size_t FrameSize, typename... Stages>
+class Pipeline {
+public:
+    static constexpr uint32_t sampleRate = Rate;
+    static constexpr size_t frameSize = FrameSize;
+    static constexpr bool empty = (true && ... && Stages::bypass);
+
+    void process(int16_t* frame) {
+        process(frame, frame);
+    }
+
+    void process(const int16_t* in, int16_t* out) {
+        if (empty) {
+            if (in != out) memcpy(out, in, FrameSize * sizeof(int16_t));
+            return;
+        }
+        beginFrame(Indices{});
+        for (size_t i = 0; i < FrameSize; i++) {
+            float x = step(in[i], Indices{});
+            if (x > 32767.0f) x = 32767.0f;
+            if (x < -32768.0f) x = -32768.0f;
+            out[i] = (int16_t)x;
+        }
+        endFrame(Indices{});
+    }
+
+    template <size_t I>
+    typename std::tuple_element<I, std::tuple<Stages...>>::type& stage() {
+        return std::get<I>(stages);
+    }
+
+private:
+    using Indices = std::index_sequence_for<Stages...>;
+    std::tuple<Stages...> stages;
+
+    template <size_t... I> void beginFrame(std::index_sequence<I...>) {
+        (std::get<I>(stages).template beginFrame<Rate, FrameSize>(), ...);
+    }
+
+    template <size_t... I> float step(float x, std::index_sequence<I...>) {
+        ((x = std::get<I>(stages).template step<Rate>(x)), ...);
+        return x;
+    }
+
+    template <size_t... I> void endFrame(std::index_sequence<I...>) {
+        (std::get<I>(stages).template endFrame<Rate, FrameSize>(), ...);
+    }
+};
+
+}  // namespace dsp
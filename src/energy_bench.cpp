@@ -0,0 +1,292 @@
+/**
+ * 設定ごとの消費電力の計測
+ */
+#include "energy_bench.h"
+
+#if ENERGY_BENCH
+
+#include <Arduino.h>
+
+#include "i2c_bus.h"
+#include "link_frame.h"
+#include "link_state.h"
+
+#define COULOMB_MIN_MAH 1.0f   // これより少なければ見積もりはサンプリングした電流から（カウンタの分解能が粗い）
+
+static const EnergyScenario scenarios[] = {
+    { "idle",               ENERGY_LINK_IDLE,         POWER_TIER_FULL,    LINK_MODE_PCM16 },
+    { "idle-dark",          ENERGY_LINK_IDLE,         POWER_TIER_DARK,    LINK_MODE_PCM16 },
+    { "discoverable",       ENERGY_LINK_DISCOVERABLE, POWER_TIER_FULL,    LINK_MODE_PCM16 },
+    { "discoverable-eco",   ENERGY_LINK_DISCOVERABLE, POWER_TIER_ECO,     LINK_MODE_PCM16 },
+    { "stream-pcm",         ENERGY_LINK_STREAM,       POWER_TIER_FULL,    LINK_MODE_PCM16 },
+    { "stream-pcm-eco",     ENERGY_LINK_STREAM,       POWER_TIER_ECO,     LINK_MODE_PCM16 },
+    { "stream-adpcm",       ENERGY_LINK_STREAM,       POWER_TIER_LOWRATE, LINK_MODE_PCM16 },
+    { "stream-adpcm-80mhz", ENERGY_LINK_STREAM,       POWER_TIER_SLOW,    LINK_MODE_PCM16 },
+    { "stream-dark",        ENERGY_LINK_STREAM,       POWER_TIER_DARK,    LINK_MODE_PCM16 },
+    { "stream-features",    ENERGY_LINK_STREAM,       POWER_TIER_ECO,     LINK_MODE_FEATURES },
+};
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static const char* const linkNames[] = { "idle", "discoverable", "stream" };
+
+struct EnergyResult {
+    bool measured;
+    bool interrupted;          // 計測中に接続状態が崩れた
+    float seconds;
+    float coulombMah;          // 消費（放電で正）
+    float sampledMa;           // 1 秒ごとの放電電流の平均（充電中は負）
+    float batteryV;
+};
+
+enum BenchPhase : uint8_t {
+    PHASE_WAIT_BATTERY,        // USB が外れるのを待つ
+    PHASE_PREPARE,             // 接続状態を作る
+    PHASE_SETTLE,
+    PHASE_START,               // 開始時のカウンタ値の読み出し待ち
+    PHASE_MEASURE,
+    PHASE_FINISH,              // 終了時のカウンタ値の読み出し待ち
+    PHASE_DONE,
+};
+
+static bool enabled = false;
+static BenchPhase phase = PHASE_WAIT_BATTERY;
+static size_t current = 0;
+static unsigned long phaseSince = 0;
+static unsigned long lastTick = 0;
+static unsigned long lastReport = 0;
+static bool skipStreams = false;
+static EnergyResult results[SCENARIO_COUNT];
+
+static I2cCoulombSnapshot startCoulomb;
+static double currentSum = 0;
+static double voltageSum = 0;
+static uint32_t samples = 0;
+
+static void enterPhase(BenchPhase next) {
+    phase = next;
+    phaseSince = millis();
+}
+
+static LinkState wantedState(const EnergyScenario& s) {
+    return s.link == ENERGY_LINK_STREAM ? LINK_STATE_CONNECTED
+         : s.link == ENERGY_LINK_DISCOVERABLE ? LINK_STATE_DISCOVERABLE : LINK_STATE_IDLE;
+}
+
+// 計測を続けられない状態（接続が切れた・受付中に接続された）
+static bool linkBroken(const EnergyScenario& s) {
+    bool connected = linkState() == LINK_STATE_CONNECTED;
+    return s.link == ENERGY_LINK_STREAM ? !connected : connected;
+}
+
+// ボタンと同じイベントで目的の状態に近づける（接続受付は 60 秒で切れるので入り直す）
+static void driveLink(const EnergyScenario& s) {
+    LinkState state = linkState();
+    if (state == wantedState(s)) return;
+    if (s.link == ENERGY_LINK_STREAM && state == LINK_STATE_DISCOVERABLE) return;  // 受信側を待つ
+    if (state == LINK_STATE_CONNECTED) {
+        linkStatePost(LINK_EV_STOP_BUTTON);
+    } else if (state == LINK_STATE_DISCOVERABLE) {
+        linkStatePost(LINK_EV_DISCOVERABLE_TIMEOUT);
+    } else {
+        linkStatePost(LINK_EV_CONNECT_BUTTON);
+    }
+}
+
+static float lifeHours(const EnergyResult& r) {
+    float ma = r.coulombMah >= COULOMB_MIN_MAH ? r.coulombMah * 3600.0f / r.seconds : -r.sampledMa;
+    return ma > 0 ? POWER_BATTERY_MAH / ma : -1;
+}
+
+static const char* codecName(const EnergyScenario& s) {
+    if (s.link != ENERGY_LINK_STREAM) return "-";
+    if (s.streamMode == LINK_MODE_FEATURES) return "features";
+    return powerPolicyTierConfig(s.tier).adpcm ? "adpcm" : "pcm";
+}
+
+static void printCsv() {
+    Serial.println("[energy] csv begin");
+    Serial.println("scenario,link,tier,ui_ms,codec,cpu_mhz,screen,seconds,coulomb_mah,coulomb_ma,sampled_ma,"
+                   "battery_v,life_h,note");
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        const EnergyScenario& s = scenarios[i];
+        const EnergyResult& r = results[i];
+        const PowerTierConfig& config = powerPolicyTierConfig(s.tier);
+        Serial.printf("%s,%s,%s,%u,%s,%u,%d,", s.name, linkNames[s.link], config.name, config.uiIntervalMs,
+                      codecName(s), config.cpuMhz, config.screenOn ? 1 : 0);
+        if (!r.measured) {
+            Serial.println(",,,,,,skipped");
+            continue;
+        }
+        Serial.printf("%.1f,%.2f,%.1f,%.1f,%.3f,%.1f,%s\n", r.seconds, r.coulombMah, r.coulombMah * 3600.0f / r.seconds,
+                      -r.sampledMa, r.batteryV, lifeHours(r),
+                      r.sampledMa >= 0 ? "charging" : r.interrupted ? "interrupted" : "");
+    }
+    Serial.println("[energy] csv end");
+}
+
+// 次のシナリオへ（受信側が来なかったら送信のシナリオは飛ばす）。全部終わったら false
+static bool nextScenario() {
+    current++;
+    while (current < SCENARIO_COUNT && skipStreams && scenarios[current].link == ENERGY_LINK_STREAM) current++;
+    if (current >= SCENARIO_COUNT) {
+        enterPhase(PHASE_DONE);
+        i2cBusPost(I2C_CMD_COULOMB, 0);
+        powerPolicyRelease();
+        Serial.println("[energy] done");
+        printCsv();
+        lastReport = millis();
+        return false;
+    }
+
+    const EnergyScenario& s = scenarios[current];
+    Serial.printf("[energy] %u/%u %s\n", (unsigned)current + 1, (unsigned)SCENARIO_COUNT, s.name);
+    if (s.link == ENERGY_LINK_STREAM && linkState() != LINK_STATE_CONNECTED) {
+        Serial.println("[energy] waiting for the receiver to connect");
+    }
+    enterPhase(PHASE_PREPARE);
+    return true;
+}
+
+static void finishScenario() {
+    I2cCoulombSnapshot end;
+    EnergyResult& r = results[current];
+    i2cBusCoulomb(end, 0);
+    r.measured = true;
+    r.seconds = (end.readMs - startCoulomb.readMs) / 1000.0f;
+    r.coulombMah = startCoulomb.mah - end.mah;
+    r.sampledMa = samples > 0 ? currentSum / samples : 0;
+    r.batteryV = samples > 0 ? voltageSum / samples : 0;
+
+    float hours = lifeHours(r);
+    Serial.printf("[energy] %s: %.0f s, %.2f mAh (%.1f mA), sampled %.1f mA, %.2f V, ~%.1f h on %d mAh%s\n",
+                  scenarios[current].name, r.seconds, r.coulombMah, r.coulombMah * 3600.0f / r.seconds,
+                  -r.sampledMa, r.batteryV, hours, POWER_BATTERY_MAH,
+                  r.sampledMa >= 0 ? " (charging)" : r.interrupted ? " (interrupted)" : "");
+}
+
+bool energyBenchBegin() {
+    enabled = true;
+    memset(results, 0, sizeof(results));
+    enterPhase(PHASE_WAIT_BATTERY);
+    Serial.printf("[energy] %u scenarios, %u s each after %u s settling; unplug USB to start\n",
+                  (unsigned)SCENARIO_COUNT, ENERGY_BENCH_MEASURE_MS / 1000, ENERGY_BENCH_SETTLE_MS / 1000);
+    return true;
+}
+
+bool energyBenchActive() {
+    return enabled && phase != PHASE_DONE;
+}
+
+bool energyBenchPoll(const EnergyScenario*& scenario) {
+    if (!enabled) return false;
+    unsigned long now = millis();
+    if (now - lastTick < ENERGY_BENCH_TICK_MS) return false;
+    lastTick = now;
+
+    I2cPowerSnapshot power = {};
+    i2cBusPower(power, ENERGY_BENCH_TICK_MS);
+    const EnergyScenario& s = scenarios[current < SCENARIO_COUNT ? current : 0];
+    I2cCoulombSnapshot coulomb;
+
+    switch (phase) {
+    case PHASE_WAIT_BATTERY:
+        if (power.batteryCurrentMa < 0) {
+            i2cBusPost(I2C_CMD_COULOMB, 1);
+            Serial.printf("[energy] on battery (%.0f%%, %.2f V), starting\n", power.batteryLevel, power.batteryVoltage);
+            current = (size_t)-1;
+            nextScenario();
+        }
+        return false;
+
+    case PHASE_PREPARE:
+        if (linkState() == wantedState(s)) {
+            enterPhase(PHASE_SETTLE);
+            scenario = &s;
+            return true;
+        }
+        if (s.link == ENERGY_LINK_STREAM && now - phaseSince >= ENERGY_BENCH_CONNECT_MS) {
+            Serial.println("[energy] receiver did not connect, skipping stream scenarios");
+            skipStreams = true;
+            if (!nextScenario()) {
+                scenario = nullptr;
+                return true;
+            }
+            return false;
+        }
+        driveLink(s);
+        return false;
+
+    case PHASE_SETTLE:
+        if (linkBroken(s)) {
+            enterPhase(PHASE_PREPARE);
+        } else if (now - phaseSince >= ENERGY_BENCH_SETTLE_MS) {
+            enterPhase(PHASE_START);
+            i2cBusCoulomb(coulomb, 0);
+        } else {
+            driveLink(s);
+        }
+        return false;
+
+    case PHASE_START:
+        if (i2cBusCoulomb(coulomb, 0) && (long)(coulomb.readMs - phaseSince) >= 0) {
+            startCoulomb = coulomb;
+            currentSum = 0;
+            voltageSum = 0;
+            samples = 0;
+            enterPhase(PHASE_MEASURE);
+        }
+        return false;
+
+    case PHASE_MEASURE:
+        currentSum += power.batteryCurrentMa;
+        voltageSum += power.batteryVoltage;
+        samples++;
+        if (linkBroken(s)) {
+            results[current].interrupted = true;
+            Serial.printf("[energy] %s: link changed to %s, stopping early\n", s.name, linkStateName(linkState()));
+        } else if (powerPolicyTier() != s.tier) {
+            // 残量低下・高温で省電力ポリシーが固定を破った
+            results[current].interrupted = true;
+            Serial.printf("[energy] %s: power policy moved to %s, stopping early\n", s.name, powerPolicyConfig().name);
+        } else if (now - phaseSince < ENERGY_BENCH_MEASURE_MS) {
+            driveLink(s);
+            return false;
+        }
+        enterPhase(PHASE_FINISH);
+        i2cBusCoulomb(coulomb, 0);
+        return false;
+
+    case PHASE_FINISH:
+        if (i2cBusCoulomb(coulomb, 0) && (long)(coulomb.readMs - phaseSince) >= 0) {
+            finishScenario();
+            if (!nextScenario()) {
+                scenario = nullptr;
+                return true;
+            }
+        }
+        return false;
+
+    case PHASE_DONE:
+        if (now - lastReport >= ENERGY_BENCH_REPORT_MS) {
+            printCsv();
+            lastReport = now;
+        }
+        return false;
+    }
+    return false;
+}
+
+uint32_t energyBenchWaitMs() {
+    if (!enabled) return UINT32_MAX;
+    long remaining = (long)(lastTick + ENERGY_BENCH_TICK_MS - millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+#else
+
+bool energyBenchBegin() { return false; }
+bool energyBenchActive() { return false; }
+bool energyBenchPoll(const EnergyScenario*& scenario) { scenario = nullptr; return false; }
+uint32_t energyBenchWaitMs() { return UINT32_MAX; }
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * 設定ごとの消費電力の計測（AXP192 のクーロンカウンタ）
+ *
+ * -DENERGY_BENCH=1 のビルドでは、起動後に USB を外す（電池から放電し始める）と
+ * 決まった順にシナリオ（接続状態 × 省電力ティア × 送信形式）を切り替え、それぞれ
+ * ENERGY_BENCH_SETTLE_MS 待ってから ENERGY_BENCH_MEASURE_MS の間の消費を測る。
+ *
+ *   - 消費量はクーロンカウンタ（約 0.36mAh 単位）の差、あわせて 1 秒ごとの放電電流の平均も取る
+ *   - 満充電の電池（POWER_BATTERY_MAH）で何時間持つかを見積もる
+ *   - シナリオごとに [energy] 行、終わったら CSV をシリアルに出力する
+ *     （USB を挿し直してから読めるよう、以降 ENERGY_BENCH_REPORT_MS ごとに CSV を出し直す）
+ *
+ * 接続状態は linkStatePost() でボタンと同じイベントを積んで作る。送信のシナリオでは受信側
+ * （m5scribed など）が接続してくるのを ENERGY_BENCH_CONNECT_MS まで待ち、来なければ残りの送信シナリオを飛ばす。
+ * 接続受付のシナリオの間は受信側を接続させないこと（接続したらそのシナリオは interrupted になる）。
+ * I2C は I2C バスタスク経由で読む。ティアの適用（CPU・画面）と送信形式の切り替えは呼び出し側で行う。
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "power_policy.h"
+
+#ifndef ENERGY_BENCH
+#define ENERGY_BENCH 0
+#endif
+
+#ifndef ENERGY_BENCH_MEASURE_MS
+#define ENERGY_BENCH_MEASURE_MS  120000   // 1 シナリオの計測時間
+#endif
+#define ENERGY_BENCH_SETTLE_MS   20000    // 切り替えてから電流が落ち着くまで
+#define ENERGY_BENCH_CONNECT_MS  120000   // 送信のシナリオで受信側の接続を待つ上限
+#define ENERGY_BENCH_TICK_MS     1000     // 状態の確認と電流のサンプリング
+#define ENERGY_BENCH_REPORT_MS   30000    // 終了後に CSV を出し直す間隔
+
+enum EnergyLink : uint8_t {
+    ENERGY_LINK_IDLE,           // 待機（READY）
+    ENERGY_LINK_DISCOVERABLE,   // 接続受付（アニメーション）
+    ENERGY_LINK_STREAM,         // 接続して送信
+};
+
+struct EnergyScenario {
+    const char* name;
+    EnergyLink link;
+    PowerTier tier;             // 画面更新間隔・コーデック・CPU 周波数・画面
+    uint8_t streamMode;         // LinkStreamMode（送信のシナリオのみ）
+};
+
+// ENERGY_BENCH=0 のビルドでは false を返し、以降の呼び出しは何もしない
+bool energyBenchBegin();
+bool energyBenchActive();
+
+// loop() から毎回呼ぶ。適用する設定が変わったら true（終了したら scenario は nullptr）
+bool energyBenchPoll(const EnergyScenario*& scenario);
+
+// 次に確認が必要になるまでの時間（loop() の待機の上限）
+uint32_t energyBenchWaitMs();
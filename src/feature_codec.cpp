@@ -0,0 +1,78 @@
+/**
+ * log-mel 特徴量の量子化の実装
+ */
+#include "feature_codec.h"
+
+#include <math.h>
+#include <string.h>
+
+static void writeFloat(uint8_t* out, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, 4);
+    out[0] = bits & 0xFF;
+    out[1] = (bits >> 8) & 0xFF;
+    out[2] = (bits >> 16) & 0xFF;
+    out[3] = bits >> 24;
+}
+
+static float readFloat(const uint8_t* in) {
+    uint32_t bits = (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+    float v;
+    memcpy(&v, &bits, 4);
+    return v;
+}
+
+MelFrontendConfig featureFrontendConfig() {
+    MelFrontendConfig cfg = { FEATURE_SAMPLE_RATE, FEATURE_FRAME_LENGTH, FEATURE_HOP_LENGTH,
+                              FEATURE_FFT_SIZE, FEATURE_NUM_MELS, FEATURE_FMIN, FEATURE_FMAX };
+    return cfg;
+}
+
+size_t featureBatchEncode(const float* logMel, int numFrames, int numMels, int hopLength, uint8_t* out) {
+    size_t count = (size_t)numFrames * numMels;
+
+    // バッチ内の範囲を 256 段階に割り当てる
+    float lo = logMel[0], hi = logMel[0];
+    for (size_t i = 1; i < count; i++) {
+        if (logMel[i] < lo) lo = logMel[i];
+        if (logMel[i] > hi) hi = logMel[i];
+    }
+    // 無音（log(1e-10) 付近）に刻みを取られないよう、最大値から一定範囲に制限
+    if (lo < hi - FEATURE_DYNAMIC_RANGE) lo = hi - FEATURE_DYNAMIC_RANGE;
+    float step = (hi - lo) / 255.0f;
+
+    out[0] = (uint8_t)numMels;
+    out[1] = (uint8_t)numFrames;
+    out[2] = hopLength & 0xFF;
+    out[3] = hopLength >> 8;
+    writeFloat(out + 4, lo);
+    writeFloat(out + 8, step);
+
+    uint8_t* q = out + FEATURE_HEADER_SIZE;
+    float inv = step > 0.0f ? 1.0f / step : 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        int v = (int)lroundf((logMel[i] - lo) * inv);
+        q[i] = (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+    return FEATURE_HEADER_SIZE + count;
+}
+
+bool featureBatchDecode(const uint8_t* payload, size_t length, float* out, size_t maxValues,
+                        FeatureBatchInfo& info) {
+    if (length < FEATURE_HEADER_SIZE) return false;
+
+    info.numMels = payload[0];
+    info.numFrames = payload[1];
+    info.hopLength = payload[2] | (payload[3] << 8);
+    info.offset = readFloat(payload + 4);
+    info.step = readFloat(payload + 8);
+
+    size_t count = (size_t)info.numMels * info.numFrames;
+    if (length < FEATURE_HEADER_SIZE + count || count > maxValues) return false;
+
+    const uint8_t* q = payload + FEATURE_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = info.offset + q[i] * info.step;
+    }
+    return true;
+}
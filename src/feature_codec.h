@@ -0,0 +1,58 @@
+/**
+ * log-mel 特徴量フレームの 8bit 量子化（LINK_FRAME_FEATURES のペイロード）
+ *
+ * 端末（feature_stream.cpp）と受信側（linux/ の m5scribed・評価ツール）で共用する。
+ * バッチごとに最小値と刻み幅を持つ線形量子化で、logMel = offset + q * step。
+ *
+ *   [0]      numMels
+ *   [1]      numFrames
+ *   [2-3]    hopLength（サンプル、LE）
+ *   [4-7]    offset（float LE）
+ *   [8-11]   step（float LE）
+ *   [12..]   uint8 q[numFrames][numMels]
+ *
+ * フレームのタイムスタンプはバッチ先頭フレームの先頭サンプル番号。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mel_frontend.h"
+
+// ASR で一般的な 25ms 窓 / 10ms ホップ / 80 帯域
+#define FEATURE_SAMPLE_RATE    16000
+#define FEATURE_FRAME_LENGTH   400
+#define FEATURE_HOP_LENGTH     160
+#define FEATURE_FFT_SIZE       512
+#define FEATURE_NUM_MELS       80
+#define FEATURE_FMIN           20.0f
+#define FEATURE_FMAX           8000.0f
+
+#define FEATURE_DYNAMIC_RANGE  16.0f  // 量子化する範囲（自然対数、約 70dB）
+
+#define FEATURE_BATCH_FRAMES   10     // 1 フレームで送る特徴量（100ms 分）
+#define FEATURE_HEADER_SIZE    12
+#define FEATURE_MAX_PAYLOAD    (FEATURE_HEADER_SIZE + FEATURE_BATCH_FRAMES * FEATURE_NUM_MELS)
+
+struct FeatureBatchInfo {
+    int numMels;
+    int numFrames;
+    int hopLength;
+    float offset;
+    float step;
+};
+
+// 特徴量送信モードのフロントエンド設定
+MelFrontendConfig featureFrontendConfig();
+
+// numFrames × numMels の log-mel を量子化して out に書き込む（書き込んだバイト数を返す）
+size_t featureBatchEncode(const float* logMel, int numFrames, int numMels, int hopLength, uint8_t* out);
+
+/**
+ * ペイロードを log-mel に戻す
+ *
+ * out には numFrames × numMels 個書き込む（maxValues に収まらなければ false）。
+ */
+bool featureBatchDecode(const uint8_t* payload, size_t length, float* out, size_t maxValues,
+                        FeatureBatchInfo& info);
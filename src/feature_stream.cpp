@@ -0,0 +1,96 @@
+/**
+ * 特徴量送信モードの実装
+ */
+#include "feature_stream.h"
+
+#include <Arduino.h>
+
+#include "feature_codec.h"
+#include "hot_path.h"
+#include "hot_placement.h"
+#include "mel_frontend.h"
+#include "transport.h"
+
+static MelFrontend frontend;
+static bool ready = false;
+
+static float batch[FEATURE_BATCH_FRAMES * FEATURE_NUM_MELS];
+static int batchFrames = 0;
+static uint32_t batchIndex = 0;        // バッチ先頭フレームのサンプル番号
+static uint8_t payload[FEATURE_MAX_PAYLOAD];
+
+static uint32_t sendUs = 0;            // featuresProcess() 内で送信に使った時間
+static FeatureStats stats = {};
+
+static void onMelFrame(const float* logMel, uint32_t frameIndex, void* context) {
+    if (batchFrames == 0) batchIndex = frameIndex;
+    memcpy(batch + batchFrames * FEATURE_NUM_MELS, logMel, FEATURE_NUM_MELS * sizeof(float));
+    batchFrames++;
+    stats.frames++;
+
+    if (batchFrames < FEATURE_BATCH_FRAMES) return;
+
+    size_t length = featureBatchEncode(batch, batchFrames, FEATURE_NUM_MELS, FEATURE_HOP_LENGTH, payload);
+    batchFrames = 0;
+
+    unsigned long start = micros();
+    if (!transportSendFrame(LINK_FRAME_FEATURES, 0, payload, length, batchIndex)) {
+        Serial.printf("Warning: Feature frame dropped (%d bytes)\n", length);
+    }
+    sendUs += micros() - start;
+    stats.batches++;
+    stats.payloadBytes += length;
+}
+
+bool featuresBegin() {
+    if (ready) return true;
+    ready = melFrontendInit(frontend, featureFrontendConfig());
+    if (ready) {
+        Serial.printf("Features: %d mel / %d ms hop, front end %u B\n",
+                      FEATURE_NUM_MELS, FEATURE_HOP_LENGTH * 1000 / FEATURE_SAMPLE_RATE,
+                      melFrontendMemory(frontend));
+    }
+    return ready;
+}
+
+void featuresReset(uint32_t nextIndex) {
+    melFrontendReset(frontend, nextIndex);
+    batchFrames = 0;
+}
+
+HOT_FUNC(FEATURES) void featuresProcess(const int16_t* samples, size_t count, uint32_t firstIndex) {
+    if (!ready) return;
+
+    HotPathMark mark;
+    hotPathBegin(mark);
+    unsigned long start = micros();
+    sendUs = 0;
+    melFrontendPush(frontend, samples, count, firstIndex, onMelFrame, nullptr);
+    stats.computeUs += (micros() - start) - sendUs;
+    if (sendUs == 0) hotPathEnd(HOT_FEATURES, mark);  // 送信待ちは区間に含めない
+}
+
+void featuresGetStats(FeatureStats& out) {
+    out = stats;
+}
+
+void featuresLogStats() {
+    static unsigned long lastLog = 0;
+    static FeatureStats last = {};
+
+    unsigned long now = millis();
+    if (lastLog != 0 && stats.frames != last.frames) {
+        float seconds = (now - lastLog) / 1000.0f;
+        uint32_t frames = stats.frames - last.frames;
+        uint64_t us = stats.computeUs - last.computeUs;
+        Serial.printf("[features] %u frames, %.2f ms/frame, cpu %.1f%%, %.2f kB/s (PCM %.2f kB/s)\n",
+                      frames,
+                      us / 1000.0f / frames,
+                      us / 10.0f / (seconds * 1000.0f),
+                      (stats.payloadBytes - last.payloadBytes) / seconds / 1000.0f,
+                      frames * FEATURE_HOP_LENGTH * 2 / seconds / 1000.0f);
+    }
+
+    last = stats;
+    lastLog = now;
+}
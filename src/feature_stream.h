@@ -0,0 +1,31 @@
+/**
+ * 特徴量送信モード
+ *
+ * 受信側が LINK_CTRL_SET_MODE で要求すると、PCM の代わりに
+ * 80 帯域 log-mel（25ms 窓 / 10ms ホップ）を 8bit 量子化して LINK_FRAME_FEATURES で送る。
+ * 量子化形式は feature_codec.h を参照。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct FeatureStats {
+    uint32_t frames;          // 計算した log-mel フレーム数
+    uint32_t batches;         // 送信したフレーム数
+    uint32_t payloadBytes;
+    uint64_t computeUs;       // 特徴量計算＋量子化の累計時間（送信待ちは含まない）
+};
+
+bool featuresBegin();
+
+// 次に渡すサンプル番号から計算し直す（モード切替時）
+void featuresReset(uint32_t nextIndex);
+
+// 履歴リングから読んだサンプルを渡す（バッチがそろうごとに送信する）
+void featuresProcess(const int16_t* samples, size_t count, uint32_t firstIndex);
+
+void featuresGetStats(FeatureStats& out);
+
+// 前回呼び出しからの計算コストとビットレートをシリアルに出力
+void featuresLogStats();
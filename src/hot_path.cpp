@@ -0,0 +1,107 @@
+/**
+ * 音声経路のキャッシュミスによるストールの計測の実装
+ */
+#include "hot_path.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "hot_placement.h"
+
+#if HOT_PATH_PROBE
+#if __has_include(<xtensa_perfmon_access.h>)
+#include <xtensa_perfmon_access.h>
+#include <xtensa_perfmon_masks.h>
+#define HOT_PATH_PERFMON 1
+#else
+#define HOT_PATH_PERFMON 0
+#endif
+
+#define PERF_I_STALL 0                // 性能カウンタの番号
+#define PERF_D_STALL 1
+
+struct RegionStats {
+    uint32_t calls;
+    uint64_t cycles;
+    uint32_t cyclesMax;
+    double cyclesSquared;             // 標準偏差用
+    uint64_t iStall;
+    uint64_t dStall;
+};
+
+static const struct {
+    const char* name;
+    bool pinned;
+} regions[HOT_REGION_COUNT] = {
+    { "capture",  HOT_PIN_CAPTURE },
+    { "read",     HOT_PIN_READ },
+    { "adpcm",    HOT_PIN_ADPCM },
+    { "features", HOT_PIN_FEATURES },
+};
+
+static RegionStats stats[HOT_REGION_COUNT];
+static bool perfStarted[portNUM_PROCESSORS];
+
+void hotPathBegin(HotPathMark& mark) {
+#if HOT_PATH_PERFMON
+    // カウンタはコアごと（最初に使うコアで設定する）
+    int core = xPortGetCoreID();
+    if (!perfStarted[core]) {
+        xtensa_perfmon_init(PERF_I_STALL, XTPERF_CNT_I_STALL,
+                            XTPERF_MASK_I_STALL_CACHE_MISS | XTPERF_MASK_I_STALL_BUSY | XTPERF_MASK_I_STALL_IN_PIF,
+                            0, -1);
+        xtensa_perfmon_init(PERF_D_STALL, XTPERF_CNT_D_STALL,
+                            XTPERF_MASK_D_STALL_CACHE_MISS | XTPERF_MASK_D_STALL_BUSY | XTPERF_MASK_D_STALL_IN_PIF,
+                            0, -1);
+        xtensa_perfmon_start();
+        perfStarted[core] = true;
+    }
+    mark.iStall = xtensa_perfmon_value(PERF_I_STALL);
+    mark.dStall = xtensa_perfmon_value(PERF_D_STALL);
+#else
+    mark.iStall = mark.dStall = 0;
+#endif
+    mark.cycles = ESP.getCycleCount();
+}
+
+void hotPathEnd(HotRegion region, const HotPathMark& mark) {
+    uint32_t cycles = ESP.getCycleCount() - mark.cycles;
+    RegionStats& s = stats[region];
+#if HOT_PATH_PERFMON
+    s.iStall += xtensa_perfmon_value(PERF_I_STALL) - mark.iStall;
+    s.dStall += xtensa_perfmon_value(PERF_D_STALL) - mark.dStall;
+#endif
+    s.calls++;
+    s.cycles += cycles;
+    s.cyclesSquared += (double)cycles * cycles;
+    if (cycles > s.cyclesMax) s.cyclesMax = cycles;
+}
+
+void hotPathLogStats() {
+    float mhz = getCpuFrequencyMhz();
+    for (int r = 0; r < HOT_REGION_COUNT; r++) {
+        RegionStats s = stats[r];
+        stats[r] = {};
+        if (s.calls == 0) continue;
+
+        double mean = (double)s.cycles / s.calls;
+        double variance = s.cyclesSquared / s.calls - mean * mean;
+        Serial.printf("[hot] %s %s: %u calls, avg %.1f us, max %.1f us, sd %.1f us",
+                      regions[r].name, regions[r].pinned ? "iram" : "flash", s.calls, mean / mhz,
+                      s.cyclesMax / mhz, variance > 0 ? sqrt(variance) / mhz : 0.0);
+        if (HOT_PATH_PERFMON) {
+            Serial.printf(", istall %.1f%%, dstall %.1f%%\n",
+                          100.0 * s.iStall / s.cycles, 100.0 * s.dStall / s.cycles);
+        } else {
+            Serial.println(", stalls n/a (no perfmon)");
+        }
+    }
+}
+
+#else
+
+void hotPathBegin(HotPathMark& mark) {}
+void hotPathEnd(HotRegion region, const HotPathMark& mark) {}
+void hotPathLogStats() {}
+
+#endif
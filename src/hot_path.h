@@ -0,0 +1,41 @@
+/**
+ * 音声経路のキャッシュミスによるストールの計測
+ *
+ * フラッシュ（と PSRAM）はキャッシュ越しに読むので、ミスすると命令フェッチ・データ読み出しが止まる。
+ * -DHOT_PATH_PROBE=1 のビルドでは、音声経路の区間（キャプチャ・履歴の読み出し・ADPCM・log-mel）ごとに
+ * Xtensa の性能カウンタ（perfmon）で命令側とデータ側のストールのサイクル数を数え、
+ * 1 回あたりの時間の平均・最大・標準偏差（ジッター）とあわせて [hot] 行に出力する。
+ * カウンタはコア全体のものなので、区間の途中で割り込みや他のタスクが走った分も含む。
+ * perfmon の無い SDK ではストールを数えず時間だけを出す。
+ *
+ * ストールの多い区間は tools/hot_pin.py で hot_pins.h に書き出すと、次のビルドから
+ * その区間の関数と定数表が IRAM / DRAM に置かれる（hot_placement.h）。
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifndef HOT_PATH_PROBE
+#define HOT_PATH_PROBE 0
+#endif
+
+enum HotRegion : uint8_t {
+    HOT_CAPTURE,      // キャプチャタスクの 1 ブロック（前処理・利得・履歴への書き込み）
+    HOT_READ,         // captureRead()（32bit 履歴ならディザ）
+    HOT_ADPCM,        // adpcmEncode()
+    HOT_FEATURES,     // featuresProcess()（送信を含んだ呼び出しは数えない）
+    HOT_REGION_COUNT,
+};
+
+struct HotPathMark {
+    uint32_t cycles;
+    uint32_t iStall;
+    uint32_t dStall;
+};
+
+// 区間の始まりと終わり（HOT_PATH_PROBE=0 のビルドでは何もしない）
+void hotPathBegin(HotPathMark& mark);
+void hotPathEnd(HotRegion region, const HotPathMark& mark);
+
+// 前回呼び出しからの区間ごとの時間とストールをシリアルに出力
+void hotPathLogStats();
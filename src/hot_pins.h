@@ -0,0 +1,31 @@
+/**
+ * IRAM / DRAM に置く音声経路の区間（hot_placement.h）
+ *
+ * tools/hot_pin.py が -DHOT_PATH_PROBE=1 のビルドの [hot] 行から生成する。手で書き換えてもよい。
+ */
+#pragma once
+
+#ifndef HOT_PIN_CAPTURE
+#define HOT_PIN_CAPTURE   0
+#endif
+#ifndef HOT_PIN_READ
+#define HOT_PIN_READ      0
+#endif
+#ifndef HOT_PIN_ADPCM
+#define HOT_PIN_ADPCM     0
+#endif
+#ifndef HOT_PIN_FEATURES
+#define HOT_PIN_FEATURES  0
+#endif
+#ifndef HOT_DRAM_CAPTURE
+#define HOT_DRAM_CAPTURE  0
+#endif
+#ifndef HOT_DRAM_READ
+#define HOT_DRAM_READ     0
+#endif
+#ifndef HOT_DRAM_ADPCM
+#define HOT_DRAM_ADPCM    0
+#endif
+#ifndef HOT_DRAM_FEATURES
+#define HOT_DRAM_FEATURES 0
+#endif
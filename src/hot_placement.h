@@ -0,0 +1,30 @@
+/**
+ * 音声経路の関数と定数表の配置（IRAM / DRAM）
+ *
+ *   HOT_FUNC(ADPCM) size_t adpcmEncode(...)          HOT_PIN_ADPCM が 1 なら IRAM
+ *   HOT_TABLE(ADPCM) static const int16_t table[]   HOT_DRAM_ADPCM が 1 なら DRAM
+ *
+ * どの区間を置くかは hot_pins.h（tools/hot_pin.py が [hot] 行から生成）で決める。
+ * IRAM は BT スタックと共用で余裕が少ないので、命令側のストールを計測して効く区間だけを置く。
+ * データ側のストールは定数表を DRAM に移すことでしか減らせない（PSRAM の履歴や DMA バッファの分は残る）。
+ * Linux の評価ツールと共有するソースからも使う（ESP_PLATFORM 以外では何もしない）。
+ */
+#pragma once
+
+#include "hot_pins.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_attr.h>
+#define HOT_FUNC_1  IRAM_ATTR
+#define HOT_TABLE_1 DRAM_ATTR
+#else
+#define HOT_FUNC_1
+#define HOT_TABLE_1
+#endif
+#define HOT_FUNC_0
+#define HOT_TABLE_0
+
+#define HOT_PLACE_(kind, pin)   kind##_##pin
+#define HOT_PLACE(kind, pin)    HOT_PLACE_(kind, pin)
+#define HOT_FUNC(region)        HOT_PLACE(HOT_FUNC, HOT_PIN_##region)
+#define HOT_TABLE(region)       HOT_PLACE(HOT_TABLE, HOT_DRAM_##region)
@@ -0,0 +1,323 @@
+/**
+ * 内部 I2C バスの管理タスク
+ */
+#include "i2c_bus.h"
+
+#include <freertos/queue.h>
+
+struct I2cCommand {
+    uint8_t type;
+    uint8_t arg;
+    uint32_t postedUs;
+};
+
+// ジョブごと（最後の要素は書き込みコマンド）の統計
+struct I2cJobStats {
+    uint32_t count;
+    uint32_t busyUs;
+    uint32_t maxUs;        // 1 回の所要時間の最大
+    uint32_t maxLateUs;    // 期限（要求）から実行開始までの最大
+};
+
+static const char* const jobNames[I2C_JOB_COUNT + 1] = { "touch", "power", "temp", "rtc", "coul", "cmd" };
+static const uint32_t jobPeriodMs[I2C_JOB_COUNT] = { I2C_BUS_TOUCH_MS, I2C_BUS_POWER_MS, I2C_BUS_TEMP_MS, 0, 0 };
+
+static TaskHandle_t busTask = nullptr;
+static I2cTouchCallback touchHandler = nullptr;
+static QueueHandle_t commandQueue = nullptr;
+static portMUX_TYPE cacheMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t nextDueUs[I2C_JOB_COUNT];
+static volatile bool jobRequested[I2C_JOB_COUNT];
+static volatile uint32_t jobRequestUs[I2C_JOB_COUNT];
+
+// キャッシュ（cacheMux で保護）
+static I2cPowerSnapshot power = {};
+static bool powerValid = false;
+static uint32_t powerMs = 0;
+static RTC_TimeTypeDef rtcTime = {};
+static RTC_DateTypeDef rtcDate = {};
+static bool rtcValid = false;
+static uint32_t rtcMs = 0;
+static I2cCoulombSnapshot coulomb = {};
+static bool coulombValid = false;
+static TouchPoint_t touchPoint = { -1, -1 };
+static uint8_t pendingButtons = 0;
+
+static I2cJobStats stats[I2C_JOB_COUNT + 1];
+static uint32_t statsSinceUs = 0;
+
+static void recordStats(int index, uint32_t startUs, uint32_t dueUs) {
+    uint32_t elapsed = micros() - startUs;
+    uint32_t late = startUs - dueUs;
+    portENTER_CRITICAL(&cacheMux);
+    I2cJobStats& s = stats[index];
+    s.count++;
+    s.busyUs += elapsed;
+    if (elapsed > s.maxUs) s.maxUs = elapsed;
+    if (late > s.maxLateUs) s.maxLateUs = late;
+    portEXIT_CRITICAL(&cacheMux);
+}
+
+// タッチの押し始めが画面下のボタン範囲なら記録する
+static void detectButton(const TouchPoint_t& previous, const TouchPoint_t& current) {
+    bool wasTouching = previous.x >= 0 && previous.y >= 0;
+    if (wasTouching || current.y < 240) return;
+
+    uint8_t button = 0;
+    if (current.x >= 10 && current.x < 120) {
+        button = I2C_BUTTON_A;
+    } else if (current.x >= 130 && current.x < 200) {
+        button = I2C_BUTTON_B;
+    } else if (current.x >= 230 && current.x < 310) {
+        button = I2C_BUTTON_C;
+    }
+    pendingButtons |= button;
+}
+
+static void runCommand(const I2cCommand& command) {
+    uint32_t start = micros();
+    switch (command.type) {
+    case I2C_CMD_BACKLIGHT:
+        M5.Axp.SetDCDC3(command.arg != 0);
+        break;
+    case I2C_CMD_LDO:
+        M5.Axp.SetLDOEnable(command.arg >> 1, command.arg & 1);
+        break;
+    case I2C_CMD_COULOMB:
+        if (command.arg) {
+            M5.Axp.EnableCoulombcounter();
+            M5.Axp.ClearCoulombcounter();
+        } else {
+            M5.Axp.StopCoulombcounter();
+        }
+        portENTER_CRITICAL(&cacheMux);
+        coulombValid = false;
+        portEXIT_CRITICAL(&cacheMux);
+        break;
+    }
+    recordStats(I2C_JOB_COUNT, start, command.postedUs);
+}
+
+static void runJob(I2cJob job, uint32_t start) {
+    // 期限と要求のうち早いほうからの遅れ
+    uint32_t due = start;
+    if (jobPeriodMs[job] != 0 && (int32_t)(start - nextDueUs[job]) >= 0) due = nextDueUs[job];
+    if (jobRequested[job] && (int32_t)(due - jobRequestUs[job]) > 0) due = jobRequestUs[job];
+    jobRequested[job] = false;
+
+    switch (job) {
+    case I2C_JOB_TOUCH: {
+        TouchPoint_t point = M5.Touch.getPressPoint();
+        portENTER_CRITICAL(&cacheMux);
+        bool pressed = touchPoint.x < 0 && point.x >= 0 && point.y >= 0;
+        detectButton(touchPoint, point);
+        touchPoint = point;
+        portEXIT_CRITICAL(&cacheMux);
+        if (pressed && touchHandler) touchHandler(point.x, point.y);
+        break;
+    }
+    case I2C_JOB_POWER: {
+        // 残量・電圧・電流はまとめて読む
+        float level = M5.Axp.GetBatteryLevel();
+        float voltage = M5.Axp.GetBatVoltage();
+        float current = M5.Axp.GetBatCurrent();
+        portENTER_CRITICAL(&cacheMux);
+        power.batteryLevel = level;
+        power.batteryVoltage = voltage;
+        power.batteryCurrentMa = current;
+        powerValid = true;
+        powerMs = millis();
+        portEXIT_CRITICAL(&cacheMux);
+        break;
+    }
+    case I2C_JOB_TEMP: {
+        float temperature = M5.Axp.GetTempInAXP192();
+        portENTER_CRITICAL(&cacheMux);
+        power.temperatureC = temperature;
+        portEXIT_CRITICAL(&cacheMux);
+        break;
+    }
+    case I2C_JOB_RTC: {
+        RTC_TimeTypeDef time;
+        RTC_DateTypeDef date;
+        M5.Rtc.GetTime(&time);
+        M5.Rtc.GetDate(&date);
+        portENTER_CRITICAL(&cacheMux);
+        rtcTime = time;
+        rtcDate = date;
+        rtcValid = true;
+        rtcMs = millis();
+        portEXIT_CRITICAL(&cacheMux);
+        break;
+    }
+    case I2C_JOB_COULOMB: {
+        float mah = M5.Axp.GetCoulombData();
+        portENTER_CRITICAL(&cacheMux);
+        coulomb.mah = mah;
+        coulomb.readMs = millis();
+        coulombValid = true;
+        portEXIT_CRITICAL(&cacheMux);
+        break;
+    }
+    default:
+        return;
+    }
+    recordStats(job, start, due);
+
+    // 周期ジョブの次の期限（大きく遅れたら今から数え直す）
+    if (jobPeriodMs[job] != 0) {
+        uint32_t periodUs = jobPeriodMs[job] * 1000;
+        nextDueUs[job] += periodUs;
+        if ((int32_t)(start - nextDueUs[job]) >= 0) nextDueUs[job] = start + periodUs;
+    }
+}
+
+static bool jobDue(int job, uint32_t now) {
+    return jobRequested[job] || (jobPeriodMs[job] != 0 && (int32_t)(now - nextDueUs[job]) >= 0);
+}
+
+static void i2cBusTask(void* param) {
+    for (;;) {
+        // 書き込みはジョブより先に
+        I2cCommand command;
+        while (xQueueReceive(commandQueue, &command, 0) == pdTRUE) {
+            runCommand(command);
+        }
+
+        // 期限を迎えたジョブのうち優先度の最も高いものを 1 つ
+        uint32_t now = micros();
+        int job = 0;
+        while (job < I2C_JOB_COUNT && !jobDue(job, now)) job++;
+        if (job < I2C_JOB_COUNT) {
+            runJob((I2cJob)job, now);
+            continue;
+        }
+
+        // 次の期限まで待つ（要求とコマンドで起こされる）
+        uint32_t waitUs = UINT32_MAX;
+        for (int j = 0; j < I2C_JOB_COUNT; j++) {
+            if (jobPeriodMs[j] == 0) continue;
+            uint32_t remaining = nextDueUs[j] - now;
+            if (remaining < waitUs) waitUs = remaining;
+        }
+        TickType_t ticks = pdMS_TO_TICKS(waitUs / 1000);
+        ulTaskNotifyTake(pdTRUE, ticks > 0 ? ticks : 1);
+    }
+}
+
+bool i2cBusBegin() {
+    commandQueue = xQueueCreate(I2C_BUS_COMMAND_DEPTH, sizeof(I2cCommand));
+    if (commandQueue == nullptr) return false;
+
+    // 最初の値はタスクを起こす前にここで読む（起動直後の画面描画に間に合わせる）
+    uint32_t now = micros();
+    runJob(I2C_JOB_POWER, now);
+    runJob(I2C_JOB_TEMP, now);
+    for (int j = 0; j < I2C_JOB_COUNT; j++) nextDueUs[j] = now + jobPeriodMs[j] * 1000;
+    memset(stats, 0, sizeof(stats));
+    statsSinceUs = micros();
+
+    return xTaskCreatePinnedToCore(i2cBusTask, "i2cbus", I2C_BUS_TASK_STACK, nullptr,
+                                   I2C_BUS_TASK_PRIORITY, &busTask, I2C_BUS_TASK_CORE) == pdPASS;
+}
+
+void i2cBusSetTouchHandler(I2cTouchCallback handler) {
+    touchHandler = handler;
+}
+
+bool i2cBusPost(I2cCommandType type, uint8_t arg) {
+    if (commandQueue == nullptr) return false;
+    I2cCommand command = { type, arg, (uint32_t)micros() };
+    if (xQueueSend(commandQueue, &command, 0) != pdTRUE) return false;
+    if (busTask) xTaskNotifyGive(busTask);
+    return true;
+}
+
+void i2cBusRequest(I2cJob job) {
+    if (!jobRequested[job]) {
+        jobRequestUs[job] = micros();
+        jobRequested[job] = true;
+    }
+    if (busTask) xTaskNotifyGive(busTask);
+}
+
+bool i2cBusPower(I2cPowerSnapshot& out, uint32_t maxAgeMs) {
+    portENTER_CRITICAL(&cacheMux);
+    bool valid = powerValid;
+    uint32_t age = millis() - powerMs;
+    out = power;
+    portEXIT_CRITICAL(&cacheMux);
+
+    if (!valid || age > maxAgeMs) i2cBusRequest(I2C_JOB_POWER);
+    return valid;
+}
+
+bool i2cBusTime(RTC_TimeTypeDef& time, RTC_DateTypeDef& date, uint32_t maxAgeMs) {
+    portENTER_CRITICAL(&cacheMux);
+    bool valid = rtcValid;
+    uint32_t age = millis() - rtcMs;
+    time = rtcTime;
+    date = rtcDate;
+    portEXIT_CRITICAL(&cacheMux);
+
+    if (!valid || age > maxAgeMs) i2cBusRequest(I2C_JOB_RTC);
+    return valid;
+}
+
+bool i2cBusCoulomb(I2cCoulombSnapshot& out, uint32_t maxAgeMs) {
+    portENTER_CRITICAL(&cacheMux);
+    bool valid = coulombValid;
+    out = coulomb;
+    portEXIT_CRITICAL(&cacheMux);
+
+    if (!valid || millis() - out.readMs > maxAgeMs) i2cBusRequest(I2C_JOB_COULOMB);
+    return valid;
+}
+
+TouchPoint_t i2cBusTouch() {
+    portENTER_CRITICAL(&cacheMux);
+    TouchPoint_t point = touchPoint;
+    portEXIT_CRITICAL(&cacheMux);
+    return point;
+}
+
+uint8_t i2cBusTakeButtons() {
+    portENTER_CRITICAL(&cacheMux);
+    uint8_t buttons = pendingButtons;
+    pendingButtons = 0;
+    portEXIT_CRITICAL(&cacheMux);
+    return buttons;
+}
+
+void i2cBusLogStats() {
+    I2cJobStats snapshot[I2C_JOB_COUNT + 1];
+    portENTER_CRITICAL(&cacheMux);
+    memcpy(snapshot, stats, sizeof(stats));
+    memset(stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&cacheMux);
+
+    uint32_t now = micros();
+    uint32_t windowUs = now - statsSinceUs;
+    statsSinceUs = now;
+    if (windowUs == 0) return;
+
+    uint32_t busyUs = 0;
+    uint32_t worstUs = 0;
+    int worst = 0;
+    for (int i = 0; i <= I2C_JOB_COUNT; i++) {
+        busyUs += snapshot[i].busyUs;
+        if (snapshot[i].maxUs > worstUs) {
+            worstUs = snapshot[i].maxUs;
+            worst = i;
+        }
+    }
+    Serial.printf("[i2c] busy %.2f%%, worst transaction %u us (%s)\n",
+                  100.0f * busyUs / windowUs, worstUs, jobNames[worst]);
+    for (int i = 0; i <= I2C_JOB_COUNT; i++) {
+        const I2cJobStats& s = snapshot[i];
+        if (s.count == 0) continue;
+        Serial.printf("[i2c]   %-5s %5u runs, avg %4u us, max %5u us, max wait %.1f ms\n",
+                      jobNames[i], s.count, s.busyUs / s.count, s.maxUs, s.maxLateUs / 1000.0f);
+    }
+}
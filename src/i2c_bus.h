@@ -0,0 +1,87 @@
+/**
+ * 内部 I2C バス（Wire1: AXP192・タッチ FT6336・RTC BM8563）の管理タスク
+ *
+ * バスに触るのはこのタスクだけにし、ほかの処理はキャッシュを読むか要求を積むだけにする（待たない）。
+ *   - 読み出しはジョブ単位。周期ジョブ（タッチ・電源・温度）と、要求されたときだけ走るジョブ（RTC）がある
+ *   - 同じ時刻に複数が期限を迎えたら優先度の高い順に 1 つずつ実行し、合間に書き込みコマンドを先に処理する
+ *   - 電源ジョブは残量・電圧・電流を 1 回の実行でまとめて読む
+ *   - クーロンカウンタ（AXP192 の充電・放電の積算）は消費電力の計測（energy_bench.h）が要求したときだけ読む
+ *   - キャッシュは読み出した時刻を持ち、取得側が許容する古さ（maxAgeMs）を超えていれば更新を要求する
+ *   - ジョブごとの回数・最大所要時間・期限からの最大遅れと、バスの使用率を i2cBusLogStats() で出力する
+ *
+ * i2cBusBegin() より前（setup() の途中）は M5.Axp などを直接呼んでよい。
+ * 以降は M5.update() も呼ばない（タッチを読むので）。画面下のタッチボタン A/B/C は i2cBusTakeButtons() で受け取る。
+ */
+#pragma once
+
+#include <M5Core2.h>
+
+#define I2C_BUS_TASK_STACK     4096
+#define I2C_BUS_TASK_PRIORITY  3      // キャプチャ（5）より低く、loop()（1）より高い
+#define I2C_BUS_TASK_CORE      1
+#define I2C_BUS_COMMAND_DEPTH  8
+
+#define I2C_BUS_TOUCH_MS       20     // タッチの読み出し周期
+#define I2C_BUS_POWER_MS       1000   // 電池残量・電圧・電流
+#define I2C_BUS_TEMP_MS        5000   // AXP192 の内部温度
+
+enum I2cJob : uint8_t {
+    I2C_JOB_TOUCH,       // 優先度の高い順
+    I2C_JOB_POWER,
+    I2C_JOB_TEMP,
+    I2C_JOB_RTC,         // 要求されたときだけ
+    I2C_JOB_COULOMB,     // 要求されたときだけ
+    I2C_JOB_COUNT,
+};
+
+enum I2cCommandType : uint8_t {
+    I2C_CMD_BACKLIGHT,   // arg: 0 / 1（DCDC3）
+    I2C_CMD_LDO,         // arg: (LDO 番号 << 1) | 0 / 1
+    I2C_CMD_COULOMB,     // arg: 1 = 0 から積算を開始 / 0 = 停止
+};
+
+// 画面下のタッチボタン（M5Core2 の BtnA / BtnB / BtnC と同じ範囲）
+enum I2cButton : uint8_t {
+    I2C_BUTTON_A = 0x01,
+    I2C_BUTTON_B = 0x02,
+    I2C_BUTTON_C = 0x04,
+};
+
+struct I2cPowerSnapshot {
+    float batteryLevel;      // %
+    float batteryVoltage;    // V
+    float batteryCurrentMa;  // 充電で正
+    float temperatureC;      // AXP192 内部温度
+};
+
+struct I2cCoulombSnapshot {
+    float mah;               // 充電 − 放電の積算（放電で負）
+    uint32_t readMs;         // 読み出した時刻（millis）
+};
+
+// タッチの押し始め（I2C バスタスクから呼ばれるので、待たずに戻ること）
+typedef void (*I2cTouchCallback)(int16_t x, int16_t y);
+
+bool i2cBusBegin();
+void i2cBusSetTouchHandler(I2cTouchCallback handler);
+
+// 書き込みの要求（キューが満杯なら false）
+bool i2cBusPost(I2cCommandType type, uint8_t arg);
+
+// 更新の要求（次の空きで実行される）
+void i2cBusRequest(I2cJob job);
+
+// キャッシュの読み出し。maxAgeMs より古ければ更新を要求する（返す値は古いまま）。
+// 一度も読めていなければ false
+bool i2cBusPower(I2cPowerSnapshot& out, uint32_t maxAgeMs);
+bool i2cBusTime(RTC_TimeTypeDef& time, RTC_DateTypeDef& date, uint32_t maxAgeMs);
+bool i2cBusCoulomb(I2cCoulombSnapshot& out, uint32_t maxAgeMs);
+
+// 最新のタッチ位置（触れていなければ -1, -1）
+TouchPoint_t i2cBusTouch();
+
+// 前回の呼び出しから押されたボタン（I2cButton のビット和）
+uint8_t i2cBusTakeButtons();
+
+// 前回呼び出しからの使用率・ジョブごとの回数と最大所要時間をシリアルに出力
+void i2cBusLogStats();
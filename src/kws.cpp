@@ -0,0 +1,409 @@
+/**
+ * ウェイクワード検出の実装
+ */
+#include "kws.h"
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <math.h>
+
+#include "capture.h"
+#include "mel_frontend.h"
+
+#define KWS_MODEL_PATH  "/kws.bin"
+#define KWS_MAX_LAYERS  16
+#define KWS_MAX_CLASSES 16
+#define KWS_MAX_FRAMES  100     // 入力の時間方向（2 秒）
+#define KWS_MAX_COEFFS  40      // MFCC は 40 帯域の log-mel から
+
+// 無音ゲート：直近 1 秒の c0（対数エネルギー）の最大値がノイズフロア＋この値を超えたら推論する
+#define KWS_GATE_MARGIN 1.5f
+
+struct KwsLayer {
+    KwsLayerHeader h;
+    const int8_t* weights;
+    const int32_t* bias;
+    int inH, inW, outH, outW;
+    int padTop, padLeft;
+    float requant;            // 入力スケール×重みスケール÷出力スケール
+};
+
+static bool enabled = false;
+static uint8_t* modelData = nullptr;
+static KwsModelHeader model;
+static KwsLayer layers[KWS_MAX_LAYERS];
+
+static MelFrontend frontend;
+static float* mfccHistory = nullptr;     // [numFrames][numCoeffs] のリング
+static int historyPos = 0;               // 次に書く行
+static int historyFilled = 0;
+static float* energyHistory = nullptr;   // 各フレームの c0
+static float noiseFloor = 0.0f;
+
+static int8_t* arenaA = nullptr;
+static int8_t* arenaB = nullptr;
+
+static int framesSinceInference = 0;
+static float posteriors[KWS_SMOOTHING][KWS_MAX_CLASSES];
+static int posteriorPos = 0;
+static int posteriorCount = 0;
+static unsigned long lastDetection = 0;
+
+static volatile bool triggerPending = false;
+static volatile uint32_t triggerIndex = 0;
+
+static KwsStats stats = {};
+
+// ============================================================
+// 推論
+// ============================================================
+
+static inline int8_t requantize(int32_t acc, float scale, bool relu) {
+    int32_t v = (int32_t)lroundf(acc * scale);
+    if (v > 127) v = 127;
+    if (v < (relu ? 0 : -128)) v = relu ? 0 : -128;
+    return (int8_t)v;
+}
+
+// 通常の畳み込み（same パディング）
+static void runConv(const KwsLayer& L, const int8_t* in, int8_t* out) {
+    const int inC = L.h.inChannels, outC = L.h.outChannels;
+    for (int oy = 0; oy < L.outH; oy++) {
+        for (int ox = 0; ox < L.outW; ox++) {
+            for (int oc = 0; oc < outC; oc++) {
+                int32_t acc = L.bias[oc];
+                const int8_t* w = L.weights + oc * L.h.kernelH * L.h.kernelW * inC;
+                for (int ky = 0; ky < L.h.kernelH; ky++) {
+                    int iy = oy * L.h.strideH + ky - L.padTop;
+                    if (iy < 0 || iy >= L.inH) continue;
+                    for (int kx = 0; kx < L.h.kernelW; kx++) {
+                        int ix = ox * L.h.strideW + kx - L.padLeft;
+                        if (ix < 0 || ix >= L.inW) continue;
+                        const int8_t* src = in + (iy * L.inW + ix) * inC;
+                        const int8_t* wk = w + (ky * L.h.kernelW + kx) * inC;
+                        for (int ic = 0; ic < inC; ic++) {
+                            acc += src[ic] * wk[ic];
+                        }
+                    }
+                }
+                out[(oy * L.outW + ox) * outC + oc] = requantize(acc, L.requant, L.h.relu);
+            }
+        }
+    }
+}
+
+// depthwise 畳み込み（same パディング）
+static void runDepthwise(const KwsLayer& L, const int8_t* in, int8_t* out) {
+    const int C = L.h.inChannels;
+    for (int oy = 0; oy < L.outH; oy++) {
+        for (int ox = 0; ox < L.outW; ox++) {
+            for (int c = 0; c < C; c++) {
+                int32_t acc = L.bias[c];
+                for (int ky = 0; ky < L.h.kernelH; ky++) {
+                    int iy = oy * L.h.strideH + ky - L.padTop;
+                    if (iy < 0 || iy >= L.inH) continue;
+                    for (int kx = 0; kx < L.h.kernelW; kx++) {
+                        int ix = ox * L.h.strideW + kx - L.padLeft;
+                        if (ix < 0 || ix >= L.inW) continue;
+                        acc += in[(iy * L.inW + ix) * C + c] * L.weights[(ky * L.h.kernelW + kx) * C + c];
+                    }
+                }
+                out[(oy * L.outW + ox) * C + c] = requantize(acc, L.requant, L.h.relu);
+            }
+        }
+    }
+}
+
+// 全体平均プーリング（スケールはそのまま）
+static void runAvgPool(const KwsLayer& L, const int8_t* in, int8_t* out) {
+    const int C = L.h.inChannels, n = L.inH * L.inW;
+    for (int c = 0; c < C; c++) {
+        int32_t sum = 0;
+        for (int i = 0; i < n; i++) sum += in[i * C + c];
+        out[c] = (int8_t)((sum + (sum >= 0 ? n / 2 : -n / 2)) / n);
+    }
+}
+
+static void runFc(const KwsLayer& L, const int8_t* in, int8_t* out) {
+    const int inC = L.h.inChannels;
+    for (int o = 0; o < L.h.outChannels; o++) {
+        int32_t acc = L.bias[o];
+        const int8_t* w = L.weights + o * inC;
+        for (int i = 0; i < inC; i++) acc += in[i] * w[i];
+        out[o] = requantize(acc, L.requant, L.h.relu);
+    }
+}
+
+// 最終層の出力から事後確率（softmax）を計算
+static void runInference(float* probs) {
+    // MFCC 履歴を時間順に int8 化して入力にする
+    int8_t* in = arenaA;
+    for (int f = 0; f < model.numFrames; f++) {
+        const float* row = mfccHistory + ((historyPos + f) % model.numFrames) * model.numCoeffs;
+        for (int c = 0; c < model.numCoeffs; c++) {
+            int32_t v = (int32_t)lroundf(row[c] / model.inputScale);
+            in[f * model.numCoeffs + c] = (int8_t)(v > 127 ? 127 : (v < -128 ? -128 : v));
+        }
+    }
+
+    int8_t* out = arenaB;
+    for (int i = 0; i < model.numLayers; i++) {
+        const KwsLayer& L = layers[i];
+        switch (L.h.type) {
+            case KWS_LAYER_CONV:    runConv(L, in, out); break;
+            case KWS_LAYER_DWCONV:  runDepthwise(L, in, out); break;
+            case KWS_LAYER_AVGPOOL: runAvgPool(L, in, out); break;
+            case KWS_LAYER_FC:      runFc(L, in, out); break;
+        }
+        int8_t* t = in;
+        in = out;
+        out = t;
+    }
+
+    // in が最終層の出力
+    float scale = layers[model.numLayers - 1].h.outputScale;
+    float maxLogit = -1e9f;
+    for (int c = 0; c < model.numClasses; c++) maxLogit = max(maxLogit, in[c] * scale);
+    float sum = 0.0f;
+    for (int c = 0; c < model.numClasses; c++) {
+        probs[c] = expf(in[c] * scale - maxLogit);
+        sum += probs[c];
+    }
+    for (int c = 0; c < model.numClasses; c++) probs[c] /= sum;
+}
+
+// ============================================================
+// モデル読み込み
+// ============================================================
+
+// 層の形状を順に計算し、重みの位置を割り当てる
+static bool parseModel(size_t size) {
+    if (size < sizeof(KwsModelHeader)) return false;
+    memcpy(&model, modelData, sizeof(model));
+    if (memcmp(model.magic, KWS_MAGIC, 4) != 0 || model.numLayers == 0 ||
+        model.numLayers > KWS_MAX_LAYERS || model.numClasses > KWS_MAX_CLASSES ||
+        model.targetClass >= model.numClasses || model.numFrames == 0 || model.numFrames > KWS_MAX_FRAMES ||
+        model.numCoeffs == 0 || model.numCoeffs > KWS_MAX_COEFFS) {
+        return false;
+    }
+
+    size_t offset = sizeof(KwsModelHeader);
+    int h = model.numFrames, w = model.numCoeffs, c = 1;
+    float inScale = model.inputScale;
+    size_t arena = (size_t)h * w * c;
+    stats.modelBytes = 0;
+
+    for (int i = 0; i < model.numLayers; i++) {
+        KwsLayer& L = layers[i];
+        if (offset + sizeof(KwsLayerHeader) > size) return false;
+        memcpy(&L.h, modelData + offset, sizeof(KwsLayerHeader));
+        offset += sizeof(KwsLayerHeader);
+        if (L.h.type != KWS_LAYER_FC && L.h.inChannels != c) return false;
+
+        L.inH = h;
+        L.inW = w;
+        size_t weightCount = 0;
+        switch (L.h.type) {
+            case KWS_LAYER_CONV:
+            case KWS_LAYER_DWCONV:
+                if (L.h.strideH == 0 || L.h.strideW == 0) return false;
+                if (L.h.type == KWS_LAYER_DWCONV && L.h.outChannels != c) return false;
+                L.outH = (h + L.h.strideH - 1) / L.h.strideH;
+                L.outW = (w + L.h.strideW - 1) / L.h.strideW;
+                L.padTop = max(0, ((L.outH - 1) * L.h.strideH + L.h.kernelH - h) / 2);
+                L.padLeft = max(0, ((L.outW - 1) * L.h.strideW + L.h.kernelW - w) / 2);
+                weightCount = (size_t)L.h.kernelH * L.h.kernelW *
+                              (L.h.type == KWS_LAYER_CONV ? (size_t)c * L.h.outChannels : (size_t)c);
+                break;
+            case KWS_LAYER_AVGPOOL:
+                L.outH = L.outW = 1;
+                L.h.outChannels = c;
+                L.h.outputScale = inScale;
+                break;
+            case KWS_LAYER_FC:
+                // FC は HWC を平坦化した長さで受ける
+                if ((int)L.h.inChannels != h * w * c) return false;
+                L.outH = L.outW = 1;
+                weightCount = (size_t)L.h.inChannels * L.h.outChannels;
+                break;
+            default:
+                return false;
+        }
+
+        if (L.h.type != KWS_LAYER_AVGPOOL) {
+            size_t biasBytes = L.h.outChannels * sizeof(int32_t);
+            if (offset + weightCount + biasBytes > size) return false;
+            L.weights = (const int8_t*)(modelData + offset);
+            offset += weightCount;
+            // int32 を読むので 4 バイト境界に揃える（エクスポート側でパディング済み）
+            offset = (offset + 3) & ~(size_t)3;
+            L.bias = (const int32_t*)(modelData + offset);
+            offset += biasBytes;
+            L.requant = inScale * L.h.weightScale / L.h.outputScale;
+            stats.modelBytes += weightCount + biasBytes;
+        }
+
+        h = L.outH;
+        w = L.outW;
+        c = L.h.outChannels;
+        inScale = L.h.outputScale;
+        arena = max(arena, (size_t)h * w * c);
+    }
+
+    if (c != model.numClasses) return false;
+
+    arenaA = (int8_t*)malloc(arena);
+    arenaB = (int8_t*)malloc(arena);
+    stats.arenaBytes = arena * 2;
+    return arenaA && arenaB;
+}
+
+bool kwsBegin() {
+    if (!SPIFFS.begin(false)) {
+        Serial.println("KWS: SPIFFS not available, wake word disabled");
+        return false;
+    }
+    File f = SPIFFS.open(KWS_MODEL_PATH, "r");
+    if (!f) {
+        Serial.println("KWS: " KWS_MODEL_PATH " not found, wake word disabled");
+        return false;
+    }
+
+    size_t size = f.size();
+    modelData = (uint8_t*)malloc(size);
+    if (!modelData || f.read(modelData, size) != size || !parseModel(size)) {
+        Serial.println("KWS: invalid model file, wake word disabled");
+        f.close();
+        free(modelData);
+        modelData = nullptr;
+        return false;
+    }
+    f.close();
+
+    // 40ms 窓 / 20ms ホップ / FFT 1024 / 40 帯域（20Hz-4kHz）
+    MelFrontendConfig cfg = { SAMPLE_RATE, 640, 320, 1024, 40, 20.0f, 4000.0f };
+    if (!melFrontendInit(frontend, cfg)) return false;
+
+    mfccHistory = (float*)calloc(model.numFrames * model.numCoeffs, sizeof(float));
+    energyHistory = (float*)calloc(model.numFrames, sizeof(float));
+    if (!mfccHistory || !energyHistory) return false;
+
+    stats.arenaBytes += melFrontendMemory(frontend) +
+                        model.numFrames * (model.numCoeffs + 1) * sizeof(float);
+
+    enabled = true;
+    Serial.printf("KWS: model loaded (%d layers, %d classes), weights %u B, arena %u B\n",
+                  model.numLayers, model.numClasses, stats.modelBytes, stats.arenaBytes);
+    return true;
+}
+
+bool kwsEnabled() {
+    return enabled;
+}
+
+// ============================================================
+// キャプチャ経路
+// ============================================================
+
+static void onMelFrame(const float* logMel, uint32_t frameIndex, void* context) {
+    float* row = mfccHistory + historyPos * model.numCoeffs;
+    melToMfcc(logMel, frontend.cfg.numMels, row, model.numCoeffs);
+
+    // ノイズフロアはゆっくり追従（下がるときは速く）
+    float energy = row[0];
+    energyHistory[historyPos] = energy;
+    if (stats.frames == 0 || energy < noiseFloor) {
+        noiseFloor = energy;
+    } else {
+        noiseFloor += (energy - noiseFloor) * 0.002f;
+    }
+
+    historyPos = (historyPos + 1) % model.numFrames;
+    if (historyFilled < model.numFrames) historyFilled++;
+    stats.frames++;
+
+    if (historyFilled < model.numFrames || ++framesSinceInference < KWS_STRIDE_FRAMES) return;
+    framesSinceInference = 0;
+
+    // 直近 1 秒がすべて無音なら推論しない
+    float peak = energyHistory[0];
+    for (int i = 1; i < model.numFrames; i++) peak = max(peak, energyHistory[i]);
+    if (peak < noiseFloor + KWS_GATE_MARGIN) {
+        stats.gatedSkips++;
+        posteriorCount = 0;
+        return;
+    }
+
+    unsigned long start = micros();
+    runInference(posteriors[posteriorPos]);
+    posteriorPos = (posteriorPos + 1) % KWS_SMOOTHING;
+    uint32_t elapsed = micros() - start;
+    stats.inferences++;
+    stats.inferenceUs += elapsed;
+    stats.inferenceMaxUs = max(stats.inferenceMaxUs, elapsed);
+    if (posteriorCount < KWS_SMOOTHING) posteriorCount++;
+
+    float score = 0.0f;
+    for (int i = 1; i <= posteriorCount; i++) {
+        score += posteriors[(posteriorPos + KWS_SMOOTHING - i) % KWS_SMOOTHING][model.targetClass];
+    }
+    score /= posteriorCount;
+
+    if (score >= model.threshold && millis() - lastDetection > KWS_REFRACTORY_MS) {
+        lastDetection = millis();
+        stats.detections++;
+        posteriorCount = 0;
+        triggerIndex = frameIndex + frontend.cfg.frameLength;
+        triggerPending = true;
+        Serial.printf("KWS: wake word detected (score %.2f)\n", score);
+    }
+}
+
+void kwsProcess(const int16_t* samples, size_t count, uint32_t firstIndex) {
+    if (!enabled) return;
+
+    unsigned long start = micros();
+    uint64_t inferenceBefore = stats.inferenceUs;
+    melFrontendPush(frontend, samples, count, firstIndex, onMelFrame, nullptr);
+    stats.frontendUs += (micros() - start) - (stats.inferenceUs - inferenceBefore);
+}
+
+bool kwsTakeTrigger(uint32_t& sampleIndex) {
+    if (!triggerPending) return false;
+    sampleIndex = triggerIndex;
+    triggerPending = false;
+    return true;
+}
+
+void kwsGetStats(KwsStats& out) {
+    out = stats;
+}
+
+void kwsLogStats(float batteryCurrentMa) {
+    static unsigned long lastLog = 0;
+    static KwsStats last = {};
+
+    if (!enabled) return;
+
+    unsigned long now = millis();
+    if (lastLog != 0) {
+        float seconds = (now - lastLog) / 1000.0f;
+        uint32_t inferences = stats.inferences - last.inferences;
+        uint64_t busyUs = (stats.frontendUs - last.frontendUs) + (stats.inferenceUs - last.inferenceUs);
+        Serial.printf("[kws] %u inferences (%u gated), avg %.1f ms max %.1f ms, "
+                      "frontend %.2f ms/frame, duty %.1f%%, battery %.1f mA\n",
+                      inferences,
+                      stats.gatedSkips - last.gatedSkips,
+                      inferences ? (stats.inferenceUs - last.inferenceUs) / 1000.0f / inferences : 0.0f,
+                      stats.inferenceMaxUs / 1000.0f,
+                      stats.frames > last.frames
+                          ? (stats.frontendUs - last.frontendUs) / 1000.0f / (stats.frames - last.frames)
+                          : 0.0f,
+                      busyUs / 10.0f / (seconds * 1000.0f),
+                      batteryCurrentMa);
+        stats.inferenceMaxUs = 0;
+    }
+
+    last = stats;
+    lastLog = now;
+}
@@ -0,0 +1,90 @@
+/**
+ * ウェイクワード検出（DS-CNN、int8 量子化）
+ *
+ * 待機中のキャプチャ経路で MFCC（40ms 窓 / 20ms ホップ / 40 帯域 / 10 係数）を常時計算し、
+ * 直近 1 秒に音声エネルギーがあるときだけ KWS_STRIDE_FRAMES ごとに推論する。
+ * モデルは SPIFFS の /kws.bin（tools/kws_export.py で生成）から読み込み、無ければ無効。
+ *
+ * モデルファイル形式（リトルエンディアン）:
+ *   KwsModelHeader
+ *   { KwsLayerHeader, int8 weights[], int32 bias[outChannels] } × numLayers
+ *
+ *   重みの並び  CONV   : [out][kh][kw][in]
+ *               DWCONV : [kh][kw][ch]
+ *               FC     : [out][in]
+ *               AVGPOOL: 重み・バイアスなし（全体平均）
+ *   活性化は HWC の int8（対称量子化、ゼロ点 0）。バイアスのスケールは入力スケール×重みスケール。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KWS_MAGIC           "KWS1"
+#define KWS_STRIDE_FRAMES   10      // 推論間隔（20ms × 10 = 200ms）
+#define KWS_SMOOTHING       3       // 事後確率を平均する推論回数
+#define KWS_REFRACTORY_MS   2000    // 検出後に再検出しない時間
+#define KWS_PREROLL_MS      1500    // 検出位置より前に遡って送る時間
+#define KWS_PREROLL_MAX_MS  5000    // 検出から接続までこれより遅れたらプリロールは送らずライブから
+
+enum KwsLayerType : uint8_t {
+    KWS_LAYER_CONV    = 1,
+    KWS_LAYER_DWCONV  = 2,
+    KWS_LAYER_AVGPOOL = 3,
+    KWS_LAYER_FC      = 4,
+};
+
+#pragma pack(push, 1)
+struct KwsModelHeader {
+    char magic[4];
+    uint16_t numFrames;       // 入力の時間方向フレーム数（49 = 1 秒）
+    uint16_t numCoeffs;       // MFCC 係数の数（10）
+    uint16_t numClasses;
+    uint16_t targetClass;     // ウェイクワードのクラス番号
+    uint16_t numLayers;
+    uint16_t reserved;
+    float inputScale;         // MFCC → int8 の量子化スケール
+    float threshold;          // 平滑化後の事後確率しきい値
+};
+
+struct KwsLayerHeader {
+    uint8_t type;
+    uint8_t kernelH;
+    uint8_t kernelW;
+    uint8_t strideH;
+    uint8_t strideW;
+    uint8_t relu;
+    uint16_t inChannels;
+    uint16_t outChannels;
+    uint16_t reserved;
+    float weightScale;
+    float outputScale;
+};
+#pragma pack(pop)
+
+struct KwsStats {
+    uint32_t frames;          // 計算した MFCC フレーム数
+    uint32_t inferences;      // 実行した推論回数
+    uint32_t gatedSkips;      // 無音で省略した推論回数
+    uint32_t detections;
+    uint64_t frontendUs;      // 特徴量計算の累計時間
+    uint64_t inferenceUs;     // 推論の累計時間
+    uint32_t inferenceMaxUs;
+    size_t modelBytes;        // 重み＋バイアス
+    size_t arenaBytes;        // 活性化バッファ＋特徴量
+};
+
+// SPIFFS からモデルを読み込んで有効化（モデルが無ければ false）
+bool kwsBegin();
+bool kwsEnabled();
+
+// キャプチャタスクから呼ぶ（待機中のみ）
+void kwsProcess(const int16_t* samples, size_t count, uint32_t firstIndex);
+
+// 検出があれば検出位置のサンプル番号を返して消費する（loop() から呼ぶ）
+bool kwsTakeTrigger(uint32_t& sampleIndex);
+
+void kwsGetStats(KwsStats& out);
+
+// 前回呼び出しからの推論コストと待機電流をシリアルに出力
+void kwsLogStats(float batteryCurrentMa);
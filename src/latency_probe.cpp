@@ -0,0 +1,211 @@
+/**
+ * チャープの音響ループバックによる遅延の計測の実装
+ */
+#include "latency_probe.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "capture.h"
+#include "transport.h"
+
+#if LATENCY_PROBE
+
+// ARMED → PLAYING はキャプチャタスク、それ以外の遷移は loop() が行う
+enum ProbeState : uint8_t {
+    PROBE_IDLE,
+    PROBE_ARMED,        // 次のブロックから鳴らす
+    PROBE_PLAYING,
+    PROBE_PLAYED,       // 鳴らし終えた（履歴がたまったら探す）
+    PROBE_DETECTED,     // 見つけた位置を含むフレームの送信待ち
+    PROBE_SENT,         // 受信側の応答待ち
+};
+
+static bool enabled = false;
+static volatile ProbeState state = PROBE_IDLE;
+static int16_t chirp[LATENCY_CHIRP_SAMPLES];
+static float chirpEnergy = 0.0f;
+static int16_t* listen = nullptr;       // 鳴らした位置からの履歴（LATENCY_LISTEN_SAMPLES）
+
+static uint8_t probeNumber = 0;
+static unsigned long nextProbeMs = 0;
+static volatile uint32_t playIndex = 0; // 鳴らし始めたときのキャプチャの位置
+static volatile size_t chirpPos = 0;
+
+static uint32_t detectIndex = 0;
+static float detectScore = 0.0f;
+static uint32_t captureToSendMs = 0;
+static unsigned long sentMs = 0;
+static int32_t rttMs = -1;              // ARRIVED が届くまで -1
+
+bool latencyProbeBegin() {
+    listen = (int16_t*)malloc(LATENCY_LISTEN_SAMPLES * sizeof(int16_t));
+    if (!listen) return false;
+
+    // 線形チャープ（両端はハン窓で絞ってクリックを防ぐ）
+    double sweep = (double)(LATENCY_CHIRP_HIGH_HZ - LATENCY_CHIRP_LOW_HZ) / LATENCY_CHIRP_SAMPLES * SAMPLE_RATE;
+    for (int i = 0; i < LATENCY_CHIRP_SAMPLES; i++) {
+        double t = (double)i / SAMPLE_RATE;
+        double phase = 2 * M_PI * (LATENCY_CHIRP_LOW_HZ * t + 0.5 * sweep * t * t);
+        double window = 0.5 - 0.5 * cos(2 * M_PI * (i + 0.5) / LATENCY_CHIRP_SAMPLES);
+        chirp[i] = (int16_t)lrint(32767.0 * LATENCY_CHIRP_LEVEL * window * sin(phase));
+        chirpEnergy += (float)chirp[i] * chirp[i];
+    }
+
+    enabled = true;
+    Serial.printf("Latency probe: %d-%d Hz chirp every %d s through the sidetone output\n",
+                  LATENCY_CHIRP_LOW_HZ, LATENCY_CHIRP_HIGH_HZ, LATENCY_PROBE_INTERVAL_MS / 1000);
+    return true;
+}
+
+void latencyProbeReset() {
+    if (!enabled) return;
+    nextProbeMs = millis() + LATENCY_PROBE_INTERVAL_MS;
+    // 鳴らしている途中ならそのまま終わらせる（キャプチャタスクが PLAYED にする）
+    if (state != PROBE_ARMED && state != PROBE_PLAYING) state = PROBE_IDLE;
+}
+
+void latencyProbeMix(int16_t* stereo, size_t count) {
+    if (state == PROBE_ARMED) {
+        // このブロックの先頭が今のキャプチャの位置と同時に出ていく
+        playIndex = captureWriteIndex();
+        chirpPos = 0;
+        state = PROBE_PLAYING;
+    }
+    if (state != PROBE_PLAYING) return;
+
+    size_t pos = chirpPos;
+    for (size_t i = 0; i < count && pos < LATENCY_CHIRP_SAMPLES; i++, pos++) {
+        int32_t v = stereo[2 * i] + chirp[pos];
+        int16_t s = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+        stereo[2 * i] = s;
+        stereo[2 * i + 1] = s;
+    }
+    chirpPos = pos;
+    if (pos >= LATENCY_CHIRP_SAMPLES) state = PROBE_PLAYED;
+}
+
+/**
+ * listen の中でチャープの先頭の位置（見つからなければ -1）
+ *
+ * 正規化相互相関が最大値の半分を最初に超えたところから LATENCY_PEAK_SEARCH の中の最大を取る
+ * （モニター経由のこだまなど、後から来る経路を避ける。相関は搬送波の周期で波打つので隣との比較では止めない）。
+ */
+static int findChirp(float& score) {
+    const int lags = LATENCY_LISTEN_SAMPLES - LATENCY_CHIRP_SAMPLES + 1;
+    static float rho[LATENCY_LISTEN_SAMPLES - LATENCY_CHIRP_SAMPLES + 1];
+
+    // 窓内のエネルギーは 1 サンプルずつずらしながら更新する（整数で足し引きして誤差をためない）
+    int64_t energy = 0;
+    for (int k = 0; k < LATENCY_CHIRP_SAMPLES; k++) energy += (int32_t)listen[k] * listen[k];
+
+    float best = 0.0f;
+    for (int lag = 0; lag < lags; lag++) {
+        if (lag > 0) {
+            int32_t out = listen[lag - 1], in = listen[lag + LATENCY_CHIRP_SAMPLES - 1];
+            energy += (int64_t)in * in - (int64_t)out * out;
+        }
+        float corr = 0.0f;
+        for (int k = 0; k < LATENCY_CHIRP_SAMPLES; k++) corr += (float)chirp[k] * listen[lag + k];
+        rho[lag] = energy > 0 ? corr / sqrtf((float)energy * chirpEnergy) : 0.0f;
+        if (rho[lag] > best) best = rho[lag];
+    }
+
+    score = best;
+    if (best < LATENCY_DETECT_MIN) return -1;
+    int first = 0;
+    while (rho[first] < best * 0.5f) first++;
+    int lag = first;
+    for (int i = first; i < lags && i < first + LATENCY_PEAK_SEARCH; i++) {
+        if (rho[i] > rho[lag]) lag = i;
+    }
+    score = rho[lag];
+    return lag;
+}
+
+static void logResult(int32_t shownMs) {
+    float speakerMs = (detectIndex - playIndex) * 1000.0f / SAMPLE_RATE;
+    if (rttMs < 0) {
+        Serial.printf("[latency] #%u speaker->capture %.1f ms, capture->send %u ms, no ack from the receiver\n",
+                      probeNumber, speakerMs, captureToSendMs);
+        return;
+    }
+    float linkMs = rttMs / 2.0f;
+    float total = speakerMs + captureToSendMs + linkMs;
+    if (shownMs >= 0) {
+        Serial.printf("[latency] #%u speaker->capture %.1f ms, capture->send %u ms, link ~%.0f ms (rtt %d), "
+                      "receiver->screen %d ms, total ~%.0f ms (score %.2f)\n",
+                      probeNumber, speakerMs, captureToSendMs, linkMs, rttMs, shownMs, total + shownMs, detectScore);
+    } else {
+        Serial.printf("[latency] #%u speaker->capture %.1f ms, capture->send %u ms, link ~%.0f ms (rtt %d), "
+                      "no transcript shown, total to receiver ~%.0f ms (score %.2f)\n",
+                      probeNumber, speakerMs, captureToSendMs, linkMs, rttMs, total, detectScore);
+    }
+}
+
+void latencyProbePoll(uint32_t streamCursor) {
+    if (!enabled) return;
+    unsigned long now = millis();
+
+    if (state == PROBE_IDLE && (long)(now - nextProbeMs) >= 0) {
+        probeNumber++;
+        rttMs = -1;
+        state = PROBE_ARMED;
+    } else if (state == PROBE_PLAYED) {
+        if (captureWriteIndex() - playIndex < LATENCY_LISTEN_SAMPLES) return;
+
+        uint32_t cursor = playIndex, dropped = 0;
+        detectScore = 0.0f;
+        size_t count = captureRead(cursor, listen, LATENCY_LISTEN_SAMPLES, &dropped);
+        int lag = -1;
+        if (dropped == 0 && count == LATENCY_LISTEN_SAMPLES) lag = findChirp(detectScore);
+        if (lag < 0) {
+            Serial.printf("[latency] #%u chirp not found (score %.2f), check the amp volume and placement\n",
+                          probeNumber, detectScore);
+            nextProbeMs = now + LATENCY_PROBE_INTERVAL_MS;
+            state = PROBE_IDLE;
+            return;
+        }
+        detectIndex = playIndex + lag;
+        state = PROBE_DETECTED;
+    } else if (state == PROBE_DETECTED && (int32_t)(streamCursor - detectIndex) > 0) {
+        // 先頭を含むフレームを送り終えた（履歴に入ってからの時間はキャプチャの位置の差で測る）
+        captureToSendMs = (captureWriteIndex() - detectIndex) * 1000 / SAMPLE_RATE;
+        uint16_t speaker = (uint16_t)min(detectIndex - playIndex, (uint32_t)UINT16_MAX);
+        uint16_t send = (uint16_t)min(captureToSendMs, (uint32_t)UINT16_MAX);
+        uint16_t score = (uint16_t)(detectScore * 1000.0f);
+        uint8_t payload[8] = { LINK_MARKER_CHIRP, probeNumber,
+                               (uint8_t)(speaker & 0xFF), (uint8_t)(speaker >> 8),
+                               (uint8_t)(send & 0xFF), (uint8_t)(send >> 8),
+                               (uint8_t)(score & 0xFF), (uint8_t)(score >> 8) };
+        transportSendFrame(LINK_FRAME_MARKER, 0, payload, sizeof(payload), detectIndex);
+        sentMs = millis();
+        state = PROBE_SENT;
+    } else if (state == PROBE_SENT && now - sentMs > LATENCY_ACK_TIMEOUT_MS) {
+        logResult(-1);
+        nextProbeMs = now + LATENCY_PROBE_INTERVAL_MS;
+        state = PROBE_IDLE;
+    }
+}
+
+void latencyProbeHandleAck(const uint8_t* payload, size_t length) {
+    if (!enabled || state != PROBE_SENT || length < 3 || payload[1] != probeNumber) return;
+
+    if (payload[2] == LINK_CHIRP_ARRIVED) {
+        rttMs = millis() - sentMs;
+    } else if (payload[2] == LINK_CHIRP_SHOWN && length >= 5) {
+        logResult(payload[3] | (payload[4] << 8));
+        nextProbeMs = millis() + LATENCY_PROBE_INTERVAL_MS;
+        state = PROBE_IDLE;
+    }
+}
+
+#else
+
+bool latencyProbeBegin() { return false; }
+void latencyProbeReset() {}
+void latencyProbeMix(int16_t* stereo, size_t count) {}
+void latencyProbePoll(uint32_t streamCursor) {}
+void latencyProbeHandleAck(const uint8_t* payload, size_t length) {}
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * チャープの音響ループバックによる遅延の計測（-DLATENCY_PROBE=1）
+ *
+ * 接続中 LATENCY_PROBE_INTERVAL_MS ごとに既知のチャープをモニター出力から鳴らし、自分のキャプチャの
+ * 履歴から整合フィルタで見つける。内蔵スピーカーはマイクとクロックを共用していてキャプチャ中は
+ * 鳴らせないので、サイドトーン（sidetone.h）の外付け I2S アンプを使う（LATENCY_PROBE=1 で SIDETONE も有効になる）。
+ *
+ * 見つけた位置を含む音声フレームを送り終えたら LINK_MARKER_CHIRP（timestamp = チャープの先頭）を送る。
+ * 受信側はマーカーが届いたら LINK_CTRL_CHIRP_ACK（ARRIVED）を、その後の最初の文字起こしを表示したら
+ * 表示までの時間を付けて SHOWN を返す。端末は自分の時計だけで内訳を [latency] 行に出力する。
+ *   speaker->capture : 鳴らしてから履歴に入るまで（I2S 送信 DMA＋空気＋マイクの受信 DMA、口からの経路の上限）
+ *   capture->send    : 履歴に入ってから、それを含むフレームを送り終えるまで（フレームがたまる時間＋送信待ち）
+ *   link             : マーカーを送ってから ARRIVED が届くまでの往復の半分
+ *   receiver->screen : 受信側が測った、到着から文字起こしの表示まで
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef LATENCY_PROBE
+#define LATENCY_PROBE 0
+#endif
+
+#ifndef LATENCY_PROBE_INTERVAL_MS
+#define LATENCY_PROBE_INTERVAL_MS  15000
+#endif
+#define LATENCY_CHIRP_SAMPLES      256     // 16ms @16kHz
+#define LATENCY_CHIRP_LOW_HZ       1000
+#define LATENCY_CHIRP_HIGH_HZ      4000
+#define LATENCY_CHIRP_LEVEL        0.5f    // フルスケール比
+#define LATENCY_LISTEN_SAMPLES     4800    // 鳴らした位置から探す長さ（300ms）
+#define LATENCY_DETECT_MIN         0.3f    // 見つけたとみなす正規化相互相関
+#define LATENCY_PEAK_SEARCH        64      // 最初の経路の山を探す幅（4ms）
+#define LATENCY_ACK_TIMEOUT_MS     10000   // 受信側の応答（表示）を待つ時間
+
+// LATENCY_PROBE=0 のビルドやメモリが足りなければ false を返し、以降の呼び出しは何もしない
+bool latencyProbeBegin();
+
+// 接続ごとに計測をやり直す（loop() から）
+void latencyProbeReset();
+
+// サイドトーンの出力（左右交互の 16bit）にチャープを足す（キャプチャタスクから、ブロックごと）
+void latencyProbeMix(int16_t* stereo, size_t count);
+
+// 計測の開始・検出・マーカーの送信・応答待ちの期限（接続中の loop() から）
+void latencyProbePoll(uint32_t streamCursor);
+
+// 受信側からの LINK_CTRL_CHIRP_ACK
+void latencyProbeHandleAck(const uint8_t* payload, size_t length);
@@ -0,0 +1,317 @@
+/**
+ * リンクフレーム形式（SPP / BLE 共通）
+ *
+ * 端末 → 受信側、受信側 → 端末の両方向で同じ形式を使う。
+ * Arduino に依存しないので Linux 受信デーモン（linux/）からもそのまま include できる。
+ *
+ *   [0]     0x4D 'M'
+ *   [1]     0x35 '5'
+ *   [2]     type      (LinkFrameType)
+ *   [3]     flags
+ *   [4-5]   payload length (LE)
+ *   [6-7]   sequence       (LE, type に関係なく送信順に +1)
+ *   [8-11]  timestamp      (LE, キャプチャ開始からのサンプル番号)
+ *   [12..]  payload
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LINK_FRAME_SYNC0        0x4D
+#define LINK_FRAME_SYNC1        0x35
+#define LINK_FRAME_HEADER_SIZE  12
+#define LINK_FRAME_MAX_PAYLOAD  4096
+
+// フレーム種別
+enum LinkFrameType : uint8_t {
+    LINK_FRAME_AUDIO_PCM16 = 0x01,  // 16bit LE モノラル PCM
+    LINK_FRAME_FEATURES    = 0x02,  // 8bit 量子化 log-mel（feature_codec.h）
+    LINK_FRAME_MARKER      = 0x03,  // 境界マーカー（payload[0] = LinkMarkerKind、timestamp = 境界位置）
+    LINK_FRAME_AUDIO_ADPCM = 0x04,  // IMA-ADPCM モノラル（adpcm.h、省電力ティアで PCM の代わりに送る）
+    LINK_FRAME_OTA         = 0x05,  // ファームウェア更新（payload[0] = LinkOtaCommand、両方向）
+    LINK_FRAME_REPLAY      = 0x06,  // 履歴の再送（16bit LE PCM、LINK_CTRL_REPLAY への応答、ライブの合間に送る）
+    LINK_FRAME_RECORDING   = 0x07,  // SD の録音の同期（payload[0] = LinkRecordingKind、ライブの合間に送る）
+    LINK_FRAME_CAPS        = 0x08,  // 端末の対応形式と現在の設定（LINK_CTRL_CAPS / LINK_CTRL_SELECT への応答、LinkCaps）
+    LINK_FRAME_CONTROL     = 0x10,  // 制御コマンド（payload[0] = LinkControlCommand）
+};
+
+// 制御コマンド（LINK_FRAME_CONTROL の payload 先頭 1 バイト）
+enum LinkControlCommand : uint8_t {
+    LINK_CTRL_CREDIT   = 0x01,      // BLE: 送信クレジット付与（uint16 LE）
+    LINK_CTRL_SET_MODE = 0x02,      // 送信内容の切替（uint8 LinkStreamMode）
+    LINK_CTRL_REPLAY   = 0x03,      // 履歴の再送要求（[1-4] 先頭サンプル番号, [5-8] サンプル数、uint32 LE）
+    LINK_CTRL_REC_LIST = 0x04,      // 録音の一覧を要求
+    LINK_CTRL_REC_FETCH = 0x05,     // 録音の取り出し（[1-4] 録音番号, [5] LinkRecordingFetch）
+    LINK_CTRL_RESUME   = 0x06,      // 再接続後、ライブをこのサンプル番号から続ける（[1-4] uint32 LE、履歴に残っていれば）
+    LINK_CTRL_CAPS     = 0x07,      // 対応形式の問い合わせ（LINK_FRAME_CAPS が返る）
+    LINK_CTRL_SELECT   = 0x08,      // 形式の選択（[1] LinkStreamMode, [2-3] サンプルレート Hz, [4-5] 1 フレームのサンプル数、uint16 LE）
+    LINK_CTRL_CHIRP_ACK = 0x09,     // 遅延計測のチャープの応答（[1] 計測番号, [2] LinkChirpStage, [3-4] 到着から表示まで ms、uint16 LE）
+};
+
+// LINK_CTRL_CHIRP_ACK の段階（LINK_MARKER_CHIRP を受け取ったら ARRIVED、その後の最初の文字起こしを表示したら SHOWN）
+enum LinkChirpStage : uint8_t {
+    LINK_CHIRP_ARRIVED = 0,
+    LINK_CHIRP_SHOWN   = 1,
+};
+
+// LINK_CTRL_REPLAY の先頭にこれを指定すると「最新からサンプル数だけさかのぼった位置」
+#define LINK_REPLAY_LATEST      0xFFFFFFFFu
+
+// LINK_FRAME_REPLAY の flags（timestamp はフレーム先頭のサンプル番号）
+//   範囲が履歴に残っていなければ、長さ 0 の最終フレームだけが返る
+#define LINK_FLAG_REPLAY_LAST   0x01    // 要求に対する最後のフレーム
+
+// ファームウェア更新（LINK_FRAME_OTA の payload 先頭 1 バイト、すべて LE）
+//   受信側 → 端末
+//     LINK_OTA_BEGIN : [1] LinkOtaKind, [2-5] 送るバイト数, [6-9] 新イメージのバイト数, [10-41] 新イメージの SHA-256
+//                      同じ内容の更新が途中なら続きから（STATUS の offset）
+//     LINK_OTA_DATA  : [1-4] 送るデータ内の位置, [5..] データ（位置が飛んだら STATUS で正しい位置を返す）
+//     LINK_OTA_END   : 検証して起動パーティションを切り替え、再起動する
+//     LINK_OTA_ABORT : 中止
+//   端末 → 受信側
+//     LINK_OTA_STATUS: [1] LinkOtaStatus, [2-5] 次に受け取る位置
+enum LinkOtaCommand : uint8_t {
+    LINK_OTA_BEGIN  = 0x01,
+    LINK_OTA_DATA   = 0x02,
+    LINK_OTA_END    = 0x03,
+    LINK_OTA_ABORT  = 0x04,
+    LINK_OTA_STATUS = 0x81,
+};
+
+enum LinkOtaKind : uint8_t {
+    LINK_OTA_FULL  = 0,             // イメージそのもの
+    LINK_OTA_DELTA = 1,             // 動作中のイメージに対する差分（ota_delta.h）
+};
+
+enum LinkOtaStatus : uint8_t {
+    LINK_OTA_OK          = 0,
+    LINK_OTA_DONE        = 1,       // 検証済み、再起動する
+    LINK_OTA_ERR_STATE   = 2,       // BEGIN の前の DATA / END など
+    LINK_OTA_ERR_OFFSET  = 3,       // 位置が飛んだ（offset から送り直す）
+    LINK_OTA_ERR_NO_SLOT = 4,       // 書き込み先パーティションが無い、または小さい
+    LINK_OTA_ERR_SOURCE  = 5,       // 差分の元が動作中のイメージと違う
+    LINK_OTA_ERR_FORMAT  = 6,
+    LINK_OTA_ERR_FLASH   = 7,
+    LINK_OTA_ERR_VERIFY  = 8,       // SHA-256 または イメージ検証の不一致
+};
+
+// 録音の同期（LINK_FRAME_RECORDING の payload 先頭 1 バイト、すべて LE）
+//   LINK_REC_LIST : [1..] 12 バイトずつ [録音番号][総サンプル数][発話区間の合計サンプル数]（書き込み中の録音は含まない）
+//   LINK_REC_INDEX: [1-4] 録音番号, [5..] 発話区間インデックス（speech_index.h）の続き
+//   LINK_REC_AUDIO: [1-4] 録音番号, [5..] 16bit LE PCM（timestamp = 録音先頭からのサンプル番号）
+// 各種別の最後のフレームに LINK_FLAG_RECORDING_LAST。FETCH はインデックスを送り切ってから音声を送る
+enum LinkRecordingKind : uint8_t {
+    LINK_REC_LIST  = 0x01,
+    LINK_REC_INDEX = 0x02,
+    LINK_REC_AUDIO = 0x03,
+};
+
+enum LinkRecordingFetch : uint8_t {
+    LINK_REC_FETCH_SPEECH = 0,      // 発話区間だけ（区間の間は詰めずに timestamp で飛ぶ）
+    LINK_REC_FETCH_ALL    = 1,      // 録音全体
+};
+
+#define LINK_FLAG_RECORDING_LAST 0x01
+
+// マーカー種別（LINK_FRAME_MARKER の payload 先頭 1 バイト）
+//   LINK_MARKER_SPEAKER_CHANGE: [1] 予約, [2-3] ΔBIC（uint16 LE、飽和）
+//   LINK_MARKER_CHIRP         : [1] 計測番号, [2-3] 鳴らしてからキャプチャに入るまでのサンプル数,
+//                               [4-5] キャプチャから送信までの ms, [6-7] 整合フィルタの相関 ×1000（uint16 LE、latency_probe.h）
+enum LinkMarkerKind : uint8_t {
+    LINK_MARKER_SPEAKER_CHANGE = 0x01,
+    LINK_MARKER_CHIRP          = 0x02,
+};
+
+// 送信内容（接続ごとに PCM から始まる）
+//   省電力ティアでは PCM16 を選んでいても ADPCM で届くので、音声を受ける側は両方を復号する
+enum LinkStreamMode : uint8_t {
+    LINK_MODE_PCM16    = 0,
+    LINK_MODE_FEATURES = 1,
+    LINK_MODE_ADPCM    = 2,
+};
+
+// 対応形式（LINK_FRAME_CAPS の payload、すべて LE）
+//   [0]    LINK_CAPS_VERSION
+//   [1]    現在の送信内容（LinkStreamMode）
+//   [2-3]  現在のサンプルレート（Hz）
+//   [4-5]  現在の 1 フレームのサンプル数
+//   [6]    送れる送信内容（1 << LinkStreamMode の OR）
+//   [7-8]  機能（LINK_CAP_*）
+//   [9]    サンプルレートの数 N、続いて N 個の uint16（Hz）
+//   [..]   フレームのサンプル数の数 M、続いて M 個の uint16
+// 受信側は接続ごとに LINK_CTRL_CAPS で問い合わせ、LINK_CTRL_SELECT で選ぶ（選べなかった項目は元のまま）。
+// 問い合わせない受信側には従来どおり PCM16・16 kHz・1024 サンプルで送る。
+#define LINK_CAPS_VERSION     1
+#define LINK_CAPS_MAX_RATES   4
+#define LINK_CAPS_MAX_FRAMES  4
+#define LINK_CAPS_MAX_SIZE    (10 + 2 * LINK_CAPS_MAX_RATES + 1 + 2 * LINK_CAPS_MAX_FRAMES)
+
+#define LINK_CAP_REPLAY       0x0001    // LINK_CTRL_REPLAY
+#define LINK_CAP_RESUME       0x0002    // LINK_CTRL_RESUME
+#define LINK_CAP_RECORDINGS   0x0004    // SD の録音の同期（カードがあるとき）
+#define LINK_CAP_MARKERS      0x0008    // 話者交代マーカー
+#define LINK_CAP_OTA          0x0010    // LINK_FRAME_OTA
+#define LINK_CAP_LATENCY      0x0020    // 遅延計測のチャープ（LINK_MARKER_CHIRP）
+
+struct LinkCaps {
+    uint8_t version;
+    uint8_t mode;
+    uint16_t sampleRate;
+    uint16_t frameSamples;
+    uint8_t modes;
+    uint16_t features;
+    uint8_t rateCount;
+    uint16_t rates[LINK_CAPS_MAX_RATES];
+    uint8_t frameCount;
+    uint16_t frames[LINK_CAPS_MAX_FRAMES];
+};
+
+inline bool linkCapsHasMode(const LinkCaps& caps, uint8_t mode) {
+    return mode < 8 && (caps.modes & (1 << mode));
+}
+
+// out に書き込む（LINK_CAPS_MAX_SIZE バイトあればよい）
+inline size_t linkCapsWrite(uint8_t* out, const LinkCaps& caps) {
+    size_t n = 0;
+    auto put16 = [&](uint16_t v) {
+        out[n++] = v & 0xFF;
+        out[n++] = v >> 8;
+    };
+    out[n++] = LINK_CAPS_VERSION;
+    out[n++] = caps.mode;
+    put16(caps.sampleRate);
+    put16(caps.frameSamples);
+    out[n++] = caps.modes;
+    put16(caps.features);
+    out[n++] = caps.rateCount;
+    for (int i = 0; i < caps.rateCount && i < LINK_CAPS_MAX_RATES; i++) put16(caps.rates[i]);
+    out[n++] = caps.frameCount;
+    for (int i = 0; i < caps.frameCount && i < LINK_CAPS_MAX_FRAMES; i++) put16(caps.frames[i]);
+    return n;
+}
+
+// 長さが足りなければ false（新しい版で増えた末尾の項目は読み飛ばす、一覧は先頭から最大数まで）
+inline bool linkCapsParse(const uint8_t* p, size_t length, LinkCaps& caps) {
+    if (length < 10) return false;
+    caps = {};
+    caps.version = p[0];
+    caps.mode = p[1];
+    caps.sampleRate = p[2] | (p[3] << 8);
+    caps.frameSamples = p[4] | (p[5] << 8);
+    caps.modes = p[6];
+    caps.features = p[7] | (p[8] << 8);
+    if (caps.sampleRate == 0 || caps.frameSamples == 0) return false;
+    size_t n = 9;
+    uint8_t rates = p[n++];
+    if (length < n + 2 * rates + 1) return false;
+    for (int i = 0; i < rates; i++, n += 2) {
+        if (caps.rateCount < LINK_CAPS_MAX_RATES) caps.rates[caps.rateCount++] = p[n] | (p[n + 1] << 8);
+    }
+    uint8_t frames = p[n++];
+    if (length < n + 2 * frames) return false;
+    for (int i = 0; i < frames; i++, n += 2) {
+        if (caps.frameCount < LINK_CAPS_MAX_FRAMES) caps.frames[caps.frameCount++] = p[n] | (p[n + 1] << 8);
+    }
+    return true;
+}
+
+struct LinkFrameHeader {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t length;
+    uint16_t seq;
+    uint32_t timestamp;
+};
+
+// ヘッダーを out に書き込む（LINK_FRAME_HEADER_SIZE バイト）
+inline size_t linkFrameWriteHeader(uint8_t* out, const LinkFrameHeader& h) {
+    out[0] = LINK_FRAME_SYNC0;
+    out[1] = LINK_FRAME_SYNC1;
+    out[2] = h.type;
+    out[3] = h.flags;
+    out[4] = h.length & 0xFF;
+    out[5] = h.length >> 8;
+    out[6] = h.seq & 0xFF;
+    out[7] = h.seq >> 8;
+    out[8] = h.timestamp & 0xFF;
+    out[9] = (h.timestamp >> 8) & 0xFF;
+    out[10] = (h.timestamp >> 16) & 0xFF;
+    out[11] = h.timestamp >> 24;
+    return LINK_FRAME_HEADER_SIZE;
+}
+
+/**
+ * バイトストリームからフレームを切り出すパーサー
+ *
+ * SPP は境界のないストリーム、BLE は MTU 単位の通知なので、
+ * どちらも 1 バイトずつ push してフレーム境界を復元する。
+ * 同期ワードが崩れた場合は次の 'M' '5' まで読み捨てる。
+ */
+struct LinkFrameParser {
+    uint8_t header[LINK_FRAME_HEADER_SIZE];
+    uint8_t payload[LINK_FRAME_MAX_PAYLOAD];
+    size_t received = 0;         // ヘッダー＋ペイロードの受信済みバイト数
+    LinkFrameHeader current = {};
+    uint32_t resyncCount = 0;    // 読み捨てが発生した回数
+};
+
+// 1 フレーム完成ごとに呼ばれる
+typedef void (*LinkFrameHandler)(const LinkFrameHeader& header, const uint8_t* payload, void* context);
+
+inline void linkFrameParserReset(LinkFrameParser& p) {
+    p.received = 0;
+}
+
+inline void linkFrameParserPush(LinkFrameParser& p, const uint8_t* data, size_t len,
+                                LinkFrameHandler handler, void* context) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = data[i];
+
+        if (p.received < LINK_FRAME_HEADER_SIZE) {
+            // 同期ワードの確認
+            if ((p.received == 0 && b != LINK_FRAME_SYNC0) ||
+                (p.received == 1 && b != LINK_FRAME_SYNC1)) {
+                p.received = (b == LINK_FRAME_SYNC0) ? 1 : 0;
+                p.header[0] = b;
+                p.resyncCount++;
+                continue;
+            }
+            p.header[p.received++] = b;
+
+            if (p.received == LINK_FRAME_HEADER_SIZE) {
+                p.current.type = p.header[2];
+                p.current.flags = p.header[3];
+                p.current.length = p.header[4] | (p.header[5] << 8);
+                p.current.seq = p.header[6] | (p.header[7] << 8);
+                p.current.timestamp = (uint32_t)p.header[8] | ((uint32_t)p.header[9] << 8) |
+                                      ((uint32_t)p.header[10] << 16) | ((uint32_t)p.header[11] << 24);
+
+                if (p.current.length > LINK_FRAME_MAX_PAYLOAD) {
+                    // 壊れたヘッダー
+                    p.received = 0;
+                    p.resyncCount++;
+                } else if (p.current.length == 0) {
+                    handler(p.current, p.payload, context);
+                    p.received = 0;
+                }
+            }
+            continue;
+        }
+
+        // ペイロード（まとめてコピー）
+        size_t offset = p.received - LINK_FRAME_HEADER_SIZE;
+        size_t want = p.current.length - offset;
+        size_t avail = len - i;
+        size_t n = want < avail ? want : avail;
+        memcpy(p.payload + offset, data + i, n);
+        p.received += n;
+        i += n - 1;
+
+        if (offset + n == p.current.length) {
+            handler(p.current, p.payload, context);
+            p.received = 0;
+        }
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * 接続の状態遷移
+ */
+#include "link_state.h"
+
+#include <freertos/queue.h>
+#include <freertos/timers.h>
+
+static const char* const stateNames[] = { "IDLE", "DISCOVERABLE", "CONNECTED" };
+static const char* const eventNames[] = {
+    "connected", "disconnected", "connect button", "stop button", "wake word", "timeout", "touch",
+};
+
+static QueueHandle_t eventQueue = nullptr;
+static TimerHandle_t discoverableTimer = nullptr;
+static LinkStateCallback changeCallback = nullptr;
+
+// 書くのは loop() のタスクだけ
+static volatile LinkState currentState = LINK_STATE_IDLE;
+static uint32_t stateSinceUs = 0;      // 状態に入るきっかけのイベントが積まれた時刻
+static unsigned long stateSinceMs = 0;
+static uint32_t droppedEvents = 0;
+
+static void onDiscoverableTimeout(TimerHandle_t timer) {
+    linkStatePost(LINK_EV_DISCOVERABLE_TIMEOUT);
+}
+
+static LinkState nextState(LinkState state, uint8_t event) {
+    switch (event) {
+    case LINK_EV_CONNECTED:
+        return LINK_STATE_CONNECTED;
+    case LINK_EV_DISCONNECTED:
+        return state == LINK_STATE_CONNECTED ? LINK_STATE_DISCOVERABLE : state;
+    case LINK_EV_STOP_BUTTON:
+        return state == LINK_STATE_CONNECTED ? LINK_STATE_IDLE : state;
+    case LINK_EV_CONNECT_BUTTON:
+    case LINK_EV_WAKE_WORD:
+        return state == LINK_STATE_IDLE ? LINK_STATE_DISCOVERABLE : state;
+    case LINK_EV_DISCOVERABLE_TIMEOUT:
+        return state == LINK_STATE_DISCOVERABLE ? LINK_STATE_IDLE : state;
+    default:
+        return state;
+    }
+}
+
+bool linkStateBegin(LinkStateCallback onChange) {
+    changeCallback = onChange;
+    eventQueue = xQueueCreate(LINK_EVENT_QUEUE_DEPTH, sizeof(LinkEventRecord));
+    discoverableTimer = xTimerCreate("discover", pdMS_TO_TICKS(LINK_DISCOVERABLE_MS), pdFALSE,
+                                     nullptr, onDiscoverableTimeout);
+    stateSinceUs = micros();
+    stateSinceMs = millis();
+    return eventQueue != nullptr && discoverableTimer != nullptr;
+}
+
+LinkState linkState() {
+    return currentState;
+}
+
+const char* linkStateName(LinkState state) {
+    return state <= LINK_STATE_CONNECTED ? stateNames[state] : "?";
+}
+
+unsigned long linkStateSinceMs() {
+    return stateSinceMs;
+}
+
+bool linkStatePost(LinkEvent type, uint32_t arg) {
+    LinkEventRecord event = { type, arg, (uint32_t)micros() };
+    if (eventQueue == nullptr || xQueueSend(eventQueue, &event, 0) != pdTRUE) {
+        droppedEvents++;
+        return false;
+    }
+    return true;
+}
+
+bool linkStateNext(LinkEventRecord& event, TickType_t timeout) {
+    return xQueueReceive(eventQueue, &event, timeout) == pdTRUE;
+}
+
+bool linkStateHandle(const LinkEventRecord& event) {
+    LinkState from = currentState;
+    LinkState to = nextState(from, event.type);
+    if (to == from) return false;
+
+    uint32_t now = micros();
+    Serial.printf("[state] +%.3f s %s -> %s on %s (queued %.1f ms, %.2f s in %s)\n",
+                  now / 1e6f, stateNames[from], stateNames[to], eventNames[event.type],
+                  (now - event.postedUs) / 1000.0f, (event.postedUs - stateSinceUs) / 1e6f, stateNames[from]);
+    if (droppedEvents > 0) {
+        Serial.printf("[state] %u events dropped (queue full)\n", droppedEvents);
+        droppedEvents = 0;
+    }
+
+    currentState = to;
+    stateSinceUs = event.postedUs;
+    stateSinceMs = millis();
+
+    if (to == LINK_STATE_DISCOVERABLE) {
+        xTimerReset(discoverableTimer, 0);
+    } else if (from == LINK_STATE_DISCOVERABLE) {
+        xTimerStop(discoverableTimer, 0);
+    }
+
+    if (changeCallback) changeCallback(from, to, event);
+    return true;
+}
+
+bool linkStateHandle(LinkEvent type) {
+    LinkEventRecord event = { type, 0, (uint32_t)micros() };
+    return linkStateHandle(event);
+}
+
+void linkStateTraceNote(const char* what) {
+    uint32_t now = micros();
+    Serial.printf("[state] +%.3f s %s (%.1f ms after entering %s)\n",
+                  now / 1e6f, what, (now - stateSinceUs) / 1000.0f, stateNames[currentState]);
+}
@@ -0,0 +1,69 @@
+/**
+ * 接続の状態遷移（待機 → 接続受付 → 接続中）
+ *
+ * Bluetooth スタック・タッチ（I2C バスタスク）・キャプチャタスク（ウェイクワード）・タイマーは
+ * linkStatePost() でイベントをキューに積むだけで、状態を変えるのは loop() の linkStateHandle() だけ。
+ * loop() は接続していない間 linkStateNext() でブロックし、イベントか次の定期処理の期限まで CPU を使わない。
+ *
+ *   IDLE         --CONNECT_BUTTON / WAKE_WORD-->  DISCOVERABLE
+ *   DISCOVERABLE --DISCOVERABLE_TIMEOUT-------->  IDLE
+ *   IDLE / DISCOVERABLE --CONNECTED------------>  CONNECTED
+ *   CONNECTED    --STOP_BUTTON----------------->  IDLE
+ *   CONNECTED    --DISCONNECTED---------------->  DISCOVERABLE（受信側の自動再接続を LINK_DISCOVERABLE_MS だけ待つ）
+ *
+ * 遷移ごとに起動からの時刻・キューでの待ち・前の状態にいた時間を [state] 行で出力する
+ * （DISCOVERABLE にいた時間が接続までの時間）。
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define LINK_EVENT_QUEUE_DEPTH  16
+#define LINK_DISCOVERABLE_MS    60000   // 接続受付の時間
+
+enum LinkState : uint8_t {
+    LINK_STATE_IDLE,
+    LINK_STATE_DISCOVERABLE,
+    LINK_STATE_CONNECTED,
+};
+
+enum LinkEvent : uint8_t {
+    LINK_EV_CONNECTED,              // BT スタック
+    LINK_EV_DISCONNECTED,           // BT スタック
+    LINK_EV_CONNECT_BUTTON,         // loop()（タッチの位置から判定）
+    LINK_EV_STOP_BUTTON,            // loop()
+    LINK_EV_WAKE_WORD,              // キャプチャタスク（arg = 検出位置のサンプル番号）
+    LINK_EV_DISCOVERABLE_TIMEOUT,   // タイマー
+    LINK_EV_TOUCH,                  // I2C バスタスク（arg = x << 16 | y、押し始めのみ）
+};
+
+struct LinkEventRecord {
+    uint8_t type;        // LinkEvent
+    uint32_t arg;
+    uint32_t postedUs;   // 積まれた時刻（micros）
+};
+
+// 遷移のたびに loop() のタスクで呼ばれる（event は遷移のきっかけ）
+typedef void (*LinkStateCallback)(LinkState from, LinkState to, const LinkEventRecord& event);
+
+bool linkStateBegin(LinkStateCallback onChange);
+
+// 現在の状態（どのタスクから読んでもよい）
+LinkState linkState();
+const char* linkStateName(LinkState state);
+
+// 状態に入った時刻（millis、接続受付の残り時間の表示用）
+unsigned long linkStateSinceMs();
+
+// イベントを積む（どのタスクからでも、待たない。キューが満杯なら false）
+bool linkStatePost(LinkEvent type, uint32_t arg = 0);
+
+// 次のイベントを取り出す（timeout まで待つ、loop() から呼ぶ）
+bool linkStateNext(LinkEventRecord& event, TickType_t timeout);
+
+// 状態遷移表に通す（loop() から呼ぶ、遷移したら true）
+bool linkStateHandle(const LinkEventRecord& event);
+bool linkStateHandle(LinkEvent type);
+
+// 現在の状態に入ってからの経過を [state] 行に出す（最初の音声フレームなど）
+void linkStateTraceNote(const char* what);
@@ -8,77 +8,81 @@
  * 2. Androidアプリで「Scan for M5Stack」をタップ
  * 3. 「M5Stack-M5Scribe」を選択して接続
  * 4. 自動的に音声ストリーミング開始
+ *
+ * ウェイクワードモデル（SPIFFS の /kws.bin）があれば、待機中に検出した時点で接続モードに入り、
+ * 接続後は検出位置の少し前から送信する。
  */
 
 #include <M5Core2.h>
-#include <driver/i2s.h>
-#include <BluetoothSerial.h>
-
-// I2Sピン設定
-#define CONFIG_I2S_BCK_PIN     12
-#define CONFIG_I2S_LRCK_PIN    0
-#define CONFIG_I2S_DATA_PIN    2
-#define CONFIG_I2S_DATA_IN_PIN 34
-
-#define Speak_I2S_NUMBER I2S_NUM_0
+#include "adpcm.h"
+#include "boot_trace.h"
+#include "capture.h"
+#include "dsp_bench.h"
+#include "feature_stream.h"
+#include "i2c_bus.h"
+#include "kws.h"
+#include "link_state.h"
+#include "ota_update.h"
+#include "power_policy.h"
+#include "recorder.h"
+#include "replay.h"
+#include "sidetone.h"
+#include "latency_probe.h"
+#include "speaker_marker.h"
+#include "transport.h"
+#include "energy_bench.h"
+#include "profiler.h"
+#include "hot_path.h"
 
 // 音声設定
-#define SAMPLE_RATE       16000  // 16kHz（帯域削減）
-#define DATA_SIZE         2048   // バッファサイズを大きく（安定性向上）
+#define DATA_SIZE         2048   // 送信バッファサイズ（安定性向上）
 
-// Bluetooth
-BluetoothSerial SerialBT;
-bool btConnected = false;
-bool btDiscoverable = false;
-unsigned long discoverableStartTime = 0;
-const unsigned long DISCOVERABLE_DURATION = 60000; // 60秒
+// 起動
+#define BT_INIT_TASK_STACK 8192
+#ifndef BOOT_SEQUENTIAL
+#define BOOT_SEQUENTIAL   0      // 1: 並行化前と同じ順に待つ（起動時間の比較用）
+#endif
 
 // バッファ
 uint8_t audioBuffer[DATA_SIZE];
+uint32_t streamCursor = 0;         // 送信済みサンプル番号（フレームのタイムスタンプ）
+uint8_t streamMode = LINK_MODE_PCM16;
+uint16_t streamFrameSamples = DATA_SIZE / 2;  // 1 フレームのサンプル数（LINK_CTRL_SELECT で選ぶ）
+bool firstFramePending = false;    // 接続後の最初のフレームを [state] 行に出す
+
+// 受信側が選べる 1 フレームのサンプル数（16 kHz で 16 / 32 / 64 ms）
+const uint16_t streamFrameOptions[] = { DATA_SIZE / 8, DATA_SIZE / 4, DATA_SIZE / 2 };
+
+// 受信側が選んだとき・省電力ティアで PCM の代わりに送る ADPCM
+AdpcmState adpcmState;
+uint8_t adpcmBuffer[ADPCM_HEADER_SIZE + DATA_SIZE / 4];
+
+// ウェイクワード
+bool prerollPending = false;
+uint32_t prerollStart = 0;         // 接続後に送り始めるサンプル番号
+
+// 接続時に返す対応形式
+bool speakerMarkersReady = false;
+bool latencyProbeReady = false;
 
 // UI関連
 int audioLevel = 0;              // 音声レベル（0-100）
 unsigned long lastAudioUpdate = 0;
 float pulseAnimation = 0.0;      // パルスアニメーション用
 int lastDisplayState = -1;       // 前回の表示状態（-1=初期、0=待機、1=検索中、2=接続中）
-bool needsFullRedraw = true;     // 全画面再描画が必要か
-
-// マイク初期化
-bool InitMicrophone() {
-    esp_err_t err = ESP_OK;
-
-    i2s_driver_uninstall(Speak_I2S_NUMBER);
-
-    i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_PDM),
-        .sample_rate = SAMPLE_RATE,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-        .channel_format = I2S_CHANNEL_FMT_ONLY_RIGHT,
-        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 6,      // DMAバッファ数を増やす
-        .dma_buf_len = 256,      // DMAバッファ長を増やす
-        .use_apll = false,
-        .tx_desc_auto_clear = false,
-        .fixed_mclk = 0
-    };
-
-    err += i2s_driver_install(Speak_I2S_NUMBER, &i2s_config, 0, NULL);
-
-    i2s_pin_config_t tx_pin_config;
-#if (ESP_IDF_VERSION > ESP_IDF_VERSION_VAL(4, 3, 0))
-    tx_pin_config.mck_io_num = I2S_PIN_NO_CHANGE;
-#endif
-    tx_pin_config.bck_io_num = CONFIG_I2S_BCK_PIN;
-    tx_pin_config.ws_io_num = CONFIG_I2S_LRCK_PIN;
-    tx_pin_config.data_out_num = CONFIG_I2S_DATA_PIN;
-    tx_pin_config.data_in_num = CONFIG_I2S_DATA_IN_PIN;
+bool needsFullRedraw = true;     // 全画面再描画が必要か（loop() のタスクだけが書く）
+bool screenOn = true;            // DARK ティアでは消灯（タッチで一時点灯）
+unsigned long screenWakeUntil = 0;
+unsigned long lastRecorderPoll = 0;  // 未接続の間の SD 録音（-DRECORDER=1）
 
-    err += i2s_set_pin(Speak_I2S_NUMBER, &tx_pin_config);
-    err += i2s_set_clk(Speak_I2S_NUMBER, SAMPLE_RATE, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
+// 二系統のライブ側の統計（-DRECORDER_ARCHIVE=1 の [live] 行）
+uint32_t liveSamples = 0;
+uint32_t liveBytes = 0;
+uint32_t liveSkipped = 0;
+uint32_t liveBacklogMax = 0;
+uint64_t liveEncodeUs = 0;
 
-    return (err == ESP_OK);
-}
+#define STATUS_BAR_INTERVAL_MS 5000   // ステータスバー（電池）の再描画
 
 // 音声レベルを計算（感度を高く調整）
 void calculateAudioLevel(uint8_t* buffer, size_t length) {
@@ -221,6 +225,13 @@ void drawLightningBolt(int x, int y, uint16_t color) {
     M5.Lcd.fillTriangle(x, y + 5, x + 4, y + 5, x + 6, y + 10, color); // 下部
 }
 
+// 電池・温度の読み取り値（I2C バスタスクのキャッシュ、古ければ更新を要求して前回の値を使う）
+I2cPowerSnapshot readPower() {
+    I2cPowerSnapshot power = {};
+    i2cBusPower(power, 2 * I2C_BUS_POWER_MS);
+    return power;
+}
+
 // ステータスバー描画
 void drawStatusBar() {
     // 背景（半透明風）
@@ -232,9 +243,10 @@ void drawStatusBar() {
     M5.Lcd.setCursor(8, 8);
     M5.Lcd.print("M5Scribe");
 
-    // バッテリー情報
-    float batteryLevel = M5.Axp.GetBatteryLevel();
-    float batCurrent = M5.Axp.GetBatCurrent();
+    // バッテリー情報（I2C バスタスクのキャッシュ）
+    I2cPowerSnapshot power = readPower();
+    float batteryLevel = power.batteryLevel;
+    float batCurrent = power.batteryCurrentMa;
     bool isCharging = (batCurrent > 0);  // 電流がプラスなら充電中
 
     // バッテリーアイコン
@@ -267,6 +279,32 @@ void drawStatusBar() {
     M5.Lcd.setTextColor(TFT_WHITE);
     M5.Lcd.setCursor(battX - 25, battY + 3);
     M5.Lcd.printf("%.0f%%", batteryLevel);
+
+    // 省電力ティア（FULL 以外）
+    if (powerPolicyTier() != POWER_TIER_FULL) {
+        M5.Lcd.setTextColor(TFT_ORANGE);
+        M5.Lcd.setCursor(195, 8);
+        M5.Lcd.print(powerPolicyConfig().name);
+    }
+
+    // SD 録音中
+    if (recorderRecording()) {
+        M5.Lcd.setTextColor(TFT_RED);
+        M5.Lcd.setCursor(70, 8);
+        M5.Lcd.print("REC");
+    }
+
+    // モニター出力（サイドトーン有効時のみ）
+    if (sidetoneEnabled()) {
+        M5.Lcd.setCursor(120, 8);
+        if (sidetoneMuted()) {
+            M5.Lcd.setTextColor(TFT_RED);
+            M5.Lcd.print("MON MUTE");
+        } else {
+            M5.Lcd.setTextColor(TFT_GREEN);
+            M5.Lcd.printf("MON %d%%", sidetoneVolume());
+        }
+    }
 }
 
 // 画面更新
@@ -278,7 +316,8 @@ void updateDisplay() {
     static unsigned long lastStatusBarUpdate = 0;
 
     // 現在の状態を判定
-    int currentState = btConnected ? 2 : (btDiscoverable ? 1 : 0);
+    LinkState state = linkState();
+    int currentState = state == LINK_STATE_CONNECTED ? 2 : (state == LINK_STATE_DISCOVERABLE ? 1 : 0);
 
     // 状態が変わった場合のみ全画面再描画
     if (currentState != lastDisplayState || needsFullRedraw) {
@@ -298,15 +337,15 @@ void updateDisplay() {
     // 部分的な更新のみ（高頻度）
     unsigned long now = millis();
 
-    // ステータスバーを定期的に更新（5秒ごと）
-    if (now - lastStatusBarUpdate > 5000) {
+    // ステータスバーを定期的に更新
+    if (now - lastStatusBarUpdate >= STATUS_BAR_INTERVAL_MS) {
         drawStatusBar();
         lastStatusBarUpdate = now;
     }
 
     M5.Lcd.setTextDatum(MC_DATUM);
 
-    if (btConnected) {
+    if (state == LINK_STATE_CONNECTED) {
         // 初回のみ静的要素を描画
         if (lastAudioLevel == -1) {
             M5.Lcd.setTextSize(3);
@@ -326,7 +365,7 @@ void updateDisplay() {
         }
 
         // アニメーション更新（適度な頻度で）
-        if (now - lastUpdate > 50) {
+        if (now - lastUpdate > powerPolicyConfig().uiIntervalMs) {
             // ビジュアライザー初期化（初回のみ背景描画）
             if (lastAudioLevel == -1) {
                 M5.Lcd.fillCircle(160, 135, 55, TFT_BLACK);
@@ -352,7 +391,7 @@ void updateDisplay() {
             lastUpdate = now;
         }
 
-    } else if (btDiscoverable) {
+    } else if (state == LINK_STATE_DISCOVERABLE) {
         // 初回のみ静的要素を描画
         if (lastAudioLevel == -1) {  // 状態変更直後
             M5.Lcd.setTextSize(3);
@@ -367,7 +406,7 @@ void updateDisplay() {
         }
 
         // アニメーション更新
-        if (now - lastUpdate > 50) {
+        if (now - lastUpdate > powerPolicyConfig().uiIntervalMs) {
             // 回転するサークルエリアのみクリア
             M5.Lcd.fillCircle(160, 120, 50, TFT_BLACK);
 
@@ -381,7 +420,7 @@ void updateDisplay() {
             }
 
             // 残り時間更新
-            unsigned long remaining = (DISCOVERABLE_DURATION - (millis() - discoverableStartTime)) / 1000;
+            unsigned long remaining = (LINK_DISCOVERABLE_MS - (millis() - linkStateSinceMs())) / 1000;
             if (remaining != lastRemainingTime) {
                 M5.Lcd.fillRect(130, 195, 100, 30, TFT_BLACK);
                 M5.Lcd.setTextSize(3);
@@ -418,29 +457,328 @@ void updateDisplay() {
     M5.Lcd.setTextDatum(TL_DATUM);
 }
 
-// Bluetoothコールバック
-void btCallback(esp_spp_cb_event_t event, esp_spp_cb_param_t *param) {
-    if (event == ESP_SPP_SRV_OPEN_EVT) {
-        btConnected = true;
-        needsFullRedraw = true;  // 状態変化で再描画
+// 画面の点灯・消灯（バックライトは AXP192 の DCDC3）
+void setScreen(bool on) {
+    if (on == screenOn) return;
+    screenOn = on;
+    if (on) {
+        i2cBusPost(I2C_CMD_BACKLIGHT, 1);
+        M5.Lcd.wakeup();
+        needsFullRedraw = true;
+    } else {
+        M5.Lcd.sleep();
+        i2cBusPost(I2C_CMD_BACKLIGHT, 0);
+    }
+}
+
+// 省電力ティアの適用（コーデックは送信時に参照する）
+void applyPowerTier() {
+    const PowerTierConfig& config = powerPolicyConfig();
+    if (getCpuFrequencyMhz() != config.cpuMhz) {
+        setCpuFrequencyMhz(config.cpuMhz);
+    }
+    if (config.screenOn) {
+        setScreen(true);
+    } else if (millis() >= screenWakeUntil) {
+        setScreen(false);
+    }
+    if (screenOn) drawStatusBar();
+}
+
+// キャプチャタスクから呼ばれる（待機中はウェイクワード、接続中は話者交代の検出）
+void onCaptureBlock(const int16_t* samples, size_t count, uint32_t firstIndex) {
+    if (linkState() != LINK_STATE_CONNECTED) {
+        kwsProcess(samples, count, firstIndex);
+        uint32_t triggerIndex;
+        if (kwsTakeTrigger(triggerIndex)) linkStatePost(LINK_EV_WAKE_WORD, triggerIndex);
+    } else {
+        speakerMarkerProcess(samples, count, firstIndex);
+    }
+}
+
+/**
+ * ウェイクワード検出後の接続で送り始める位置
+ *
+ * 接続が遅れると大きく遅れたライブになるので、検出から KWS_PREROLL_MAX_MS を過ぎていたら最新から。
+ * 履歴に残っていない分は送れないので最古のサンプルまで詰める。
+ */
+uint32_t prerollCursor() {
+    uint32_t now = captureWriteIndex();
+    uint32_t behind = now - prerollStart;
+    if (behind > (uint32_t)(KWS_PREROLL_MS + KWS_PREROLL_MAX_MS) * (SAMPLE_RATE / 1000)) {
+        Serial.printf("Wake word was %.1f s ago, starting live without preroll\n", (float)behind / SAMPLE_RATE);
+        return now;
+    }
+    if (behind > now - captureOldestIndex()) return captureOldestIndex();
+    return prerollStart;
+}
+
+// 状態遷移の処理（linkStateHandle() から loop() のタスクで呼ばれる）
+void onLinkStateChange(LinkState from, LinkState to, const LinkEventRecord& event) {
+    needsFullRedraw = true;  // 状態変化で再描画
+
+    if (to == LINK_STATE_DISCOVERABLE) {
+        // 接続モード有効化（CONNECTボタン / ウェイクワード / 切断後の再接続待ち）
+        if (from == LINK_STATE_CONNECTED) Serial.println("Bluetooth client disconnected, waiting for reconnect");
+        transportEnableConnection();
+        Serial.printf("Connection mode enabled for %d seconds\n", LINK_DISCOVERABLE_MS / 1000);
+    } else if (to == LINK_STATE_CONNECTED) {
+        // 接続した時点から送信開始（ウェイクワード検出後ならプリロールから）
+        streamCursor = prerollPending ? prerollCursor() : captureWriteIndex();
+        prerollPending = false;
+        streamMode = LINK_MODE_PCM16;
+        streamFrameSamples = DATA_SIZE / 2;
+        speakerMarkerReset(captureWriteIndex());
+        latencyProbeReset();
+        replayReset();
+        if (!RECORDER_ARCHIVE) recorderStop();  // 書き込み中の録音を閉じて同期できるようにする
+        recorderSyncReset();
+        firstFramePending = true;
         Serial.println("Bluetooth client connected");
-    } else if (event == ESP_SPP_CLOSE_EVT) {
-        btConnected = false;
-        needsFullRedraw = true;  // 状態変化で再描画
-        Serial.println("Bluetooth client disconnected");
+    } else if (event.type == LINK_EV_STOP_BUTTON) {
+        transportDisconnect();
+        Serial.println("Disconnected by user");
+    } else {
+        // 接続受付のタイムアウト（切断後の再接続待ちを含む）
+        transportDisableConnection();
+        prerollPending = false;
+        Serial.println("Connection mode timeout");
+    }
+
+    // 切断したら次の録音を始める（RECORDER_ARCHIVE では続けている）
+    if (from == LINK_STATE_CONNECTED) recorderStart();
+}
+
+// 履歴リングから SD へ（送信待ちの間も transportSetStallHandler() から呼ばれる）
+void pollRecorder() {
+    if (recorderRecording() && millis() - lastRecorderPoll >= RECORDER_POLL_MS) {
+        recorderPoll();
+        lastRecorderPoll = millis();
+    }
+}
+
+// タッチの押し始め（I2C バスタスクから呼ばれる、位置の判定は loop() で）
+void onTouch(int16_t x, int16_t y) {
+    linkStatePost(LINK_EV_TOUCH, ((uint32_t)(uint16_t)x << 16) | (uint16_t)y);
+}
+
+// タッチの処理（loop() のタスク）
+void handleTouch(int16_t x, int16_t y) {
+    // 消灯中はタッチで一時点灯するだけ（ボタンとしては扱わない）
+    if (!powerPolicyConfig().screenOn) {
+        screenWakeUntil = millis() + POWER_WAKE_MS;
+        if (!screenOn) {
+            setScreen(true);
+            return;
+        }
+    }
+
+    LinkState state = linkState();
+
+    // CONNECTボタン判定（画面下部中央）
+    if (state == LINK_STATE_IDLE && x >= 70 && x <= 250 && y >= 190 && y <= 240) {
+        // ボタン押下フィードバック
+        drawModernButton(70, 190, 180, 50, "CONNECT", TFT_DARKGREY, true);
+        delay(100);
+        linkStateHandle(LINK_EV_CONNECT_BUTTON);
+    }
+
+    // STOPボタン判定（画面右下）
+    if (state == LINK_STATE_CONNECTED && x >= 195 && x <= 305 && y >= 185 && y <= 230) {
+        // ボタン押下フィードバック
+        drawModernButton(195, 185, 110, 45, "STOP", TFT_MAROON, true);
+        delay(100);
+        linkStateHandle(LINK_EV_STOP_BUTTON);
+    }
+}
+
+// キューから取り出したイベントの処理
+void handleEvent(const LinkEventRecord& event) {
+    if (event.type == LINK_EV_TOUCH) {
+        handleTouch((int16_t)(event.arg >> 16), (int16_t)(event.arg & 0xFFFF));
+        return;
+    }
+    if (event.type == LINK_EV_WAKE_WORD) {
+        // ウェイクワード検出 → 接続モード（スマホ側が再接続する）
+        prerollPending = true;
+        prerollStart = event.arg - (uint32_t)KWS_PREROLL_MS * (SAMPLE_RATE / 1000);
+    }
+    linkStateHandle(event);
+}
+
+// 期限（millis）までの残り
+uint32_t untilMs(unsigned long deadline, unsigned long now) {
+    long remaining = (long)(deadline - now);
+    return remaining > 0 ? remaining : 0;
+}
+
+const char* streamModeName(uint8_t mode) {
+    return mode == LINK_MODE_FEATURES ? "log-mel features" : (mode == LINK_MODE_ADPCM ? "ADPCM" : "PCM");
+}
+
+// 送信内容の切り替え（PCM / ADPCM / log-mel）
+void setStreamMode(uint8_t mode) {
+    if (mode > LINK_MODE_ADPCM) {
+        Serial.printf("ERROR: Unknown stream mode %u\n", mode);
+        return;
+    }
+    if (mode == LINK_MODE_FEATURES && !featuresBegin()) {
+        Serial.println("ERROR: Feature front end allocation failed, staying in PCM mode");
+        return;
+    }
+    if (mode == LINK_MODE_FEATURES) {
+        featuresReset(streamCursor);
+    }
+    streamMode = mode;
+    Serial.printf("Stream mode: %s\n", streamModeName(mode));
+}
+
+// 対応形式と現在の設定を受信側に返す
+void sendCaps() {
+    LinkCaps caps = {};
+    caps.mode = streamMode;
+    caps.sampleRate = SAMPLE_RATE;
+    caps.frameSamples = streamFrameSamples;
+    caps.modes = (1 << LINK_MODE_PCM16) | (1 << LINK_MODE_ADPCM) | (1 << LINK_MODE_FEATURES);
+    caps.features = LINK_CAP_REPLAY | LINK_CAP_RESUME | LINK_CAP_OTA;
+    if (recorderEnabled()) caps.features |= LINK_CAP_RECORDINGS;
+    if (speakerMarkersReady) caps.features |= LINK_CAP_MARKERS;
+    if (latencyProbeReady) caps.features |= LINK_CAP_LATENCY;
+    caps.rateCount = 1;  // 前処理・KWS・話者交代がキャプチャのレートで動くので 1 つだけ
+    caps.rates[0] = SAMPLE_RATE;
+    for (uint16_t samples : streamFrameOptions) caps.frames[caps.frameCount++] = samples;
+
+    uint8_t payload[LINK_CAPS_MAX_SIZE];
+    size_t length = linkCapsWrite(payload, caps);
+    transportSendFrame(LINK_FRAME_CAPS, 0, payload, length, streamCursor);
+}
+
+// 受信側が選んだ形式にする（対応していない項目は変えない）
+void selectStream(uint8_t mode, uint16_t rate, uint16_t frameSamples) {
+    if (rate != SAMPLE_RATE) {
+        Serial.printf("[caps] %u Hz is not supported, staying at %u Hz\n", rate, SAMPLE_RATE);
+    }
+    bool frameOk = false;
+    for (uint16_t samples : streamFrameOptions) frameOk = frameOk || samples == frameSamples;
+    if (frameOk) {
+        streamFrameSamples = frameSamples;
+    } else {
+        Serial.printf("[caps] %u-sample frames are not supported\n", frameSamples);
+    }
+    if (mode != streamMode) setStreamMode(mode);
+    Serial.printf("[caps] %s, %u Hz, %u ms frames\n", streamModeName(streamMode), SAMPLE_RATE,
+                  streamFrameSamples * 1000 / SAMPLE_RATE);
+    sendCaps();
+}
+
+// 再接続した受信側が最後に受け取った位置からライブを続ける（履歴に残っていなければ最新から）
+void resumeStream(uint32_t position) {
+    uint32_t behind = captureWriteIndex() - position;
+    if (behind > captureWriteIndex() - captureOldestIndex()) {
+        Serial.printf("[link] resume at %u is no longer in history, continuing live\n", position);
+        return;
     }
+    streamCursor = position;
+    if (streamMode == LINK_MODE_FEATURES) featuresReset(streamCursor);
+    Serial.printf("[link] resumed at %u (%.0f ms behind live)\n", position, behind * 1000.0f / SAMPLE_RATE);
+}
+
+// 消費電力の計測のシナリオを適用する（終了したら省電力ポリシーに戻す）
+void applyEnergyScenario(const EnergyScenario* scenario) {
+    if (scenario) {
+        powerPolicyHold(scenario->tier);
+        if (linkState() == LINK_STATE_CONNECTED && streamMode != scenario->streamMode) {
+            setStreamMode(scenario->streamMode);
+        }
+    } else {
+        powerPolicyRelease();
+    }
+    applyPowerTier();
+}
+
+// 受信側からの制御フレーム（transportPoll() から呼ばれる）
+void onControl(const LinkFrameHeader& header, const uint8_t* payload) {
+    if (header.type == LINK_FRAME_OTA) {
+        otaUpdateHandleFrame(header, payload);
+        return;
+    }
+    if (payload[0] == LINK_CTRL_SET_MODE && header.length >= 2) {
+        setStreamMode(payload[1]);
+    } else if (payload[0] == LINK_CTRL_RESUME && header.length >= 5) {
+        uint32_t position;
+        memcpy(&position, payload + 1, 4);
+        resumeStream(position);
+    } else if (payload[0] == LINK_CTRL_REPLAY && header.length >= 9) {
+        uint32_t start, count;
+        memcpy(&start, payload + 1, 4);
+        memcpy(&count, payload + 5, 4);
+        replayRequest(start, count);
+    } else if (payload[0] == LINK_CTRL_REC_LIST || payload[0] == LINK_CTRL_REC_FETCH) {
+        recorderHandleControl(header, payload);
+    } else if (payload[0] == LINK_CTRL_CAPS) {
+        sendCaps();
+    } else if (payload[0] == LINK_CTRL_CHIRP_ACK) {
+        latencyProbeHandleAck(payload, header.length);
+    } else if (payload[0] == LINK_CTRL_SELECT && header.length >= 6) {
+        uint16_t rate, frameSamples;
+        memcpy(&rate, payload + 2, 2);
+        memcpy(&frameSamples, payload + 4, 2);
+        selectStream(payload[1], rate, frameSamples);
+    }
+}
+
+// Bluetoothコールバック（SPP / BLE 共通、BT スタックのタスクから呼ばれるのでイベントを積むだけ）
+void btCallback(bool connected) {
+    linkStatePost(connected ? LINK_EV_CONNECTED : LINK_EV_DISCONNECTED);
+}
+
+// Bluetooth は起動用タスクで core 0（コントローラーと同じコア）に任せ、
+// その間に setup() 側で画面・マイク・モデル読み込みを進める
+SemaphoreHandle_t btInitDone = nullptr;
+volatile bool btInitOk = false;
+
+void btInitTask(void* param) {
+    uint32_t start = micros();
+    btInitOk = transportBegin("M5Stack-M5Scribe", btCallback);
+    bootTraceMark("bluetooth", start);
+    xSemaphoreGive(btInitDone);
+    vTaskDelete(nullptr);
+}
+
+// 起動失敗時の表示（戻らない）
+void bootFailed(const char* message) {
+    M5.Lcd.fillScreen(RED);
+    M5.Lcd.setCursor(10, 100);
+    M5.Lcd.println(message);
+    Serial.printf("ERROR: %s\n", message);
+    while (1) delay(1000);
 }
 
 void setup() {
-    // M5Stack Core2初期化
-    M5.begin();
+    // シリアルを先に開いて Bluetooth の初期化を始める
+    Serial.begin(115200);
+    bootTraceMark("serial");
+
+    // PC サンプリング（-DPROFILER=1 のビルドのみ、起動から記録する）
+    profilerBegin();
+
+    // 接続の状態遷移（BT スタックのコールバックより先に）
+    if (!linkStateBegin(onLinkStateChange)) {
+        Serial.println("ERROR: Link state machine allocation failed");
+    }
+
+    btInitDone = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(btInitTask, "btinit", BT_INIT_TASK_STACK, nullptr, 1, nullptr, 0);
+#if BOOT_SEQUENTIAL
+    xSemaphoreTake(btInitDone, portMAX_DELAY);
+#endif
+
+    // M5Stack Core2初期化（SD カードは録音（recorder.h）が使うときだけ自分でマウントする、シリアルは開始済み）
+    M5.begin(true, false, false);
 
     // ディスプレイを180度回転（上下逆さ）
     M5.Lcd.setRotation(3);
-
-    // シリアル通信
-    Serial.begin(115200);
-    Serial.println("\n\n=== M5Scribe Bluetooth Streaming Started ===");
+    bootTraceMark("m5 begin");
 
     // 画面表示
     M5.Lcd.fillScreen(BLACK);
@@ -448,132 +786,297 @@ void setup() {
     M5.Lcd.setTextColor(WHITE);
     M5.Lcd.setCursor(60, 100);
     M5.Lcd.println("Starting...");
+    bootTraceMark("splash");
 
-    // マイク電源ON
+    Serial.println("\n\n=== M5Scribe Bluetooth Streaming Started ===");
+
+    // マイク電源ON（100ms 後に OFF。待つ間に以降の初期化を進める）
     M5.Axp.SetLDOEnable(3, true);
+    unsigned long ldoOffAt = millis() + 100;
+#if BOOT_SEQUENTIAL
     delay(100);
-    M5.Axp.SetLDOEnable(3, false);
+#endif
 
     // マイク初期化
-    if (InitMicrophone()) {
-        Serial.println("Microphone initialized");
-    } else {
-        M5.Lcd.fillScreen(RED);
-        M5.Lcd.setCursor(10, 100);
-        M5.Lcd.println("Mic init failed!");
-        Serial.println("ERROR: Microphone initialization failed!");
-        while (1) delay(1000);
+    if (!InitMicrophone()) bootFailed("Mic init failed!");
+    Serial.println("Microphone initialized");
+    bootTraceMark("microphone");
+
+    // モニター出力（-DSIDETONE=1 のビルドのみ）
+    if (sidetoneBegin()) {
+        Serial.println("Sidetone enabled (A: vol-, B: mute, C: vol+)");
     }
 
-    // Bluetooth初期化（最初は発見不可）
-    if (!SerialBT.begin("M5Stack-M5Scribe", false)) {
-        M5.Lcd.fillScreen(RED);
-        M5.Lcd.setCursor(10, 100);
-        M5.Lcd.println("BT init failed!");
-        Serial.println("ERROR: Bluetooth initialization failed!");
-        while (1) delay(1000);
+    // 遅延計測のチャープ（-DLATENCY_PROBE=1 のビルドのみ、サイドトーンの出力から鳴らす）
+    latencyProbeReady = sidetoneEnabled() && latencyProbeBegin();
+    if (LATENCY_PROBE && !latencyProbeReady) {
+        Serial.println("WARNING: Latency probe disabled (no sidetone output or out of memory)");
     }
 
-    SerialBT.register_callback(btCallback);
-    Serial.println("Bluetooth initialized (not discoverable)");
+    // ウェイクワード（モデルが無ければ無効のまま）
+    kwsBegin();
+    bootTraceMark("wake word");
+
+    // 話者交代検出
+    speakerMarkersReady = speakerMarkerBegin();
+    if (!speakerMarkersReady) {
+        Serial.println("WARNING: Speaker change detector disabled (out of memory)");
+    }
+    bootTraceMark("speaker change");
+
+    while ((long)(ldoOffAt - millis()) > 0) delay(1);
+    M5.Axp.SetLDOEnable(3, false);
+    bootTraceMark("mic ldo");
+
+    // 以降の内部 I2C（AXP192・タッチ・RTC）はバスタスクだけが触る
+    i2cBusSetTouchHandler(onTouch);
+    if (!i2cBusBegin()) bootFailed("I2C bus task failed!");
+    bootTraceMark("i2c bus");
+
+    // キャプチャ開始
+    if (!captureBegin(onCaptureBlock)) bootFailed("Capture init failed!");
+    bootTraceMark("capture");
+
+    // 未接続の間の SD 録音（-DRECORDER=1 のビルドでカードがあるときのみ）
+    if (recorderBegin()) recorderStart();
+    bootTraceMark("recorder");
+
+    // Bluetooth初期化の完了待ち（最初は発見不可）
+    uint32_t waitStart = micros();
+    xSemaphoreTake(btInitDone, portMAX_DELAY);
+    bootTraceMark("wait bluetooth", waitStart);
+    if (!btInitOk) bootFailed("BT init failed!");
+
+    transportSetControlHandler(onControl);
+    if (RECORDER_ARCHIVE) transportSetStallHandler(pollRecorder);
+
+    // 省電力ポリシー（FULL から開始）
+    powerPolicyBegin();
+
+    Serial.printf("Bluetooth initialized (%s, not discoverable)\n", transportName());
     Serial.println("Press button to enable connection mode");
 
+    // 設定ごとの消費電力の計測（-DENERGY_BENCH=1 のビルドのみ、USB を外すと始まる）
+    energyBenchBegin();
+
     updateDisplay();
+    bootTraceMark("ready");
+    bootTraceReport();
+
+#if DSP_BENCH
+    // パイプラインの実機コスト（m5scribe-dspbench と同じ計測）
+    DspBenchResult bench;
+    dspBenchRun(bench, 200, []() -> uint64_t { return (uint64_t)esp_timer_get_time() * 1000; });
+    Serial.printf("[dsp] pipeline %.1f ns/sample, virtual %.1f ns/sample, disabled %.1f / %.1f ns/sample, diff %d\n",
+                  bench.pipelineNs, bench.virtualNs, bench.pipelineBypassNs, bench.virtualBypassNs, bench.maxDiff);
+#endif
 }
 
-void loop() {
-    M5.update();
+// 待機中に次に起きる必要があるまでの時間
+// （統計の出力は省電力ポリシーの評価のついでに行うので、最大でその間隔だけ遅れる）
+uint32_t idleWaitMs(unsigned long lastPowerEval) {
+    unsigned long now = millis();
+    uint32_t wait = untilMs(lastPowerEval + POWER_EVAL_INTERVAL_MS, now);
+    if (screenOn) {
+        // 接続受付中はアニメーション、それ以外はステータスバーの更新
+        wait = min(wait, linkState() == LINK_STATE_DISCOVERABLE ? powerPolicyConfig().uiIntervalMs + 1
+                                                                : (uint32_t)STATUS_BAR_INTERVAL_MS);
+        if (!powerPolicyConfig().screenOn) wait = min(wait, untilMs(screenWakeUntil, now));
+    }
+    if (recorderRecording()) wait = min(wait, untilMs(lastRecorderPoll + RECORDER_POLL_MS, now));
+    if (otaUpdateActive()) wait = min(wait, (uint32_t)10);
+    wait = min(wait, energyBenchWaitMs());
+    if (profilerEnabled()) wait = min(wait, (uint32_t)PROFILER_POLL_MS);
+    return wait;
+}
 
-    // 画面更新
-    updateDisplay();
+// 前回呼び出しからのライブ側の送信量・エンコード時間と履歴の未処理量
+void logLiveStats() {
+    static unsigned long lastLog = 0;
 
-    // タッチ処理
-    static bool lastTouchState = false;
-    TouchPoint_t pos = M5.Touch.getPressPoint();
-    bool touching = (pos.x > 0 && pos.y > 0);
+    unsigned long now = millis();
+    if (lastLog != 0 && liveSamples > 0) {
+        float seconds = (now - lastLog) / 1000.0f;
+        Serial.printf("[live] %s %.1f kB/s, encode %.0f us/frame, cpu %.2f%%, backlog max %u ms, skipped %u samples\n",
+                      streamMode == LINK_MODE_FEATURES ? "log-mel" : "ADPCM", liveBytes / seconds / 1000.0f,
+                      (float)liveEncodeUs / (liveSamples / (float)streamFrameSamples), liveEncodeUs / 10.0f / (seconds * 1000.0f),
+                      liveBacklogMax * 1000 / SAMPLE_RATE, liveSkipped);
+    }
 
-    // CONNECTボタン判定（画面下部中央）
-    if (!btConnected && !btDiscoverable && touching && !lastTouchState) {
-        if (pos.x >= 70 && pos.x <= 250 && pos.y >= 190 && pos.y <= 240) {
-            // ボタン押下フィードバック
-            drawModernButton(70, 190, 180, 50, "CONNECT", TFT_DARKGREY, true);
-            delay(100);
-
-            // 接続モード有効化
-            btDiscoverable = true;
-            discoverableStartTime = millis();
-            SerialBT.enableSSP();  // ペアリングモード有効
-            Serial.println("Connection mode enabled for 60 seconds");
-            needsFullRedraw = true;  // 状態変化で再描画
-            delay(200);
-        }
+    liveSamples = liveBytes = liveSkipped = liveBacklogMax = 0;
+    liveEncodeUs = 0;
+    lastLog = now;
+}
+
+void loop() {
+    static unsigned long lastPowerEval = 0;
+
+    // イベント（BT スタック・タッチ・タイマー・ウェイクワード）
+    // 接続中は送信がキャプチャ待ちでブロックするので覗くだけ、それ以外は次の期限までブロックして待つ
+    bool connected = linkState() == LINK_STATE_CONNECTED;
+    TickType_t wait = connected ? 0 : pdMS_TO_TICKS(idleWaitMs(lastPowerEval));
+    LinkEventRecord event;
+    while (linkStateNext(event, wait)) {
+        handleEvent(event);
+        wait = 0;
     }
+    connected = linkState() == LINK_STATE_CONNECTED;
 
-    // STOPボタン判定（画面右下）
-    if (btConnected && touching && !lastTouchState) {
-        if (pos.x >= 195 && pos.x <= 305 && pos.y >= 185 && pos.y <= 230) {
-            // ボタン押下フィードバック
-            drawModernButton(195, 185, 110, 45, "STOP", TFT_MAROON, true);
-            delay(100);
-
-            // 切断
-            SerialBT.disconnect();
-            btConnected = false;
-            btDiscoverable = false;
-            Serial.println("Disconnected by user");
-            needsFullRedraw = true;  // 状態変化で再描画
-            delay(200);
+    // 省電力ポリシー
+    if (millis() - lastPowerEval >= POWER_EVAL_INTERVAL_MS) {
+        I2cPowerSnapshot power = readPower();
+        if (powerPolicyUpdate(power.batteryLevel, power.batteryCurrentMa, power.temperatureC, millis())) {
+            applyPowerTier();
         }
+        lastPowerEval = millis();
     }
 
-    lastTouchState = touching;
+    // 設定ごとの消費電力の計測（-DENERGY_BENCH=1 のビルドのみ）
+    const EnergyScenario* scenario;
+    if (energyBenchPoll(scenario)) applyEnergyScenario(scenario);
+
+    // 消灯中の一時点灯の終了
+    if (!powerPolicyConfig().screenOn && screenOn && millis() >= screenWakeUntil) {
+        setScreen(false);
+    }
 
-    // 接続可能モードのタイムアウト
-    if (btDiscoverable && !btConnected) {
-        if (millis() - discoverableStartTime > DISCOVERABLE_DURATION) {
-            btDiscoverable = false;
-            needsFullRedraw = true;  // 状態変化で再描画
-            Serial.println("Connection mode timeout");
+    // 画面更新
+    if (screenOn) updateDisplay();
+
+    // モニター音量・ミュート（画面下のタッチボタン A: 音量- / B: ミュート / C: 音量+）
+    if (sidetoneEnabled()) {
+        bool changed = true;
+        uint8_t buttons = i2cBusTakeButtons();
+        if (buttons & I2C_BUTTON_A) {
+            sidetoneSetVolume(sidetoneVolume() - SIDETONE_VOLUME_STEP);
+        } else if (buttons & I2C_BUTTON_B) {
+            sidetoneSetMuted(!sidetoneMuted());
+        } else if (buttons & I2C_BUTTON_C) {
+            sidetoneSetVolume(sidetoneVolume() + SIDETONE_VOLUME_STEP);
+        } else {
+            changed = false;
+        }
+        if (changed) drawStatusBar();
+
+        static unsigned long lastSidetoneStats = 0;
+        if (millis() - lastSidetoneStats > 10000) {
+            sidetoneLogStats();
+            lastSidetoneStats = millis();
         }
     }
 
+    // 受信側からの制御フレーム
+    transportPoll();
+
+    // プロファイラのコマンド（-DPROFILER=1 のビルドのみ）
+    profilerPoll();
+
+    // 履歴リングから SD へ（未接続の間、RECORDER_ARCHIVE では接続中も。ライブとは別のカーソルで読む）
+    pollRecorder();
+
+    // ファームウェア更新中は音声を送らず、受信だけを回す
+    otaUpdatePoll();
+    if (connected && otaUpdateActive()) {
+        return;
+    }
+
     // Bluetooth接続中のみストリーミング
-    if (btConnected) {
-        size_t bytesRead;
-
-        // マイクから音声データ読み込み
-        esp_err_t result = i2s_read(
-            Speak_I2S_NUMBER,
-            audioBuffer,
-            DATA_SIZE,
-            &bytesRead,
-            portMAX_DELAY
-        );
+    if (connected) {
+        // 1 フレーム分たまるまで待つ（送信単位はキャプチャのブロックではなく受信側が選んだフレーム長）
+        uint32_t timestamp = streamCursor;
+        size_t count = 0;
+        if (captureWriteIndex() - streamCursor < streamFrameSamples) {
+            // たまるまでの間は履歴の再送と録音の同期を進める（無ければ待つ）
+            uint32_t backlog = captureWriteIndex() - streamCursor;
+            if (!replaySendNext(backlog) && !recorderSendNext(backlog)) {
+                captureWaitData(pdMS_TO_TICKS(min((uint32_t)50, transportFlushWaitMs())));
+            }
+        } else {
+            // 履歴リングから読み出し
+            uint32_t dropped = 0;
+            count = captureRead(streamCursor, (int16_t*)audioBuffer, streamFrameSamples, &dropped);
+            if (dropped > 0) {
+                Serial.printf("Warning: Send fell behind, %u samples skipped\n", dropped);
+                timestamp += dropped;
+            }
+            uint32_t backlog = captureWriteIndex() - streamCursor + count;
+            if (backlog > liveBacklogMax) liveBacklogMax = backlog;
+            liveSkipped += dropped;
+        }
+
+        if (count > 0) {
+            size_t bytesRead = count * 2;
 
-        if (result == ESP_OK && bytesRead > 0) {
             // 音声レベル計算
             if (millis() - lastAudioUpdate > 50) {
                 calculateAudioLevel(audioBuffer, bytesRead);
                 lastAudioUpdate = millis();
             }
 
-            // Bluetooth経由で送信（複数回に分けて確実に送る）
-            size_t totalWritten = 0;
-            while (totalWritten < bytesRead && btConnected) {
-                size_t written = SerialBT.write(audioBuffer + totalWritten, bytesRead - totalWritten);
-                if (written > 0) {
-                    totalWritten += written;
-                } else {
-                    delay(1);  // 送信キューが空くまで待つ
+            liveSamples += count;
+            if (streamMode == LINK_MODE_FEATURES) {
+                // log-mel を計算し、バッチごとに送信（計算時間は送信待ちを含まない featuresGetStats() から）
+                FeatureStats before, after;
+                featuresGetStats(before);
+                featuresProcess((int16_t*)audioBuffer, count, timestamp);
+                featuresGetStats(after);
+                liveEncodeUs += after.computeUs - before.computeUs;
+                liveBytes += after.payloadBytes - before.payloadBytes;
+            } else if (streamMode == LINK_MODE_ADPCM || powerPolicyConfig().adpcm || RECORDER_ARCHIVE) {
+                // 受信側の選択・省電力ティア・二系統のライブ側: ADPCM（送信量 1/4）
+                uint32_t start = micros();
+                HotPathMark mark;
+                hotPathBegin(mark);
+                size_t length = adpcmEncode(adpcmState, (int16_t*)audioBuffer, count, adpcmBuffer);
+                hotPathEnd(HOT_ADPCM, mark);
+                liveEncodeUs += micros() - start;
+                liveBytes += length;
+                if (!transportSendFrame(LINK_FRAME_AUDIO_ADPCM, 0, adpcmBuffer, length, timestamp)) {
+                    Serial.printf("Warning: Frame dropped (%d bytes)\n", length);
                 }
+            } else if (!transportSendFrame(LINK_FRAME_AUDIO_PCM16, 0, audioBuffer, bytesRead, timestamp)) {
+                // Bluetooth経由で送信（フレーム単位、送り切るまでブロック）
+                Serial.printf("Warning: Frame dropped (%d bytes)\n", bytesRead);
             }
 
-            if (totalWritten != bytesRead) {
-                Serial.printf("Warning: Only wrote %d/%d bytes\n", totalWritten, bytesRead);
+            // 接続から最初の音声フレームまで
+            if (firstFramePending) {
+                linkStateTraceNote("first audio frame");
+                firstFramePending = false;
             }
+
+            // ライブ 1 フレームごとに再送か同期を 1 フレーム（ライブが遅れていれば送らない）
+            uint32_t backlog = captureWriteIndex() - streamCursor;
+            if (!replaySendNext(backlog)) recorderSendNext(backlog);
+        }
+
+        // 話者交代マーカー
+        speakerMarkerSendPending();
+
+        // 遅延計測のチャープ（鳴らす・探す・マーカーを送る）
+        latencyProbePoll(streamCursor);
+
+        // 送信路の統計（SPP / BLE のスループットと電流の比較用）
+        static unsigned long lastLinkStats = 0;
+        if (millis() - lastLinkStats > 10000) {
+            transportLogStats(readPower().batteryCurrentMa);
+            captureLogStats();
+            i2cBusLogStats();
+            if (streamMode == LINK_MODE_FEATURES) featuresLogStats();
+            speakerMarkerLogStats();
+            hotPathLogStats();
+            if (RECORDER_ARCHIVE) {
+                logLiveStats();
+                recorderLogStats();
+            }
+            lastLinkStats = millis();
         }
     } else {
-        // 接続待機中は少し待つ
-        delay(100);
+        // 待機中の推論コストと電流（ウェイクワード有効時）
+        static unsigned long lastKwsStats = 0;
+        if (kwsEnabled() && millis() - lastKwsStats > 30000) {
+            kwsLogStats(readPower().batteryCurrentMa);
+            lastKwsStats = millis();
+        }
     }
 }
@@ -0,0 +1,256 @@
+/**
+ * log-mel / MFCC フロントエンドの実装
+ */
+#include "mel_frontend.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hot_placement.h"
+
+#if defined(ESP_PLATFORM)
+#include "esp_dsp.h"
+#define MEL_USE_ESP_DSP 1
+#else
+#define MEL_USE_ESP_DSP 0
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static float hzToMel(float hz) {
+    return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+static float melToHz(float mel) {
+    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+#if MEL_USE_ESP_DSP
+static bool fftTableReady = false;
+#else
+// ホスト用の基数 2 FFT（複素インターリーブ、in-place）
+HOT_FUNC(FEATURES) static void fftRadix2(float* data, int n) {
+    // ビット反転並べ替え
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            float tr = data[2 * i], ti = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = tr;
+            data[2 * j + 1] = ti;
+        }
+    }
+
+    for (int len = 2; len <= n; len <<= 1) {
+        float angle = -2.0f * (float)M_PI / len;
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < len / 2; k++) {
+                float wr = cosf(angle * k), wi = sinf(angle * k);
+                float* a = data + 2 * (i + k);
+                float* b = data + 2 * (i + k + len / 2);
+                float br = b[0] * wr - b[1] * wi;
+                float bi = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - br;
+                b[1] = a[1] - bi;
+                a[0] += br;
+                a[1] += bi;
+            }
+        }
+    }
+}
+#endif
+
+// esp-dsp の FFT はライブラリのままフラッシュに置かれるので、呼ぶだけのこの関数は IRAM に置かない
+static void runFft(float* data, int n) {
+#if MEL_USE_ESP_DSP
+    dsps_fft2r_fc32(data, n);
+    dsps_bit_rev_fc32(data, n);
+#else
+    fftRadix2(data, n);
+#endif
+}
+
+bool melFrontendInit(MelFrontend& fe, const MelFrontendConfig& cfg) {
+    fe.cfg = cfg;
+    int bins = cfg.fftSize / 2 + 1;
+    if (cfg.numMels <= 0 || cfg.numMels > MEL_MAX_MELS) return false;
+
+#if MEL_USE_ESP_DSP
+    if (!fftTableReady) {
+        if (dsps_fft2r_init_fc32(NULL, CONFIG_DSP_MAX_FFT_SIZE) != ESP_OK) return false;
+        fftTableReady = true;
+    }
+#endif
+
+    fe.window = (float*)malloc(cfg.frameLength * sizeof(float));
+    fe.fftBuf = (float*)malloc(cfg.fftSize * 2 * sizeof(float));
+    fe.power = (float*)malloc(bins * sizeof(float));
+    fe.bandStart = (int16_t*)malloc(cfg.numMels * sizeof(int16_t));
+    fe.bandLength = (int16_t*)malloc(cfg.numMels * sizeof(int16_t));
+    fe.weightOffset = (int16_t*)malloc(cfg.numMels * sizeof(int16_t));
+    fe.frame = (int16_t*)malloc(cfg.frameLength * sizeof(int16_t));
+    if (!fe.window || !fe.fftBuf || !fe.power || !fe.bandStart || !fe.bandLength ||
+        !fe.weightOffset || !fe.frame) {
+        melFrontendFree(fe);
+        return false;
+    }
+
+    // Hann 窓（periodic）
+    for (int i = 0; i < cfg.frameLength; i++) {
+        fe.window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / cfg.frameLength);
+    }
+
+    // メル帯域の境界（numMels + 2 点）をビン番号（小数）に変換
+    float melLow = hzToMel(cfg.fMin);
+    float melHigh = hzToMel(cfg.fMax);
+    float binHz = (float)cfg.sampleRate / cfg.fftSize;
+    float* edges = (float*)malloc((cfg.numMels + 2) * sizeof(float));
+    if (!edges) {
+        melFrontendFree(fe);
+        return false;
+    }
+    for (int m = 0; m < cfg.numMels + 2; m++) {
+        edges[m] = melToHz(melLow + (melHigh - melLow) * m / (cfg.numMels + 1)) / binHz;
+    }
+
+    // 非ゼロ区間だけ重みを持つ（疎な三角フィルタ）
+    int totalWeights = 0;
+    for (int m = 0; m < cfg.numMels; m++) {
+        int start = (int)ceilf(edges[m]);
+        int end = (int)floorf(edges[m + 2]);
+        if (end >= bins) end = bins - 1;
+        if (end < start) end = start;
+        fe.bandStart[m] = start;
+        fe.bandLength[m] = end - start + 1;
+        fe.weightOffset[m] = totalWeights;
+        totalWeights += fe.bandLength[m];
+    }
+
+    fe.weights = (float*)malloc(totalWeights * sizeof(float));
+    if (!fe.weights) {
+        free(edges);
+        melFrontendFree(fe);
+        return false;
+    }
+    for (int m = 0; m < cfg.numMels; m++) {
+        float left = edges[m], center = edges[m + 1], right = edges[m + 2];
+        for (int k = 0; k < fe.bandLength[m]; k++) {
+            float bin = fe.bandStart[m] + k;
+            float w = 0.0f;
+            if (bin >= left && bin <= center && center > left) {
+                w = (bin - left) / (center - left);
+            } else if (bin > center && bin <= right && right > center) {
+                w = (right - bin) / (right - center);
+            }
+            fe.weights[fe.weightOffset[m] + k] = w;
+        }
+    }
+    free(edges);
+
+    melFrontendReset(fe, 0);
+    return true;
+}
+
+void melFrontendFree(MelFrontend& fe) {
+    free(fe.window);
+    free(fe.fftBuf);
+    free(fe.power);
+    free(fe.bandStart);
+    free(fe.bandLength);
+    free(fe.weightOffset);
+    free(fe.weights);
+    free(fe.frame);
+    fe.window = fe.fftBuf = fe.power = fe.weights = nullptr;
+    fe.bandStart = fe.bandLength = fe.weightOffset = fe.frame = nullptr;
+}
+
+void melFrontendReset(MelFrontend& fe, uint32_t nextIndex) {
+    fe.filled = 0;
+    fe.nextFrameIndex = nextIndex;
+}
+
+HOT_FUNC(FEATURES) void melFrontendCompute(MelFrontend& fe, const int16_t* frame, float* logMel) {
+    const MelFrontendConfig& cfg = fe.cfg;
+    const float scale = 1.0f / 32768.0f;
+
+    // 窓掛け（虚部 0、残りはゼロ詰め）
+    for (int i = 0; i < cfg.frameLength; i++) {
+        fe.fftBuf[2 * i] = frame[i] * scale * fe.window[i];
+        fe.fftBuf[2 * i + 1] = 0.0f;
+    }
+    memset(fe.fftBuf + 2 * cfg.frameLength, 0, (cfg.fftSize - cfg.frameLength) * 2 * sizeof(float));
+
+    runFft(fe.fftBuf, cfg.fftSize);
+
+    int bins = cfg.fftSize / 2 + 1;
+    for (int k = 0; k < bins; k++) {
+        float re = fe.fftBuf[2 * k], im = fe.fftBuf[2 * k + 1];
+        fe.power[k] = re * re + im * im;
+    }
+
+    for (int m = 0; m < cfg.numMels; m++) {
+        const float* w = fe.weights + fe.weightOffset[m];
+        const float* p = fe.power + fe.bandStart[m];
+        float energy = 0.0f;
+        for (int k = 0; k < fe.bandLength[m]; k++) {
+            energy += w[k] * p[k];
+        }
+        logMel[m] = logf(energy + 1e-10f);
+    }
+}
+
+HOT_FUNC(FEATURES) void melFrontendPush(MelFrontend& fe, const int16_t* samples, size_t count, uint32_t firstIndex,
+                     MelFrameHandler handler, void* context) {
+    const MelFrontendConfig& cfg = fe.cfg;
+
+    // 途中でサンプルが途切れた場合は蓄積をやり直す
+    if (firstIndex != fe.nextFrameIndex + fe.filled) {
+        melFrontendReset(fe, firstIndex);
+    }
+
+    float logMel[MEL_MAX_MELS];
+    size_t offset = 0;
+    while (offset < count) {
+        size_t n = cfg.frameLength - fe.filled;
+        if (n > count - offset) n = count - offset;
+        memcpy(fe.frame + fe.filled, samples + offset, n * sizeof(int16_t));
+        fe.filled += n;
+        offset += n;
+
+        if (fe.filled == cfg.frameLength) {
+            melFrontendCompute(fe, fe.frame, logMel);
+            handler(logMel, fe.nextFrameIndex, context);
+
+            memmove(fe.frame, fe.frame + cfg.hopLength, (cfg.frameLength - cfg.hopLength) * sizeof(int16_t));
+            fe.filled -= cfg.hopLength;
+            fe.nextFrameIndex += cfg.hopLength;
+        }
+    }
+}
+
+void melToMfcc(const float* logMel, int numMels, float* mfcc, int numCoeffs) {
+    for (int c = 0; c < numCoeffs; c++) {
+        float sum = 0.0f;
+        for (int m = 0; m < numMels; m++) {
+            sum += logMel[m] * cosf((float)M_PI * c * (m + 0.5f) / numMels);
+        }
+        mfcc[c] = sum * sqrtf((c == 0 ? 1.0f : 2.0f) / numMels);
+    }
+}
+
+size_t melFrontendMemory(const MelFrontend& fe) {
+    const MelFrontendConfig& cfg = fe.cfg;
+    size_t weights = 0;
+    for (int m = 0; m < cfg.numMels; m++) weights += fe.bandLength[m];
+    return cfg.frameLength * (sizeof(float) + sizeof(int16_t)) +
+           cfg.fftSize * 2 * sizeof(float) +
+           (cfg.fftSize / 2 + 1) * sizeof(float) +
+           cfg.numMels * 3 * sizeof(int16_t) +
+           weights * sizeof(float);
+}
@@ -0,0 +1,63 @@
+/**
+ * log-mel / MFCC フロントエンド
+ *
+ * 窓長・ホップ・FFT 長・メル帯域数を設定で切り替えられるので、
+ * ウェイクワード（40 帯域 / 40ms 窓 / 20ms ホップ）と
+ * 特徴量送信モード（80 帯域 / 25ms 窓 / 10ms ホップ）で共用する。
+ *
+ * FFT は ESP32 では esp-dsp、ホストでは同じ結果になる基数 2 の実装を使う。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MEL_MAX_MELS  128   // melFrontendPush() の作業領域の大きさ
+
+struct MelFrontendConfig {
+    int sampleRate;
+    int frameLength;    // 窓長（サンプル）
+    int hopLength;      // ホップ（サンプル）
+    int fftSize;        // 2 のべき乗、frameLength 以上
+    int numMels;        // 1..MEL_MAX_MELS
+    float fMin;
+    float fMax;
+};
+
+struct MelFrontend {
+    MelFrontendConfig cfg;
+
+    float* window = nullptr;        // Hann 窓（frameLength）
+    float* fftBuf = nullptr;        // 複素インターリーブ（fftSize * 2）
+    float* power = nullptr;         // パワースペクトル（fftSize / 2 + 1）
+
+    // 三角フィルタ：帯域 m はビン bandStart[m] から bandLength[m] 本、重みは weights[weightOffset[m]..]
+    int16_t* bandStart = nullptr;
+    int16_t* bandLength = nullptr;
+    int16_t* weightOffset = nullptr;
+    float* weights = nullptr;
+
+    int16_t* frame = nullptr;       // 入力の蓄積（frameLength）
+    int filled = 0;                 // frame に溜まっているサンプル数
+    uint32_t nextFrameIndex = 0;    // 次に出すフレームの先頭サンプル番号
+};
+
+// log-mel 1 フレームごとに呼ばれる（frameIndex はフレーム先頭のサンプル番号）
+typedef void (*MelFrameHandler)(const float* logMel, uint32_t frameIndex, void* context);
+
+bool melFrontendInit(MelFrontend& fe, const MelFrontendConfig& cfg);
+void melFrontendFree(MelFrontend& fe);
+void melFrontendReset(MelFrontend& fe, uint32_t nextIndex);
+
+// サンプルを追加し、ホップごとに log-mel を handler に渡す
+void melFrontendPush(MelFrontend& fe, const int16_t* samples, size_t count, uint32_t firstIndex,
+                     MelFrameHandler handler, void* context);
+
+// 1 フレーム分（frameLength サンプル）から log-mel を計算
+void melFrontendCompute(MelFrontend& fe, const int16_t* frame, float* logMel);
+
+// log-mel → MFCC（DCT-II、直交正規化）
+void melToMfcc(const float* logMel, int numMels, float* mfcc, int numCoeffs);
+
+// 確保しているメモリ量（バイト）
+size_t melFrontendMemory(const MelFrontend& fe);
@@ -0,0 +1,145 @@
+/**
+ * 差分ファームウェアの適用（M5D1 形式）
+ */
+#include "ota_delta.h"
+
+#include <string.h>
+
+enum ApplierState : uint8_t {
+    STATE_HEADER,
+    STATE_OP,
+    STATE_COPY_ARGS,
+    STATE_DATA_ARGS,
+    STATE_DATA,
+    STATE_DONE,
+    STATE_FAILED,
+};
+
+static uint32_t readLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool fail(OtaDeltaApplier& a, OtaDeltaError error) {
+    a.error = error;
+    a.state = STATE_FAILED;
+    return false;
+}
+
+// 読みかけ（ヘッダー・命令の引数）を need バイトまでためる（そろったら true）
+static bool fillPending(OtaDeltaApplier& a, const uint8_t*& data, size_t& length, size_t need) {
+    size_t n = need - a.pendingLength;
+    if (n > length) n = length;
+    memcpy(a.pending + a.pendingLength, data, n);
+    a.pendingLength += n;
+    data += n;
+    length -= n;
+    if (a.pendingLength < need) return false;
+    a.pendingLength = 0;
+    return true;
+}
+
+static bool applyCopy(OtaDeltaApplier& a, uint32_t srcOffset, uint32_t count) {
+    if (srcOffset > a.info.sourceSize || count > a.info.sourceSize - srcOffset ||
+        count > a.info.targetSize - a.targetOffset) {
+        return fail(a, OTA_DELTA_ERR_FORMAT);
+    }
+
+    uint8_t buf[OTA_DELTA_COPY_CHUNK];
+    while (count > 0) {
+        size_t n = count < sizeof(buf) ? count : sizeof(buf);
+        if (!a.io.readSource(a.io.context, srcOffset, buf, n) ||
+            !a.io.writeTarget(a.io.context, a.targetOffset, buf, n)) {
+            return fail(a, OTA_DELTA_ERR_IO);
+        }
+        srcOffset += n;
+        a.targetOffset += n;
+        count -= n;
+    }
+    return true;
+}
+
+void otaDeltaBegin(OtaDeltaApplier& a, const OtaDeltaIo& io) {
+    memset(&a, 0, sizeof(a));
+    a.io = io;
+    a.state = STATE_HEADER;
+}
+
+bool otaDeltaPush(OtaDeltaApplier& a, const uint8_t* data, size_t length) {
+    if (a.state == STATE_FAILED) return false;
+    a.consumed += length;
+
+    while (length > 0) {
+        switch (a.state) {
+        case STATE_HEADER:
+            if (!fillPending(a, data, length, OTA_DELTA_HEADER_SIZE)) break;
+            if (memcmp(a.pending, OTA_DELTA_MAGIC, 4) != 0) return fail(a, OTA_DELTA_ERR_FORMAT);
+            a.info.sourceSize = readLe32(a.pending + 4);
+            memcpy(a.info.sourceSha256, a.pending + 8, 32);
+            a.info.targetSize = readLe32(a.pending + 40);
+            memcpy(a.info.targetSha256, a.pending + 44, 32);
+            if (a.io.checkSource && !a.io.checkSource(a.io.context, a.info)) {
+                return fail(a, OTA_DELTA_ERR_SOURCE);
+            }
+            a.state = STATE_OP;
+            break;
+
+        case STATE_OP: {
+            uint8_t op = *data++;
+            length--;
+            if (op == OTA_DELTA_OP_COPY) {
+                a.state = STATE_COPY_ARGS;
+            } else if (op == OTA_DELTA_OP_DATA) {
+                a.state = STATE_DATA_ARGS;
+            } else if (op == OTA_DELTA_OP_END) {
+                a.state = STATE_DONE;
+            } else {
+                return fail(a, OTA_DELTA_ERR_FORMAT);
+            }
+            break;
+        }
+
+        case STATE_COPY_ARGS:
+            if (!fillPending(a, data, length, 8)) break;
+            if (!applyCopy(a, readLe32(a.pending), readLe32(a.pending + 4))) return false;
+            a.state = STATE_OP;
+            break;
+
+        case STATE_DATA_ARGS:
+            if (!fillPending(a, data, length, 4)) break;
+            a.remaining = readLe32(a.pending);
+            if (a.remaining > a.info.targetSize - a.targetOffset) return fail(a, OTA_DELTA_ERR_FORMAT);
+            a.state = a.remaining > 0 ? STATE_DATA : STATE_OP;
+            break;
+
+        case STATE_DATA: {
+            size_t n = length < a.remaining ? length : a.remaining;
+            if (!a.io.writeTarget(a.io.context, a.targetOffset, data, n)) return fail(a, OTA_DELTA_ERR_IO);
+            a.targetOffset += n;
+            a.remaining -= n;
+            data += n;
+            length -= n;
+            if (a.remaining == 0) a.state = STATE_OP;
+            break;
+        }
+
+        default:
+            // END の後にデータが続いている
+            return fail(a, OTA_DELTA_ERR_FORMAT);
+        }
+    }
+    return true;
+}
+
+bool otaDeltaFinished(const OtaDeltaApplier& a) {
+    return a.state == STATE_DONE && a.targetOffset == a.info.targetSize;
+}
+
+const char* otaDeltaErrorName(OtaDeltaError error) {
+    switch (error) {
+    case OTA_DELTA_OK:         return "ok";
+    case OTA_DELTA_ERR_FORMAT: return "bad delta";
+    case OTA_DELTA_ERR_SOURCE: return "source image mismatch";
+    case OTA_DELTA_ERR_IO:     return "flash I/O";
+    }
+    return "?";
+}
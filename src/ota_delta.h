@@ -0,0 +1,77 @@
+/**
+ * 差分ファームウェアの適用（M5D1 形式）
+ *
+ * 動作中のイメージ（元）と差分から新しいイメージを先頭から順に組み立てる。
+ * 差分は tools/mkdelta.py で作る。すべて LE。
+ *
+ *   [0-3]    "M5D1"
+ *   [4-7]    元イメージのバイト数
+ *   [8-39]   元イメージの SHA-256
+ *   [40-43]  新イメージのバイト数
+ *   [44-75]  新イメージの SHA-256
+ *   [76..]   命令の並び
+ *              0x01 COPY  [srcOffset u32][length u32]   元イメージから複製
+ *              0x02 DATA  [length u32][bytes...]         そのまま書き込む
+ *              0x00 END
+ *
+ * 差分は任意の位置で分割して otaDeltaPush() に渡してよい（受信チャンクの境界と命令の境界は無関係）。
+ * 元の読み出しと新の書き込みはコールバックなので、実機（esp_partition）でも Linux の検証ツールでも使える。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define OTA_DELTA_MAGIC        "M5D1"
+#define OTA_DELTA_HEADER_SIZE  76
+#define OTA_DELTA_COPY_CHUNK   512     // COPY で 1 回に読み書きするバイト数
+
+enum OtaDeltaOp : uint8_t {
+    OTA_DELTA_OP_END  = 0x00,
+    OTA_DELTA_OP_COPY = 0x01,
+    OTA_DELTA_OP_DATA = 0x02,
+};
+
+enum OtaDeltaError : uint8_t {
+    OTA_DELTA_OK = 0,
+    OTA_DELTA_ERR_FORMAT,      // 壊れた差分（未知の命令、範囲外の COPY、END の後のデータ）
+    OTA_DELTA_ERR_SOURCE,      // 元イメージが差分の想定と違う
+    OTA_DELTA_ERR_IO,          // 読み出し／書き込みの失敗
+};
+
+struct OtaDeltaInfo {
+    uint32_t sourceSize;
+    uint8_t sourceSha256[32];
+    uint32_t targetSize;
+    uint8_t targetSha256[32];
+};
+
+struct OtaDeltaIo {
+    void* context;
+    bool (*readSource)(void* context, uint32_t offset, uint8_t* out, size_t length);
+    bool (*writeTarget)(void* context, uint32_t offset, const uint8_t* data, size_t length);
+    // ヘッダーを読んだ時点で呼ばれる（元イメージの照合、false で OTA_DELTA_ERR_SOURCE）
+    bool (*checkSource)(void* context, const OtaDeltaInfo& info);
+};
+
+struct OtaDeltaApplier {
+    OtaDeltaIo io;
+    OtaDeltaInfo info;
+    uint8_t state;
+    uint8_t pending[OTA_DELTA_HEADER_SIZE];   // ヘッダー・命令の読みかけ
+    uint8_t pendingLength;
+    uint32_t remaining;                       // DATA の残りバイト数
+    uint32_t targetOffset;                    // 次に書き込む位置
+    uint32_t consumed;                        // 受け取った差分のバイト数
+    OtaDeltaError error;
+};
+
+void otaDeltaBegin(OtaDeltaApplier& a, const OtaDeltaIo& io);
+
+// 差分の続きを渡す（エラーになったら false、以後は何もしない）
+bool otaDeltaPush(OtaDeltaApplier& a, const uint8_t* data, size_t length);
+
+// END まで読み、新イメージのバイト数どおりに書き終えたか
+bool otaDeltaFinished(const OtaDeltaApplier& a);
+
+const char* otaDeltaErrorName(OtaDeltaError error);
@@ -0,0 +1,291 @@
+/**
+ * Bluetooth 経由のファームウェア更新
+ */
+#include "ota_update.h"
+
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include "ota_delta.h"
+#include "transport.h"
+
+struct OtaSession {
+    bool active;
+    uint8_t kind;                    // LinkOtaKind
+    uint32_t payloadSize;            // 送られてくるバイト数（差分ならその大きさ）
+    uint32_t targetSize;
+    uint8_t targetSha256[32];
+    uint32_t received;               // 受け取り済み（次に受け取る位置）
+    uint32_t erasedEnd;              // 書き込み先の消去済み範囲
+    uint32_t nextProgress;           // 次に進捗を出力する位置
+    const esp_partition_t* target;
+    const esp_partition_t* running;
+    OtaDeltaApplier delta;
+    unsigned long startMs;
+    unsigned long lastRxMs;
+    uint32_t resumes;
+    uint32_t rewinds;
+};
+
+static OtaSession session = {};
+static unsigned long rebootAt = 0;
+
+// 動作中のイメージの SHA-256（差分の元の照合用、大きさごとに 1 回だけ計算する）
+static uint32_t runningShaSize = 0;
+static uint8_t runningSha256[32];
+
+static uint32_t readLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void sendStatus(LinkOtaStatus status, uint32_t offset) {
+    uint8_t payload[6] = {
+        LINK_OTA_STATUS, status,
+        (uint8_t)offset, (uint8_t)(offset >> 8), (uint8_t)(offset >> 16), (uint8_t)(offset >> 24),
+    };
+    transportSendFrame(LINK_FRAME_OTA, 0, payload, sizeof(payload), 0);
+}
+
+static bool partitionSha256(const esp_partition_t* partition, uint32_t size, uint8_t out[32]) {
+    static uint8_t buf[1024];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+
+    bool ok = true;
+    for (uint32_t offset = 0; offset < size; offset += sizeof(buf)) {
+        size_t n = min((uint32_t)sizeof(buf), size - offset);
+        if (esp_partition_read(partition, offset, buf, n) != ESP_OK) {
+            ok = false;
+            break;
+        }
+        mbedtls_sha256_update(&ctx, buf, n);
+    }
+    mbedtls_sha256_finish(&ctx, out);
+    mbedtls_sha256_free(&ctx);
+    return ok;
+}
+
+// ------------------------------------------------------------
+// 差分適用のコールバック
+// ------------------------------------------------------------
+
+static bool readRunning(void* context, uint32_t offset, uint8_t* out, size_t length) {
+    return esp_partition_read(session.running, offset, out, length) == ESP_OK;
+}
+
+static bool writeTarget(void* context, uint32_t offset, const uint8_t* data, size_t length) {
+    // 書き込み位置の手前まで消去しておく
+    while (offset + length > session.erasedEnd) {
+        uint32_t block = min((uint32_t)OTA_ERASE_BLOCK, session.target->size - session.erasedEnd);
+        if (block == 0 || esp_partition_erase_range(session.target, session.erasedEnd, block) != ESP_OK) {
+            return false;
+        }
+        session.erasedEnd += block;
+    }
+    return esp_partition_write(session.target, offset, data, length) == ESP_OK;
+}
+
+static bool checkRunning(void* context, const OtaDeltaInfo& info) {
+    if (info.sourceSize > session.running->size || info.targetSize != session.targetSize ||
+        memcmp(info.targetSha256, session.targetSha256, 32) != 0) {
+        return false;
+    }
+    if (runningShaSize != info.sourceSize) {
+        unsigned long start = millis();
+        if (!partitionSha256(session.running, info.sourceSize, runningSha256)) return false;
+        runningShaSize = info.sourceSize;
+        Serial.printf("[ota] running image hashed in %lu ms\n", millis() - start);
+    }
+    if (memcmp(runningSha256, info.sourceSha256, 32) != 0) {
+        Serial.println("[ota] delta was made against a different image");
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// コマンド
+// ------------------------------------------------------------
+
+static void abortSession(LinkOtaStatus status, const char* reason) {
+    Serial.printf("[ota] failed at %u/%u: %s\n", session.received, session.payloadSize, reason);
+    session.active = false;
+    sendStatus(status, session.received);
+}
+
+static void handleBegin(const uint8_t* payload, uint16_t length) {
+    if (length < 42) {
+        sendStatus(LINK_OTA_ERR_FORMAT, 0);
+        return;
+    }
+    uint8_t kind = payload[1];
+    uint32_t payloadSize = readLe32(payload + 2);
+    uint32_t targetSize = readLe32(payload + 6);
+    const uint8_t* targetSha = payload + 10;
+
+    // 同じ更新の途中なら続きから
+    if (session.active && session.kind == kind && session.payloadSize == payloadSize &&
+        session.targetSize == targetSize && memcmp(session.targetSha256, targetSha, 32) == 0) {
+        session.resumes++;
+        session.lastRxMs = millis();
+        Serial.printf("[ota] resuming at %u/%u\n", session.received, payloadSize);
+        sendStatus(LINK_OTA_OK, session.received);
+        return;
+    }
+
+    memset(&session, 0, sizeof(session));
+    session.running = esp_ota_get_running_partition();
+    session.target = esp_ota_get_next_update_partition(nullptr);
+    if (session.target == nullptr || targetSize > session.target->size) {
+        Serial.println("[ota] no OTA slot large enough (partition table without ota_1?)");
+        sendStatus(LINK_OTA_ERR_NO_SLOT, 0);
+        return;
+    }
+    if (kind == LINK_OTA_FULL ? payloadSize != targetSize : kind != LINK_OTA_DELTA) {
+        sendStatus(LINK_OTA_ERR_FORMAT, 0);
+        return;
+    }
+
+    session.active = true;
+    session.kind = kind;
+    session.payloadSize = payloadSize;
+    session.targetSize = targetSize;
+    memcpy(session.targetSha256, targetSha, 32);
+    session.nextProgress = payloadSize / 10;
+    session.startMs = session.lastRxMs = millis();
+
+    OtaDeltaIo io = { nullptr, readRunning, writeTarget, checkRunning };
+    otaDeltaBegin(session.delta, io);
+
+    Serial.printf("[ota] %s update: %u bytes for a %u byte image, %s -> %s\n",
+                  kind == LINK_OTA_DELTA ? "delta" : "full", payloadSize, targetSize,
+                  session.running->label, session.target->label);
+    sendStatus(LINK_OTA_OK, 0);
+}
+
+static void handleData(const uint8_t* payload, uint16_t length) {
+    if (!session.active || length < 5) {
+        sendStatus(LINK_OTA_ERR_STATE, 0);
+        return;
+    }
+    session.lastRxMs = millis();
+
+    uint32_t offset = readLe32(payload + 1);
+    const uint8_t* data = payload + 5;
+    uint32_t n = length - 5;
+
+    // 欠落（先の位置）は送り直してもらい、重複（受け取り済みの分）は読み飛ばす
+    if (offset > session.received) {
+        session.rewinds++;
+        sendStatus(LINK_OTA_ERR_OFFSET, session.received);
+        return;
+    }
+    uint32_t skip = session.received - offset;
+    if (skip >= n) {
+        sendStatus(LINK_OTA_OK, session.received);
+        return;
+    }
+    data += skip;
+    n -= skip;
+    if (n > session.payloadSize - session.received) {
+        abortSession(LINK_OTA_ERR_FORMAT, "more data than announced");
+        return;
+    }
+
+    if (session.kind == LINK_OTA_FULL) {
+        if (!writeTarget(nullptr, session.received, data, n)) {
+            abortSession(LINK_OTA_ERR_FLASH, "flash write");
+            return;
+        }
+    } else if (!otaDeltaPush(session.delta, data, n)) {
+        OtaDeltaError error = session.delta.error;
+        abortSession(error == OTA_DELTA_ERR_SOURCE ? LINK_OTA_ERR_SOURCE :
+                     error == OTA_DELTA_ERR_IO ? LINK_OTA_ERR_FLASH : LINK_OTA_ERR_FORMAT,
+                     otaDeltaErrorName(error));
+        return;
+    }
+    session.received += n;
+
+    if (session.received >= session.nextProgress) {
+        Serial.printf("[ota] %u%% (%u/%u)\n", (uint32_t)((uint64_t)session.received * 100 / session.payloadSize),
+                      session.received, session.payloadSize);
+        session.nextProgress += session.payloadSize / 10;
+    }
+    sendStatus(LINK_OTA_OK, session.received);
+}
+
+static void handleEnd() {
+    if (!session.active) {
+        sendStatus(LINK_OTA_ERR_STATE, 0);
+        return;
+    }
+    if (session.received != session.payloadSize) {
+        sendStatus(LINK_OTA_ERR_OFFSET, session.received);
+        return;
+    }
+    if (session.kind == LINK_OTA_DELTA && !otaDeltaFinished(session.delta)) {
+        abortSession(LINK_OTA_ERR_FORMAT, "delta ended early");
+        return;
+    }
+    float seconds = (millis() - session.startMs) / 1000.0f;
+
+    uint8_t sha[32];
+    if (!partitionSha256(session.target, session.targetSize, sha) ||
+        memcmp(sha, session.targetSha256, 32) != 0) {
+        abortSession(LINK_OTA_ERR_VERIFY, "SHA-256 mismatch");
+        return;
+    }
+    esp_err_t err = esp_ota_set_boot_partition(session.target);
+    if (err != ESP_OK) {
+        abortSession(LINK_OTA_ERR_VERIFY, esp_err_to_name(err));
+        return;
+    }
+
+    // 同じ速度でイメージ全体を送った場合と比べる（BEGIN からの時間なので再開までの待ちも含む）
+    float rate = seconds > 0 ? session.payloadSize / seconds : 0;
+    Serial.printf("[ota] received %u bytes in %.1f s (%.1f kB/s, %u resumes, %u rewinds)\n",
+                  session.payloadSize, seconds, rate / 1000.0f, session.resumes, session.rewinds);
+    if (session.kind == LINK_OTA_DELTA && rate > 0) {
+        Serial.printf("[ota] delta is %.1f%% of the image; full image at this rate ~%.1f s\n",
+                      100.0f * session.payloadSize / session.targetSize, session.targetSize / rate);
+    }
+    Serial.printf("[ota] verified, booting %s\n", session.target->label);
+
+    session.active = false;
+    sendStatus(LINK_OTA_DONE, session.received);
+    rebootAt = millis() + OTA_REBOOT_DELAY_MS;
+}
+
+void otaUpdateHandleFrame(const LinkFrameHeader& header, const uint8_t* payload) {
+    if (rebootAt != 0) return;
+
+    switch (payload[0]) {
+    case LINK_OTA_BEGIN:
+        handleBegin(payload, header.length);
+        break;
+    case LINK_OTA_DATA:
+        handleData(payload, header.length);
+        break;
+    case LINK_OTA_END:
+        handleEnd();
+        break;
+    case LINK_OTA_ABORT:
+        if (session.active) Serial.println("[ota] aborted by receiver");
+        session.active = false;
+        sendStatus(LINK_OTA_OK, 0);
+        break;
+    }
+}
+
+bool otaUpdateActive() {
+    return rebootAt != 0 || (session.active && millis() - session.lastRxMs < OTA_IDLE_TIMEOUT_MS);
+}
+
+void otaUpdatePoll() {
+    if (rebootAt != 0 && (long)(millis() - rebootAt) >= 0) {
+        Serial.println("[ota] restarting");
+        Serial.flush();
+        ESP.restart();
+    }
+}
@@ -0,0 +1,29 @@
+/**
+ * Bluetooth 経由のファームウェア更新（LINK_FRAME_OTA）
+ *
+ * 受け取ったデータ（イメージそのもの、または ota_delta.h の差分）から新イメージを組み立て、
+ * 使っていない側の OTA パーティションへ書き込む。送る側は tools/ota_push.py。
+ *   - 書き込みは esp_partition_* で直接行い、消去は書き込み位置の手前で OTA_ERASE_BLOCK ずつ
+ *   - 状態は RAM に持つ。切断されても再起動するまでは、同じ BEGIN を送れば STATUS の位置から再開できる
+ *   - END で書き込んだ範囲を読み戻して SHA-256 を確かめ、esp_ota_set_boot_partition() で切り替えて再起動する
+ *   - 終了時に受信時間と、同じ速度でイメージ全体を送った場合の見積もりをシリアルに出力する
+ *
+ * パーティションテーブルに OTA スロットが 2 つ必要（partitions_ota.csv）。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "link_frame.h"
+
+#define OTA_ERASE_BLOCK      0x10000   // 64KB（ブロック消去の単位）
+#define OTA_IDLE_TIMEOUT_MS  30000     // これだけ何も届かなければ音声の送信に戻る（再開はできる）
+#define OTA_REBOOT_DELAY_MS  500       // DONE を送り切ってから再起動する
+
+// LINK_FRAME_OTA の受信（transportPoll() の制御フレームから呼ぶ）
+void otaUpdateHandleFrame(const LinkFrameHeader& header, const uint8_t* payload);
+
+// 更新中か（この間は音声を送らない）
+bool otaUpdateActive();
+
+// 再起動待ちの処理（loop() から呼ぶ）
+void otaUpdatePoll();
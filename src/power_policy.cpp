@@ -0,0 +1,121 @@
+/**
+ * 省電力ポリシーの実装
+ */
+#include "power_policy.h"
+
+#include <Arduino.h>
+
+#define CURRENT_SMOOTHING 0.3f   // 放電電流の指数平均の係数
+
+static const PowerTierConfig tiers[POWER_TIER_COUNT] = {
+    { "FULL",     50, 240, false, true  },
+    { "ECO",     200, 240, false, true  },
+    { "LOWRATE", 200, 240, true,  true  },
+    { "SLOW",    200,  80, true,  true  },
+    { "DARK",    200,  80, true,  false },
+};
+
+static PowerTier tier = POWER_TIER_FULL;
+static unsigned long tierSince = 0;
+static float dischargeMa = 0;                       // 現ティアでの平滑化した放電電流
+static float tierDischargeMa[POWER_TIER_COUNT];     // ティアごとに実測した放電電流（0 = 未計測）
+static float remainingMinutes = -1;
+static bool tierHeld = false;
+
+static float estimateMinutes(float levelPercent, float currentMa) {
+    if (currentMa <= 0) return -1;
+    return POWER_BATTERY_MAH * levelPercent / 100.0f / currentMa * 60.0f;
+}
+
+static void setTier(PowerTier next, unsigned long nowMs, const char* reason,
+                    float levelPercent, float tempC) {
+    Serial.printf("[power] %s -> %s: %s (%.0f%%, %.0f mA, %.1f C, est %.0f min, target %d min)\n",
+                  tiers[tier].name, tiers[next].name, reason, levelPercent, dischargeMa, tempC,
+                  remainingMinutes, POWER_TARGET_MINUTES);
+    tier = next;
+    tierSince = nowMs;
+    // 新しいティアの電流は前回の実測値から始める（未計測なら今の値）
+    if (tierDischargeMa[tier] > 0) dischargeMa = tierDischargeMa[tier];
+}
+
+void powerPolicyBegin() {
+    tier = POWER_TIER_FULL;
+    tierSince = millis();
+    dischargeMa = 0;
+    remainingMinutes = -1;
+    for (int i = 0; i < POWER_TIER_COUNT; i++) tierDischargeMa[i] = 0;
+}
+
+bool powerPolicyUpdate(float levelPercent, float batCurrentMa, float tempC, unsigned long nowMs) {
+    PowerTier before = tier;
+
+    // 充電中は制限しない
+    if (batCurrentMa >= 0) {
+        remainingMinutes = -1;
+        if (!tierHeld && tier != POWER_TIER_FULL) setTier(POWER_TIER_FULL, nowMs, "charging", levelPercent, tempC);
+        dischargeMa = 0;
+        return tier != before;
+    }
+
+    float current = -batCurrentMa;
+    dischargeMa = dischargeMa > 0 ? dischargeMa + CURRENT_SMOOTHING * (current - dischargeMa) : current;
+    remainingMinutes = estimateMinutes(levelPercent, dischargeMa);
+
+    bool settled = nowMs - tierSince >= POWER_MIN_DWELL_MS;
+    if (settled) tierDischargeMa[tier] = dischargeMa;
+
+    // 即時の下限（残量・温度）はティアを固定していても守る
+    if (levelPercent <= POWER_CRITICAL_LEVEL && tier < POWER_TIER_DARK) {
+        setTier(POWER_TIER_DARK, nowMs, "battery critical", levelPercent, tempC);
+    } else if (tempC >= POWER_HOT_C && tier < POWER_TIER_SLOW) {
+        setTier(POWER_TIER_SLOW, nowMs, "hot", levelPercent, tempC);
+    } else if (tierHeld) {
+        // 目標時間による変更はしない
+    } else if (settled && remainingMinutes < POWER_TARGET_MINUTES && tier < POWER_TIER_DARK) {
+        setTier((PowerTier)(tier + 1), nowMs, "below target", levelPercent, tempC);
+    } else if (settled && tier > POWER_TIER_FULL) {
+        // ひとつ下のティアの実測電流（未計測なら今の電流）でも余裕があれば戻す
+        PowerTier lower = (PowerTier)(tier - 1);
+        float lowerMa = tierDischargeMa[lower] > 0 ? tierDischargeMa[lower] : dischargeMa;
+        bool floorHeld = (lower < POWER_TIER_DARK && levelPercent <= POWER_CRITICAL_LEVEL) ||
+                         (lower < POWER_TIER_SLOW && tempC >= POWER_HOT_C);
+        if (!floorHeld && estimateMinutes(levelPercent, lowerMa) >= POWER_TARGET_MINUTES * POWER_RELAX_MARGIN) {
+            setTier(lower, nowMs, "headroom", levelPercent, tempC);
+        }
+    }
+
+    return tier != before;
+}
+
+PowerTier powerPolicyTier() {
+    return tier;
+}
+
+const PowerTierConfig& powerPolicyConfig() {
+    return tiers[tier];
+}
+
+const PowerTierConfig& powerPolicyTierConfig(PowerTier t) {
+    return tiers[t];
+}
+
+void powerPolicyHold(PowerTier held) {
+    if (held != tier || !tierHeld) {
+        Serial.printf("[power] %s -> %s: held\n", tiers[tier].name, tiers[held].name);
+    }
+    tier = held;
+    tierSince = millis();
+    tierHeld = true;
+    if (tierDischargeMa[tier] > 0) dischargeMa = tierDischargeMa[tier];
+}
+
+void powerPolicyRelease() {
+    if (!tierHeld) return;
+    tierHeld = false;
+    tierSince = millis();
+    Serial.printf("[power] %s: released\n", tiers[tier].name);
+}
+
+float powerPolicyRemainingMinutes() {
+    return remainingMinutes;
+}
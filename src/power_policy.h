@@ -0,0 +1,64 @@
+/**
+ * バッテリー残量に応じた省電力ポリシー
+ *
+ * AXP192 の残量・放電電流・温度から「今の消費電流で何分録れるか」を見積もり、
+ * 目標録音時間（POWER_TARGET_MINUTES）を下回りそうならティアを 1 段ずつ上げる。
+ * ティアごとに画面更新間隔・送信コーデック・CPU 周波数・画面オフを段階的に切り替える。
+ *
+ *   FULL     50ms  PCM    240MHz  画面あり
+ *   ECO     200ms  PCM    240MHz  画面あり
+ *   LOWRATE 200ms  ADPCM  240MHz  画面あり（送信量 1/4）
+ *   SLOW    200ms  ADPCM   80MHz  画面あり
+ *   DARK     --    ADPCM   80MHz  画面オフ（タッチで POWER_WAKE_MS だけ点灯）
+ *
+ * 戻すときは、ひとつ下のティアで実測した電流でも目標の POWER_RELAX_MARGIN 倍以上録れる場合だけ戻す。
+ * ティアが変わるたびに理由と見積もりをシリアルに出力する。適用（CPU・画面）は呼び出し側で行う。
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifndef POWER_TARGET_MINUTES
+#define POWER_TARGET_MINUTES   120    // 保証したい残り録音時間
+#endif
+#define POWER_BATTERY_MAH      390    // Core2 内蔵バッテリー
+#define POWER_EVAL_INTERVAL_MS 10000
+#define POWER_MIN_DWELL_MS     60000  // 電流が落ち着くまで次の段に進まない
+#define POWER_RELAX_MARGIN     1.5f
+#define POWER_CRITICAL_LEVEL   5      // %（これ以下は即 DARK）
+#define POWER_HOT_C            55.0f  // AXP192 内部温度（これ以上は SLOW 以上）
+#define POWER_WAKE_MS          15000
+
+enum PowerTier : uint8_t {
+    POWER_TIER_FULL = 0,
+    POWER_TIER_ECO,
+    POWER_TIER_LOWRATE,
+    POWER_TIER_SLOW,
+    POWER_TIER_DARK,
+    POWER_TIER_COUNT
+};
+
+struct PowerTierConfig {
+    const char* name;
+    uint16_t uiIntervalMs;   // アニメーションの更新間隔
+    uint16_t cpuMhz;
+    bool adpcm;              // PCM モードの音声を ADPCM で送る
+    bool screenOn;
+};
+
+void powerPolicyBegin();
+
+// POWER_EVAL_INTERVAL_MS ごとに呼ぶ（batCurrentMa は充電で正、放電で負）。ティアが変わったら true
+bool powerPolicyUpdate(float levelPercent, float batCurrentMa, float tempC, unsigned long nowMs);
+
+PowerTier powerPolicyTier();
+const PowerTierConfig& powerPolicyConfig();
+const PowerTierConfig& powerPolicyTierConfig(PowerTier t);
+
+// ティアを固定する（消費電力の計測用、解除するまで powerPolicyUpdate() は目標時間ではティアを変えない。
+// 残量低下・高温の下限は固定中も守る）
+void powerPolicyHold(PowerTier held);
+void powerPolicyRelease();
+
+// 現在の消費電流での残り録音時間の見積もり（分、充電中・未計測は負）
+float powerPolicyRemainingMinutes();
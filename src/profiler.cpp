@@ -0,0 +1,196 @@
+/**
+ * PC サンプリングによるプロファイラの実装
+ */
+#include "profiler.h"
+
+#include <Arduino.h>
+
+#if PROFILER
+#include <esp_debug_helpers.h>
+#include <esp_freertos_hooks.h>
+#include <esp_spi_flash.h>
+#include <freertos/xtensa_context.h>
+#include <soc/soc_memory_layout.h>
+
+#define PROFILER_TICK_STEP  (configTICK_RATE_HZ / PROFILER_HZ)
+#define PROFILER_LINE_MAX   32
+
+// 割り込みのネスト数（FreeRTOS の Xtensa ポート、ティック割り込み自身で 1）
+extern "C" unsigned port_interruptNesting[portNUM_PROCESSORS];
+
+struct ProfilerSample {
+    uint32_t pc[PROFILER_DEPTH];    // [0] が割り込まれた位置、以降は呼び出し元（0 で終わり）
+    char task[PROFILER_TASK_NAME];  // 空白は '_'（dump の区切りと重ならないように）
+};
+
+struct CoreRing {
+    ProfilerSample* samples;
+    volatile uint32_t write;        // 記録したサンプル総数
+    uint32_t tick;
+    uint32_t cacheOff;              // フラッシュ書き込み中で記録しなかった数
+};
+
+static bool enabled = false;
+static volatile bool running = false;
+static CoreRing rings[portNUM_PROCESSORS];
+static unsigned long startMs = 0;
+static char line[PROFILER_LINE_MAX];
+static size_t lineLength = 0;
+
+// ティック割り込みから（IRAM、フラッシュ上の関数はキャッシュが有効なときだけ呼ぶ）
+static void IRAM_ATTR sample(int core) {
+    CoreRing& ring = rings[core];
+    if (!running || ++ring.tick < PROFILER_TICK_STEP) return;
+    ring.tick = 0;
+    if (!spi_flash_cache_enabled()) {
+        ring.cacheOff++;
+        return;
+    }
+
+    ProfilerSample& s = ring.samples[ring.write % PROFILER_SAMPLES];
+    memset(&s, 0, sizeof(s));
+    TaskHandle_t task = xTaskGetCurrentTaskHandleForCPU(core);
+    const char* name = task ? pcTaskGetTaskName(task) : "?";
+    for (int i = 0; i < PROFILER_TASK_NAME - 1 && name[i]; i++) {
+        s.task[i] = name[i] == ' ' ? '_' : name[i];
+    }
+
+    if (port_interruptNesting[core] > 1 || !task) {
+        s.pc[0] = PROFILER_PC_ISR;
+    } else {
+        // 割り込まれたタスクの例外フレーム（割り込みの入口で TCB の先頭 pxTopOfStack に保存される）
+        const XtExcFrame* frame = *(XtExcFrame* const*)task;
+        esp_backtrace_frame_t f = {(uint32_t)frame->pc, (uint32_t)frame->a1, (uint32_t)frame->a0};
+        s.pc[0] = f.pc;
+        for (int i = 1; i < PROFILER_DEPTH && f.next_pc != 0 && esp_stack_ptr_is_sane(f.sp); i++) {
+            if (!esp_backtrace_get_next_frame(&f)) break;
+            // 戻り番地の上位 2bit はウィンドウの増分、呼び出し命令を指すように 3 戻す
+            s.pc[i] = ((f.pc & 0x3FFFFFFF) | 0x40000000) - 3;
+        }
+    }
+    ring.write = ring.write + 1;
+}
+
+static void IRAM_ATTR sampleCore0() {
+    sample(0);
+}
+
+static void IRAM_ATTR sampleCore1() {
+    sample(1);
+}
+
+static int compareSamples(const void* a, const void* b) {
+    return memcmp(a, b, sizeof(ProfilerSample));
+}
+
+static void reset() {
+    running = false;
+    for (CoreRing& ring : rings) {
+        ring.write = 0;
+        ring.cacheOff = 0;
+    }
+    startMs = millis();
+    running = true;
+}
+
+// 同じタスク・スタックをまとめて出力（並べ替えるのでリングは空にする）
+static void dump() {
+    bool wasRunning = running;
+    running = false;
+    delay(2);  // 書き込み中のティックが終わるまで
+
+    float seconds = (millis() - startMs) / 1000.0f;
+    Serial.printf("[prof] dump begin: hz %u, depth %u, %.1f s\n", PROFILER_HZ, PROFILER_DEPTH, seconds);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        CoreRing& ring = rings[core];
+        uint32_t count = ring.write < PROFILER_SAMPLES ? ring.write : PROFILER_SAMPLES;
+        qsort(ring.samples, count, sizeof(ProfilerSample), compareSamples);
+
+        uint32_t stacks = 0, isr = 0;
+        for (uint32_t i = 0; i < count;) {
+            uint32_t j = i + 1;
+            while (j < count && compareSamples(&ring.samples[i], &ring.samples[j]) == 0) j++;
+
+            // [prof] <回数> <コア> <タスク> <PC>,<呼び出し元>,...
+            const ProfilerSample& s = ring.samples[i];
+            Serial.printf("[prof] %u %d %s ", j - i, core, s.task[0] ? s.task : "?");
+            for (int d = 0; d < PROFILER_DEPTH && s.pc[d] != 0; d++) {
+                Serial.printf(d == 0 ? "%08x" : ",%08x", s.pc[d]);
+            }
+            Serial.println();
+            if (s.pc[0] == PROFILER_PC_ISR) isr += j - i;
+            stacks++;
+            i = j;
+        }
+        Serial.printf("[prof] core %d: %u samples (%u dropped from ring), %u stacks, %u in other ISRs, "
+                      "%u skipped during flash writes\n",
+                      core, count, ring.write - count, stacks, isr, ring.cacheOff);
+    }
+    Serial.println("[prof] dump end");
+    reset();
+    running = wasRunning;
+}
+
+bool profilerBegin() {
+    if (!psramFound()) {
+        Serial.println("Profiler: no PSRAM, disabled");
+        return false;
+    }
+    for (CoreRing& ring : rings) {
+        ring.samples = (ProfilerSample*)ps_malloc(PROFILER_SAMPLES * sizeof(ProfilerSample));
+        if (!ring.samples) {
+            Serial.println("Profiler: sample buffer allocation failed");
+            return false;
+        }
+    }
+    if (esp_register_freertos_tick_hook_for_cpu(sampleCore0, 0) != ESP_OK ||
+        esp_register_freertos_tick_hook_for_cpu(sampleCore1, 1) != ESP_OK) {
+        Serial.println("Profiler: tick hook registration failed");
+        return false;
+    }
+
+    enabled = true;
+    reset();
+    Serial.printf("Profiler: %u Hz per core, %u samples per core (%.1f s, %u KB PSRAM), send 'prof dump'\n",
+                  PROFILER_HZ, PROFILER_SAMPLES, (float)PROFILER_SAMPLES / PROFILER_HZ,
+                  portNUM_PROCESSORS * PROFILER_SAMPLES * sizeof(ProfilerSample) / 1024);
+    return true;
+}
+
+bool profilerEnabled() {
+    return enabled;
+}
+
+void profilerPoll() {
+    if (!enabled) return;
+
+    while (Serial.available() > 0) {
+        int c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (lineLength < PROFILER_LINE_MAX - 1) line[lineLength++] = c;
+            continue;
+        }
+        line[lineLength] = '\0';
+        lineLength = 0;
+
+        if (strcmp(line, "prof dump") == 0) {
+            dump();
+        } else if (strcmp(line, "prof stop") == 0) {
+            running = false;
+            Serial.println("[prof] stopped");
+        } else if (strcmp(line, "prof start") == 0) {
+            reset();
+            Serial.println("[prof] started");
+        } else if (line[0] != '\0') {
+            Serial.printf("[prof] unknown command '%s' (prof dump / prof stop / prof start)\n", line);
+        }
+    }
+}
+
+#else
+
+bool profilerBegin() { return false; }
+bool profilerEnabled() { return false; }
+void profilerPoll() {}
+
+#endif
@@ -0,0 +1,40 @@
+/**
+ * PC サンプリングによるプロファイラ
+ *
+ * -DPROFILER=1 のビルドでは、両コアの FreeRTOS ティック割り込みのフックで、割り込まれた位置の PC と
+ * 数段の呼び出し元（PROFILER_DEPTH）、タスク名を PSRAM のリングに記録する（コアごとに直近の
+ * PROFILER_SAMPLES 個）。計測コードを入れていない処理（画面描画・BT スタック・I2S など）にも時間の内訳が出る。
+ *
+ * シリアルに 1 行のコマンドを送って操作する（115200bps、改行で終わり）。
+ *   prof dump   同じスタックをまとめて [prof] 行で出力し、リングを空にして再開する
+ *   prof stop   記録を止める / prof start  空にして再開する
+ * 出力は tools/profile_fold.py で ELF と突き合わせて、フレームグラフ用の folded 形式にする。
+ *
+ * 別の割り込みの処理中だった場合はスタックをたどれないので PC を PROFILER_PC_ISR にする。
+ * フラッシュの書き込み中（キャッシュ無効）は PSRAM に書けないので記録せず数だけ数える。
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifndef PROFILER
+#define PROFILER 0
+#endif
+
+#ifndef PROFILER_HZ
+#define PROFILER_HZ         1000     // コアごと（ティックの周波数の約数、最大 configTICK_RATE_HZ）
+#endif
+#ifndef PROFILER_SAMPLES
+#define PROFILER_SAMPLES    16384    // コアごとのリング（1kHz で約 16 秒）
+#endif
+#define PROFILER_DEPTH      6        // PC と呼び出し元 5 段
+#define PROFILER_TASK_NAME  12
+#define PROFILER_PC_ISR     1        // 別の割り込みの処理中
+#define PROFILER_POLL_MS    200      // 待機中にコマンドを確認する間隔
+
+// ティックのフックを登録して記録を始める（PROFILER=0 のビルドや PSRAM が無ければ false）
+bool profilerBegin();
+bool profilerEnabled();
+
+// シリアルのコマンドを処理する（loop() から）
+void profilerPoll();
@@ -0,0 +1,473 @@
+/**
+ * SD カード録音と同期の実装
+ */
+#include "recorder.h"
+
+#include <Arduino.h>
+
+#if RECORDER
+#include <SD.h>
+
+#include "capture.h"
+#include "speech_index.h"
+#include "transport.h"
+
+#define RECORDER_MAX_LIVE_LAG   ((uint32_t)SAMPLE_RATE * RECORDER_MAX_LIVE_LAG_MS / 1000)
+#define LIST_ENTRY_SIZE         12
+#define SYNC_HEADER_SIZE        5      // 種別 + 録音番号
+
+enum SyncPhase : uint8_t {
+    SYNC_IDLE,
+    SYNC_INDEX,
+    SYNC_AUDIO,
+};
+
+static bool enabled = false;
+static uint32_t nextId = 1;
+
+// 録音中
+static bool recording = false;
+static uint32_t recordId = 0;
+static File pcmFile;
+static File idxFile;
+static SpeechIndexBuilder indexBuilder;
+static uint32_t cursor = 0;            // 履歴のサンプル番号
+static uint32_t recordedSamples = 0;
+static uint32_t lostSamples = 0;       // 書き出しが遅れて履歴から消えた分
+static uint32_t indexBytes = 0;
+static uint32_t writeUsMax = 0;        // 1 回の recorderPoll() の最大
+static RecorderStats stats = {};       // 録音をまたいで累計
+static unsigned long lastFlush = 0;
+static int16_t chunk[RECORDER_CHUNK_SAMPLES];
+
+// 同期（取り出し）
+static SyncPhase syncPhase = SYNC_IDLE;
+static uint32_t syncId = 0;
+static uint8_t syncMode = LINK_REC_FETCH_SPEECH;
+static File syncIdx;
+static File syncPcm;
+static uint32_t syncTotal = 0;         // 録音のサンプル数
+static uint32_t regionPos = 0;         // 送っている区間
+static uint32_t regionEnd = 0;
+static bool regionValid = false;
+static uint32_t syncRequestUs = 0;
+static uint32_t syncIndexBytes = 0;
+static uint32_t syncSamples = 0;
+static uint32_t syncMaxBacklog = 0;
+static uint8_t syncBuffer[SYNC_HEADER_SIZE + RECORDER_SEND_SAMPLES * 2];
+
+static void recordPath(char* out, size_t size, uint32_t id, const char* ext) {
+    snprintf(out, size, RECORDER_DIR "/%05u.%s", id, ext);
+}
+
+static void putLe32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static void writeIndexRecord(const uint8_t* record, size_t length, void* context) {
+    indexBytes += idxFile.write(record, length);
+}
+
+// ファイル名（"00012.idx" またはパス付き）から録音番号、拡張子が違えば 0
+static uint32_t idFromName(const char* name, const char* ext) {
+    const char* base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+    const char* dot = strrchr(base, '.');
+    if (!dot || strcmp(dot + 1, ext) != 0) return 0;
+    return strtoul(base, nullptr, 10);
+}
+
+bool recorderBegin() {
+    if (!SD.begin(TFCARD_CS_PIN, SPI, RECORDER_SPI_HZ) || SD.cardType() == CARD_NONE) {
+        Serial.println("Recorder: no SD card, offline recording disabled");
+        return false;
+    }
+    if (!SD.exists(RECORDER_DIR)) SD.mkdir(RECORDER_DIR);
+
+    // 続きの番号から
+    uint32_t count = 0;
+    File dir = SD.open(RECORDER_DIR);
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+        uint32_t id = idFromName(f.name(), "pcm");
+        if (id > 0) count++;
+        if (id >= nextId) nextId = id + 1;
+        f.close();
+    }
+    dir.close();
+
+    enabled = true;
+    Serial.printf("Recorder: SD %llu MB free, %u recordings\n",
+                  (SD.totalBytes() - SD.usedBytes()) / (1024 * 1024), count);
+    return true;
+}
+
+bool recorderEnabled() {
+    return enabled;
+}
+
+bool recorderRecording() {
+    return recording;
+}
+
+// 次の録音番号で .pcm / .idx を作り、インデックスを始める（cursor には触れない）
+static bool openFiles() {
+    char path[32];
+    recordId = nextId++;
+    recordPath(path, sizeof(path), recordId, "pcm");
+    pcmFile = SD.open(path, "w");
+    recordPath(path, sizeof(path), recordId, "idx");
+    idxFile = SD.open(path, "w");
+    if (!pcmFile || !idxFile) {
+        Serial.printf("[rec] cannot create recording #%u\n", recordId);
+        if (pcmFile) pcmFile.close();
+        if (idxFile) idxFile.close();
+        return false;
+    }
+
+    uint8_t header[SPEECH_INDEX_HEADER_SIZE];
+    indexBytes = idxFile.write(header, speechIndexWriteHeader(header, SAMPLE_RATE));
+    speechIndexInit(indexBuilder, SAMPLE_RATE, writeIndexRecord, nullptr);
+
+    recordedSamples = lostSamples = writeUsMax = 0;
+    lastFlush = millis();
+    recording = true;
+    Serial.printf("[rec] recording #%u\n", recordId);
+    return true;
+}
+
+void recorderStart() {
+    if (!enabled || recording) return;
+    cursor = captureWriteIndex();
+    openFiles();
+}
+
+static void closeRecording() {
+    speechIndexFinish(indexBuilder);
+    pcmFile.close();
+    idxFile.close();
+    recording = false;
+
+    float seconds = (float)recordedSamples / SAMPLE_RATE;
+    float speech = (float)indexBuilder.speechSamples / SAMPLE_RATE;
+    Serial.printf("[rec] #%u closed: %.1f s, %u speech regions, %.1f s speech (%.1f%%), index %u B, "
+                  "write max %u us, lost %u samples\n",
+                  recordId, seconds, indexBuilder.regions, speech, seconds > 0 ? 100.0f * speech / seconds : 0.0f,
+                  indexBytes, writeUsMax, lostSamples);
+}
+
+// 長くなった録音を閉じて続きを次のファイルに書く。cursor とノイズフロアは引き継ぐので、
+// まだ書き出していない履歴も次のファイルの先頭に入る
+static void openNextFile() {
+    float floorDb = indexBuilder.floorDb;
+    bool floorValid = indexBuilder.floorValid;
+    closeRecording();
+    if (!openFiles()) return;
+    indexBuilder.floorDb = floorDb;
+    indexBuilder.floorValid = floorValid;
+}
+
+void recorderPoll() {
+    if (!recording) return;
+
+    uint32_t start = micros();
+    stats.backlog = captureWriteIndex() - cursor;
+    if (stats.backlog > stats.backlogMax) stats.backlogMax = stats.backlog;
+    for (;;) {
+        uint32_t dropped = 0;
+        size_t count = captureRead(cursor, chunk, RECORDER_CHUNK_SAMPLES, &dropped);
+        lostSamples += dropped;
+        stats.lostSamples += dropped;
+        if (count == 0) break;
+
+        if (pcmFile.write((const uint8_t*)chunk, count * 2) != count * 2) {
+            Serial.printf("[rec] write failed (SD full?), stopping #%u\n", recordId);
+            closeRecording();
+            return;
+        }
+        speechIndexPush(indexBuilder, chunk, count);
+        recordedSamples += count;
+        stats.samples += count;
+
+        // 長くなったら次のファイルへ
+        if (recordedSamples >= (uint32_t)SAMPLE_RATE * RECORDER_FILE_SECONDS) {
+            stats.busyUs += micros() - start;
+            openNextFile();
+            return;
+        }
+    }
+
+    if (millis() - lastFlush >= RECORDER_FLUSH_MS) {
+        pcmFile.flush();
+        idxFile.flush();
+        lastFlush = millis();
+    }
+
+    uint32_t elapsed = micros() - start;
+    if (elapsed > writeUsMax) writeUsMax = elapsed;
+    stats.busyUs += elapsed;
+}
+
+void recorderGetStats(RecorderStats& out) {
+    out = stats;
+}
+
+void recorderLogStats() {
+    static unsigned long lastLog = 0;
+    static RecorderStats last = {};
+
+    unsigned long now = millis();
+    if (recording && lastLog != 0) {
+        float seconds = (now - lastLog) / 1000.0f;
+        uint32_t history = captureWriteIndex() - captureOldestIndex();
+        Serial.printf("[archive] #%u PCM %.1f kB/s, cpu %.1f%%, backlog %u ms (max %u ms, %.0f%% of history), "
+                      "lost %u samples\n",
+                      recordId, (stats.samples - last.samples) * 2 / seconds / 1000.0f,
+                      (stats.busyUs - last.busyUs) / 10.0f / (seconds * 1000.0f),
+                      stats.backlog * 1000 / SAMPLE_RATE, stats.backlogMax * 1000 / SAMPLE_RATE,
+                      history > 0 ? 100.0f * stats.backlogMax / history : 0.0f, stats.lostSamples - last.lostSamples);
+    }
+
+    last = stats;
+    stats.backlogMax = 0;
+    lastLog = now;
+}
+
+void recorderStop() {
+    if (!recording) return;
+    recorderPoll();
+    if (recording) closeRecording();
+}
+
+// インデックスの END から長さと発話区間の合計を読む（閉じていなければ区間を数え直す）
+static bool readSummary(uint32_t id, uint32_t& total, uint32_t& speech) {
+    char path[32];
+    recordPath(path, sizeof(path), id, "idx");
+    File f = SD.open(path, "r");
+    if (!f) return false;
+
+    uint8_t buf[256];
+    SpeechIndexRecord record;
+    size_t size = f.size();
+    if (size >= SPEECH_INDEX_HEADER_SIZE + 9 && f.seek(size - 9) && f.read(buf, 9) == 9 &&
+        speechIndexReadRecord(buf, 9, record) == 9 && record.type == SPEECH_INDEX_END) {
+        total = record.totalSamples;
+        speech = record.speechSamples;
+        f.close();
+        return true;
+    }
+
+    // 電源断などで END が無い
+    recordPath(path, sizeof(path), id, "pcm");
+    File pcm = SD.open(path, "r");
+    total = pcm ? pcm.size() / 2 : 0;
+    if (pcm) pcm.close();
+    speech = 0;
+    f.seek(SPEECH_INDEX_HEADER_SIZE);
+    size_t filled = 0;
+    for (;;) {
+        filled += f.read(buf + filled, sizeof(buf) - filled);
+        size_t used = 0, n;
+        while ((n = speechIndexReadRecord(buf + used, filled - used, record)) > 0) {
+            if (record.type == SPEECH_INDEX_REGION && record.region.end <= total) {
+                speech += record.region.end - record.region.start;
+            }
+            used += n;
+        }
+        if (used == 0) break;
+        memmove(buf, buf + used, filled - used);
+        filled -= used;
+    }
+    f.close();
+    return true;
+}
+
+static void sendList() {
+    static uint8_t payload[1 + (LINK_FRAME_MAX_PAYLOAD - 1) / LIST_ENTRY_SIZE * LIST_ENTRY_SIZE];
+    size_t length = 1;
+    uint32_t count = 0;
+    payload[0] = LINK_REC_LIST;
+
+    File dir = SD.open(RECORDER_DIR);
+    for (File f = dir ? dir.openNextFile() : File(); f; f = dir.openNextFile()) {
+        uint32_t id = idFromName(f.name(), "idx");
+        f.close();
+        if (id == 0 || (recording && id == recordId)) continue;
+
+        uint32_t total, speech;
+        if (!readSummary(id, total, speech)) continue;
+        if (length + LIST_ENTRY_SIZE > sizeof(payload)) {
+            transportSendFrame(LINK_FRAME_RECORDING, 0, payload, length, 0);
+            length = 1;
+        }
+        putLe32(payload + length, id);
+        putLe32(payload + length + 4, total);
+        putLe32(payload + length + 8, speech);
+        length += LIST_ENTRY_SIZE;
+        count++;
+    }
+    if (dir) dir.close();
+
+    transportSendFrame(LINK_FRAME_RECORDING, LINK_FLAG_RECORDING_LAST, payload, length, 0);
+    Serial.printf("[rec] listed %u recordings\n", count);
+}
+
+static void closeSync() {
+    if (syncIdx) syncIdx.close();
+    if (syncPcm) syncPcm.close();
+    syncPhase = SYNC_IDLE;
+}
+
+// 次に送る区間（発話区間だけならインデックスの次の 'R'、全体なら 1 回だけ録音全体）
+static bool nextRegion() {
+    regionValid = false;
+    if (syncMode == LINK_REC_FETCH_ALL) {
+        if (regionEnd == 0 && syncTotal > 0) {
+            regionPos = 0;
+            regionEnd = syncTotal;
+            regionValid = true;
+        }
+        return regionValid;
+    }
+
+    uint8_t buf[SPEECH_INDEX_MAX_RECORD];
+    while (syncIdx.read(buf, 1) == 1) {
+        size_t size = speechIndexRecordSize(buf[0]);
+        SpeechIndexRecord record;
+        if (size == 0 || syncIdx.read(buf + 1, size - 1) != size - 1 ||
+            speechIndexReadRecord(buf, size, record) != size) {
+            break;
+        }
+        if (record.type != SPEECH_INDEX_REGION) continue;
+
+        uint32_t end = record.region.end < syncTotal ? record.region.end : syncTotal;
+        if (record.region.start >= end) continue;
+        regionPos = record.region.start;
+        regionEnd = end;
+        regionValid = true;
+        return true;
+    }
+    return false;
+}
+
+static void startFetch(uint32_t id, uint8_t mode) {
+    closeSync();
+    syncId = id;
+    syncMode = mode;
+    syncRequestUs = micros();
+    syncIndexBytes = syncSamples = syncMaxBacklog = 0;
+    syncTotal = 0;
+    regionEnd = 0;
+    regionValid = false;
+
+    char path[32];
+    if (!(recording && id == recordId)) {
+        recordPath(path, sizeof(path), id, "idx");
+        syncIdx = SD.open(path, "r");
+        recordPath(path, sizeof(path), id, "pcm");
+        syncPcm = SD.open(path, "r");
+    }
+    if (syncPcm) syncTotal = syncPcm.size() / 2;
+    if (!syncIdx || !syncPcm) {
+        // 無い（または書き込み中の）録音は空のインデックスと音声で応える
+        Serial.printf("[rec] fetch #%u: no such recording\n", id);
+        closeSync();
+        syncPhase = SYNC_INDEX;
+        return;
+    }
+    syncPhase = SYNC_INDEX;
+    Serial.printf("[rec] fetch #%u (%s, %.1f s recorded)\n", id,
+                  mode == LINK_REC_FETCH_ALL ? "all" : "speech only", (float)syncTotal / SAMPLE_RATE);
+}
+
+void recorderHandleControl(const LinkFrameHeader& header, const uint8_t* payload) {
+    if (!enabled) return;
+    if (payload[0] == LINK_CTRL_REC_LIST) {
+        sendList();
+    } else if (payload[0] == LINK_CTRL_REC_FETCH && header.length >= 6) {
+        uint32_t id = payload[1] | (payload[2] << 8) | (payload[3] << 16) | ((uint32_t)payload[4] << 24);
+        startFetch(id, payload[5]);
+    }
+}
+
+void recorderSyncReset() {
+    closeSync();
+}
+
+bool recorderSendNext(uint32_t liveBacklog) {
+    if (syncPhase == SYNC_IDLE) return false;
+    if (liveBacklog > syncMaxBacklog) syncMaxBacklog = liveBacklog;
+    if (liveBacklog > RECORDER_MAX_LIVE_LAG) return false;
+
+    putLe32(syncBuffer + 1, syncId);
+    size_t length = SYNC_HEADER_SIZE;
+    uint8_t flags = 0;
+    uint32_t timestamp = 0;
+
+    if (syncPhase == SYNC_INDEX) {
+        // インデックスをそのまま送る
+        syncBuffer[0] = LINK_REC_INDEX;
+        if (syncIdx) length += syncIdx.read(syncBuffer + length, sizeof(syncBuffer) - length);
+        timestamp = syncIndexBytes;
+        syncIndexBytes += length - SYNC_HEADER_SIZE;
+        if (!syncIdx || !syncIdx.available()) {
+            flags = LINK_FLAG_RECORDING_LAST;
+            syncPhase = SYNC_AUDIO;
+            if (syncIdx) syncIdx.seek(SPEECH_INDEX_HEADER_SIZE);
+            if (syncPcm) nextRegion();
+        }
+    } else {
+        // 区間の続き（区間の終わりで次の区間を探し、無ければ最後のフレーム）
+        syncBuffer[0] = LINK_REC_AUDIO;
+        if (regionValid) {
+            uint32_t count = regionEnd - regionPos;
+            if (count > RECORDER_SEND_SAMPLES) count = RECORDER_SEND_SAMPLES;
+            timestamp = regionPos;
+            if (syncPcm.position() != regionPos * 2) syncPcm.seek(regionPos * 2);
+            count = syncPcm.read(syncBuffer + length, count * 2) / 2;
+            length += count * 2;
+            regionPos += count;
+            syncSamples += count;
+            if (count == 0 || regionPos >= regionEnd) nextRegion();
+        }
+        if (!regionValid) flags = LINK_FLAG_RECORDING_LAST;
+    }
+
+    if (!transportSendFrame(LINK_FRAME_RECORDING, flags, syncBuffer, length, timestamp)) {
+        closeSync();
+        return false;
+    }
+
+    if (syncPhase == SYNC_AUDIO && flags) {
+        float ms = (micros() - syncRequestUs) / 1000.0f;
+        float seconds = (float)syncSamples / SAMPLE_RATE;
+        float total = (float)syncTotal / SAMPLE_RATE;
+        float bytes = syncSamples * 2.0f + syncIndexBytes;
+        Serial.printf("[rec] fetch #%u done: %.1f s of %.1f s audio (%.1f%%), index %u B, %.2f s, %.1f kB/s, "
+                      "full transfer at this rate ~%.1f s, live lag max %u ms\n",
+                      syncId, seconds, total, total > 0 ? 100.0f * seconds / total : 0.0f, syncIndexBytes,
+                      ms / 1000.0f, ms > 0 ? bytes / ms : 0.0f,
+                      bytes > 0 ? ms / 1000.0f * syncTotal * 2.0f / bytes : 0.0f,
+                      syncMaxBacklog * 1000 / SAMPLE_RATE);
+        closeSync();
+    }
+    return true;
+}
+
+#else
+
+bool recorderBegin() { return false; }
+bool recorderEnabled() { return false; }
+void recorderStart() {}
+void recorderStop() {}
+bool recorderRecording() { return false; }
+void recorderPoll() {}
+void recorderGetStats(RecorderStats& out) { out = {}; }
+void recorderLogStats() {}
+void recorderHandleControl(const LinkFrameHeader& header, const uint8_t* payload) {}
+void recorderSyncReset() {}
+bool recorderSendNext(uint32_t liveBacklog) { return false; }
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * 未接続の間の SD カード録音と、接続後の同期
+ *
+ * -DRECORDER=1 のビルドでは、接続していない間の音声を履歴リングから SD の RECORDER_DIR に書き出す。
+ *   <番号>.pcm  16bit LE モノラル PCM
+ *   <番号>.idx  発話区間インデックス（speech_index.h、書きながら作る）
+ * 接続すると書き込み中の録音を閉じ、受信側は LINK_CTRL_REC_LIST / LINK_CTRL_REC_FETCH で取り出す。
+ * 発話区間だけを指定すれば、ほとんど無音の録音でも区間の分だけ転送すればよい。
+ * 送信は再送（replay.h）と同じくライブの合間に行い、取り出しごとに所要時間とスループットを [rec] 行で出力する。
+ *
+ * -DRECORDER_ARCHIVE=1 のビルドでは接続中も録音を続け、キャプチャを二系統に分ける。
+ *   ライブ   : ADPCM（1/4）で送信する。streamCursor で履歴を読む
+ *   アーカイブ: 16bit PCM をそのまま SD に書く。自分のカーソルで履歴を読む
+ * カーソルが別なので、送信が詰まってもアーカイブは履歴の長さまで遅れるだけで欠けない
+ * （送信待ちの間も transportSetStallHandler() から書き出しを進める）。
+ * 系統ごとの CPU 時間と履歴の未処理量は [live] / [archive] 行に出力する。
+ *
+ * SD カードは液晶と SPI を共用するので、読み書きは loop() のタスクだけで行う。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "link_frame.h"
+
+#ifndef RECORDER_ARCHIVE
+#define RECORDER_ARCHIVE 0
+#endif
+#ifndef RECORDER
+#define RECORDER RECORDER_ARCHIVE
+#endif
+
+#define RECORDER_DIR            "/rec"
+#define RECORDER_SPI_HZ         25000000
+#define RECORDER_FILE_SECONDS   1800    // 1 ファイルの長さ
+#define RECORDER_POLL_MS        1000    // 履歴から書き出す間隔（履歴の長さより十分短く）
+#define RECORDER_FLUSH_MS       5000    // 電源断に備えてファイルを確定する間隔
+#define RECORDER_CHUNK_SAMPLES  2048    // 1 回の書き込み
+#define RECORDER_SEND_SAMPLES   1024    // 同期の 1 フレーム（ライブの PCM フレームと同じ 2KB）
+#ifndef RECORDER_MAX_LIVE_LAG_MS
+#define RECORDER_MAX_LIVE_LAG_MS 250    // ライブの未送信がこれを超えたら同期を止める
+#endif
+
+struct RecorderStats {
+    uint32_t samples;        // 書き出したサンプル数
+    uint32_t lostSamples;    // 書き出しが遅れて履歴から消えた分
+    uint64_t busyUs;         // recorderPoll() の累計時間（SD の書き込み＋インデックス）
+    uint32_t backlog;        // 直近の recorderPoll() を始めた時点の未処理サンプル数
+    uint32_t backlogMax;
+};
+
+// SD カードをマウントする（RECORDER=0 のビルドやカードが無ければ false、以降の呼び出しは何もしない）
+bool recorderBegin();
+bool recorderEnabled();
+
+// 録音の開始・終了（未接続になったら開始、接続したら終了）
+void recorderStart();
+void recorderStop();
+bool recorderRecording();
+
+// 履歴リングから SD に書き出す（loop() から、RECORDER_POLL_MS ごと）
+void recorderPoll();
+
+void recorderGetStats(RecorderStats& out);
+
+// 前回呼び出しからの書き出しの CPU 時間と履歴の未処理量をシリアルに出力（録音中のみ）
+void recorderLogStats();
+
+// LINK_CTRL_REC_LIST / LINK_CTRL_REC_FETCH（loop() の制御フレーム処理から）
+void recorderHandleControl(const LinkFrameHeader& header, const uint8_t* payload);
+
+// 接続ごとに途中の取り出しを捨てる
+void recorderSyncReset();
+
+// 同期を 1 フレーム送る（loop() から、liveBacklog はライブの未送信サンプル数）。送ったら true
+bool recorderSendNext(uint32_t liveBacklog);
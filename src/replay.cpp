@@ -0,0 +1,120 @@
+/**
+ * 履歴の再送の実装
+ */
+#include "replay.h"
+
+#include <Arduino.h>
+
+#include "capture.h"
+#include "transport.h"
+
+#define REPLAY_MAX_SAMPLES    ((uint32_t)SAMPLE_RATE * REPLAY_MAX_SECONDS)
+#define REPLAY_MAX_LIVE_LAG   ((uint32_t)SAMPLE_RATE * REPLAY_MAX_LIVE_LAG_MS / 1000)
+
+static int16_t replayBuffer[REPLAY_FRAME_SAMPLES];
+
+// 処理中の要求（書くのは loop() のタスクだけ）
+static bool active = false;
+static uint32_t cursor = 0;          // 次に送るサンプル番号
+static uint32_t endIndex = 0;        // この手前まで
+static uint32_t requested = 0;       // 要求されたサンプル数（切り詰め後）
+static uint32_t requestUs = 0;
+static uint32_t firstFrameUs = 0;    // 0 なら未送信
+static uint32_t sentSamples = 0;
+static uint32_t sentFrames = 0;
+static uint32_t skippedSamples = 0;  // 履歴から消えていた分
+static uint32_t maxLiveBacklog = 0;
+
+static void finish() {
+    uint32_t now = micros();
+    float totalMs = (now - requestUs) / 1000.0f;
+    float firstMs = firstFrameUs ? (firstFrameUs - requestUs) / 1000.0f : totalMs;
+    float seconds = (float)sentSamples / SAMPLE_RATE;
+    float kBps = totalMs > 0 ? sentSamples * 2 / totalMs : 0;
+
+    Serial.printf("[replay] %.2f s in %u frames: first frame %.1f ms, done %.1f ms, %.1f kB/s (%.1fx real time), "
+                  "live lag max %u ms, skipped %u\n",
+                  seconds, sentFrames, firstMs, totalMs, kBps,
+                  totalMs > 0 ? seconds * 1000.0f / totalMs : 0.0f,
+                  maxLiveBacklog * 1000 / SAMPLE_RATE, skippedSamples);
+    active = false;
+}
+
+void replayRequest(uint32_t start, uint32_t count) {
+    if (active) {
+        Serial.println("[replay] previous request replaced");
+    }
+
+    uint32_t now = captureWriteIndex();
+    if (count > REPLAY_MAX_SAMPLES) count = REPLAY_MAX_SAMPLES;
+    if (start == LINK_REPLAY_LATEST) start = now - min(count, now);
+
+    // まだ書かれていない分は返さない
+    uint32_t end = start + count;
+    if ((int32_t)(end - now) > 0) end = now;
+    if ((int32_t)(end - start) < 0) end = start;
+
+    active = true;
+    cursor = start;
+    endIndex = end;
+    requested = end - start;
+    requestUs = micros();
+    firstFrameUs = 0;
+    sentSamples = sentFrames = skippedSamples = maxLiveBacklog = 0;
+
+    Serial.printf("[replay] request %u samples from %u (%.1f s before now)\n",
+                  requested, start, (float)(now - start) / SAMPLE_RATE);
+}
+
+void replayReset() {
+    active = false;
+}
+
+bool replayActive() {
+    return active;
+}
+
+bool replaySendNext(uint32_t liveBacklog) {
+    if (!active) return false;
+    if (liveBacklog > maxLiveBacklog) maxLiveBacklog = liveBacklog;
+    if (liveBacklog > REPLAY_MAX_LIVE_LAG) return false;
+
+    // 履歴から消えた分は飛ばす（captureRead() の追い越し判定と同じく書き込み中の 1 ブロック分は余裕を取る）
+    uint32_t oldest = captureOldestIndex();
+    if (oldest > 0) oldest += CAPTURE_BLOCK_SAMPLES;
+    if ((int32_t)(oldest - cursor) > 0) {
+        uint32_t gap = (int32_t)(endIndex - oldest) > 0 ? oldest - cursor : endIndex - cursor;
+        skippedSamples += gap;
+        cursor += gap;
+    }
+
+    uint32_t remaining = endIndex - cursor;
+    size_t count = 0;
+    uint32_t timestamp = cursor;
+    if (remaining > 0) {
+        uint32_t dropped = 0;
+        count = captureRead(cursor, replayBuffer, min(remaining, (uint32_t)REPLAY_FRAME_SAMPLES), &dropped);
+        timestamp += dropped;
+        skippedSamples += dropped;
+        // 読む間に追い越されて範囲の外まで読んだ分は捨てる
+        if ((int32_t)(cursor - endIndex) > 0) {
+            uint32_t over = cursor - endIndex;
+            count = over < count ? count - over : 0;
+            cursor = endIndex;
+        }
+    }
+
+    bool last = cursor == endIndex;
+    if (!transportSendFrame(LINK_FRAME_REPLAY, last ? LINK_FLAG_REPLAY_LAST : 0,
+                            (const uint8_t*)replayBuffer, count * 2, timestamp)) {
+        // 切断（接続し直したら要求し直してもらう）
+        active = false;
+        return false;
+    }
+
+    if (firstFrameUs == 0) firstFrameUs = micros();
+    sentSamples += count;
+    sentFrames++;
+    if (last) finish();
+    return true;
+}
@@ -0,0 +1,33 @@
+/**
+ * 履歴の再送（インスタントリプレイ）
+ *
+ * 認識が崩れた箇所の元の音声を取り直すため、受信側が LINK_CTRL_REPLAY でサンプル番号の範囲を要求すると、
+ * キャプチャの履歴リング（capture.h、PSRAM に 30 秒）から読み出して LINK_FRAME_REPLAY で返す。
+ *   - ライブの送信は止めない。ライブの音声がたまるのを待つ間は再送を続けて送り、
+ *     ライブのフレームを送った直後にも 1 フレーム送る（ライブの遅れが REPLAY_MAX_LIVE_LAG_MS 以下のとき）
+ *   - 送るのは常に PCM（送信モードや省電力ティアに関係なく元の音声）
+ *   - 要求は 1 つだけ持ち、新しい要求が来たら置き換える
+ * 要求ごとに、受け取ってから最初のフレームと最後のフレームを送り終えるまでの時間・スループットを
+ * [replay] 行で出力する。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define REPLAY_FRAME_SAMPLES     1024   // 1 フレーム（ライブの PCM フレームと同じ 2KB）
+#define REPLAY_MAX_SECONDS       30     // 1 回の要求で返す上限
+#ifndef REPLAY_MAX_LIVE_LAG_MS
+#define REPLAY_MAX_LIVE_LAG_MS   250    // ライブの未送信がこれを超えたらライブを優先する
+#endif
+
+// 受信側からの要求（loop() の制御フレーム処理から）。start は LINK_REPLAY_LATEST も可
+void replayRequest(uint32_t start, uint32_t count);
+
+// 接続ごとに途中の要求を捨てる
+void replayReset();
+
+bool replayActive();
+
+// 再送を 1 フレーム送る（loop() から、liveBacklog はライブの未送信サンプル数）。送ったら true
+bool replaySendNext(uint32_t liveBacklog);
@@ -0,0 +1,146 @@
+/**
+ * サイドトーンの実装
+ */
+#include "sidetone.h"
+
+#include <Arduino.h>
+
+#include "capture.h"
+
+#if SIDETONE
+#include <driver/i2s.h>
+
+#define SIDETONE_I2S_NUMBER I2S_NUM_1
+
+static bool enabled = false;
+static volatile int volumePercent = SIDETONE_DEFAULT_VOLUME;
+static volatile bool muted = LATENCY_PROBE;   // 計測ではチャープのこだまを拾わないように
+
+static float gain = 0.0f;              // 現在のゲイン（目標へランプで近づける）
+static float dcPrevIn = 0.0f;
+static float dcPrevOut = 0.0f;
+
+static int16_t stereo[CAPTURE_BLOCK_SAMPLES * 2];
+
+static uint32_t blocks = 0;
+static uint32_t dropped = 0;
+static uint32_t processUsMax = 0;
+static uint64_t processUsTotal = 0;
+
+bool sidetoneBegin() {
+    i2s_config_t config = {
+        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
+        .sample_rate = SAMPLE_RATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .dma_buf_count = SIDETONE_DMA_BUF_COUNT,
+        .dma_buf_len = SIDETONE_DMA_BUF_LEN,
+        .use_apll = false,
+        .tx_desc_auto_clear = true,   // 書き込みが途切れたら無音
+        .fixed_mclk = 0
+    };
+
+    esp_err_t err = ESP_OK;
+    err += i2s_driver_install(SIDETONE_I2S_NUMBER, &config, 0, NULL);
+
+    i2s_pin_config_t pins;
+#if (ESP_IDF_VERSION > ESP_IDF_VERSION_VAL(4, 3, 0))
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+#endif
+    pins.bck_io_num = SIDETONE_BCK_PIN;
+    pins.ws_io_num = SIDETONE_WS_PIN;
+    pins.data_out_num = SIDETONE_DATA_PIN;
+    pins.data_in_num = I2S_PIN_NO_CHANGE;
+    err += i2s_set_pin(SIDETONE_I2S_NUMBER, &pins);
+
+    enabled = (err == ESP_OK);
+    if (enabled) {
+        Serial.printf("Sidetone: I2S1 BCK %d WS %d DATA %d\n", SIDETONE_BCK_PIN, SIDETONE_WS_PIN, SIDETONE_DATA_PIN);
+    }
+    return enabled;
+}
+
+bool sidetoneEnabled() {
+    return enabled;
+}
+
+void sidetoneProcess(const int16_t* samples, size_t count) {
+    if (!enabled) return;
+
+    unsigned long start = micros();
+    float target = muted ? 0.0f : volumePercent / 100.0f;
+    float step = (target - gain) / count;    // ブロック内でランプ（クリック防止）
+
+    for (size_t i = 0; i < count; i++) {
+        // DC 除去（1 次ハイパス、約 20Hz）
+        float x = samples[i];
+        float y = x - dcPrevIn + 0.992f * dcPrevOut;
+        dcPrevIn = x;
+        dcPrevOut = y;
+
+        gain += step;
+        float v = y * gain;
+        int16_t s = (int16_t)(v > 32767.0f ? 32767 : (v < -32768.0f ? -32768 : v));
+        stereo[2 * i] = s;
+        stereo[2 * i + 1] = s;
+    }
+    gain = target;
+    latencyProbeMix(stereo, count);
+
+    // 待たない（送信キューが満杯ならこのブロックは捨てて遅延を増やさない）
+    size_t written = 0;
+    i2s_write(SIDETONE_I2S_NUMBER, stereo, count * 4, &written, 0);
+    if (written < count * 4) dropped++;
+    blocks++;
+
+    uint32_t elapsed = micros() - start;
+    processUsTotal += elapsed;
+    if (elapsed > processUsMax) processUsMax = elapsed;
+}
+
+void sidetoneSetVolume(int percent) {
+    volumePercent = constrain(percent, 0, 100);
+}
+
+int sidetoneVolume() {
+    return volumePercent;
+}
+
+void sidetoneSetMuted(bool m) {
+    muted = m;
+}
+
+bool sidetoneMuted() {
+    return muted;
+}
+
+void sidetoneLogStats() {
+    if (!enabled || blocks == 0) return;
+
+    // 受信 DMA 1 段＋処理＋送信キュー（最大 SIDETONE_DMA_BUF_COUNT 段）
+    float blockMs = CAPTURE_BLOCK_SAMPLES * 1000.0f / SAMPLE_RATE;
+    float txMs = SIDETONE_DMA_BUF_COUNT * SIDETONE_DMA_BUF_LEN * 1000.0f / SAMPLE_RATE;
+    float processMs = processUsTotal / 1000.0f / blocks;
+    Serial.printf("[sidetone] latency ~%.1f ms (rx %.1f + proc %.2f + tx <=%.1f), max proc %.2f ms, "
+                  "%u/%u blocks dropped, vol %d%%%s\n",
+                  blockMs + processMs + txMs, blockMs, processMs, txMs, processUsMax / 1000.0f,
+                  dropped, blocks, volumePercent, muted ? " (muted)" : "");
+    blocks = dropped = 0;
+    processUsTotal = 0;
+    processUsMax = 0;
+}
+
+#else
+
+bool sidetoneBegin() { return false; }
+bool sidetoneEnabled() { return false; }
+void sidetoneProcess(const int16_t* samples, size_t count) {}
+void sidetoneSetVolume(int percent) {}
+int sidetoneVolume() { return 0; }
+void sidetoneSetMuted(bool muted) {}
+bool sidetoneMuted() { return true; }
+void sidetoneLogStats() {}
+
+#endif
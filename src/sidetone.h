@@ -0,0 +1,52 @@
+/**
+ * サイドトーン（マイク音のモニター出力）
+ *
+ * Core2 内蔵スピーカーのアンプ（NS4168）は LRCK に GPIO0 を使うが、GPIO0 は PDM マイクの
+ * クロックと共用なので、マイク受信中に内蔵スピーカーへ同時出力することはできない。
+ * そこで -DSIDETONE=1 のビルドでは I2S_NUM_1 を標準 I2S 送信で使い、
+ * 外付けの I2S アンプ／DAC（MAX98357A など、ピンは SIDETONE_*_PIN）に出力する。
+ *
+ * キャプチャタスクでブロックごとに DC 除去と音量を掛けて書き込む。送信キューが満杯なら
+ * そのブロックは捨てる（キャプチャと送信経路は待たせない）ので、遅延は DMA の段数で決まる。
+ * -DLATENCY_PROBE=1 のビルドでは同じ出力から遅延計測のチャープを鳴らす（latency_probe.h、モニターはミュートで始まる）。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "latency_probe.h"
+
+#ifndef SIDETONE
+#define SIDETONE LATENCY_PROBE
+#endif
+
+#ifndef SIDETONE_BCK_PIN
+#define SIDETONE_BCK_PIN   19
+#endif
+#ifndef SIDETONE_WS_PIN
+#define SIDETONE_WS_PIN    27
+#endif
+#ifndef SIDETONE_DATA_PIN
+#define SIDETONE_DATA_PIN  26   // Port B
+#endif
+
+#define SIDETONE_DMA_BUF_COUNT  2
+#define SIDETONE_DMA_BUF_LEN    32    // 2ms @16kHz
+#define SIDETONE_VOLUME_STEP    10
+#define SIDETONE_DEFAULT_VOLUME 50    // %
+
+// SIDETONE=0 のビルドでは false を返し、以降の呼び出しは何もしない
+bool sidetoneBegin();
+bool sidetoneEnabled();
+
+// キャプチャタスクから呼ぶ（他の処理より先に）
+void sidetoneProcess(const int16_t* samples, size_t count);
+
+void sidetoneSetVolume(int percent);
+int sidetoneVolume();
+void sidetoneSetMuted(bool muted);
+bool sidetoneMuted();
+
+// 遅延の内訳（受信 DMA・処理時間・送信キュー）をシリアルに出力
+void sidetoneLogStats();
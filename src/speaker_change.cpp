@@ -0,0 +1,144 @@
+/**
+ * 話者交代検出の実装
+ */
+#include "speaker_change.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct PushContext {
+    SpeakerChange* sc;
+    SpeakerChangeHandler handler;
+    void* context;
+};
+
+// 窓内の対角共分散の log|Σ|（frames 個、リング上の開始位置 start から）
+static float logDetDiag(const SpeakerChange& sc, int start, int frames) {
+    const int ringSize = 2 * SC_WINDOW_FRAMES;
+    float sum[SC_DIM] = {};
+    float sq[SC_DIM] = {};
+    for (int f = 0; f < frames; f++) {
+        const float* x = sc.features[(start + f) % ringSize];
+        for (int i = 0; i < SC_DIM; i++) {
+            sum[i] += x[i];
+            sq[i] += x[i] * x[i];
+        }
+    }
+    float logDet = 0.0f;
+    for (int i = 0; i < SC_DIM; i++) {
+        float mean = sum[i] / frames;
+        float var = sq[i] / frames - mean * mean;
+        logDet += logf(var > 1e-6f ? var : 1e-6f);
+    }
+    return logDet;
+}
+
+static float deltaBic(const SpeakerChange& sc) {
+    const int n1 = SC_WINDOW_FRAMES, n2 = SC_WINDOW_FRAMES, n = n1 + n2;
+    float whole = logDetDiag(sc, sc.pos, n);
+    float left = logDetDiag(sc, sc.pos, n1);
+    float right = logDetDiag(sc, sc.pos + n1, n2);
+    float penalty = SC_PENALTY * 0.5f * (2 * SC_DIM) * logf((float)n);
+    return 0.5f * (n * whole - n1 * left - n2 * right) - penalty;
+}
+
+static void onMelFrame(const float* logMel, uint32_t frameIndex, void* context) {
+    PushContext* pc = (PushContext*)context;
+    SpeakerChange& sc = *pc->sc;
+    sc.frames++;
+
+    float mfcc[SC_NUM_COEFFS];
+    for (int c = 0; c < SC_NUM_COEFFS; c++) {
+        const float* row = sc.dct + c * SC_NUM_MELS;
+        float v = 0.0f;
+        for (int m = 0; m < SC_NUM_MELS; m++) v += row[m] * logMel[m];
+        mfcc[c] = v;
+    }
+
+    // 無音ゲート（ノイズフロアは下がるときは即座に、上がるときはゆっくり追従）
+    float energy = mfcc[0] / sqrtf((float)SC_NUM_MELS);
+    if (!sc.floorValid || energy < sc.noiseFloor) {
+        sc.noiseFloor = energy;
+        sc.floorValid = true;
+    } else {
+        sc.noiseFloor += (energy - sc.noiseFloor) * 0.001f;
+    }
+    if (energy < sc.noiseFloor + SC_SPEECH_MARGIN) return;
+
+    const int ringSize = 2 * SC_WINDOW_FRAMES;
+    memcpy(sc.features[sc.pos], mfcc + 1, sizeof(sc.features[0]));
+    sc.frameIndex[sc.pos] = frameIndex;
+    sc.pos = (sc.pos + 1) % ringSize;
+    if (sc.filled < ringSize) sc.filled++;
+    sc.speechFrames++;
+
+    if (sc.filled < ringSize || ++sc.sinceEval < SC_EVAL_STRIDE) return;
+    sc.sinceEval = 0;
+    sc.evaluations++;
+
+    float score = deltaBic(sc);
+    uint32_t centerIndex = sc.frameIndex[(sc.pos + SC_WINDOW_FRAMES) % ringSize];
+    uint32_t centerFrame = sc.speechFrames - SC_WINDOW_FRAMES;
+
+    // 前回の境界から片側の窓以上離れた位置だけを候補にする
+    bool candidate = score > 0.0f && centerFrame - sc.lastBoundaryFrame >= SC_WINDOW_FRAMES;
+    if (candidate && (!sc.inPeak || score > sc.peakScore)) {
+        sc.inPeak = true;
+        sc.peakScore = score;
+        sc.peakIndex = centerIndex;
+        sc.peakFrame = centerFrame;
+        sc.peakAge = 0;
+        return;
+    }
+    if (!sc.inPeak) return;
+
+    // ΔBIC が 0 以下に戻るか、極大から半窓進んだら確定
+    sc.peakAge++;
+    if (score <= 0.0f || sc.peakAge * SC_EVAL_STRIDE >= SC_WINDOW_FRAMES / 2) {
+        sc.inPeak = false;
+        sc.lastBoundaryFrame = sc.peakFrame;
+        pc->handler(sc.peakIndex, sc.peakScore, pc->context);
+    }
+}
+
+bool speakerChangeInit(SpeakerChange& sc) {
+    // 25ms 窓 / 10ms ホップ / FFT 512 / 24 帯域（20Hz-7.6kHz）
+    MelFrontendConfig cfg = { 16000, 400, 160, 512, SC_NUM_MELS, 20.0f, 7600.0f };
+    if (!melFrontendInit(sc.frontend, cfg)) return false;
+
+    // 直交正規化 DCT-II
+    for (int c = 0; c < SC_NUM_COEFFS; c++) {
+        float norm = sqrtf((c == 0 ? 1.0f : 2.0f) / SC_NUM_MELS);
+        for (int m = 0; m < SC_NUM_MELS; m++) {
+            sc.dct[c * SC_NUM_MELS + m] = norm * cosf((float)M_PI * c * (m + 0.5f) / SC_NUM_MELS);
+        }
+    }
+
+    speakerChangeReset(sc, 0);
+    return true;
+}
+
+void speakerChangeFree(SpeakerChange& sc) {
+    melFrontendFree(sc.frontend);
+}
+
+void speakerChangeReset(SpeakerChange& sc, uint32_t nextIndex) {
+    melFrontendReset(sc.frontend, nextIndex);
+    sc.pos = 0;
+    sc.filled = 0;
+    sc.sinceEval = 0;
+    sc.floorValid = false;
+    sc.inPeak = false;
+    sc.speechFrames = 0;
+    sc.lastBoundaryFrame = 0;
+}
+
+void speakerChangePush(SpeakerChange& sc, const int16_t* samples, size_t count, uint32_t firstIndex,
+                       SpeakerChangeHandler handler, void* context) {
+    PushContext pc = { &sc, handler, context };
+    melFrontendPush(sc.frontend, samples, count, firstIndex, onMelFrame, &pc);
+}
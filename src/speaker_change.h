@@ -0,0 +1,66 @@
+/**
+ * 話者交代の検出（BIC、対角共分散）
+ *
+ * 25ms 窓 / 10ms ホップの MFCC（c1〜c12）を音声区間だけ蓄積し、
+ * 直近 2 秒を中央で分けたときに「1 つのガウス分布」より「2 つのガウス分布」の方が
+ * BIC で良く説明できれば話者交代の候補とする。候補の極大を境界として報告する。
+ *
+ *   ΔBIC = N/2 log|Σ| − N1/2 log|Σ1| − N2/2 log|Σ2| − λ · (d + d)/2 · log N
+ *
+ * Arduino に依存しないので、ホストの評価ツール（linux/ の m5scribe-spkbench）でも同じ処理を使う。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mel_frontend.h"
+
+#define SC_NUM_MELS       24
+#define SC_NUM_COEFFS     13       // c0（エネルギー）＋ c1〜c12
+#define SC_DIM            (SC_NUM_COEFFS - 1)
+#define SC_WINDOW_FRAMES  100      // 片側の窓（音声フレーム数、1 秒）
+#define SC_EVAL_STRIDE    10       // ΔBIC を評価する間隔（音声フレーム数）
+#define SC_SPEECH_MARGIN  1.0f     // 平均 log-mel がノイズフロア＋この値を超えたら音声
+#ifndef SC_PENALTY
+#define SC_PENALTY        1.5f     // BIC のペナルティ係数 λ（誤検出が多ければ上げる）
+#endif
+
+// 境界ごとに呼ばれる（sampleIndex は新しい話者の最初の音声フレームの先頭サンプル番号）
+typedef void (*SpeakerChangeHandler)(uint32_t sampleIndex, float score, void* context);
+
+struct SpeakerChange {
+    MelFrontend frontend;
+    float dct[SC_NUM_COEFFS * SC_NUM_MELS];    // DCT-II の係数表
+
+    // 音声フレームのリング（2 × SC_WINDOW_FRAMES）
+    float features[2 * SC_WINDOW_FRAMES][SC_DIM];
+    uint32_t frameIndex[2 * SC_WINDOW_FRAMES];
+    int pos = 0;                    // 次に書く位置（= 最古のフレーム）
+    int filled = 0;
+    int sinceEval = 0;
+
+    float noiseFloor = 0.0f;
+    bool floorValid = false;
+
+    // ΔBIC の極大探索
+    bool inPeak = false;
+    float peakScore = 0.0f;
+    uint32_t peakIndex = 0;         // 極大位置のサンプル番号
+    uint32_t peakFrame = 0;         // 極大位置（speechFrames 基準）
+    int peakAge = 0;                // 極大からの評価回数
+    uint32_t speechFrames = 0;      // 音声フレームの累計
+    uint32_t lastBoundaryFrame = 0; // 前回の境界（speechFrames 基準）
+
+    uint32_t frames = 0;            // 計算したフレーム数
+    uint32_t evaluations = 0;
+};
+
+bool speakerChangeInit(SpeakerChange& sc);
+void speakerChangeFree(SpeakerChange& sc);
+
+// 蓄積を捨てて nextIndex から始め直す（接続ごと）
+void speakerChangeReset(SpeakerChange& sc, uint32_t nextIndex);
+
+void speakerChangePush(SpeakerChange& sc, const int16_t* samples, size_t count, uint32_t firstIndex,
+                       SpeakerChangeHandler handler, void* context);
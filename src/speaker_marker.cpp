@@ -0,0 +1,104 @@
+/**
+ * 話者交代マーカー送信の実装
+ */
+#include "speaker_marker.h"
+
+#include <Arduino.h>
+#include <new>
+
+#include "speaker_change.h"
+#include "transport.h"
+
+#define MARKER_QUEUE_LENGTH 8
+
+struct MarkerEvent {
+    uint32_t sampleIndex;
+    float score;
+};
+
+static SpeakerChange* detector = nullptr;
+static QueueHandle_t markerQueue = nullptr;
+static volatile bool resetRequested = false;
+static volatile uint32_t resetIndex = 0;
+
+static uint64_t computeUs = 0;
+static uint32_t boundaries = 0;
+
+static void onBoundary(uint32_t sampleIndex, float score, void* context) {
+    MarkerEvent ev = { sampleIndex, score };
+    xQueueSend(markerQueue, &ev, 0);
+    boundaries++;
+}
+
+bool speakerMarkerBegin() {
+    // 両方そろってから detector を置く（キャプチャタスクは detector だけを見て呼ぶ）
+    SpeakerChange* sc = new (std::nothrow) SpeakerChange();
+    if (sc == nullptr) return false;
+    if (!speakerChangeInit(*sc)) {    // 失敗したときは speakerChangeInit() の中で解放済み
+        delete sc;
+        return false;
+    }
+    markerQueue = xQueueCreate(MARKER_QUEUE_LENGTH, sizeof(MarkerEvent));
+    if (markerQueue == nullptr) {
+        speakerChangeFree(*sc);
+        delete sc;
+        return false;
+    }
+
+    Serial.printf("Speaker change: %u B\n", sizeof(SpeakerChange) + melFrontendMemory(sc->frontend));
+    detector = sc;
+    return true;
+}
+
+void speakerMarkerReset(uint32_t nextIndex) {
+    if (!detector) return;
+    // 検出器はキャプチャタスクが持っているので、次のブロックでリセットしてもらう
+    resetIndex = nextIndex;
+    resetRequested = true;
+    xQueueReset(markerQueue);
+}
+
+void speakerMarkerProcess(const int16_t* samples, size_t count, uint32_t firstIndex) {
+    if (!detector) return;
+
+    if (resetRequested) {
+        speakerChangeReset(*detector, resetIndex);
+        resetRequested = false;
+    }
+
+    unsigned long start = micros();
+    speakerChangePush(*detector, samples, count, firstIndex, onBoundary, nullptr);
+    computeUs += micros() - start;
+}
+
+void speakerMarkerSendPending() {
+    if (!markerQueue) return;
+
+    MarkerEvent ev;
+    while (xQueueReceive(markerQueue, &ev, 0) == pdTRUE) {
+        float score = ev.score < 65535.0f ? ev.score : 65535.0f;
+        uint16_t s = (uint16_t)score;
+        uint8_t payload[4] = { LINK_MARKER_SPEAKER_CHANGE, 0, (uint8_t)(s & 0xFF), (uint8_t)(s >> 8) };
+        transportSendFrame(LINK_FRAME_MARKER, 0, payload, sizeof(payload), ev.sampleIndex);
+        Serial.printf("Speaker change at sample %u (dBIC %.0f)\n", ev.sampleIndex, ev.score);
+    }
+}
+
+void speakerMarkerLogStats() {
+    static unsigned long lastLog = 0;
+    static uint64_t lastUs = 0;
+    static uint32_t lastBoundaries = 0;
+
+    if (!detector) return;
+
+    unsigned long now = millis();
+    if (lastLog != 0) {
+        float seconds = (now - lastLog) / 1000.0f;
+        Serial.printf("[speaker] %u boundaries, cpu %.2f%%\n",
+                      boundaries - lastBoundaries,
+                      (computeUs - lastUs) / 10.0f / (seconds * 1000.0f));
+    }
+    lastUs = computeUs;
+    lastBoundaries = boundaries;
+    lastLog = now;
+}
@@ -0,0 +1,25 @@
+/**
+ * 話者交代マーカーの送信
+ *
+ * 接続中のキャプチャ経路で speaker_change.h の検出器を回し、境界を見つけたら
+ * LINK_FRAME_MARKER（LINK_MARKER_SPEAKER_CHANGE、タイムスタンプ＝境界のサンプル番号）を送る。
+ * 検出はキャプチャタスク、送信は loop() で行う。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+bool speakerMarkerBegin();
+
+// 接続ごとに蓄積をリセット（loop() から）
+void speakerMarkerReset(uint32_t nextIndex);
+
+// キャプチャタスクから呼ぶ（接続中のみ）
+void speakerMarkerProcess(const int16_t* samples, size_t count, uint32_t firstIndex);
+
+// 検出済みの境界を送信（loop() から）
+void speakerMarkerSendPending();
+
+// 前回呼び出しからの計算コストと境界数をシリアルに出力
+void speakerMarkerLogStats();
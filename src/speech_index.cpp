@@ -0,0 +1,199 @@
+/**
+ * 録音の発話区間インデックス（M5SI 形式）
+ */
+#include "speech_index.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "audio_kernels.h"
+
+static void putLe32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint32_t readLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 二乗和から dBFS（無音は -100）
+static float levelDb(double energy, uint32_t count) {
+    if (count == 0 || energy <= 0) return -100.0f;
+    return 10.0f * log10f((float)(energy / count)) - 90.309f;
+}
+
+static uint8_t packDb(float db) {
+    float v = db + 100.0f;
+    if (v < 0) v = 0;
+    if (v > 100) v = 100;
+    return (uint8_t)(v + 0.5f);
+}
+
+static void emitSegment(SpeechIndexBuilder& b, uint32_t samples) {
+    uint8_t record[5] = {
+        SPEECH_INDEX_SEGMENT,
+        packDb(levelDb(b.segmentEnergy, samples)),
+        packDb(levelDb((double)b.segmentPeak * b.segmentPeak, 1)),
+        packDb(b.floorDb),
+        (uint8_t)b.segmentSpeech,
+    };
+    b.writer(record, sizeof(record), b.context);
+    b.segmentEnergy = 0;
+    b.segmentPeak = 0;
+    b.segmentFill = 0;
+    b.segmentSpeech = 0;
+}
+
+static void closeRegion(SpeechIndexBuilder& b, uint32_t end) {
+    b.inRegion = false;
+    uint32_t minSpeech = b.sampleRate * SPEECH_INDEX_MIN_SPEECH_MS / 1000;
+    if (b.speechEnd - b.speechStart < minSpeech) return;
+
+    uint8_t record[9] = { SPEECH_INDEX_REGION };
+    putLe32(record + 1, b.regionStart);
+    putLe32(record + 5, end);
+    b.writer(record, sizeof(record), b.context);
+    b.lastRegionEnd = end;
+    b.regions++;
+    b.speechSamples += end - b.regionStart;
+}
+
+// 1 フレーム分のレベルがそろった（count は通常 frameSamples、最後だけ短い）
+static void endFrame(SpeechIndexBuilder& b, uint32_t count) {
+    uint32_t frameEnd = b.position;
+    uint32_t frameStart = frameEnd - count;
+    float db = levelDb((double)b.frameEnergy, count);
+
+    // ノイズフロア（下がるときはすぐ、上がるときはゆっくり）
+    if (!b.floorValid || db < b.floorDb) {
+        b.floorDb = db;
+        b.floorValid = true;
+    } else {
+        b.floorDb += SPEECH_INDEX_FLOOR_RISE_DB * SPEECH_INDEX_FRAME_MS / 1000.0f;
+    }
+    bool speech = db > SPEECH_INDEX_MIN_DBFS && db >= b.floorDb + SPEECH_INDEX_THRESHOLD_DB;
+
+    // 発話区間（前に PREROLL、後に HANGOVER の余裕を付け、HANGOVER 内の次の発話とはつなぐ）
+    uint32_t preroll = b.sampleRate * SPEECH_INDEX_PREROLL_MS / 1000;
+    uint32_t hangover = b.sampleRate * SPEECH_INDEX_HANGOVER_MS / 1000;
+    if (speech) {
+        if (!b.inRegion) {
+            b.inRegion = true;
+            b.regionStart = frameStart > preroll ? frameStart - preroll : 0;
+            if (b.regionStart < b.lastRegionEnd) b.regionStart = b.lastRegionEnd;
+            b.speechStart = frameStart;
+        }
+        b.speechEnd = frameEnd;
+    } else if (b.inRegion && frameEnd - b.speechEnd >= hangover) {
+        closeRegion(b, b.speechEnd + hangover);
+    }
+
+    // セグメントの要約
+    b.segmentEnergy += (double)b.frameEnergy;
+    if (b.framePeak > b.segmentPeak) b.segmentPeak = b.framePeak;
+    b.segmentFill++;
+    if (speech) b.segmentSpeech++;
+    if (b.segmentFill == b.segmentFrames) emitSegment(b, b.segmentFrames * b.frameSamples);
+
+    b.frameEnergy = 0;
+    b.framePeak = 0;
+    b.frameFill = 0;
+}
+
+void speechIndexInit(SpeechIndexBuilder& b, uint32_t sampleRate, SpeechIndexWriter writer, void* context) {
+    memset(&b, 0, sizeof(b));
+    b.sampleRate = sampleRate;
+    b.frameSamples = sampleRate * SPEECH_INDEX_FRAME_MS / 1000;
+    b.segmentFrames = SPEECH_INDEX_SEGMENT_MS / SPEECH_INDEX_FRAME_MS;
+    b.writer = writer;
+    b.context = context;
+}
+
+size_t speechIndexWriteHeader(uint8_t* out, uint32_t sampleRate) {
+    memcpy(out, SPEECH_INDEX_MAGIC, 4);
+    out[4] = SPEECH_INDEX_VERSION;
+    out[5] = 0;
+    out[6] = SPEECH_INDEX_SEGMENT_MS & 0xFF;
+    out[7] = SPEECH_INDEX_SEGMENT_MS >> 8;
+    putLe32(out + 8, sampleRate);
+    return SPEECH_INDEX_HEADER_SIZE;
+}
+
+void speechIndexPush(SpeechIndexBuilder& b, const int16_t* samples, size_t count) {
+    while (count > 0) {
+        size_t n = b.frameSamples - b.frameFill;
+        if (n > count) n = count;
+
+        AudioMeterResult meter;
+        audioKernels->meter(samples, n, meter);
+        b.frameEnergy += meter.sumSquares;
+        if (meter.peak > b.framePeak) b.framePeak = meter.peak;
+        b.frameFill += n;
+        b.position += n;
+        samples += n;
+        count -= n;
+
+        if (b.frameFill == b.frameSamples) endFrame(b, b.frameSamples);
+    }
+}
+
+void speechIndexFinish(SpeechIndexBuilder& b) {
+    uint32_t partial = b.frameFill;
+    if (partial > 0) endFrame(b, partial);
+    if (b.segmentFill > 0) emitSegment(b, (b.segmentFill - 1) * b.frameSamples + (partial ? partial : b.frameSamples));
+
+    if (b.inRegion) {
+        uint32_t end = b.speechEnd + b.sampleRate * SPEECH_INDEX_HANGOVER_MS / 1000;
+        closeRegion(b, end < b.position ? end : b.position);
+    }
+
+    uint8_t record[9] = { SPEECH_INDEX_END };
+    putLe32(record + 1, b.position);
+    putLe32(record + 5, b.speechSamples);
+    b.writer(record, sizeof(record), b.context);
+}
+
+uint32_t speechIndexReadHeader(const uint8_t* data, size_t length) {
+    if (length < SPEECH_INDEX_HEADER_SIZE || memcmp(data, SPEECH_INDEX_MAGIC, 4) != 0 ||
+        data[4] != SPEECH_INDEX_VERSION) {
+        return 0;
+    }
+    return readLe32(data + 8);
+}
+
+size_t speechIndexRecordSize(uint8_t type) {
+    switch (type) {
+    case SPEECH_INDEX_SEGMENT:
+        return 5;
+    case SPEECH_INDEX_REGION:
+    case SPEECH_INDEX_END:
+        return 9;
+    default:
+        return 0;
+    }
+}
+
+size_t speechIndexReadRecord(const uint8_t* data, size_t length, SpeechIndexRecord& out) {
+    if (length == 0) return 0;
+    size_t size = speechIndexRecordSize(data[0]);
+    if (size == 0 || length < size) return 0;
+
+    memset(&out, 0, sizeof(out));
+    out.type = data[0];
+    switch (out.type) {
+    case SPEECH_INDEX_SEGMENT:
+        out.segment = { data[1], data[2], data[3], data[4] };
+        break;
+    case SPEECH_INDEX_REGION:
+        out.region = { readLe32(data + 1), readLe32(data + 5) };
+        break;
+    case SPEECH_INDEX_END:
+        out.totalSamples = readLe32(data + 1);
+        out.speechSamples = readLe32(data + 5);
+        break;
+    }
+    return size;
+}
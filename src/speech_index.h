@@ -0,0 +1,121 @@
+/**
+ * 録音の発話区間インデックス（M5SI 形式）
+ *
+ * 録音を書きながら 20ms ごとのレベル（audioKernels->meter）から発話／無音を判定し、
+ * 1 秒ごとのエネルギー要約（セグメント）と、前後に余裕を付けた発話区間をレコードとして追記する。
+ * 同期では区間だけを（先に）取り出せば、ほとんど無音の録音全体を転送しなくて済む。
+ *
+ * ファイルは追記だけで書けるよう、ヘッダーの後にレコードを並べる。すべて LE。
+ *   [0-3]   "M5SI"
+ *   [4]     バージョン（1）
+ *   [5]     予約
+ *   [6-7]   セグメントの長さ（ms）
+ *   [8-11]  サンプルレート
+ *   [12..]  レコードの並び
+ *             'S' [平均 dB][ピーク dB][ノイズフロア dB][発話フレーム数]   セグメント（dB は dBFS + 100、0-100）
+ *             'R' [start u32][end u32]                                  発話区間（録音先頭からのサンプル番号、end は含まない）
+ *             'E' [総サンプル数 u32][区間の合計サンプル数 u32]          録音の終わり（閉じたときだけ）
+ *
+ * 判定はノイズフロア（下がるときはすぐ追従し、上がるときはゆっくり）から SPEECH_INDEX_THRESHOLD_DB 以上高い
+ * フレームを発話とする。Arduino に依存しないので Linux の評価ツール（m5scribe-syncbench）からも使う。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPEECH_INDEX_MAGIC            "M5SI"
+#define SPEECH_INDEX_VERSION          1
+#define SPEECH_INDEX_HEADER_SIZE      12
+#define SPEECH_INDEX_MAX_RECORD       9
+
+#define SPEECH_INDEX_FRAME_MS         20     // レベルを測る単位
+#define SPEECH_INDEX_SEGMENT_MS       1000   // 要約の単位
+#define SPEECH_INDEX_THRESHOLD_DB     9.0f   // ノイズフロアからの高さ
+#define SPEECH_INDEX_MIN_DBFS         -60.0f // これより小さいフレームは発話としない
+#define SPEECH_INDEX_FLOOR_RISE_DB    1.0f   // ノイズフロアが上がる速さ（dB/秒）
+#define SPEECH_INDEX_PREROLL_MS       200    // 区間の始まりをこれだけ前から
+#define SPEECH_INDEX_HANGOVER_MS      400    // 区間の終わりをこれだけ後まで（この間に次の発話があればつなぐ）
+#define SPEECH_INDEX_MIN_SPEECH_MS    100    // 発話がこれより短い区間は捨てる（クリック音など）
+
+enum SpeechIndexRecordType : uint8_t {
+    SPEECH_INDEX_SEGMENT = 'S',
+    SPEECH_INDEX_REGION  = 'R',
+    SPEECH_INDEX_END     = 'E',
+};
+
+struct SpeechSegment {
+    uint8_t meanDb;          // dBFS + 100
+    uint8_t peakDb;
+    uint8_t floorDb;
+    uint8_t speechFrames;    // 発話と判定したフレーム数
+};
+
+struct SpeechRegion {
+    uint32_t start;
+    uint32_t end;
+};
+
+struct SpeechIndexRecord {
+    uint8_t type;            // SpeechIndexRecordType
+    SpeechSegment segment;
+    SpeechRegion region;
+    uint32_t totalSamples;   // END
+    uint32_t speechSamples;  // END
+};
+
+// 作ったレコードの受け取り（書き込み先に追記する）
+typedef void (*SpeechIndexWriter)(const uint8_t* record, size_t length, void* context);
+
+struct SpeechIndexBuilder {
+    uint32_t sampleRate;
+    uint32_t frameSamples;
+    uint32_t segmentFrames;
+    SpeechIndexWriter writer;
+    void* context;
+
+    uint32_t position;           // 次に受け取るサンプル番号（録音先頭から）
+    float floorDb;
+    bool floorValid;
+
+    // 測定中のフレーム
+    int64_t frameEnergy;
+    int32_t framePeak;
+    uint32_t frameFill;
+
+    // 集計中のセグメント
+    double segmentEnergy;
+    int32_t segmentPeak;
+    uint32_t segmentFill;        // フレーム数
+    uint32_t segmentSpeech;
+
+    // 発話区間
+    bool inRegion;
+    uint32_t regionStart;
+    uint32_t speechStart;        // 区間内の最初の発話フレーム
+    uint32_t speechEnd;          // 区間内の最後の発話フレームの終わり
+    uint32_t lastRegionEnd;
+
+    uint32_t regions;
+    uint32_t speechSamples;      // 書き出した区間の合計
+};
+
+void speechIndexInit(SpeechIndexBuilder& b, uint32_t sampleRate, SpeechIndexWriter writer, void* context);
+
+// ヘッダー（SPEECH_INDEX_HEADER_SIZE バイト）を out に書く
+size_t speechIndexWriteHeader(uint8_t* out, uint32_t sampleRate);
+
+// 録音の続きを渡す（レコードができるたびに writer が呼ばれる）
+void speechIndexPush(SpeechIndexBuilder& b, const int16_t* samples, size_t count);
+
+// 途中の区間・セグメントを閉じて END を書く
+void speechIndexFinish(SpeechIndexBuilder& b);
+
+// ヘッダーを確かめてサンプルレートを返す（違えば 0）
+uint32_t speechIndexReadHeader(const uint8_t* data, size_t length);
+
+// 種別ごとのレコードのバイト数（未知なら 0）
+size_t speechIndexRecordSize(uint8_t type);
+
+// 先頭のレコードを読む（読んだバイト数、足りないか壊れていれば 0）
+size_t speechIndexReadRecord(const uint8_t* data, size_t length, SpeechIndexRecord& out);
@@ -0,0 +1,492 @@
+/**
+ * 送信路の実装（SPP / BLE GATT）
+ */
+#include "transport.h"
+
+#if TRANSPORT_BLE
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <BLE2902.h>
+#include <freertos/stream_buffer.h>
+#else
+#include <BluetoothSerial.h>
+#include <freertos/stream_buffer.h>
+#endif
+
+static TransportConnectionCallback connectionCallback = nullptr;
+static TransportControlCallback controlHandler = nullptr;
+static TransportStallCallback stallHandler = nullptr;
+static volatile bool connected = false;
+
+static uint16_t txSeq = 0;
+#if TRANSPORT_BLE || !SPP_PACKETISER
+static uint8_t txBuffer[LINK_FRAME_HEADER_SIZE + LINK_FRAME_MAX_PAYLOAD];
+#endif
+static LinkFrameParser rxParser;
+static TransportStats stats = {};
+
+static void handleRxFrame(const LinkFrameHeader& header, const uint8_t* payload, void* context);
+
+#if TRANSPORT_BLE
+// ============================================================
+// BLE GATT（Nordic UART 互換ではなく独自 UUID）
+// ============================================================
+
+#define BLE_SERVICE_UUID   "6e5a0001-5c7b-4d2e-9f3a-4d35536372b1"
+#define BLE_TX_CHAR_UUID   "6e5a0002-5c7b-4d2e-9f3a-4d35536372b1"  // 端末 → 受信側（notify）
+#define BLE_RX_CHAR_UUID   "6e5a0003-5c7b-4d2e-9f3a-4d35536372b1"  // 受信側 → 端末（write）
+
+#define BLE_LOCAL_MTU       517
+#define BLE_INITIAL_CREDITS 16   // 接続直後に受信側からの付与を待たずに送れる通知数
+#define BLE_DATA_LEN        251  // Data Length Extension の最大 LL ペイロード
+#define BLE_NOTIFY_OVERHEAD 7    // ATT（3）＋ L2CAP（4）ヘッダー
+
+// 接続間隔 15-30ms（1.25ms 単位）、スレーブレイテンシ 0、監視タイムアウト 4s（10ms 単位）
+#define BLE_CONN_INTERVAL_MIN 12
+#define BLE_CONN_INTERVAL_MAX 24
+#define BLE_CONN_TIMEOUT      400
+
+static BLEServer* bleServer = nullptr;
+static BLECharacteristic* bleTxChar = nullptr;
+static uint16_t bleConnId = 0;
+static volatile uint16_t blePeerMtu = 23;
+static volatile int32_t bleCredits = 0;
+static StreamBufferHandle_t bleRxStream = nullptr;
+
+class ScribeServerCallbacks : public BLEServerCallbacks {
+    void onConnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) override {
+        bleConnId = param->connect.conn_id;
+        bleCredits = BLE_INITIAL_CREDITS;
+        blePeerMtu = 23;
+
+        // 低消費電力寄りの接続パラメータと Data Length Extension を要求
+        server->updateConnParams(param->connect.remote_bda,
+                                 BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX, 0, BLE_CONN_TIMEOUT);
+        esp_ble_gap_set_pkt_data_len(param->connect.remote_bda, BLE_DATA_LEN);
+
+        connected = true;
+        if (connectionCallback) connectionCallback(true);
+    }
+
+    void onDisconnect(BLEServer* server) override {
+        connected = false;
+        bleCredits = 0;
+        if (connectionCallback) connectionCallback(false);
+    }
+
+    void onMtuChanged(BLEServer* server, esp_ble_gatts_cb_param_t* param) override {
+        blePeerMtu = param->mtu.mtu;
+        Serial.printf("BLE MTU negotiated: %d\n", blePeerMtu);
+    }
+};
+
+class ScribeRxCallbacks : public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* characteristic) override {
+        // BT タスクからは解析せず、loop() 側で処理する
+        std::string value = characteristic->getValue();
+        xStreamBufferSend(bleRxStream, value.data(), value.size(), 0);
+    }
+};
+
+static bool bleBegin(const char* deviceName) {
+    bleRxStream = xStreamBufferCreate(1024, 1);
+    if (bleRxStream == nullptr) return false;
+
+    BLEDevice::init(deviceName);
+    BLEDevice::setMTU(BLE_LOCAL_MTU);
+
+    bleServer = BLEDevice::createServer();
+    bleServer->setCallbacks(new ScribeServerCallbacks());
+
+    BLEService* service = bleServer->createService(BLE_SERVICE_UUID);
+    bleTxChar = service->createCharacteristic(BLE_TX_CHAR_UUID, BLECharacteristic::PROPERTY_NOTIFY);
+    bleTxChar->addDescriptor(new BLE2902());
+
+    BLECharacteristic* rxChar = service->createCharacteristic(
+        BLE_RX_CHAR_UUID, BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR);
+    rxChar->setCallbacks(new ScribeRxCallbacks());
+
+    service->start();
+
+    BLEAdvertising* advertising = BLEDevice::getAdvertising();
+    advertising->addServiceUUID(BLE_SERVICE_UUID);
+    advertising->setScanResponse(true);
+    return true;
+}
+
+static void bleDrainRx() {
+    uint8_t buf[128];
+    size_t n;
+    while ((n = xStreamBufferReceive(bleRxStream, buf, sizeof(buf), 0)) > 0) {
+        linkFrameParserPush(rxParser, buf, n, handleRxFrame, nullptr);
+    }
+}
+
+// フレームを MTU-3 バイトの通知に分割して送る（クレジット 1 つで通知 1 回）
+static bool bleWriteAll(const uint8_t* data, size_t length) {
+    size_t offset = 0;
+    while (offset < length && connected) {
+        if (bleCredits <= 0) {
+            unsigned long waitStart = millis();
+            while (bleCredits <= 0 && connected) {
+                bleDrainRx();
+                if (stallHandler) stallHandler();
+                delay(1);
+            }
+            stats.stallMs += millis() - waitStart;
+            continue;
+        }
+
+        size_t chunk = min((size_t)(blePeerMtu - 3), length - offset);
+        bleTxChar->setValue((uint8_t*)data + offset, chunk);
+        bleTxChar->notify();
+        bleCredits--;
+        stats.packets++;
+        stats.airPackets += (chunk + BLE_NOTIFY_OVERHEAD + BLE_DATA_LEN - 1) / BLE_DATA_LEN;
+        offset += chunk;
+    }
+    return offset == length;
+}
+
+#else
+// ============================================================
+// Classic SPP（BluetoothSerial）
+// ============================================================
+
+// 受信は BluetoothSerial の 512 バイトのキュー（あふれると捨てる）を通さず、onData() でここにためる。
+// いっぱいのときは BT タスクを最大 SPP_RX_WAIT_MS 待たせ、RFCOMM のフロー制御で送信側を止める
+#define SPP_RX_BUFFER   8192   // OTA のデータフレーム（2KB）を 3 つ先送りされても入る大きさ
+#define SPP_RX_WAIT_MS  200
+
+// 無線パケット数の見積もり（RFCOMM フレーム 1 つを 3-DH5 に載せる）
+#define SPP_AIR_PAYLOAD     1021   // 3-DH5 の最大ペイロード
+#define SPP_FRAME_OVERHEAD  10     // RFCOMM（アドレス・制御・長さ 2・クレジット・FCS）＋ L2CAP（4）
+
+static BluetoothSerial SerialBT;
+static StreamBufferHandle_t sppRxStream = nullptr;
+
+static uint32_t sppAirPackets(size_t rfcommBytes) {
+    return (rfcommBytes + SPP_FRAME_OVERHEAD + SPP_AIR_PAYLOAD - 1) / SPP_AIR_PAYLOAD;
+}
+
+#if SPP_PACKETISER
+// パケッタイザ: フレームの区切りに関係なく送信データを RFCOMM フレームの大きさ（SPP_PACKET_BYTES）に詰め、
+// 1 回の esp_spp_write で 1 フレームずつ渡す。BluetoothSerial の送信キュー（SPP_TX_MAX ごとの分割）は通さない。
+// 詰め切らない端数は次のフレームを待ち、SPP_COALESCE_MS（制御・OTA 応答を含むなら SPP_COALESCE_CONTROL_MS）で送る。
+// esp_spp_write はデータをコピーせず ESP_SPP_WRITE_EVT までポインタを持つので、送信データは必ず
+// sppPackets のどれかに詰めて渡す。RFCOMM の書き込みは順に完了するので、バッファは書き込みの通し番号で
+// 順に使い、ESP_SPP_WRITE_EVT（sppWritesDone の更新）で一番古いものを返す
+static uint32_t sppHandle = 0;
+static volatile uint32_t sppConnection = 0;      // 接続ごとに増える（前の接続の端数を捨てる）
+static volatile bool sppCongested = false;
+static uint32_t sppWritesIssued = 0;             // loop() のタスクだけが書く
+static volatile uint32_t sppWritesDone = 0;      // BT タスクだけが書く（ESP_SPP_WRITE_EVT）
+static uint8_t sppPackets[SPP_TX_INFLIGHT][SPP_PACKET_BYTES];
+static size_t sppPacketFill = 0;                 // 詰めている途中のバッファ（sppPackets[sppWritesIssued % SPP_TX_INFLIGHT]）
+static uint32_t sppPacketConnection = 0;
+static unsigned long sppFlushDue = 0;            // 端数を送る期限（sppPacketFill > 0 のとき）
+#endif
+
+static void sppOnData(const uint8_t* data, size_t length) {
+    size_t sent = xStreamBufferSend(sppRxStream, data, length, pdMS_TO_TICKS(SPP_RX_WAIT_MS));
+    if (sent < length) stats.rxDropped += length - sent;
+}
+
+static void sppCallback(esp_spp_cb_event_t event, esp_spp_cb_param_t* param) {
+    if (event == ESP_SPP_SRV_OPEN_EVT) {
+#if SPP_PACKETISER
+        sppHandle = param->srv_open.handle;
+        sppCongested = false;
+        sppWritesDone = sppWritesIssued;
+        sppConnection++;
+#endif
+        connected = true;
+        if (connectionCallback) connectionCallback(true);
+    } else if (event == ESP_SPP_CLOSE_EVT) {
+        connected = false;
+        if (connectionCallback) connectionCallback(false);
+    }
+#if SPP_PACKETISER
+    else if (event == ESP_SPP_CONG_EVT) {
+        sppCongested = param->cong.cong;
+    } else if (event == ESP_SPP_WRITE_EVT) {
+        sppCongested = param->write.cong;
+        sppWritesDone++;
+    }
+#endif
+}
+
+#if SPP_PACKETISER
+static bool sppAllBuffersInFlight() {
+    return sppWritesIssued - sppWritesDone >= SPP_TX_INFLIGHT;
+}
+
+static bool sppIsCongested() {
+    return sppCongested;
+}
+
+// busy() が偽になるまで待つ（切断されたら false）
+static bool sppWaitWhile(bool (*busy)()) {
+    if (busy()) {
+        unsigned long waitStart = millis();
+        while (busy() && connected) {
+            if (stallHandler) stallHandler();
+            delay(1);
+        }
+        stats.stallMs += millis() - waitStart;
+    }
+    return connected;
+}
+
+// 詰めたバッファを RFCOMM フレーム 1 つとして渡す（輻輳中は空くまで待つ）
+static bool sppFlushPacket() {
+    size_t length = sppPacketFill;
+    sppPacketFill = 0;
+    if (length == 0) return true;
+    if (!sppWaitWhile(sppIsCongested)) return false;
+
+    uint8_t* packet = sppPackets[sppWritesIssued % SPP_TX_INFLIGHT];
+    sppWritesIssued++;
+    if (esp_spp_write(sppHandle, length, packet) != ESP_OK) {
+        sppWritesIssued--;     // 完了イベントは来ないのでバッファはすぐ使える
+        return false;
+    }
+    stats.packets++;
+    stats.airPackets += sppAirPackets(length);
+    return true;
+}
+
+// 送信データを詰める（urgent なら端数の期限を SPP_COALESCE_CONTROL_MS に縮める）
+static bool sppQueue(const uint8_t* data, size_t length, bool urgent) {
+    if (sppPacketConnection != sppConnection) {
+        sppPacketFill = 0;
+        sppPacketConnection = sppConnection;
+    }
+
+    while (length > 0) {
+        if (sppPacketFill == 0) {
+            // 次のバッファがまだ送信中なら、一番古い書き込みの完了を待つ
+            if (!sppWaitWhile(sppAllBuffersInFlight)) return false;
+            sppFlushDue = millis() + SPP_COALESCE_MS;
+        }
+        size_t n = min(length, (size_t)(SPP_PACKET_BYTES - sppPacketFill));
+        memcpy(sppPackets[sppWritesIssued % SPP_TX_INFLIGHT] + sppPacketFill, data, n);
+        sppPacketFill += n;
+        if (sppPacketFill == SPP_PACKET_BYTES && !sppFlushPacket()) return false;
+        data += n;
+        length -= n;
+    }
+
+    if (urgent && sppPacketFill > 0) {
+        unsigned long due = millis() + SPP_COALESCE_CONTROL_MS;
+        if ((long)(due - sppFlushDue) < 0) sppFlushDue = due;
+    }
+    return true;
+}
+
+// 期限を過ぎた端数を送る
+static void sppFlushDuePacket() {
+    if (sppPacketFill > 0 && (long)(millis() - sppFlushDue) >= 0) {
+        if (sppPacketConnection != sppConnection || !connected) {
+            sppPacketFill = 0;
+        } else {
+            sppFlushPacket();
+        }
+    }
+}
+#else
+// 送信キューに入り切らない分は空くまで待って送り切る
+static bool sppWriteAll(const uint8_t* data, size_t length) {
+    size_t totalWritten = 0;
+    while (totalWritten < length && connected) {
+        size_t written = SerialBT.write(data + totalWritten, length - totalWritten);
+        stats.packets++;
+        if (written > 0) {
+            totalWritten += written;
+        } else {
+            if (stallHandler) stallHandler();
+            delay(1);  // 送信キューが空くまで待つ
+            stats.stallMs++;
+        }
+    }
+
+    // BluetoothSerial は SPP_TX_MAX（SPP_LIBRARY_TX_MAX）ごとに esp_spp_write する（送信タスクが
+    // 続けて書かれた分をまとめることもあるので目安）
+    for (size_t offset = 0; offset < totalWritten; offset += SPP_LIBRARY_TX_MAX) {
+        stats.airPackets += sppAirPackets(min((size_t)SPP_LIBRARY_TX_MAX, totalWritten - offset));
+    }
+    return totalWritten == length;
+}
+#endif
+
+#endif
+
+// 受信側からのフレーム
+static void handleRxFrame(const LinkFrameHeader& header, const uint8_t* payload, void* context) {
+    if ((header.type != LINK_FRAME_CONTROL && header.type != LINK_FRAME_OTA) || header.length == 0) return;
+
+#if TRANSPORT_BLE
+    if (header.type == LINK_FRAME_CONTROL && payload[0] == LINK_CTRL_CREDIT && header.length >= 3) {
+        bleCredits += payload[1] | (payload[2] << 8);
+        return;
+    }
+#endif
+
+    if (controlHandler) controlHandler(header, payload);
+}
+
+bool transportBegin(const char* deviceName, TransportConnectionCallback onConnection) {
+    connectionCallback = onConnection;
+    linkFrameParserReset(rxParser);
+
+#if TRANSPORT_BLE
+    return bleBegin(deviceName);
+#else
+    sppRxStream = xStreamBufferCreate(SPP_RX_BUFFER, 1);
+    if (sppRxStream == nullptr) return false;
+    if (!SerialBT.begin(deviceName, false)) return false;
+    SerialBT.register_callback(sppCallback);
+    SerialBT.onData(sppOnData);
+    return true;
+#endif
+}
+
+void transportSetControlHandler(TransportControlCallback handler) {
+    controlHandler = handler;
+}
+
+void transportSetStallHandler(TransportStallCallback handler) {
+    stallHandler = handler;
+}
+
+void transportEnableConnection() {
+#if TRANSPORT_BLE
+    BLEDevice::startAdvertising();
+#else
+    SerialBT.enableSSP();  // ペアリングモード有効
+#endif
+}
+
+void transportDisableConnection() {
+#if TRANSPORT_BLE
+    BLEDevice::stopAdvertising();
+#endif
+}
+
+void transportDisconnect() {
+#if TRANSPORT_BLE
+    if (connected) bleServer->disconnect(bleConnId);
+#else
+    SerialBT.disconnect();
+#endif
+    connected = false;
+}
+
+bool transportConnected() {
+    return connected;
+}
+
+bool transportSendFrame(uint8_t type, uint8_t flags, const uint8_t* payload, uint16_t length, uint32_t timestamp) {
+    if (!connected || length > LINK_FRAME_MAX_PAYLOAD) return false;
+
+    LinkFrameHeader header = { type, flags, length, txSeq++, timestamp };
+    size_t total = LINK_FRAME_HEADER_SIZE + length;
+
+#if TRANSPORT_BLE || !SPP_PACKETISER
+    linkFrameWriteHeader(txBuffer, header);
+    memcpy(txBuffer + LINK_FRAME_HEADER_SIZE, payload, length);
+#if TRANSPORT_BLE
+    bool ok = bleWriteAll(txBuffer, total);
+#else
+    bool ok = sppWriteAll(txBuffer, total);
+#endif
+#else
+    // 受信側が応答を待つフレームは端数を長く待たせない
+    uint8_t headerBytes[LINK_FRAME_HEADER_SIZE];
+    linkFrameWriteHeader(headerBytes, header);
+    bool urgent = type == LINK_FRAME_CONTROL || type == LINK_FRAME_OTA;
+    bool ok = sppQueue(headerBytes, sizeof(headerBytes), false) && sppQueue(payload, length, urgent);
+#endif
+
+    if (ok) {
+        stats.bytesSent += total;
+        stats.framesSent++;
+    }
+    return ok;
+}
+
+void transportPoll() {
+#if TRANSPORT_BLE
+    bleDrainRx();
+#else
+    uint8_t buf[256];
+    size_t n;
+    while ((n = xStreamBufferReceive(sppRxStream, buf, sizeof(buf), 0)) > 0) {
+        linkFrameParserPush(rxParser, buf, n, handleRxFrame, nullptr);
+    }
+#if SPP_PACKETISER
+    sppFlushDuePacket();
+#endif
+#endif
+}
+
+uint32_t transportFlushWaitMs() {
+#if !TRANSPORT_BLE && SPP_PACKETISER
+    if (sppPacketFill > 0) {
+        long remaining = (long)(sppFlushDue - millis());
+        return remaining > 0 ? remaining : 0;
+    }
+#endif
+    return UINT32_MAX;
+}
+
+const char* transportName() {
+#if TRANSPORT_BLE
+    return "BLE";
+#else
+    return "SPP";
+#endif
+}
+
+uint16_t transportMtu() {
+#if TRANSPORT_BLE
+    return blePeerMtu - 3;
+#elif SPP_PACKETISER
+    return SPP_PACKET_BYTES;
+#else
+    return ESP_SPP_MAX_MTU;
+#endif
+}
+
+void transportGetStats(TransportStats& out) {
+    out = stats;
+}
+
+void transportLogStats(float batteryCurrentMa) {
+    static unsigned long lastLog = 0;
+    static TransportStats last = {};
+
+    unsigned long now = millis();
+    float seconds = (now - lastLog) / 1000.0f;
+    if (connected && lastLog != 0) {
+        uint32_t bytes = stats.bytesSent - last.bytesSent;
+        uint32_t packets = stats.packets - last.packets;
+        uint32_t airPackets = stats.airPackets - last.airPackets;
+        Serial.printf("[link] %s %.1f kB/s, %u frames, %.0f B/packet, %.0f B/air packet, stall %u ms, mtu %u, "
+                      "battery %.1f mA\n",
+                      transportName(),
+                      bytes / seconds / 1000.0f,
+                      stats.framesSent - last.framesSent,
+                      packets > 0 ? (float)bytes / packets : 0.0f,
+                      airPackets > 0 ? (float)bytes / airPackets : 0.0f,
+                      stats.stallMs - last.stallMs,
+                      transportMtu(),
+                      batteryCurrentMa);
+        if (stats.rxDropped != last.rxDropped) {
+            Serial.printf("[link] receive buffer full, %u bytes dropped\n", stats.rxDropped - last.rxDropped);
+        }
+    }
+
+    last = stats;
+    lastLog = now;
+}
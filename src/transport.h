@@ -0,0 +1,70 @@
+/**
+ * 送信路の抽象化
+ *
+ * ビルドフラグで Classic SPP（BluetoothSerial）と BLE GATT を切り替える。
+ *   - デフォルト          : SPP
+ *   - -DTRANSPORT_BLE=1   : BLE GATT 通知（MTU ネゴシエーション＋クレジット制御）
+ *
+ * どちらも link_frame.h の同じフレーム形式で送受信する。
+ *
+ * SPP ではフレームをそのまま BluetoothSerial に渡すと SPP_TX_MAX（330 バイト）ごとに分割され、
+ * フレームの末尾が小さなパケットになる。パケッタイザ（SPP_PACKETISER）はフレームと制御メッセージを
+ * 区切りに関係なく RFCOMM フレームの大きさに詰めて送り、端数だけを少し待って次のフレームとまとめる。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "link_frame.h"
+
+#ifndef SPP_PACKETISER
+#define SPP_PACKETISER 1               // 0 で従来どおり BluetoothSerial に分割を任せる（比較用）
+#endif
+#define SPP_PACKET_BYTES        990    // RFCOMM 1 フレーム（ESP_SPP_MAX_MTU、3-DH5 1 つに収まる）
+#define SPP_LIBRARY_TX_MAX      330    // BluetoothSerial が 1 回に esp_spp_write する上限（SPP_TX_MAX）
+#ifndef SPP_COALESCE_MS
+#define SPP_COALESCE_MS         80     // 端数を次のフレームとまとめるために待つ上限（ライブの 1 フレーム 64ms より長く）。
+                                       // ライブの遅延はこの分まで増える
+#endif
+#define SPP_COALESCE_CONTROL_MS 5      // 制御・OTA 応答を含む端数
+#define SPP_TX_INFLIGHT         4      // 完了（ESP_SPP_WRITE_EVT）を待たずに渡す書き込み数（＝送信バッファの数）
+
+// 接続状態が変わったときに呼ばれる（Bluetooth スタックのタスクから呼ばれる）
+typedef void (*TransportConnectionCallback)(bool connected);
+// 受信側から届いた制御フレーム（LINK_FRAME_CONTROL / LINK_FRAME_OTA、loop() の transportPoll() から呼ばれる）
+typedef void (*TransportControlCallback)(const LinkFrameHeader& header, const uint8_t* payload);
+// 送信キュー／クレジットが空くのを待っている間に呼ばれる（loop() のタスク、SD 録音を止めないため）
+typedef void (*TransportStallCallback)();
+
+struct TransportStats {
+    uint32_t bytesSent;      // ヘッダー込みの送信バイト数
+    uint32_t framesSent;
+    uint32_t packets;        // 下位層への書き込み回数（SPP は RFCOMM フレーム、BLE は通知数）
+    uint32_t airPackets;     // 無線パケット数の見積もり（SPP は 3-DH5、BLE は 251 バイトの LL パケット）
+    uint32_t stallMs;        // 送信キュー／クレジット待ちの累計時間
+    uint32_t rxDropped;      // 受信バッファがあふれて捨てたバイト数（SPP）
+};
+
+bool transportBegin(const char* deviceName, TransportConnectionCallback onConnection);
+void transportSetControlHandler(TransportControlCallback handler);
+void transportSetStallHandler(TransportStallCallback handler);
+
+void transportEnableConnection();    // 接続受付開始（CONNECT ボタン）
+void transportDisableConnection();   // 接続受付終了（タイムアウト）
+void transportDisconnect();          // 切断（STOP ボタン）
+bool transportConnected();
+
+// 1 フレーム送信（送り切るか切断されるまでブロック）
+bool transportSendFrame(uint8_t type, uint8_t flags, const uint8_t* payload, uint16_t length, uint32_t timestamp);
+
+// 受信データの処理と、期限を過ぎた送信の端数の送出（loop() から定期的に呼ぶ）
+void transportPoll();
+
+// 送信の端数を送る期限までの時間（端数が無ければ UINT32_MAX、待機の上限に使う）
+uint32_t transportFlushWaitMs();
+
+const char* transportName();
+uint16_t transportMtu();
+void transportGetStats(TransportStats& out);
+
+// 前回呼び出しからのスループットと電流をシリアルに出力（SPP / BLE 比較用）
+void transportLogStats(float batteryCurrentMa);
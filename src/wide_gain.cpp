@@ -0,0 +1,70 @@
+/**
+ * 32bit 利得段と TPDF ディザの実装
+ */
+#include "wide_gain.h"
+
+#include <math.h>
+
+#include "hot_placement.h"
+
+#define DC_POLE_Q20   1044462     // (1 - 2π·10Hz/16kHz) * 2^20
+#define DC_FRAC_BITS  8           // 帰還の状態に残す端数
+
+static inline int32_t sat32(int64_t v) {
+    if (v > INT32_MAX) return INT32_MAX;
+    if (v < INT32_MIN) return INT32_MIN;
+    return (int32_t)v;
+}
+
+static inline int16_t sat16(int32_t v) {
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+void wideGainInit(WideGain& g, float gainDb, bool dcBlock) {
+    float linear = powf(10.0f, gainDb / 20.0f);
+    float maxLinear = (float)INT32_MAX / (1 << WIDE_GAIN_FRAC_BITS);
+    if (linear > maxLinear) linear = maxLinear;
+    g.gainQ24 = (int32_t)lrintf(linear * (1 << WIDE_GAIN_FRAC_BITS));
+    g.dcBlock = dcBlock;
+    g.x1 = 0;
+    g.y1 = 0;
+}
+
+HOT_FUNC(CAPTURE) void wideGainProcess(WideGain& g, int32_t* x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int64_t v = x[i];
+        if (g.dcBlock) {
+            // y = x - x1 + R * y1（y1 は端数 8bit 付き）
+            int64_t y = (v - g.x1) * (1 << DC_FRAC_BITS) + ((g.y1 * DC_POLE_Q20) >> 20);
+            g.x1 = (int32_t)v;
+            g.y1 = y;
+            v = sat32(y >> DC_FRAC_BITS);
+        }
+        x[i] = sat32((v * g.gainQ24) >> WIDE_GAIN_FRAC_BITS);
+    }
+}
+
+HOT_FUNC(CAPTURE) void wideFromInt16(const int16_t* x, int32_t* y, size_t n) {
+    for (size_t i = 0; i < n; i++) y[i] = (int32_t)x[i] * 65536;
+}
+
+HOT_FUNC(CAPTURE) void wideToInt16Round(const int32_t* x, int16_t* y, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        y[i] = sat16((int32_t)(((int64_t)x[i] + 32768) >> 16));
+    }
+}
+
+HOT_FUNC(READ) void wideToInt16Dither(TpdfDither& d, const int32_t* x, int16_t* y, size_t n) {
+    uint32_t s = d.state;
+    for (size_t i = 0; i < n; i++) {
+        // xorshift32 の上位・下位 16bit を 2 つの一様乱数として足す（-1 〜 +1 LSB の三角分布）
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        int32_t tpdf = (int32_t)(s >> 16) + (int32_t)(s & 0xFFFF) - 65535;
+        y[i] = sat16((int32_t)(((int64_t)x[i] + tpdf + 32768) >> 16));
+    }
+    d.state = s;
+}
@@ -0,0 +1,37 @@
+/**
+ * 32bit 固定小数点の利得段と 16bit への TPDF ディザ
+ *
+ * サンプルは int32（16bit フルスケール = 1 << 31、つまり int16 を 16bit 左に寄せた値）で扱い、
+ * DC 除去と利得を掛けても下位ビットを捨てない。16bit に落とすのは送信路で 1 回だけにし、
+ * そのとき三角分布（TPDF、±1 LSB）のディザを加えて量子化ひずみを雑音に変える。
+ * Arduino に依存しないので Linux の評価ツール（m5scribe-gainbench）からも使う。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WIDE_GAIN_FRAC_BITS 24    // 利得は Q8.24（最大 約 +42dB）
+
+struct WideGain {
+    int32_t gainQ24;
+    bool dcBlock;
+    int32_t x1;
+    int64_t y1;        // 端数 8bit 付きで保持（帰還で丸め誤差をためない）
+};
+
+struct TpdfDither {
+    uint32_t state = 0x12345678;
+};
+
+// dcBlock は 16kHz 前提（約 10Hz）
+void wideGainInit(WideGain& g, float gainDb, bool dcBlock);
+// その場で DC 除去と利得（飽和）
+void wideGainProcess(WideGain& g, int32_t* x, size_t n);
+
+// int16 → int32（16bit 左寄せ）
+void wideFromInt16(const int16_t* x, int32_t* y, size_t n);
+// int32 → int16（最近接丸め、解析用）
+void wideToInt16Round(const int32_t* x, int16_t* y, size_t n);
+// int32 → int16（TPDF ディザ、送信用）
+void wideToInt16Dither(TpdfDither& d, const int32_t* x, int16_t* y, size_t n);
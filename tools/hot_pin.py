@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+音声経路の区間のうちストールの多いものを IRAM / DRAM に置く設定（src/hot_pins.h）を作る
+
+-DHOT_PATH_PROBE=1 のビルド（m5stack-core2-hotpath）のシリアルログから [hot] 行を集め、
+区間ごとに命令側のストールの割合が --threshold % 以上のものを HOT_PIN_<区間> 1（関数を IRAM）、
+データ側が --threshold % 以上のものを HOT_DRAM_<区間> 1（その区間が読む定数表を DRAM）にする。
+データ側のストールは PSRAM の履歴や DMA バッファからも来るので、関数を IRAM に移す理由にはしない。
+書き出したら同じ環境でビルドし直して、もう一度ログを取り、--compare で前後のジッターを比べる。
+
+使い方:
+  python3 tools/hot_pin.py before.log                    # 判定だけ表示
+  python3 tools/hot_pin.py before.log -o src/hot_pins.h  # 書き出す
+  python3 tools/hot_pin.py --compare before.log after.log
+"""
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+REGIONS = ["capture", "read", "adpcm", "features"]  # src/hot_path.h の HotRegion の順
+HOT = re.compile(r"\[hot\] (\w+) (iram|flash): (\d+) calls, avg ([\d.]+) us, max ([\d.]+) us, sd ([\d.]+) us"
+                 r"(?:, istall ([\d.]+)%, dstall ([\d.]+)%)?")
+
+
+def read_log(path):
+    """区間 → 呼び出し回数で重み付けした平均（avg / sd / istall / dstall）と最大、配置"""
+    sums = defaultdict(lambda: defaultdict(float))
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = HOT.search(line)
+            if not m:
+                continue
+            name, place, calls = m.group(1), m.group(2), int(m.group(3))
+            s = sums[name]
+            s["calls"] += calls
+            s["place"] = place
+            s["max"] = max(s["max"], float(m.group(5)))
+            s["stalls"] = m.group(7) is not None
+            for key, group in (("avg", 4), ("sd", 6), ("istall", 7), ("dstall", 8)):
+                if m.group(group) is not None:
+                    s[key] += float(m.group(group)) * calls
+    for s in sums.values():
+        for key in ("avg", "sd", "istall", "dstall"):
+            s[key] /= s["calls"]
+    return sums
+
+
+def write_pins(path, pins, drams, source):
+    lines = [
+        "/**",
+        " * IRAM / DRAM に置く音声経路の区間（hot_placement.h）",
+        " *",
+        " * tools/hot_pin.py が -DHOT_PATH_PROBE=1 のビルドの [hot] 行から生成する。手で書き換えてもよい。",
+        f" * 生成元: {source}",
+        " */",
+        "#pragma once",
+        "",
+    ]
+    for prefix, chosen in (("HOT_PIN", pins), ("HOT_DRAM", drams)):
+        for name in REGIONS:
+            macro = f"{prefix}_{name.upper()}"
+            lines += [f"#ifndef {macro}", f"#define {macro:<17} {1 if chosen.get(name) else 0}", "#endif"]
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def compare(before_path, after_path):
+    before, after = read_log(before_path), read_log(after_path)
+    print(f"{'region':<10} {'place':>13} {'avg us':>15} {'max us':>15} {'sd us':>13} {'istall %':>13} "
+          f"{'dstall %':>13}")
+    for name in REGIONS:
+        if name not in before or name not in after:
+            continue
+        b, a = before[name], after[name]
+        print(f"{name:<10} {b['place']:>5} > {a['place']:<5} {b['avg']:>6.1f} > {a['avg']:<6.1f} "
+              f"{b['max']:>6.1f} > {a['max']:<6.1f} {b['sd']:>5.1f} > {a['sd']:<5.1f} "
+              f"{b['istall']:>5.1f} > {a['istall']:<5.1f} {b['dstall']:>5.1f} > {a['dstall']:<5.1f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="+", help="シリアルのログ（--compare では前と後の 2 つ）")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="IRAM（命令側）/ DRAM（データ側）に置くストールの割合（%%）")
+    parser.add_argument("-o", "--output", help="hot_pins.h の書き出し先（省略時は判定の表示だけ）")
+    parser.add_argument("--compare", action="store_true", help="2 つのログの区間ごとの時間とジッターを比べる")
+    args = parser.parse_args()
+
+    if args.compare:
+        if len(args.log) != 2:
+            sys.exit("--compare needs two logs (before, after)")
+        compare(*args.log)
+        return
+
+    if len(args.log) != 1:
+        sys.exit("give one log (or --compare before.log after.log)")
+    sums = read_log(args.log[0])
+    if not sums:
+        sys.exit("no [hot] lines in the log (build with -e m5stack-core2-hotpath)")
+
+    pins, drams = {}, {}
+    for name in REGIONS:
+        if name not in sums:
+            print(f"{name:<10} no samples -> flash")
+            continue
+        s = sums[name]
+        if not s["stalls"]:
+            sys.exit("the log has no stall counts (SDK without perfmon); edit src/hot_pins.h by hand")
+        pins[name] = s["istall"] >= args.threshold
+        drams[name] = s["dstall"] >= args.threshold
+        print(f"{name:<10} {int(s['calls']):>7} calls, avg {s['avg']:.1f} us, sd {s['sd']:.1f} us, "
+              f"istall {s['istall']:.1f}% -> {'iram' if pins[name] else 'flash'}, "
+              f"dstall {s['dstall']:.1f}% -> tables {'dram' if drams[name] else 'flash'}")
+
+    if args.output:
+        write_pins(args.output, pins, drams, args.log[0])
+        print(f"wrote {args.output}")
+
+
+if __name__ == "__main__":
+    main()
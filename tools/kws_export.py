@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""
+ウェイクワードモデル（DS-CNN）を firmware 用の /kws.bin に変換する
+
+入力は学習済み Keras モデルの重みを書き出した .npz。各層 i について:
+
+  layer{i}_type     "conv" | "dwconv" | "avgpool" | "fc"
+  layer{i}_w        Keras の kernel（Conv2D: [kh,kw,in,out] / DepthwiseConv2D: [kh,kw,ch,1] / Dense: [in,out]）
+  layer{i}_b        bias（BatchNorm は事前に畳み込んでおく）
+  layer{i}_stride   [sh, sw]（conv / dwconv のみ）
+  layer{i}_relu     1 なら ReLU
+  layer{i}_act_max  校正データでの出力の最大絶対値（出力スケールの決定に使う）
+
+モデル全体:
+
+  num_frames, num_coeffs, num_classes, target_class, threshold, input_max
+
+使い方:
+  python3 tools/kws_export.py model.npz data/kws.bin
+  pio run --target uploadfs
+"""
+import struct
+import sys
+
+import numpy as np
+
+LAYER_TYPES = {"conv": 1, "dwconv": 2, "avgpool": 3, "fc": 4}
+
+
+def quantize_weights(w):
+    scale = max(float(np.abs(w).max()), 1e-8) / 127.0
+    q = np.clip(np.round(w / scale), -127, 127).astype(np.int8)
+    return q, scale
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(2)
+
+    npz = np.load(sys.argv[1])
+    num_layers = sum(1 for k in npz.files if k.endswith("_type"))
+    input_scale = float(npz["input_max"]) / 127.0
+
+    out = bytearray()
+    out += struct.pack("<4sHHHHHHff", b"KWS1",
+                       int(npz["num_frames"]), int(npz["num_coeffs"]),
+                       int(npz["num_classes"]), int(npz["target_class"]),
+                       num_layers, 0, input_scale, float(npz["threshold"]))
+
+    in_scale = input_scale
+    channels = 1
+    for i in range(num_layers):
+        kind = str(npz[f"layer{i}_type"])
+        type_id = LAYER_TYPES[kind]
+
+        if kind == "avgpool":
+            out += struct.pack("<BBBBBBHHHff", type_id, 0, 0, 0, 0, 0,
+                               channels, channels, 0, 1.0, in_scale)
+            continue
+
+        w = npz[f"layer{i}_w"].astype(np.float32)
+        b = npz[f"layer{i}_b"].astype(np.float32)
+        relu = int(npz[f"layer{i}_relu"])
+        out_scale = float(npz[f"layer{i}_act_max"]) / 127.0
+
+        if kind == "conv":
+            kh, kw, cin, cout = w.shape
+            w = w.transpose(3, 0, 1, 2)          # → [out][kh][kw][in]
+            sh, sw = (int(s) for s in npz[f"layer{i}_stride"])
+        elif kind == "dwconv":
+            kh, kw, cin, _ = w.shape
+            cout = cin
+            w = w[:, :, :, 0]                    # → [kh][kw][ch]
+            sh, sw = (int(s) for s in npz[f"layer{i}_stride"])
+        else:  # fc
+            cin, cout = w.shape
+            w = w.transpose(1, 0)                # → [out][in]
+            kh = kw = sh = sw = 0
+
+        qw, w_scale = quantize_weights(w)
+        qb = np.round(b / (in_scale * w_scale)).astype(np.int32)
+
+        out += struct.pack("<BBBBBBHHHff", type_id, kh, kw, sh, sw, relu,
+                           cin, cout, 0, w_scale, out_scale)
+        out += qw.tobytes()
+        out += b"\0" * (-len(out) % 4)           # bias は 4 バイト境界
+        out += qb.astype("<i4").tobytes()
+
+        in_scale = out_scale
+        channels = cout
+
+    with open(sys.argv[2], "wb") as f:
+        f.write(out)
+    print(f"wrote {sys.argv[2]}: {num_layers} layers, {len(out)} bytes")
+
+
+if __name__ == "__main__":
+    main()
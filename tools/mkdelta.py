@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+2 つのファームウェアイメージの差分（M5D1 形式、src/ota_delta.h）を作る
+
+元イメージを BLOCK バイトの窓で索引し、新イメージの各位置で一致を探して前後に伸ばす。
+一致した範囲は COPY、それ以外は DATA として書く。作った差分は適用して新イメージに戻ることを確かめる。
+
+元イメージは端末で動いている firmware.bin そのもの（USB で書いたもの、または前回 OTA で送ったもの）。
+端末は動作中のパーティションの先頭から同じバイト数の SHA-256 を取って照合する。
+
+使い方:
+  python3 tools/mkdelta.py old/firmware.bin .pio/build/m5stack-core2/firmware.bin update.m5d
+"""
+import hashlib
+import struct
+import sys
+
+MAGIC = b"M5D1"
+OP_END = 0x00
+OP_COPY = 0x01
+OP_DATA = 0x02
+
+BLOCK = 32      # 一致とみなす最小の長さ（COPY 命令 9 バイトより十分長く）
+STRIDE = 4      # 元イメージを索引する間隔（一致が BLOCK + STRIDE 以上あれば見つかる）
+
+
+def match_length(src, s, dst, d):
+    """src[s:] と dst[d:] の先頭から一致する長さ"""
+    n = 0
+    limit = min(len(src) - s, len(dst) - d)
+    # 64 バイト単位で比べてから 1 バイトずつ
+    while n + 64 <= limit and src[s + n:s + n + 64] == dst[d + n:d + n + 64]:
+        n += 64
+    while n < limit and src[s + n] == dst[d + n]:
+        n += 1
+    return n
+
+
+def make_delta(src, dst):
+    index = {}
+    for i in range(0, len(src) - BLOCK + 1, STRIDE):
+        index.setdefault(src[i:i + BLOCK], i)
+
+    out = bytearray()
+    out += struct.pack("<4sI32sI32s", MAGIC, len(src), hashlib.sha256(src).digest(),
+                       len(dst), hashlib.sha256(dst).digest())
+    stats = {"copies": 0, "copied": 0, "literals": 0, "literal_bytes": 0}
+
+    def emit_literal(start, end):
+        if end > start:
+            out.extend(struct.pack("<BI", OP_DATA, end - start))
+            out.extend(dst[start:end])
+            stats["literals"] += 1
+            stats["literal_bytes"] += end - start
+
+    literal_start = 0
+    p = 0
+    while p + BLOCK <= len(dst):
+        s = index.get(dst[p:p + BLOCK])
+        if s is None:
+            p += 1
+            continue
+
+        # 未確定の DATA の範囲まで後ろに伸ばす
+        back = 0
+        while back < p - literal_start and back < s and src[s - back - 1] == dst[p - back - 1]:
+            back += 1
+        s -= back
+        d = p - back
+        n = match_length(src, s, dst, d)
+
+        emit_literal(literal_start, d)
+        out += struct.pack("<BII", OP_COPY, s, n)
+        stats["copies"] += 1
+        stats["copied"] += n
+        p = d + n
+        literal_start = p
+
+    emit_literal(literal_start, len(dst))
+    out.append(OP_END)
+    return bytes(out), stats
+
+
+def apply_delta(src, delta):
+    """ota_delta.cpp と同じ手順で適用する（検証用）"""
+    magic, src_size, src_sha, dst_size, dst_sha = struct.unpack_from("<4sI32sI32s", delta, 0)
+    if magic != MAGIC or src_size != len(src) or hashlib.sha256(src).digest() != src_sha:
+        raise ValueError("delta does not match the source image")
+    out = bytearray()
+    pos = struct.calcsize("<4sI32sI32s")
+    while True:
+        op = delta[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            s, n = struct.unpack_from("<II", delta, pos)
+            pos += 8
+            out += src[s:s + n]
+        elif op == OP_DATA:
+            (n,) = struct.unpack_from("<I", delta, pos)
+            pos += 4
+            out += delta[pos:pos + n]
+            pos += n
+        else:
+            raise ValueError(f"unknown op {op:#x}")
+    if pos != len(delta) or len(out) != dst_size or hashlib.sha256(out).digest() != dst_sha:
+        raise ValueError("delta does not reproduce the target image")
+    return bytes(out)
+
+
+def main():
+    if len(sys.argv) != 4:
+        print(__doc__)
+        sys.exit(2)
+
+    with open(sys.argv[1], "rb") as f:
+        src = f.read()
+    with open(sys.argv[2], "rb") as f:
+        dst = f.read()
+
+    delta, stats = make_delta(src, dst)
+    apply_delta(src, delta)
+
+    with open(sys.argv[3], "wb") as f:
+        f.write(delta)
+    print(f"{sys.argv[3]}: {len(delta)} bytes for a {len(dst)} byte image ({100.0 * len(delta) / len(dst):.1f}%), "
+          f"{stats['copies']} copies ({stats['copied']} bytes), "
+          f"{stats['literals']} literals ({stats['literal_bytes']} bytes)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+"""
+Bluetooth（SPP / RFCOMM）でファームウェアを更新する（src/ota_update.h）
+
+--base に端末で動いているイメージを渡すと差分（tools/mkdelta.py）を送り、無ければイメージ全体を送る。
+データは OTA_CHUNK バイトずつ、確認を待たずに OTA_WINDOW 個まで先に送る
+（端末の受信バッファ SPP_RX_BUFFER に収まる数）。
+応答が途切れたら同じ接続で BEGIN を送り直し、それでもだめなら接続し直して、端末が返した位置から続ける。
+終了時に転送時間と、同じ速度でイメージ全体を送った場合の見積もりを表示する。
+
+接続先は Bluetooth アドレス（RFCOMM チャンネル 1 に直接接続）か、'rfcomm bind' したデバイスファイル。
+m5scribed などほかの受信側は切断しておくこと。
+
+使い方:
+  python3 tools/ota_push.py AA:BB:CC:DD:EE:FF .pio/build/m5stack-core2/firmware.bin --base old/firmware.bin
+  python3 tools/ota_push.py /dev/rfcomm0 .pio/build/m5stack-core2/firmware.bin
+"""
+import argparse
+import hashlib
+import os
+import select
+import socket
+import struct
+import sys
+import termios
+import time
+import tty
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import mkdelta  # noqa: E402
+
+# src/link_frame.h
+FRAME_SYNC = b"M5"
+FRAME_HEADER = struct.Struct("<2sBBHHI")
+FRAME_OTA = 0x05
+
+OTA_BEGIN = 0x01
+OTA_DATA = 0x02
+OTA_END = 0x03
+OTA_STATUS = 0x81
+OTA_FULL = 0
+OTA_DELTA = 1
+
+STATUS_NAMES = {
+    0: "ok", 1: "done", 2: "not started", 3: "offset", 4: "no OTA slot",
+    5: "source image mismatch", 6: "bad format", 7: "flash error", 8: "verify failed",
+}
+STATUS_OK = 0
+STATUS_DONE = 1
+STATUS_OFFSET = 3
+
+OTA_CHUNK = 2048
+OTA_WINDOW = 3
+STATUS_TIMEOUT = 10.0     # 最初の差分データで動作中のイメージのハッシュを取るので長め
+END_TIMEOUT = 60.0        # 書き込んだイメージの読み戻しと検証
+RECONNECT_TRIES = 10
+RECONNECT_DELAY = 3.0
+
+
+class Link:
+    """RFCOMM ソケットまたはデバイスファイル"""
+
+    def __init__(self, target):
+        self.target = target
+        self.sock = None
+        self.fd = None
+        self.rx = bytearray()
+        self.seq = 0
+        if ":" in target and not target.startswith("/"):
+            self.sock = socket.socket(socket.AF_BLUETOOTH, socket.SOCK_STREAM, socket.BTPROTO_RFCOMM)
+            self.sock.connect((target, 1))
+        else:
+            self.fd = os.open(target, os.O_RDWR | os.O_NOCTTY)
+            tty.setraw(self.fd)
+            termios.tcflush(self.fd, termios.TCIOFLUSH)
+
+    def close(self):
+        if self.sock:
+            self.sock.close()
+        if self.fd is not None:
+            os.close(self.fd)
+
+    def send_frame(self, frame_type, payload):
+        data = FRAME_HEADER.pack(FRAME_SYNC, frame_type, 0, len(payload), self.seq & 0xFFFF, 0) + payload
+        self.seq += 1
+        if self.sock:
+            self.sock.sendall(data)
+        else:
+            view = memoryview(data)
+            while view:
+                view = view[os.write(self.fd, view):]
+
+    def _read_some(self, timeout):
+        source = self.sock if self.sock else self.fd
+        ready, _, _ = select.select([source], [], [], timeout)
+        if not ready:
+            return False
+        data = self.sock.recv(4096) if self.sock else os.read(self.fd, 4096)
+        if not data:
+            raise ConnectionError("link closed")
+        self.rx += data
+        return True
+
+    def recv_ota_status(self, timeout):
+        """次の LINK_OTA_STATUS（status, offset）。音声などほかのフレームは読み捨てる"""
+        deadline = time.monotonic() + timeout
+        while True:
+            while len(self.rx) >= FRAME_HEADER.size:
+                start = self.rx.find(FRAME_SYNC)
+                if start < 0:
+                    del self.rx[:-1]
+                    break
+                del self.rx[:start]
+                if len(self.rx) < FRAME_HEADER.size:
+                    break
+                _, frame_type, _, length, _, _ = FRAME_HEADER.unpack_from(self.rx, 0)
+                if len(self.rx) < FRAME_HEADER.size + length:
+                    break
+                payload = bytes(self.rx[FRAME_HEADER.size:FRAME_HEADER.size + length])
+                del self.rx[:FRAME_HEADER.size + length]
+                if frame_type == FRAME_OTA and length >= 6 and payload[0] == OTA_STATUS:
+                    return payload[1], struct.unpack_from("<I", payload, 2)[0]
+            remaining = deadline - time.monotonic()
+            if remaining <= 0 or not self._read_some(remaining):
+                raise TimeoutError("no status from device")
+
+
+def push(link_factory, payload, kind, image):
+    """payload を送り切って END まで。戻り値は（転送秒数、再接続回数）"""
+    begin = struct.pack("<BBII32s", OTA_BEGIN, kind, len(payload), len(image), hashlib.sha256(image).digest())
+    start = time.monotonic()
+    reconnects = 0
+    link = None
+    timed_out = False
+
+    while True:
+        try:
+            if link is None:
+                link = link_factory()
+            link.send_frame(FRAME_OTA, begin)
+            status, acked = link.recv_ota_status(STATUS_TIMEOUT)
+            if status != STATUS_OK:
+                raise RuntimeError(f"BEGIN refused: {STATUS_NAMES.get(status, status)}")
+            if acked > 0:
+                print(f"resuming at {acked}/{len(payload)}")
+
+            next_offset = acked
+            outstanding = 0
+            rewound_to = None
+            last_report = 0
+            while acked < len(payload):
+                while next_offset < len(payload) and outstanding < OTA_WINDOW:
+                    chunk = payload[next_offset:next_offset + OTA_CHUNK]
+                    link.send_frame(FRAME_OTA, struct.pack("<BI", OTA_DATA, next_offset) + chunk)
+                    next_offset += len(chunk)
+                    outstanding += 1
+
+                status, offset = link.recv_ota_status(STATUS_TIMEOUT)
+                timed_out = False
+                outstanding = max(0, outstanding - 1)
+                if status == STATUS_OK:
+                    acked = max(acked, offset)
+                elif status == STATUS_OFFSET:
+                    # 欠けたので送り直す（巻き戻し前に送った分の応答も同じ位置を返すので 1 回だけ）
+                    if offset != rewound_to:
+                        rewound_to = offset
+                        acked = next_offset = offset
+                        outstanding = 0
+                else:
+                    raise RuntimeError(f"update failed at {offset}: {STATUS_NAMES.get(status, status)}")
+
+                if acked - last_report >= len(payload) // 10:
+                    elapsed = time.monotonic() - start
+                    print(f"{100 * acked // len(payload):3d}%  {acked}/{len(payload)}  {acked / elapsed / 1000:.1f} kB/s")
+                    last_report = acked
+
+            # END（まだ届いていない DATA の応答は読み捨てる）
+            seconds = time.monotonic() - start
+            link.send_frame(FRAME_OTA, bytes([OTA_END]))
+            status, offset = link.recv_ota_status(END_TIMEOUT)
+            while status in (STATUS_OK, STATUS_OFFSET) and offset == len(payload):
+                status, offset = link.recv_ota_status(END_TIMEOUT)
+            if status != STATUS_DONE:
+                raise RuntimeError(f"END refused: {STATUS_NAMES.get(status, status)} at {offset}")
+            link.close()
+            return seconds, reconnects
+
+        except (OSError, ConnectionError) as e:
+            # 応答が 1 つ欠けただけなら、同じ接続で位置を問い合わせて続ける
+            if isinstance(e, TimeoutError) and link is not None and not timed_out:
+                timed_out = True
+                print(f"{e}, asking for the current position")
+                continue
+            timed_out = False
+            if link is not None:
+                link.close()
+                link = None
+            reconnects += 1
+            if reconnects > RECONNECT_TRIES:
+                raise
+            print(f"link lost ({e}), reconnecting in {RECONNECT_DELAY:.0f} s")
+            time.sleep(RECONNECT_DELAY)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bluetooth firmware update for M5Scribe")
+    parser.add_argument("device", help="Bluetooth address or rfcomm device file")
+    parser.add_argument("image", help="new firmware.bin")
+    parser.add_argument("--base", help="firmware.bin currently running on the device (sends a delta)")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read()
+        payload, _ = mkdelta.make_delta(base, image)
+        mkdelta.apply_delta(base, payload)
+        kind = OTA_DELTA
+        print(f"delta: {len(payload)} bytes for a {len(image)} byte image ({100.0 * len(payload) / len(image):.1f}%)")
+    else:
+        payload = image
+        kind = OTA_FULL
+        print(f"full image: {len(image)} bytes")
+
+    try:
+        seconds, reconnects = push(lambda: Link(args.device), payload, kind, image)
+    except RuntimeError as e:
+        print(f"error: {e}")
+        sys.exit(1)
+
+    rate = len(payload) / seconds
+    print(f"sent {len(payload)} bytes in {seconds:.1f} s ({rate / 1000:.1f} kB/s, {reconnects} reconnects)")
+    if kind == OTA_DELTA:
+        print(f"full image at this rate: ~{len(image) / rate:.1f} s ({len(image) / len(payload):.1f}x longer)")
+    print("device verified the image and is rebooting")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+プロファイラ（src/profiler.h）の出力をシンボル化し、フレームグラフ用の folded 形式にする
+
+シリアルのログ（'prof dump' を送ったあとの [prof] 行を含むもの）から最後のダンプを読み、
+PC と呼び出し元を ELF と突き合わせて（xtensa-esp32-elf-addr2line）1 行 1 スタックで出力する。
+  core1;loopTask;loop;updateDisplay;drawAudioVisualizer;sinf 412
+標準エラーには関数ごとの自己時間（スタックの先頭にいた割合）の上位をコアごとに出す。
+ELF はログを取ったときのビルドのものを使うこと（違うとでたらめな関数名になる）。
+
+使い方:
+  pio device monitor | tee prof.log    # 'prof dump' を送る
+  python3 tools/profile_fold.py prof.log > prof.folded
+  flamegraph.pl prof.folded > prof.svg
+"""
+import argparse
+import glob
+import os
+import re
+import shutil
+import subprocess
+import sys
+from collections import Counter, defaultdict
+
+PC_ISR = 1  # PROFILER_PC_ISR
+SAMPLE = re.compile(r"\[prof\] (\d+) (\d) (\S+) ([0-9a-f,]+)\s*$")
+DUMP_BEGIN = re.compile(r"\[prof\] dump begin: hz (\d+)")
+DUMP_END = "[prof] dump end"
+
+
+def find_addr2line():
+    name = "xtensa-esp32-elf-addr2line"
+    path = shutil.which(name)
+    if path:
+        return path
+    found = glob.glob(os.path.expanduser(f"~/.platformio/packages/toolchain-xtensa-esp32*/bin/{name}"))
+    return found[0] if found else None
+
+
+def read_dump(lines):
+    """最後のダンプの (回数, コア, タスク, [PC...]) のリストとサンプリング周波数"""
+    samples, hz, current = [], 0, None
+    for line in lines:
+        m = DUMP_BEGIN.search(line)
+        if m:
+            current, hz = [], int(m.group(1))
+            continue
+        if current is None:
+            continue
+        if DUMP_END in line:
+            samples, current = current, None
+            continue
+        m = SAMPLE.search(line)
+        if m:
+            pcs = [int(a, 16) for a in m.group(4).split(",")]
+            current.append((int(m.group(1)), int(m.group(2)), m.group(3), pcs))
+    if current:
+        samples = current  # ログが途中で終わっている
+    return samples, hz
+
+
+def symbolize(addr2line, elf, addresses, inline):
+    """番地 → 関数名のリスト（インライン展開を含め、呼び出し元が先）"""
+    names = {}
+    addresses = sorted(addresses)
+    args = [addr2line, "-e", elf, "-f", "-C", "-a"] + (["-i"] if inline else [])
+    for start in range(0, len(addresses), 500):
+        chunk = addresses[start:start + 500]
+        out = subprocess.run(args + [f"0x{a:08x}" for a in chunk], capture_output=True, text=True,
+                             check=True).stdout.splitlines()
+        # -a の番地の行で区切り、続く (関数名, ファイル:行) の組がインライン展開の内側から並ぶ
+        addr, funcs, lines = None, [], 0
+        for line in out + ["0xffffffff"]:
+            line = line.strip()
+            if lines % 2 == 0 and re.fullmatch(r"0x[0-9a-f]+", line):
+                if addr is not None:
+                    names[addr] = list(reversed(funcs)) or [f"0x{addr:08x}"]
+                addr, funcs, lines = int(line, 16), [], 0
+                continue
+            if lines % 2 == 0:
+                funcs.append(line if line != "??" else f"0x{addr:08x}")
+            lines += 1
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="シリアルのログ（省略時は標準入力）")
+    parser.add_argument("--elf", default=".pio/build/m5stack-core2-profiler/firmware.elf")
+    parser.add_argument("--addr2line", help="xtensa-esp32-elf-addr2line（省略時は PATH と ~/.platformio から探す）")
+    parser.add_argument("--no-inline", action="store_true", help="インライン展開された関数を展開しない")
+    parser.add_argument("--merge-cores", action="store_true", help="コアを区別しない")
+    parser.add_argument("--top", type=int, default=15, help="自己時間の上位をいくつ出すか")
+    args = parser.parse_args()
+
+    with (open(args.log, errors="replace") if args.log else sys.stdin) as f:
+        samples, hz = read_dump(f)
+    if not samples:
+        sys.exit("no '[prof] dump begin' ... '[prof] dump end' block in the log (send 'prof dump')")
+
+    addr2line = args.addr2line or find_addr2line()
+    if not addr2line:
+        sys.exit("xtensa-esp32-elf-addr2line not found (use --addr2line)")
+    if not os.path.exists(args.elf):
+        sys.exit(f"{args.elf}: no such ELF (use --elf)")
+    addresses = {a for _, _, _, pcs in samples for a in pcs if a != PC_ISR}
+    names = symbolize(addr2line, args.elf, addresses, not args.no_inline)
+    names[PC_ISR] = ["[other ISR]"]
+
+    folded = Counter()
+    self_time = defaultdict(Counter)
+    totals = Counter()
+    for count, core, task, pcs in samples:
+        frames = []
+        for pc in reversed(pcs):  # 呼び出し元から
+            frames += names.get(pc, [f"0x{pc:08x}"])
+        root = [task] if args.merge_cores else [f"core{core}", task]
+        folded[";".join(root + frames)] += count
+        self_time[core][names.get(pcs[0], [f"0x{pcs[0]:08x}"])[-1]] += count
+        totals[core] += count
+
+    for stack, count in sorted(folded.items()):
+        print(f"{stack} {count}")
+
+    for core in sorted(self_time):
+        seconds = totals[core] / hz if hz else 0
+        print(f"core {core}: {totals[core]} samples ({seconds:.1f} s)", file=sys.stderr)
+        for func, count in self_time[core].most_common(args.top):
+            print(f"  {100.0 * count / totals[core]:5.1f}%  {func}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()